@@ -208,6 +208,7 @@ static int64_t input_ts_offset = 0;
 static int file_overwrite = 0;
 static AVMetadata *metadata;
 static int do_benchmark = 0;
+static int do_thread_stats = 0;
 static int do_hex_dump = 0;
 static int do_pkt_dump = 0;
 static int do_psnr = 0;
@@ -229,6 +230,7 @@ static int opt_programid = 0;
 static int copy_initial_nonkeyframes = 0;
 
 static int rate_emu = 0;
+static int adaptive_decode = 0;
 
 static int  video_channel = 0;
 static char *video_standard;
@@ -940,7 +942,7 @@ need_realloc:
         if (ost->reformat_ctx)
             av_audio_convert_free(ost->reformat_ctx);
         ost->reformat_ctx = av_audio_convert_alloc(enc->sample_fmt, 1,
-                            dec->sample_fmt, 1, NULL, 0);
+                            dec->sample_fmt, 1, NULL, av_get_cpu_flags());
         if (!ost->reformat_ctx)
         {
             fprintf(stderr, "Cannot convert %s sample format to %s sample format\n",
@@ -1730,6 +1732,9 @@ handle_eof:
                 avpkt.dts = ist->pts;
                 pkt_pts = AV_NOPTS_VALUE;
 
+                if (rate_emu && adaptive_decode)
+                    ist->st->codec->frame_deadline = ist->start + ist->pts;
+
                 ret = avcodec_decode_video2(ist->st->codec,
                                             &picture, &got_picture, &avpkt);
                 ist->st->quality = picture.quality;
@@ -2156,6 +2161,41 @@ static void parse_forced_key_frames(char *kf, AVOutputStream *ost,
     }
 }
 
+static void print_thread_stats_line(const char *name, const AVCodecThreadStats *s)
+{
+    fprintf(stderr, "  %-5s %6d packets, decode %7.3fs (setup %4.1f%%), "
+            "%6d ref waits %7.3fs, worst %6.3fs on frame %d row %d field %d, "
+            "setup waits %7.3fs, output waits %7.3fs, %"PRId64" kB copied\n",
+            name, s->packets, s->decode_time / 1000000.0,
+            s->decode_time ? 100.0 * s->setup_time / s->decode_time : 0.0,
+            s->progress_waits, s->progress_wait_time / 1000000.0,
+            s->max_progress_wait / 1000000.0, s->max_wait_frame,
+            s->max_wait_row, s->max_wait_field,
+            s->setup_wait_time / 1000000.0, s->output_wait_time / 1000000.0,
+            s->bytes_copied >> 10);
+}
+
+static void print_thread_stats(AVInputStream *ist)
+{
+    AVCodecContext *dec = ist->st->codec;
+    AVCodecThreadStats stats;
+    char name[16];
+    int i;
+
+    if (avcodec_get_thread_stats(dec, -1, &stats) < 0)
+        return;
+
+    fprintf(stderr, "Input stream #%d.%d: frame threading with %d threads\n",
+            ist->file_index, ist->index, dec->thread_count);
+    for (i = 0; i < dec->thread_count; i++) {
+        AVCodecThreadStats s;
+        avcodec_get_thread_stats(dec, i, &s);
+        snprintf(name, sizeof(name), "#%d", i);
+        print_thread_stats_line(name, &s);
+    }
+    print_thread_stats_line("total", &stats);
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -3088,7 +3128,13 @@ discard_packet:
         ist = ist_table[i];
         if (ist->decoding_needed)
         {
-            avcodec_close(ist->st->codec);
+            AVCodecContext *dec = ist->st->codec;
+            if (dec->deadline_skip_loop_filter_count || dec->deadline_drop_count)
+                fprintf(stderr, "Input stream #%d.%d: %"PRId64" frames decoded without loop filter, %"PRId64" dropped to keep up\n",
+                        ist->file_index, ist->index, dec->deadline_skip_loop_filter_count, dec->deadline_drop_count);
+            if (do_thread_stats)
+                print_thread_stats(ist);
+            avcodec_close(dec);
         }
     }
 
@@ -4789,6 +4835,7 @@ static const OptionDef options[] =
         "benchmark", OPT_BOOL | OPT_EXPERT, {(void *)&do_benchmark},
         "add timings for benchmarking"
     },
+    { "threadstats", OPT_BOOL | OPT_EXPERT, {(void *)&do_thread_stats}, "print frame threading statistics of the decoders" },
     { "timelimit", OPT_FUNC2 | HAS_ARG, {(void *)opt_timelimit}, "set max runtime in seconds", "limit" },
     {
         "dump", OPT_BOOL | OPT_EXPERT, {(void *)&do_pkt_dump},
@@ -4799,6 +4846,7 @@ static const OptionDef options[] =
         "when dumping packets, also dump the payload"
     },
     { "re", OPT_BOOL | OPT_EXPERT, {(void *)&rate_emu}, "read input at native frame rate", "" },
+    { "adaptive_decode", OPT_BOOL | OPT_EXPERT, {(void *)&adaptive_decode}, "with -re, lower the video decoding quality while decoding falls behind", "" },
     { "loop_input", OPT_BOOL | OPT_EXPERT, {(void *)&loop_input}, "loop (current only works with images)" },
     { "loop_output", HAS_ARG | OPT_INT | OPT_EXPERT, {(void *)&loop_output}, "number of times to loop output in formats that support looping (0 loops forever)", "" },
     { "v", HAS_ARG | OPT_FUNC2, {(void *)opt_verbose}, "set ffmpeg verbosity level", "number" },
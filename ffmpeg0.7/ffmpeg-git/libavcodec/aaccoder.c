@@ -127,10 +127,10 @@ static av_always_inline float quantize_and_encode_band_cost_template(
         return cost * lambda;
     }
     if (!scaled) {
-        abs_pow34_v(s->scoefs, in, size);
+        s->abs_pow34(s->scoefs, in, size);
         scaled = s->scoefs;
     }
-    quantize_bands(s->qcoefs, in, scaled, size, Q34, !BT_UNSIGNED, maxval);
+    s->quant_bands(s->qcoefs, in, scaled, size, Q34, !BT_UNSIGNED, maxval);
     if (BT_UNSIGNED) {
         off = 0;
     } else {
@@ -319,7 +319,7 @@ static void encode_window_bands_info(AACEncContext *s, SingleChannelElement *sce
     float next_minrd = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = 0.0f;
@@ -421,7 +421,7 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
     float next_minrd = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = run_bits+4;
@@ -597,7 +597,7 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     idx = 1;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0; g < sce->ics.num_swb; g++) {
@@ -633,7 +633,7 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
                 maxscale = coef2maxsf(qmax);
                 minscale = av_clip(minscale - q0, 0, TRELLIS_STATES - 1);
                 maxscale = av_clip(maxscale - q0, 0, TRELLIS_STATES);
-                maxval = find_max_val(sce->ics.group_len[w], sce->ics.swb_sizes[g], s->scoefs+start);
+                maxval = s->find_max_val(sce->ics.group_len[w], sce->ics.swb_sizes[g], s->scoefs+start);
                 for (q = minscale; q < maxscale; q++) {
                     float dist = 0;
                     int cb = find_min_book(maxval, sce->sf_idx[w*16+g]);
@@ -738,13 +738,13 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
 
     if (!allz)
         return;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
 
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0;  g < sce->ics.num_swb; g++) {
             const float *scaled = s->scoefs + start;
-            maxvals[w*16+g] = find_max_val(sce->ics.group_len[w], sce->ics.swb_sizes[g], scaled);
+            maxvals[w*16+g] = s->find_max_val(sce->ics.group_len[w], sce->ics.swb_sizes[g], scaled);
             start += sce->ics.swb_sizes[g];
         }
     }
@@ -919,7 +919,7 @@ static void search_for_quantizers_faac(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     memset(sce->sf_idx, 0, sizeof(sce->sf_idx));
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0;  g < sce->ics.num_swb; g++) {
@@ -1060,10 +1060,10 @@ static void search_for_ms(AACEncContext *s, ChannelElement *cpe,
                         S[i] =  M[i]
                               - sce1->coeffs[start+w2*128+i];
                     }
-                    abs_pow34_v(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(M34, M,                         sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(S34, S,                         sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(M34, M,                         sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(S34, S,                         sce0->ics.swb_sizes[g]);
                     dist1 += quantize_band_cost(s, sce0->coeffs + start + w2*128,
                                                 L34,
                                                 sce0->ics.swb_sizes[g],
@@ -1096,6 +1096,17 @@ static void search_for_ms(AACEncContext *s, ChannelElement *cpe,
     }
 }
 
+av_cold void ff_aac_coder_init(AACEncContext *s)
+{
+    s->abs_pow34    = abs_pow34_v;
+    s->quant_bands  = quantize_bands;
+    s->find_max_val = find_max_val;
+
+#if HAVE_MMX
+    ff_aac_coder_init_x86(s);
+#endif
+}
+
 AACCoefficientsEncoder ff_aac_coders[] = {
     {
         search_for_quantizers_faac,
@@ -190,6 +190,7 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     s->samplerate_index = i;
 
     dsputil_init(&s->dsp, avctx);
+    ff_aac_coder_init(s);
     ff_mdct_init(&s->mdct1024, 11, 0, 1.0);
     ff_mdct_init(&s->mdct128,   8, 0, 1.0);
     // window init
@@ -216,6 +217,20 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
 
     ff_aac_tableinit();
 
+    /* each thread needs its own scratch buffers for the quantizer search */
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        s->thread_context = av_mallocz(avctx->thread_count * sizeof(*s->thread_context));
+        if (!s->thread_context)
+            return AVERROR(ENOMEM);
+        s->thread_context[0] = s;
+        for (i = 1; i < avctx->thread_count; i++) {
+            s->thread_context[i] = av_malloc(sizeof(*s));
+            if (!s->thread_context[i])
+                return AVERROR(ENOMEM);
+            memcpy(s->thread_context[i], s, sizeof(*s));
+        }
+    }
+
     return 0;
 }
 
@@ -483,6 +498,53 @@ static void put_bitstream_info(AVCodecContext *avctx, AACEncContext *s,
     put_bits(&s->pb, 12 - padbits, 0);
 }
 
+/**
+ * Search the quantizers of a channel element and choose its stereo coding.
+ * Channel elements do not depend on each other, so this runs on the slice
+ * threads, one element per job.
+ */
+static int search_channel_element(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    const float lambda = s->lambda;
+    const uint8_t *chan_map = aac_chan_configs[avctx->channels-1];
+    FFPsyWindowInfo *wi = arg;
+    ChannelElement *cpe = &s->cpe[jobnr];
+    int i, j, chans;
+
+    if (s->thread_context)
+        s = s->thread_context[threadnr];
+
+    for (i = 0; i < jobnr; i++)
+        wi += chan_map[i+1] == TYPE_CPE ? 2 : 1;
+    chans = chan_map[jobnr+1] == TYPE_CPE ? 2 : 1;
+
+    for (j = 0; j < chans; j++) {
+        s->cur_channel = wi - (FFPsyWindowInfo*)arg + j;
+        ff_psy_set_band_info(&s->psy, s->cur_channel, cpe->ch[j].coeffs, &wi[j]);
+        s->coder->search_for_quantizers(avctx, s, &cpe->ch[j], lambda);
+    }
+    cpe->common_window = 0;
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (j = 0; j < wi[0].num_windows; j++) {
+            if (wi[0].grouping[j] != wi[1].grouping[j]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    s->cur_channel = wi - (FFPsyWindowInfo*)arg;
+    if (cpe->common_window && s->coder->search_for_ms)
+        s->coder->search_for_ms(s, cpe, lambda);
+    adjust_frame_information(s, cpe, chans);
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx,
                             uint8_t *frame, int buf_size, void *data)
 {
@@ -557,40 +619,18 @@ static int aac_encode_frame(AVCodecContext *avctx,
     }
     do {
         int frame_bits;
+        avctx->execute2(avctx, search_channel_element, windows, NULL, chan_map[0]);
         init_put_bits(&s->pb, frame, buf_size*8);
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(avctx, s, LIBAVCODEC_IDENT);
         start_ch = 0;
         memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < chan_map[0]; i++) {
-            FFPsyWindowInfo* wi = windows + start_ch;
             tag      = chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (j = 0; j < chans; j++) {
-                s->cur_channel = start_ch + j;
-                ff_psy_set_band_info(&s->psy, s->cur_channel, cpe->ch[j].coeffs, &wi[j]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[j], s->lambda);
-            }
-            cpe->common_window = 0;
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (j = 0; j < wi[0].num_windows; j++) {
-                    if (wi[0].grouping[j] != wi[1].grouping[j]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            s->cur_channel = start_ch;
-            if (cpe->common_window && s->coder->search_for_ms)
-                s->coder->search_for_ms(s, cpe, s->lambda);
-            adjust_frame_information(s, cpe, chans);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -641,6 +681,12 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     ff_psy_preprocess_end(s->psypp);
     av_freep(&s->samples);
     av_freep(&s->cpe);
+    if (s->thread_context) {
+        int i;
+        for (i = 1; i < avctx->thread_count; i++)
+            av_freep(&s->thread_context[i]);
+        av_freep(&s->thread_context);
+    }
     return 0;
 }
 
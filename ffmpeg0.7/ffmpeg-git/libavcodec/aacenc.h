@@ -63,8 +63,18 @@ typedef struct AACEncContext {
     int cur_channel;
     int last_frame;
     float lambda;
+    struct AACEncContext **thread_context;       ///< contexts for the channel element search on each thread, [0] is this one
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(16, float, scoefs)[1024];    ///< scaled coefficients
+
+    /* band sizes are multiples of 4 */
+    void (*abs_pow34)(float *out, const float *in, int size);
+    void (*quant_bands)(int *out, const float *in, const float *scaled,
+                        int size, float Q34, int is_signed, int maxval);
+    float (*find_max_val)(int group_len, int swb_size, const float *scaled);
 } AACEncContext;
 
+void ff_aac_coder_init(AACEncContext *s);
+void ff_aac_coder_init_x86(AACEncContext *s);
+
 #endif /* AVCODEC_AACENC_H */
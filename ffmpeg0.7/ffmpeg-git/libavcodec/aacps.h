@@ -26,6 +26,7 @@
 
 #include "avcodec.h"
 #include "get_bits.h"
+#include "psdsp.h"
 
 #define PS_MAX_NUM_ENV 5
 #define PS_MAX_NR_IIDICC 34
@@ -72,6 +73,7 @@ typedef struct {
     float  H22[2][PS_MAX_NUM_ENV+1][PS_MAX_NR_IIDICC];
     int8_t opd_hist[PS_MAX_NR_IIDICC];
     int8_t ipd_hist[PS_MAX_NR_IIDICC];
+    PSDSPContext dsp;
 } PSContext;
 
 void ff_ps_init(void);
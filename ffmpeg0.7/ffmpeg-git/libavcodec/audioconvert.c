@@ -25,8 +25,10 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
+#include <string.h>
 #include "libavutil/avstring.h"
 #include "libavutil/libm.h"
+#include "libavutil/mathematics.h"
 #include "libavutil/samplefmt.h"
 #include "avcodec.h"
 #include "audioconvert.h"
@@ -79,24 +81,91 @@ int avcodec_channel_layout_num_channels(int64_t channel_layout)
 }
 #endif
 
+/* frames converted at once when the samples go through a buffer */
+#define BLOCK_SIZE 256
+
+typedef struct SampleConv {
+    enum AVSampleFormat out_fmt, in_fmt;
+    int out_size, in_size;      ///< bytes per sample
+    int fmt_pair;
+    /** conversion of len contiguous samples, len a multiple of 8, or NULL */
+    void (*simd)(uint8_t *po, const uint8_t *pi, int len);
+} SampleConv;
+
 struct AVAudioConvert {
     int in_channels, out_channels;
-    int fmt_pair;
+    AudioConvertDSPContext dsp;
+    SampleConv conv;            ///< in_fmt to out_fmt
+    int mix;                    ///< the channels go through matrix
+    float matrix[6][6];         ///< mixing coefficients, [out][in]
+    SampleConv to_flt;          ///< in_fmt to float, for mixing
+    SampleConv from_flt;        ///< float to out_fmt, for mixing
 };
 
+static void init_conv(SampleConv *c, const AudioConvertDSPContext *dsp,
+                      enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt)
+{
+    c->out_fmt  = out_fmt;
+    c->in_fmt   = in_fmt;
+    c->out_size = av_get_bits_per_sample_fmt(out_fmt) >> 3;
+    c->in_size  = av_get_bits_per_sample_fmt(in_fmt)  >> 3;
+    c->fmt_pair = out_fmt + AV_SAMPLE_FMT_NB*in_fmt;
+    c->simd     = dsp->conv[out_fmt][in_fmt];
+}
+
+/**
+ * Set the mixing coefficients used when no matrix is given.
+ * The 5.1 downmix is scaled so that it cannot clip.
+ */
+static int default_matrix(float m[6][6], int out_channels, int in_channels)
+{
+    if (in_channels == 2 && out_channels == 1) {
+        m[0][0] = m[0][1] = 0.5;
+    } else if (in_channels == 1 && out_channels == 2) {
+        m[0][0] = m[1][0] = 1.0;
+    } else if (in_channels == 6 && out_channels == 2) {
+        /* FL FR FC LFE BL BR, center and surround at -3dB */
+        float norm = 1.0 / (1.0 + 2 * M_SQRT1_2);
+        m[0][0] = m[1][1] = norm;
+        m[0][2] = m[1][2] = M_SQRT1_2 * norm;
+        m[0][4] = m[1][5] = M_SQRT1_2 * norm;
+    } else
+        return -1;
+    return 0;
+}
+
 AVAudioConvert *av_audio_convert_alloc(enum AVSampleFormat out_fmt, int out_channels,
                                        enum AVSampleFormat in_fmt, int in_channels,
                                        const float *matrix, int flags)
 {
     AVAudioConvert *ctx;
-    if (in_channels!=out_channels)
-        return NULL;  /* FIXME: not supported */
-    ctx = av_malloc(sizeof(AVAudioConvert));
+    int i, j;
+
+    if (in_channels < 1 || in_channels > 6 || out_channels < 1 || out_channels > 6)
+        return NULL;
+    ctx = av_mallocz(sizeof(AVAudioConvert));
     if (!ctx)
         return NULL;
     ctx->in_channels = in_channels;
     ctx->out_channels = out_channels;
-    ctx->fmt_pair = out_fmt + AV_SAMPLE_FMT_NB*in_fmt;
+#if HAVE_MMX
+    ff_audio_convert_init_x86(&ctx->dsp, flags);
+#endif
+    init_conv(&ctx->conv, &ctx->dsp, out_fmt, in_fmt);
+
+    if (matrix || in_channels != out_channels) {
+        ctx->mix = 1;
+        if (matrix) {
+            for (j = 0; j < out_channels; j++)
+                for (i = 0; i < in_channels; i++)
+                    ctx->matrix[j][i] = matrix[j * in_channels + i];
+        } else if (default_matrix(ctx->matrix, out_channels, in_channels) < 0) {
+            av_free(ctx);
+            return NULL;
+        }
+        init_conv(&ctx->to_flt,   &ctx->dsp, AV_SAMPLE_FMT_FLT, in_fmt);
+        init_conv(&ctx->from_flt, &ctx->dsp, out_fmt, AV_SAMPLE_FMT_FLT);
+    }
     return ctx;
 }
 
@@ -105,59 +174,496 @@ void av_audio_convert_free(AVAudioConvert *ctx)
     av_free(ctx);
 }
 
+static int convert_samples_c(int fmt_pair, uint8_t *po, int os,
+                             const uint8_t *pi, int is, int len)
+{
+    uint8_t *end= po + os*len;
+
+#define CONV(ofmt, otype, ifmt, expr)\
+if(fmt_pair == ofmt + AV_SAMPLE_FMT_NB*ifmt){\
+    while(po < end){\
+        *(otype*)po = expr; pi += is; po += os;\
+    }\
+}
+
+//FIXME put things below under ifdefs so we do not waste space for cases no codec will need
+//FIXME rounding ?
+
+         CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_U8 ,  *(const uint8_t*)pi)
+    else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)<<8)
+    else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)<<24)
+    else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)*(1.0 / (1<<7)))
+    else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)*(1.0 / (1<<7)))
+    else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_S16, (*(const int16_t*)pi>>8) + 0x80)
+    else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_S16,  *(const int16_t*)pi)
+    else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_S16,  *(const int16_t*)pi<<16)
+    else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_S16,  *(const int16_t*)pi*(1.0 / (1<<15)))
+    else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_S16,  *(const int16_t*)pi*(1.0 / (1<<15)))
+    else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_S32, (*(const int32_t*)pi>>24) + 0x80)
+    else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_S32,  *(const int32_t*)pi>>16)
+    else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_S32,  *(const int32_t*)pi)
+    else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1U<<31)))
+    else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1U<<31)))
+    else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_FLT, av_clip_uint8(  lrintf(*(const float*)pi * (1<<7)) + 0x80))
+    else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_FLT, av_clip_int16(  lrintf(*(const float*)pi * (1<<15))))
+    else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_FLT, av_clipl_int32(llrintf(*(const float*)pi * (1U<<31))))
+    else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_FLT, *(const float*)pi)
+    else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_FLT, *(const float*)pi)
+    else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_DBL, av_clip_uint8(  lrint(*(const double*)pi * (1<<7)) + 0x80))
+    else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_DBL, av_clip_int16(  lrint(*(const double*)pi * (1<<15))))
+    else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_DBL, av_clipl_int32(llrint(*(const double*)pi * (1U<<31))))
+    else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_DBL, *(const double*)pi)
+    else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_DBL, *(const double*)pi)
+    else return -1;
+    return 0;
+}
+
+/**
+ * Convert len samples, with SIMD if they are contiguous.
+ */
+static int convert_samples(const SampleConv *c, uint8_t *po, int os,
+                           const uint8_t *pi, int is, int len)
+{
+    if (is == c->in_size && os == c->out_size) {
+        if (c->in_fmt == c->out_fmt) {
+            memcpy(po, pi, len * os);
+            return 0;
+        }
+        if (c->simd && len >= 8) {
+            int n = len & ~7;
+            c->simd(po, pi, n);
+            po  += n * os;
+            pi  += n * is;
+            len -= n;
+        }
+    }
+    return convert_samples_c(c->fmt_pair, po, os, pi, is, len);
+}
+
+static void unzip(const AudioConvertDSPContext *dsp, uint8_t *out0, uint8_t *out1,
+                  const uint8_t *in, int size, int len)
+{
+    int i = 0;
+
+    if (size == 2) {
+        if (dsp->unzip16 && len >= 8)
+            dsp->unzip16((int16_t*)out0, (int16_t*)out1, (const int16_t*)in, i = len & ~7);
+        for (; i < len; i++) {
+            ((int16_t*)out0)[i] = ((const int16_t*)in)[2*i  ];
+            ((int16_t*)out1)[i] = ((const int16_t*)in)[2*i+1];
+        }
+    } else if (size == 4) {
+        if (dsp->unzip32 && len >= 8)
+            dsp->unzip32((int32_t*)out0, (int32_t*)out1, (const int32_t*)in, i = len & ~7);
+        for (; i < len; i++) {
+            ((int32_t*)out0)[i] = ((const int32_t*)in)[2*i  ];
+            ((int32_t*)out1)[i] = ((const int32_t*)in)[2*i+1];
+        }
+    } else if (size == 8) {
+        for (; i < len; i++) {
+            ((uint64_t*)out0)[i] = ((const uint64_t*)in)[2*i  ];
+            ((uint64_t*)out1)[i] = ((const uint64_t*)in)[2*i+1];
+        }
+    } else {
+        for (; i < len; i++) {
+            memcpy(out0 + i*size, in + (2*i  )*size, size);
+            memcpy(out1 + i*size, in + (2*i+1)*size, size);
+        }
+    }
+}
+
+static void zip(const AudioConvertDSPContext *dsp, uint8_t *out,
+                const uint8_t *in0, const uint8_t *in1, int size, int len)
+{
+    int i = 0;
+
+    if (size == 2) {
+        if (dsp->zip16 && len >= 8)
+            dsp->zip16((int16_t*)out, (const int16_t*)in0, (const int16_t*)in1, i = len & ~7);
+        for (; i < len; i++) {
+            ((int16_t*)out)[2*i  ] = ((const int16_t*)in0)[i];
+            ((int16_t*)out)[2*i+1] = ((const int16_t*)in1)[i];
+        }
+    } else if (size == 4) {
+        if (dsp->zip32 && len >= 8)
+            dsp->zip32((int32_t*)out, (const int32_t*)in0, (const int32_t*)in1, i = len & ~7);
+        for (; i < len; i++) {
+            ((int32_t*)out)[2*i  ] = ((const int32_t*)in0)[i];
+            ((int32_t*)out)[2*i+1] = ((const int32_t*)in1)[i];
+        }
+    } else if (size == 8) {
+        for (; i < len; i++) {
+            ((uint64_t*)out)[2*i  ] = ((const uint64_t*)in0)[i];
+            ((uint64_t*)out)[2*i+1] = ((const uint64_t*)in1)[i];
+        }
+    } else {
+        for (; i < len; i++) {
+            memcpy(out + (2*i  )*size, in0 + i*size, size);
+            memcpy(out + (2*i+1)*size, in1 + i*size, size);
+        }
+    }
+}
+
+/**
+ * Check if channels samples of size bytes are packed into frames.
+ */
+static int is_interleaved(const void * const *p, const int *stride,
+                          int channels, int size)
+{
+    int ch;
+    for (ch = 0; ch < channels; ch++)
+        if (!p[ch] || (const uint8_t*)p[ch] != (const uint8_t*)p[0] + ch*size ||
+            stride[ch] != channels*size)
+            return 0;
+    return 1;
+}
+
+static int is_planar(const void * const *p, const int *stride,
+                     int channels, int size)
+{
+    int ch;
+    for (ch = 0; ch < channels; ch++)
+        if (!p[ch] || stride[ch] != size)
+            return 0;
+    return 1;
+}
+
+/**
+ * Convert two channels which are interleaved on one side and planar on the
+ * other, going through a buffer in blocks.
+ * @return 1 if the channels were converted, 0 if they are not such a pair,
+ *         a negative value on error
+ */
+static int convert_pair(const AudioConvertDSPContext *dsp, const SampleConv *c,
+                        void * const *out, const int *out_stride,
+                        const void * const *in, const int *in_stride, int len)
+{
+    uint64_t buf[2][BLOCK_SIZE];
+    uint8_t *b0 = (uint8_t*)buf[0], *b1 = (uint8_t*)buf[1];
+    int i, n;
+
+    if (is_interleaved(in, in_stride, 2, c->in_size) &&
+        is_planar((const void * const *)out, out_stride, 2, c->out_size)) {
+        const uint8_t *pi = in[0];
+        if (c->in_fmt == c->out_fmt) {
+            unzip(dsp, out[0], out[1], pi, c->in_size, len);
+            return 1;
+        }
+        for (i = 0; i < len; i += BLOCK_SIZE) {
+            n = FFMIN(len - i, BLOCK_SIZE);
+            unzip(dsp, b0, b1, pi + 2*i*c->in_size, c->in_size, n);
+            if (convert_samples(c, (uint8_t*)out[0] + i*c->out_size, c->out_size,
+                                b0, c->in_size, n) < 0 ||
+                convert_samples(c, (uint8_t*)out[1] + i*c->out_size, c->out_size,
+                                b1, c->in_size, n) < 0)
+                return -1;
+        }
+        return 1;
+    }
+    if (is_planar(in, in_stride, 2, c->in_size) &&
+        is_interleaved((const void * const *)out, out_stride, 2, c->out_size)) {
+        uint8_t *po = out[0];
+        if (c->in_fmt == c->out_fmt) {
+            zip(dsp, po, in[0], in[1], c->out_size, len);
+            return 1;
+        }
+        for (i = 0; i < len; i += BLOCK_SIZE) {
+            n = FFMIN(len - i, BLOCK_SIZE);
+            if (convert_samples(c, b0, c->out_size, (const uint8_t*)in[0] + i*c->in_size,
+                                c->in_size, n) < 0 ||
+                convert_samples(c, b1, c->out_size, (const uint8_t*)in[1] + i*c->in_size,
+                                c->in_size, n) < 0)
+                return -1;
+            zip(dsp, po + 2*i*c->out_size, b0, b1, c->out_size, n);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Mix and convert in blocks, the samples stay in float in between.
+ */
+static int convert_mix(AVAudioConvert *ctx,
+                       void * const out[6], const int out_stride[6],
+                       const void * const in[6], const int in_stride[6], int len)
+{
+    float flt[6][BLOCK_SIZE], mix[BLOCK_SIZE];
+    uint64_t buf[2][BLOCK_SIZE];
+    int in_pair = ctx->in_channels == 2 &&
+                  is_interleaved(in, in_stride, 2, ctx->to_flt.in_size);
+    int i, j, k, n, pos;
+
+    for (pos = 0; pos < len; pos += BLOCK_SIZE) {
+        n = FFMIN(len - pos, BLOCK_SIZE);
+        if (in_pair) {
+            /* split the frames first so that the conversion gets contiguous samples */
+            unzip(&ctx->dsp, (uint8_t*)buf[0], (uint8_t*)buf[1],
+                  (const uint8_t*)in[0] + pos * in_stride[0], ctx->to_flt.in_size, n);
+            for (i = 0; i < 2; i++)
+                if (convert_samples(&ctx->to_flt, (uint8_t*)flt[i], sizeof(float),
+                                    (const uint8_t*)buf[i], ctx->to_flt.in_size, n) < 0)
+                    return -1;
+        } else {
+            for (i = 0; i < ctx->in_channels; i++)
+                if (convert_samples(&ctx->to_flt, (uint8_t*)flt[i], sizeof(float),
+                                    (const uint8_t*)in[i] + pos * in_stride[i],
+                                    in_stride[i], n) < 0)
+                    return -1;
+        }
+        for (j = 0; j < ctx->out_channels; j++) {
+            const float *m = ctx->matrix[j];
+            if (!out[j])
+                continue;
+            for (k = 0; k < n; k++)
+                mix[k] = m[0] * flt[0][k];
+            for (i = 1; i < ctx->in_channels; i++)
+                if (m[i])
+                    for (k = 0; k < n; k++)
+                        mix[k] += m[i] * flt[i][k];
+            if (convert_samples(&ctx->from_flt, (uint8_t*)out[j] + pos * out_stride[j],
+                                out_stride[j], (const uint8_t*)mix, sizeof(float), n) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
 int av_audio_convert(AVAudioConvert *ctx,
                            void * const out[6], const int out_stride[6],
                      const void * const  in[6], const int  in_stride[6], int len)
 {
-    int ch;
+    const SampleConv *c = &ctx->conv;
+    int ch, ret;
 
-    //FIXME optimize common cases
+    if (ctx->mix)
+        return convert_mix(ctx, out, out_stride, in, in_stride, len);
+
+    /* interleaved on both sides is one run of samples */
+    if (ctx->in_channels > 1 &&
+        is_interleaved(in,  in_stride,  ctx->in_channels,  c->in_size) &&
+        is_interleaved((const void * const *)out, out_stride, ctx->out_channels, c->out_size))
+        return convert_samples(c, out[0], c->out_size, in[0], c->in_size,
+                               ctx->in_channels * len);
 
     for(ch=0; ch<ctx->out_channels; ch++){
-        const int is=  in_stride[ch];
-        const int os= out_stride[ch];
-        const uint8_t *pi=  in[ch];
-        uint8_t *po= out[ch];
-        uint8_t *end= po + os*len;
         if(!out[ch])
             continue;
+        if (ch + 1 < ctx->out_channels) {
+            ret = convert_pair(&ctx->dsp, c, out + ch, out_stride + ch,
+                               in + ch, in_stride + ch, len);
+            if (ret < 0)
+                return -1;
+            if (ret) {
+                ch++;
+                continue;
+            }
+        }
+        if (convert_samples(c, out[ch], out_stride[ch], in[ch], in_stride[ch], len) < 0)
+            return -1;
+    }
+    return 0;
+}
 
-#define CONV(ofmt, otype, ifmt, expr)\
-if(ctx->fmt_pair == ofmt + AV_SAMPLE_FMT_NB*ifmt){\
-    do{\
-        *(otype*)po = expr; pi += is; po += os;\
-    }while(po < end);\
+#ifdef TEST
+#include <stdio.h>
+#include <sys/time.h>
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+
+#define MAX_LEN 1024
+
+static const enum AVSampleFormat formats[] = {
+    AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL,
+};
+
+static AVLFG prng;
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
 }
 
-//FIXME put things below under ifdefs so we do not waste space for cases no codec will need
-//FIXME rounding ?
+/**
+ * Fill buf with random samples, including values at and beyond full scale.
+ */
+static void fill(uint8_t *buf, enum AVSampleFormat fmt, int n)
+{
+    static const double special[] = { 0, 1, -1, 1.5, -1.5, 0.5 / (1 << 15),
+                                      (double)INT16_MAX / (1 << 15), 1000, -1000 };
+    int i;
 
-             CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_U8 ,  *(const uint8_t*)pi)
-        else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)<<8)
-        else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)<<24)
-        else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)*(1.0 / (1<<7)))
-        else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_U8 , (*(const uint8_t*)pi - 0x80)*(1.0 / (1<<7)))
-        else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_S16, (*(const int16_t*)pi>>8) + 0x80)
-        else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_S16,  *(const int16_t*)pi)
-        else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_S16,  *(const int16_t*)pi<<16)
-        else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_S16,  *(const int16_t*)pi*(1.0 / (1<<15)))
-        else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_S16,  *(const int16_t*)pi*(1.0 / (1<<15)))
-        else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_S32, (*(const int32_t*)pi>>24) + 0x80)
-        else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_S32,  *(const int32_t*)pi>>16)
-        else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_S32,  *(const int32_t*)pi)
-        else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1U<<31)))
-        else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1U<<31)))
-        else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_FLT, av_clip_uint8(  lrintf(*(const float*)pi * (1<<7)) + 0x80))
-        else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_FLT, av_clip_int16(  lrintf(*(const float*)pi * (1<<15))))
-        else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_FLT, av_clipl_int32(llrintf(*(const float*)pi * (1U<<31))))
-        else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_FLT, *(const float*)pi)
-        else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_FLT, *(const float*)pi)
-        else CONV(AV_SAMPLE_FMT_U8 , uint8_t, AV_SAMPLE_FMT_DBL, av_clip_uint8(  lrint(*(const double*)pi * (1<<7)) + 0x80))
-        else CONV(AV_SAMPLE_FMT_S16, int16_t, AV_SAMPLE_FMT_DBL, av_clip_int16(  lrint(*(const double*)pi * (1<<15))))
-        else CONV(AV_SAMPLE_FMT_S32, int32_t, AV_SAMPLE_FMT_DBL, av_clipl_int32(llrint(*(const double*)pi * (1U<<31))))
-        else CONV(AV_SAMPLE_FMT_FLT, float  , AV_SAMPLE_FMT_DBL, *(const double*)pi)
-        else CONV(AV_SAMPLE_FMT_DBL, double , AV_SAMPLE_FMT_DBL, *(const double*)pi)
-        else return -1;
+    for (i = 0; i < n; i++) {
+        unsigned r = av_lfg_get(&prng);
+        double   d = r / (double)UINT32_MAX * 2.2 - 1.1;
+        if (r % 16 == 0)
+            d = special[r / 16 % FF_ARRAY_ELEMS(special)];
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16: ((int16_t*)buf)[i] = r >> 16; break;
+        case AV_SAMPLE_FMT_S32: ((int32_t*)buf)[i] = r;       break;
+        case AV_SAMPLE_FMT_FLT: ((float  *)buf)[i] = d;       break;
+        case AV_SAMPLE_FMT_DBL: ((double *)buf)[i] = d;       break;
+        default: break;
+        }
     }
-    return 0;
 }
+
+/**
+ * Convert with the original per channel loops.
+ */
+static void convert_ref(const SampleConv *c, int channels,
+                        void * const out[6], const int out_stride[6],
+                        const void * const in[6], const int in_stride[6], int len)
+{
+    int ch;
+    for (ch = 0; ch < channels; ch++)
+        convert_samples_c(c->fmt_pair, out[ch], out_stride[ch],
+                          in[ch], in_stride[ch], len);
+}
+
+/**
+ * Set up 2 channels, interleaved or planar, in buf.
+ */
+static void layout(void *p[6], int stride[6], uint8_t *buf, int size, int interleaved)
+{
+    p[0]      = buf;
+    p[1]      = buf + (interleaved ? size : MAX_LEN * size);
+    stride[0] = stride[1] = interleaved ? 2 * size : size;
+}
+
+static int test_conversion(enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt)
+{
+    static uint8_t in_buf[2 * MAX_LEN * 8], ref_buf[2 * MAX_LEN * 8], out_buf[2 * MAX_LEN * 8];
+    AVAudioConvert *ctx = av_audio_convert_alloc(out_fmt, 2, in_fmt, 2, NULL,
+                                                 av_get_cpu_flags());
+    void *in[6], *ref[6], *out[6];
+    int in_stride[6], ref_stride[6], out_stride[6];
+    int it, len, errors = 0;
+
+    if (!ctx)
+        return 1;
+    for (it = 0; it < 64 && !errors; it++) {
+        int in_il  = it & 1, out_il = it >> 1 & 1;
+        len = it < 8 ? it + 1 : av_lfg_get(&prng) % MAX_LEN + 1;
+        fill(in_buf, in_fmt, 2 * MAX_LEN);
+        memset(ref_buf, 0, sizeof(ref_buf));
+        memset(out_buf, 0, sizeof(out_buf));
+        layout(in,  in_stride,  in_buf,  ctx->conv.in_size,  in_il);
+        layout(ref, ref_stride, ref_buf, ctx->conv.out_size, out_il);
+        layout(out, out_stride, out_buf, ctx->conv.out_size, out_il);
+        convert_ref(&ctx->conv, 2, ref, ref_stride, (const void **)in, in_stride, len);
+        if (av_audio_convert(ctx, out, out_stride, (const void **)in, in_stride, len) < 0 ||
+            memcmp(ref_buf, out_buf, sizeof(out_buf))) {
+            av_log(NULL, AV_LOG_ERROR, "%s -> %s, %s -> %s, %d samples differs\n",
+                   av_get_sample_fmt_name(in_fmt), av_get_sample_fmt_name(out_fmt),
+                   in_il ? "interleaved" : "planar", out_il ? "interleaved" : "planar", len);
+            errors++;
+        }
+    }
+    av_audio_convert_free(ctx);
+    return errors;
+}
+
+/**
+ * Mixing identical channels down or a channel up must keep the samples.
+ */
+static int test_mix(enum AVSampleFormat fmt, int out_channels, int in_channels)
+{
+    static int16_t src[MAX_LEN];
+    static uint8_t in_buf[6 * MAX_LEN * 8], out_buf[6 * MAX_LEN * 8], ref_buf[MAX_LEN * 8];
+    AVAudioConvert *ctx = av_audio_convert_alloc(fmt, out_channels, fmt, in_channels, NULL,
+                                                 av_get_cpu_flags());
+    SampleConv to_fmt;
+    void *in[6], *out[6];
+    int in_stride[6], out_stride[6];
+    int size = av_get_bits_per_sample_fmt(fmt) >> 3;
+    int ch, len = MAX_LEN - 3, errors = 0;
+
+    if (!ctx)
+        return 1;
+    fill((uint8_t*)src, AV_SAMPLE_FMT_S16, len);
+    init_conv(&to_fmt, &ctx->dsp, fmt, AV_SAMPLE_FMT_S16);
+    convert_samples_c(to_fmt.fmt_pair, ref_buf, size, (const uint8_t*)src, 2, len);
+    for (ch = 0; ch < in_channels; ch++) {
+        in[ch] = in_buf + ch * size;
+        in_stride[ch] = in_channels * size;
+        convert_samples_c(to_fmt.fmt_pair, in[ch], in_stride[ch],
+                          (const uint8_t*)src, 2, len);
+    }
+    for (ch = 0; ch < out_channels; ch++) {
+        out[ch] = out_buf + ch * MAX_LEN * size;
+        out_stride[ch] = size;
+    }
+    if (av_audio_convert(ctx, out, out_stride, (const void **)in, in_stride, len) < 0)
+        errors++;
+    for (ch = 0; ch < out_channels; ch++)
+        errors += !!memcmp(out[ch], ref_buf, len * size);
+    if (errors)
+        av_log(NULL, AV_LOG_ERROR, "%s mixing %d -> %d channels differs\n",
+               av_get_sample_fmt_name(fmt), in_channels, out_channels);
+    av_audio_convert_free(ctx);
+    return errors;
+}
+
+/**
+ * Time the original loops and av_audio_convert() on interleaved stereo
+ * input, to interleaved and to planar output.
+ */
+static void benchmark(enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt)
+{
+    static uint8_t in_buf[2 * MAX_LEN * 8], out_buf[2 * MAX_LEN * 8];
+    AVAudioConvert *ctx = av_audio_convert_alloc(out_fmt, 2, in_fmt, 2, NULL,
+                                                 av_get_cpu_flags());
+    void *in[6], *out[6];
+    int in_stride[6], out_stride[6];
+    int il, it, runs = 2000;
+
+    fill(in_buf, in_fmt, 2 * MAX_LEN);
+    layout(in, in_stride, in_buf, ctx->conv.in_size, 1);
+    for (il = 1; il >= 0; il--) {
+        int64_t t0, t1, t2;
+        layout(out, out_stride, out_buf, ctx->conv.out_size, il);
+        t0 = gettime();
+        for (it = 0; it < runs; it++)
+            convert_ref(&ctx->conv, 2, out, out_stride, (const void **)in, in_stride, MAX_LEN);
+        t1 = gettime();
+        for (it = 0; it < runs; it++)
+            av_audio_convert(ctx, out, out_stride, (const void **)in, in_stride, MAX_LEN);
+        t2 = gettime();
+        printf("%s -> %s %-11s %7.3f %7.3f ns/sample\n",
+               av_get_sample_fmt_name(in_fmt), av_get_sample_fmt_name(out_fmt),
+               il ? "interleaved" : "planar",
+               (t1 - t0) * 1000.0 / (runs * 2 * MAX_LEN),
+               (t2 - t1) * 1000.0 / (runs * 2 * MAX_LEN));
+    }
+    av_audio_convert_free(ctx);
+}
+
+/**
+ * Compare av_audio_convert() with the original conversion loops for all
+ * pairs of 16/32 bit and float formats, planar and interleaved.
+ * Only errors are printed, -b prints the time per sample of both instead.
+ */
+int main(int argc, char **argv)
+{
+    int i, j, errors = 0;
+
+    av_lfg_init(&prng, 1);
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+        printf("                              loops   convert\n");
+        for (i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+            for (j = 0; j < FF_ARRAY_ELEMS(formats); j++)
+                benchmark(formats[j], formats[i]);
+        return 0;
+    }
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        for (j = 0; j < FF_ARRAY_ELEMS(formats); j++)
+            errors += test_conversion(formats[j], formats[i]);
+        errors += test_mix(formats[i], 1, 2);
+        errors += test_mix(formats[i], 2, 1);
+    }
+    return !!errors;
+}
+#endif /* TEST */
@@ -91,7 +91,11 @@ typedef struct AVAudioConvert AVAudioConvert;
  * @param out_channels Number of output channels
  * @param in_fmt Input sample format
  * @param in_channels Number of input channels
- * @param[in] matrix Channel mixing matrix (of dimension in_channel*out_channels). Set to NULL to ignore.
+ * @param[in] matrix Channel mixing matrix (of dimension in_channel*out_channels),
+ *                   the coefficients of output channel j are at matrix[j*in_channels].
+ *                   Set to NULL to ignore. Without a matrix, stereo to mono,
+ *                   mono to stereo and 5.1 to stereo are mixed by default,
+ *                   other channel count changes are not supported.
  * @param flags See AV_CPU_FLAG_xx
  * @return NULL on error
  */
@@ -111,9 +115,33 @@ FFMPEGLIB_API void av_audio_convert_free(AVAudioConvert *ctx);
  * @param[in] in array of input buffers for each channel
  * @param[in] in_stride distance between consecutive input samples (measured in bytes)
  * @param len length of audio frame size (measured in samples)
+ *
+ * Channels are processed together when they are interleaved on both sides
+ * or when a pair of them is interleaved on one side only. Mixing goes
+ * through float.
  */
 FFMPEGLIB_API int av_audio_convert(AVAudioConvert *ctx,
                            void * const out[6], const int out_stride[6],
                      const void * const  in[6], const int  in_stride[6], int len);
 
+/**
+ * Optimized functions for contiguous samples. They work on a nonzero
+ * multiple of 8 samples or frames and are NULL where there is none.
+ */
+typedef struct AudioConvertDSPContext {
+    /** conversion of len samples, indexed by [out_fmt][in_fmt] */
+    void (*conv[AV_SAMPLE_FMT_NB][AV_SAMPLE_FMT_NB])(uint8_t *po, const uint8_t *pi, int len);
+    /** split len interleaved stereo frames */
+    void (*unzip16)(int16_t *out0, int16_t *out1, const int16_t *in, int len);
+    void (*unzip32)(int32_t *out0, int32_t *out1, const int32_t *in, int len);
+    /** interleave len stereo frames */
+    void (*zip16)(int16_t *out, const int16_t *in0, const int16_t *in1, int len);
+    void (*zip32)(int32_t *out, const int32_t *in0, const int32_t *in1, int len);
+} AudioConvertDSPContext;
+
+/**
+ * @param flags See AV_CPU_FLAG_xx
+ */
+void ff_audio_convert_init_x86(AudioConvertDSPContext *c, int flags);
+
 #endif /* AVCODEC_AUDIOCONVERT_H */
@@ -646,6 +646,8 @@ typedef struct RcOverride{
 #define CODEC_FLAG2_PSY           0x00080000 ///< Use psycho visual optimizations.
 #define CODEC_FLAG2_SSIM          0x00100000 ///< Compute SSIM during encoding, error[] values are undefined.
 #define CODEC_FLAG2_INTRA_REFRESH 0x00200000 ///< Use periodic insertion of intra blocks instead of keyframes.
+#define CODEC_FLAG2_LOW_MEMORY    0x00400000 ///< Reduce decoder memory use, possibly at some cost in speed.
+#define CODEC_FLAG2_PARALLEL_BRD  0x00800000 ///< Run the b_frame_strategy 2 trials in parallel, the chosen B-frame counts may differ.
 
 /* Unsupported options :
  *              Syntax Arithmetic coding (SAC)
@@ -711,6 +713,11 @@ typedef struct RcOverride{
  * Codec supports frame-level multithreading.
  */
 #define CODEC_CAP_FRAME_THREADS    0x1000
+/**
+ * Codec can run later passes over a frame, e.g. deblocking, on another
+ * thread, see FF_THREAD_PIPELINE.
+ */
+#define CODEC_CAP_PIPELINE_THREADS 0x2000
 
 //The following defines may change, don't expect compatibility if you use them.
 #define MB_TYPE_INTRA4x4   0x0001
@@ -2892,6 +2899,10 @@ typedef struct AVCodecContext {
      * Which multithreading methods to use.
      * Use of FF_THREAD_FRAME will increase decoding delay by one frame per thread,
      * so clients which cannot provide future frames should not use it.
+     * FF_THREAD_PIPELINE can be combined with either of the other two; it
+     * starts one more thread per decoding thread.
+     * Encoders use frame threads only if FF_THREAD_FRAME is the only type
+     * set, this increases the encoding delay by one frame per thread.
      *
      * - encoding: Set by user, otherwise the default is used.
      * - decoding: Set by user, otherwise the default is used.
@@ -2899,6 +2910,7 @@ typedef struct AVCodecContext {
     int thread_type;
 #define FF_THREAD_FRAME   1 //< Decode more than one frame at once
 #define FF_THREAD_SLICE   2 //< Decode more than one part of a single frame at once
+#define FF_THREAD_PIPELINE 4 //< Run later passes over a frame (e.g. deblocking) behind the decoding of it
 
     /**
      * Which multithreading methods are in use by the codec.
@@ -2942,6 +2954,48 @@ typedef struct AVCodecContext {
     int64_t pts_correction_last_pts;       /// PTS of the last frame
     int64_t pts_correction_last_dts;       /// DTS of the last frame
 
+    /**
+     * Time, in av_gettime() units, by which the next call to
+     * avcodec_decode_video2() has to return, 0 for none.
+     * While decoding misses its deadlines, decoders supporting it trade
+     * quality for speed in steps, see deadline_level.
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int64_t frame_deadline;
+
+    /**
+     * How much quality the decoder currently trades for speed to meet
+     * frame_deadline. Every late frame raises it by one step, it is
+     * lowered again one step at a time once frames are on time.
+     * - encoding: unused
+     * - decoding: Set by libavcodec.
+     */
+    int deadline_level;
+#define FF_DEADLINE_SKIP_LOOP_FILTER 1 ///< skip the loop filter of non-reference frames
+#define FF_DEADLINE_DROP_NONREF      2 ///< drop non-reference frames
+
+    /**
+     * Number of frames decoded without loop filter
+     * because of deadline_level.
+     * - encoding: unused
+     * - decoding: Set by libavcodec.
+     */
+    int64_t deadline_skip_loop_filter_count;
+
+    /**
+     * Number of frames dropped because of deadline_level.
+     * - encoding: unused
+     * - decoding: Set by libavcodec.
+     */
+    int64_t deadline_drop_count;
+
+    /**
+     * Number of frames on time since deadline_level was last changed.
+     * - decoding: maintained and used by libavcodec, not intended to be used by user apps
+     * - encoding: unused
+     */
+    int deadline_on_time;
 } AVCodecContext;
 
 /**
@@ -3014,6 +3068,13 @@ typedef struct AVCodec {
      */
     int (*update_thread_context)(AVCodecContext *dst, const AVCodecContext *src);
     /** @} */
+
+    /**
+     * If defined, return the number of bytes of tables and scratch buffers
+     * the codec has allocated for this context, not counting priv_data
+     * itself and the frame buffers.
+     */
+    int64_t (*memory_usage)(AVCodecContext *);
 } AVCodec;
 
 /**
@@ -3762,6 +3823,113 @@ FFMPEGLIB_API int avcodec_default_execute(AVCodecContext *c, int (*func)(AVCodec
 FFMPEGLIB_API int avcodec_default_execute2(AVCodecContext *c, int (*func)(AVCodecContext *c2, void *arg2, int, int),void *arg, int *ret, int count);
 //FIXME func typedef
 
+/**
+ * Statistics of the shared codec thread pool.
+ * New fields may be added to the end with minor version bumps.
+ */
+typedef struct AVCodecThreadPoolStats {
+    int nb_workers;             ///< number of worker threads
+    int active_workers;         ///< workers currently running a task
+    int users;                  ///< codec contexts currently using the pool
+    int queue_depth;            ///< tasks currently waiting in the pool queues
+    int max_queue_depth;        ///< highest queue_depth since the pool was started
+    uint64_t tasks_submitted;   ///< tasks queued since the pool was started
+    uint64_t tasks_run;         ///< tasks run by the workers
+    uint64_t steals;            ///< tasks a worker took from the queue of another worker
+} AVCodecThreadPoolStats;
+
+/**
+ * Pin worker thread n to CPU n modulo the number of CPUs.
+ */
+#define AVCODEC_THREAD_POOL_PIN 0x0001
+
+/**
+ * Start the process-wide codec thread pool.
+ *
+ * Codec contexts opened with thread_count > 1 while the pool is running
+ * do not create threads of their own. They run their execute()/execute2()
+ * jobs and their frame decoding tasks on the pool instead, with
+ * thread_count bounding how many of them run in parallel for that context.
+ * Contexts opened before the pool was started keep their private threads.
+ *
+ * Frame threading only uses the pool if get_buffer() is the default one or
+ * thread_safe_callbacks is set.
+ *
+ * @param nb_workers number of worker threads, 0 for one per CPU
+ * @param flags a combination of AVCODEC_THREAD_POOL_* flags
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+FFMPEGLIB_API int avcodec_thread_pool_init(int nb_workers, int flags);
+
+/**
+ * Stop the codec thread pool started with avcodec_thread_pool_init().
+ *
+ * @return 0 on success, AVERROR(EBUSY) if codec contexts still use the pool
+ */
+FFMPEGLIB_API int avcodec_thread_pool_uninit(void);
+
+/**
+ * Get the statistics of the codec thread pool.
+ *
+ * @return 0 on success, a negative AVERROR code if no pool is running
+ */
+FFMPEGLIB_API int avcodec_thread_pool_get_stats(AVCodecThreadPoolStats *stats);
+
+/**
+ * Memory used by a codec context, in bytes.
+ * New fields may be added to the end with minor version bumps.
+ */
+typedef struct AVCodecMemoryUsage {
+    int64_t contexts;           ///< AVCodecContext and private codec contexts, including frame thread copies
+    int64_t tables;             ///< tables and scratch buffers allocated by the codec
+    int64_t frames;             ///< frame buffers allocated by the default get_buffer()
+    int64_t total;              ///< sum of the above
+} AVCodecMemoryUsage;
+
+/**
+ * Get the memory currently used by an opened codec context and its
+ * threads. The numbers are computed from the allocation sizes and are
+ * only approximate, codecs without a memory_usage callback only report
+ * their contexts and frames.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+FFMPEGLIB_API int avcodec_get_memory_usage(AVCodecContext *avctx, AVCodecMemoryUsage *usage);
+
+/**
+ * Frame threading statistics of one decoding thread, see
+ * avcodec_get_thread_stats(). All times are in microseconds.
+ */
+typedef struct AVCodecThreadStats {
+    int packets;                ///< number of packets decoded, including the empty ones flushing delayed frames
+    int64_t decode_time;        ///< time spent in AVCodec.decode()
+    int64_t setup_time;         ///< time from the start of decode() until ff_thread_finish_setup()
+    int64_t progress_wait_time; ///< time spent waiting for reference frames to be decoded
+    int progress_waits;         ///< number of waits for reference frames that blocked
+    int64_t max_progress_wait;  ///< longest single wait for a reference frame
+    int max_wait_frame;         ///< coded_picture_number of the reference frame of the longest wait
+    int max_wait_row;           ///< progress (row) waited for in the longest wait
+    int max_wait_field;         ///< field waited for in the longest wait
+    int64_t setup_wait_time;    ///< time the frame waited for the previous thread to finish setup before it could start
+    int64_t output_wait_time;   ///< time the caller waited for this thread to return a frame
+    int64_t bytes_copied;       ///< bytes copied by update_thread_context() into this thread
+} AVCodecThreadStats;
+
+/**
+ * Get the frame threading statistics of a decoder. They are collected
+ * for every decoder using frame threading and explain how well it
+ * scales: most time spent in setup_wait_time and progress_wait_time
+ * means the threads are serialized by the bitstream or by reference
+ * frame dependencies.
+ *
+ * @param thread index of the thread, or -1 for the sum over all threads;
+ *               max_* fields are then taken from the thread with the
+ *               longest wait
+ * @return 0 on success, AVERROR(EINVAL) if avctx does not use frame
+ *         threading or thread is out of range
+ */
+FFMPEGLIB_API int avcodec_get_thread_stats(AVCodecContext *avctx, int thread, AVCodecThreadStats *stats);
+
 /**
  * Initialize the AVCodecContext to use the given AVCodec. Prior to using this
  * function the context has to be allocated.
@@ -270,7 +270,12 @@ static void refill(CABACContext *c){
     c->bytestream+= CABAC_BITS/8;
 }
 
-#if ! ( ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS) )
+#if ARCH_X86_64 && HAVE_INLINE_ASM
+#   include "x86/cabac.h"
+#endif
+
+#if !defined(get_cabac_inline) && \
+    !( ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS) )
 static void refill2(CABACContext *c){
     int i, x;
 
@@ -368,6 +373,7 @@ static inline void renorm_cabac_decoder_once(CABACContext *c){
         refill(c);
 }
 
+#ifndef get_cabac_inline
 static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const state){
     //FIXME gcc generates duplicate load/stores for c->low and c->range
 #define LOW          "0"
@@ -579,6 +585,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
 #endif /* ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS) */
     return bit;
 }
+#endif /* get_cabac_inline */
 
 static int av_noinline av_unused get_cabac_noinline(CABACContext *c, uint8_t * const state){
     return get_cabac_inline(c,state);
@@ -588,6 +595,7 @@ static int av_unused get_cabac(CABACContext *c, uint8_t * const state){
     return get_cabac_inline(c,state);
 }
 
+#ifndef get_cabac_bypass
 static int av_unused get_cabac_bypass(CABACContext *c){
 #if 0 //not faster
     int bit;
@@ -634,8 +642,10 @@ static int av_unused get_cabac_bypass(CABACContext *c){
     }
 #endif
 }
+#endif /* get_cabac_bypass */
 
 
+#ifndef get_cabac_bypass_sign
 static av_always_inline int get_cabac_bypass_sign(CABACContext *c, int val){
 #if ARCH_X86 && HAVE_EBX_AVAILABLE
     __asm__ volatile(
@@ -682,6 +692,7 @@ static av_always_inline int get_cabac_bypass_sign(CABACContext *c, int val){
     return (val^mask)-mask;
 #endif
 }
+#endif /* get_cabac_bypass_sign */
 
 /**
  *
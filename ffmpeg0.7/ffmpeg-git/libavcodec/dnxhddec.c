@@ -27,6 +27,7 @@
 #include "get_bits.h"
 #include "dnxhddata.h"
 #include "dsputil.h"
+#include "thread.h"
 
 typedef struct {
     AVCodecContext *avctx;
@@ -60,6 +61,15 @@ static av_cold int dnxhd_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int dnxhd_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    DNXHDContext *ctx = avctx->priv_data;
+
+    ctx->avctx = avctx;
+    avctx->coded_frame = &ctx->picture;
+    return 0;
+}
+
 static int dnxhd_init_vlc(DNXHDContext *ctx, int cid)
 {
     if (!ctx->cid_table) {
@@ -313,8 +323,8 @@ static int dnxhd_decode_frame(AVCodecContext *avctx, void *data, int *data_size,
 
     if (first_field) {
         if (ctx->picture.data[0])
-            avctx->release_buffer(avctx, &ctx->picture);
-        if (avctx->get_buffer(avctx, &ctx->picture) < 0) {
+            ff_thread_release_buffer(avctx, &ctx->picture);
+        if (ff_thread_get_buffer(avctx, &ctx->picture) < 0) {
             av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
             return -1;
         }
@@ -355,6 +365,7 @@ AVCodec ff_dnxhd_decoder = {
     NULL,
     dnxhd_decode_close,
     dnxhd_decode_frame,
-    CODEC_CAP_DR1,
+    CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
     .long_name = NULL_IF_CONFIG_SMALL("VC3/DNxHD"),
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(dnxhd_decode_init_thread_copy),
 };
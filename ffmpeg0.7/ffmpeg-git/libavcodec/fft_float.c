@@ -24,10 +24,15 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include "libavutil/cpu.h"
 #include "libavutil/mathematics.h"
 #include "fft.h"
 #include "fft-internal.h"
 
+#if ARCH_X86
+#include "x86/fft_float.h"
+#endif
+
 /* cos(2*pi*x/n) for 0<=x<=n/4, followed by its reverse */
 #if !CONFIG_HARDCODED_TABLES
 COSTABLE(16);
@@ -63,6 +68,9 @@ COSTABLE_CONST FFTSample * const FFT_NAME(ff_cos_tabs)[] = {
 
 static void ff_fft_permute_c(FFTContext *s, FFTComplex *z);
 static void ff_fft_calc_c(FFTContext *s, FFTComplex *z);
+#ifdef fft_pass_simd
+static void fft_calc_simd(FFTContext *s, FFTComplex *z);
+#endif
 
 static int split_radix_permutation(int i, int n, int inverse)
 {
@@ -119,6 +127,10 @@ av_cold int ff_fft_init(FFTContext *s, int nbits, int inverse)
 	//if (ARCH_ARM)     ff_fft_init_arm(s);
 	//if (HAVE_ALTIVEC) ff_fft_init_altivec(s);
 	//if (HAVE_MMX)     ff_fft_init_mmx(s);
+#ifdef fft_pass_simd
+	if (av_get_cpu_flags() & fft_pass_simd_flags)
+		s->fft_calc = fft_calc_simd;
+#endif
 	if (CONFIG_MDCT)  s->mdct_calcw = s->mdct_calc;
 #else
 	if (CONFIG_MDCT)  s->mdct_calcw = ff_mdct_calcw_c;
@@ -314,3 +326,42 @@ static void ff_fft_calc_c(FFTContext *s, FFTComplex *z)
 	fft_dispatch[s->nbits-2](z);
 }
 
+#ifdef fft_pass_simd
+/* same recursion as above, with the passes of 32 points and up in SIMD */
+#define DECL_FFT_SIMD(n,n2,n4)\
+	static void fft##n##_simd(FFTComplex *z)\
+{\
+	fft##n2##_simd(z);\
+	fft##n4##_simd(z+n4*2);\
+	fft##n4##_simd(z+n4*3);\
+	fft_pass_simd(z,FFT_NAME(ff_cos_##n),n4/2);\
+}
+
+#define fft4_simd  fft4
+#define fft8_simd  fft8
+#define fft16_simd fft16
+DECL_FFT_SIMD(32,16,8)
+DECL_FFT_SIMD(64,32,16)
+DECL_FFT_SIMD(128,64,32)
+DECL_FFT_SIMD(256,128,64)
+DECL_FFT_SIMD(512,256,128)
+DECL_FFT_SIMD(1024,512,256)
+DECL_FFT_SIMD(2048,1024,512)
+DECL_FFT_SIMD(4096,2048,1024)
+DECL_FFT_SIMD(8192,4096,2048)
+DECL_FFT_SIMD(16384,8192,4096)
+DECL_FFT_SIMD(32768,16384,8192)
+DECL_FFT_SIMD(65536,32768,16384)
+
+static void (* const fft_dispatch_simd[])(FFTComplex*) = {
+	fft4, fft8, fft16, fft32_simd, fft64_simd, fft128_simd, fft256_simd,
+	fft512_simd, fft1024_simd, fft2048_simd, fft4096_simd, fft8192_simd,
+	fft16384_simd, fft32768_simd, fft65536_simd,
+};
+
+static void fft_calc_simd(FFTContext *s, FFTComplex *z)
+{
+	fft_dispatch_simd[s->nbits-2](z);
+}
+#endif
+
@@ -89,6 +89,13 @@ typedef struct FLACFrameInfo {
                                          frame_or_sample_num             */
 } FLACFrameInfo;
 
+typedef struct FLACEncDSPContext {
+    /**
+     * Sum of the residual folded to unsigned values and shifted right by k.
+     */
+    uint32_t (*rice_sum)(const int32_t *res, int n, int k);
+} FLACEncDSPContext;
+
 /**
  * Parse the Streaminfo metadata block
  * @param[out] avctx   codec context to set basic stream parameters
@@ -137,4 +144,7 @@ FFMPEGLIB_API int ff_flac_get_max_frame_size(int blocksize, int ch, int bps);
  */
 FFMPEGLIB_API int ff_flac_decode_frame_header(AVCodecContext *avctx, GetBitContext *gb,
                                 FLACFrameInfo *fi, int log_level_offset);
+
+void ff_flacenc_dsp_init_x86(FLACEncDSPContext *c);
+
 #endif /* AVCODEC_FLAC_H */
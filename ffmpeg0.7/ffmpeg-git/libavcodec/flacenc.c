@@ -95,7 +95,13 @@ typedef struct FlacEncodeContext {
     CompressionOptions options;
     AVCodecContext *avctx;
     LPCContext lpc_ctx;
+    FLACEncDSPContext dsp;
     struct AVMD5 *md5ctx;
+    struct FlacEncodeContext **thread_context; ///< one context per frame encoded in parallel, NULL without slice threads
+    int first_queued;       ///< index in thread_context of the oldest frame not returned yet
+    int nb_queued;          ///< number of frames queued and not returned yet
+    uint8_t *frame_buf;     ///< encoded frame, in thread contexts
+    int frame_bytes;        ///< size of the frame in frame_buf, -1 if it is not encoded yet
 } FlacEncodeContext;
 
 
@@ -206,6 +212,53 @@ static av_cold void dprint_compression_options(FlacEncodeContext *s)
 }
 
 
+static uint32_t rice_sum_c(const int32_t *res, int n, int k)
+{
+    uint32_t sum = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        sum += (uint32_t)((2 * res[i]) ^ (res[i] >> 31)) >> k;
+    return sum;
+}
+
+
+/**
+ * Allocate a context for each frame encoded in parallel.
+ * FLAC frames do not depend on each other, so up to thread_count frames
+ * are queued and then encoded at once with avctx->execute().
+ */
+static av_cold int init_thread_contexts(FlacEncodeContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i;
+
+    s->thread_context = av_mallocz(avctx->thread_count * sizeof(*s->thread_context));
+    if (!s->thread_context)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < avctx->thread_count; i++) {
+        FlacEncodeContext *t = av_malloc(sizeof(*t));
+        if (!t)
+            return AVERROR(ENOMEM);
+        s->thread_context[i] = t;
+
+        memcpy(t, s, sizeof(*t));
+        memset(&t->lpc_ctx, 0, sizeof(t->lpc_ctx));
+        t->md5ctx         = NULL;
+        t->thread_context = NULL;
+        t->frame_bytes    = 0;
+        t->frame_buf      = av_malloc(s->max_framesize);
+        if (!t->frame_buf)
+            return AVERROR(ENOMEM);
+        if (ff_lpc_init(&t->lpc_ctx, avctx->frame_size,
+                        s->options.max_prediction_order, AV_LPC_TYPE_LEVINSON) < 0)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+
 static av_cold int flac_encode_init(AVCodecContext *avctx)
 {
     int freq = avctx->sample_rate;
@@ -439,6 +492,14 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, AV_LPC_TYPE_LEVINSON);
 
+    s->dsp.rice_sum = rice_sum_c;
+#if HAVE_MMX
+    ff_flacenc_dsp_init_x86(&s->dsp);
+#endif
+
+    if (!ret && avctx->active_thread_type & FF_THREAD_SLICE)
+        ret = init_thread_contexts(s);
+
     dprint_compression_options(s);
 
     return ret;
@@ -493,17 +554,9 @@ static void copy_samples(FlacEncodeContext *s, const int16_t *samples)
 }
 
 
-static int rice_count_exact(int32_t *res, int n, int k)
+static int rice_count_exact(FlacEncodeContext *s, int32_t *res, int n, int k)
 {
-    int i;
-    int count = 0;
-
-    for (i = 0; i < n; i++) {
-        int32_t v = -2 * res[i] - 1;
-        v ^= v >> 31;
-        count += (v >> k) + 1 + k;
-    }
-    return count;
+    return s->dsp.rice_sum(res, n, k) + n * (k + 1);
 }
 
 
@@ -544,7 +597,7 @@ static int subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
         for (p = 0; p < 1 << porder; p++) {
             int k = sub->rc.params[p];
             count += 4;
-            count += rice_count_exact(&sub->residual[i], part_end - i, k);
+            count += rice_count_exact(s, &sub->residual[i], part_end - i, k);
             i = part_end;
             part_end = FFMIN(s->frame.blocksize, part_end + psize);
         }
@@ -596,22 +649,20 @@ static uint32_t calc_optimal_rice_params(RiceContext *rc, int porder,
 }
 
 
-static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
-                      uint32_t sums[][MAX_PARTITIONS])
+static void calc_sums(FlacEncodeContext *s, int pmin, int pmax, int32_t *data,
+                      int n, int pred_order, uint32_t sums[][MAX_PARTITIONS])
 {
     int i, j;
     int parts;
-    uint32_t *res, *res_end;
+    int32_t *res, *res_end;
 
     /* sums for highest level */
     parts   = (1 << pmax);
     res     = &data[pred_order];
     res_end = &data[n >> pmax];
     for (i = 0; i < parts; i++) {
-        uint32_t sum = 0;
-        while (res < res_end)
-            sum += *(res++);
-        sums[pmax][i] = sum;
+        sums[pmax][i] = s->dsp.rice_sum(res, res_end - res, 0);
+        res      = res_end;
         res_end += n >> pmax;
     }
     /* sums for lower levels */
@@ -623,25 +674,21 @@ static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
 }
 
 
-static uint32_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
-                                 int32_t *data, int n, int pred_order)
+static uint32_t calc_rice_params(FlacEncodeContext *s, RiceContext *rc,
+                                 int pmin, int pmax, int32_t *data, int n,
+                                 int pred_order)
 {
     int i;
     uint32_t bits[MAX_PARTITION_ORDER+1];
     int opt_porder;
     RiceContext tmp_rc;
-    uint32_t *udata;
     uint32_t sums[MAX_PARTITION_ORDER+1][MAX_PARTITIONS];
 
     assert(pmin >= 0 && pmin <= MAX_PARTITION_ORDER);
     assert(pmax >= 0 && pmax <= MAX_PARTITION_ORDER);
     assert(pmin <= pmax);
 
-    udata = av_malloc(n * sizeof(uint32_t));
-    for (i = 0; i < n; i++)
-        udata[i] = (2*data[i]) ^ (data[i]>>31);
-
-    calc_sums(pmin, pmax, udata, n, pred_order, sums);
+    calc_sums(s, pmin, pmax, data, n, pred_order, sums);
 
     opt_porder = pmin;
     bits[pmin] = UINT32_MAX;
@@ -653,7 +700,6 @@ static uint32_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
         }
     }
 
-    av_freep(&udata);
     return bits[opt_porder];
 }
 
@@ -678,7 +724,7 @@ static uint32_t find_subframe_rice_params(FlacEncodeContext *s,
     uint32_t bits = 8 + pred_order * sub->obits + 2 + 4;
     if (sub->type == FLAC_SUBFRAME_LPC)
         bits += 4 + 5 + pred_order * s->options.lpc_coeff_precision;
-    bits += calc_rice_params(&sub->rc, pmin, pmax, sub->residual,
+    bits += calc_rice_params(s, &sub->rc, pmin, pmax, sub->residual,
                              s->frame.blocksize, pred_order);
     return bits;
 }
@@ -918,8 +964,8 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         bits[opt_index] = UINT32_MAX;
         for (i = levels-1; i >= 0; i--) {
             order = min_order + (((max_order-min_order+1) * (i+1)) / levels)-1;
-            if (order < 0)
-                order = 0;
+            /* only coefficients for min_order..max_order have been calculated */
+            order = av_clip(order, min_order - 1, max_order - 1);
             encode_residual_lpc(res, smp, n, order+1, coefs[order], shift[order]);
             bits[i] = find_subframe_rice_params(s, sub, order+1);
             if (bits[i] < bits[opt_index]) {
@@ -1245,27 +1291,124 @@ static void update_md5_sum(FlacEncodeContext *s, const int16_t *samples)
 {
 #if HAVE_BIGENDIAN
     int i;
-    for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+    for (i = 0; i < s->avctx->frame_size * s->channels; i++) {
         int16_t smp = av_le2ne16(samples[i]);
         av_md5_update(s->md5ctx, (uint8_t *)&smp, 2);
     }
 #else
-    av_md5_update(s->md5ctx, (const uint8_t *)samples, s->frame.blocksize*s->channels*2);
+    av_md5_update(s->md5ctx, (const uint8_t *)samples, s->avctx->frame_size*s->channels*2);
 #endif
 }
 
 
+/**
+ * Compress the frame whose samples have been copied in and write it.
+ * @return number of bytes written, 0 if the output buffer is too small
+ */
+static int encode_and_write_frame(FlacEncodeContext *s, uint8_t *frame,
+                                  int buf_size)
+{
+    int frame_bytes;
+
+    channel_decorrelation(s);
+
+    frame_bytes = encode_frame(s);
+
+    /* fallback to verbatim mode if the compressed frame is larger than it
+       would be if encoded uncompressed. */
+    if (frame_bytes > s->max_framesize) {
+        s->frame.verbatim_only = 1;
+        frame_bytes = encode_frame(s);
+    }
+
+    if (buf_size < frame_bytes) {
+        av_log(s->avctx, AV_LOG_ERROR, "output buffer too small\n");
+        return 0;
+    }
+    return write_frame(s, frame, buf_size);
+}
+
+
+static int encode_frame_thread(AVCodecContext *avctx, void *arg)
+{
+    FlacEncodeContext *s = *(FlacEncodeContext **)arg;
+
+    if (s->frame_bytes < 0)
+        s->frame_bytes = encode_and_write_frame(s, s->frame_buf, s->max_framesize);
+    return 0;
+}
+
+
+static void update_frame_size_range(FlacEncodeContext *s, int out_bytes)
+{
+    if (out_bytes > s->max_encoded_framesize)
+        s->max_encoded_framesize = out_bytes;
+    if (out_bytes < s->min_framesize)
+        s->min_framesize = out_bytes;
+}
+
+
+/**
+ * Queue a frame in the next free thread context.
+ */
+static void queue_frame(FlacEncodeContext *s, const int16_t *samples)
+{
+    int i = (s->first_queued + s->nb_queued) % s->avctx->thread_count;
+    FlacEncodeContext *t = s->thread_context[i];
+
+    t->frame_count   = s->frame_count;
+    t->sample_count  = s->sample_count;
+    t->max_framesize = s->max_framesize;
+    t->frame_bytes   = -1;
+    init_frame(t);
+    copy_samples(t, samples);
+    s->nb_queued++;
+}
+
+
+/**
+ * Return the oldest queued frame. If it is not encoded yet, all queued
+ * frames are encoded in parallel first.
+ */
+static int output_queued_frame(FlacEncodeContext *s, uint8_t *frame,
+                               int buf_size)
+{
+    AVCodecContext *avctx = s->avctx;
+    FlacEncodeContext *t  = s->thread_context[s->first_queued];
+
+    if (t->frame_bytes < 0)
+        avctx->execute(avctx, encode_frame_thread, s->thread_context, NULL,
+                       avctx->thread_count, sizeof(*s->thread_context));
+
+    s->first_queued = (s->first_queued + 1) % avctx->thread_count;
+    s->nb_queued--;
+
+    if (buf_size < t->frame_bytes) {
+        av_log(avctx, AV_LOG_ERROR, "output buffer too small\n");
+        return 0;
+    }
+    memcpy(frame, t->frame_buf, t->frame_bytes);
+
+    avctx->coded_frame->pts = t->sample_count;
+    update_frame_size_range(s, t->frame_bytes);
+
+    return t->frame_bytes;
+}
+
+
 static int flac_encode_frame(AVCodecContext *avctx, uint8_t *frame,
                              int buf_size, void *data)
 {
     FlacEncodeContext *s;
     const int16_t *samples = data;
-    int frame_bytes, out_bytes;
+    int out_bytes = 0;
 
     s = avctx->priv_data;
 
     /* when the last block is reached, update the header in extradata */
     if (!data) {
+        if (s->nb_queued)
+            return output_queued_frame(s, frame, buf_size);
         s->max_framesize = s->max_encoded_framesize;
         av_md5_final(s->md5ctx, s->md5sum);
         write_streaminfo(s, avctx->extradata);
@@ -1273,40 +1416,32 @@ static int flac_encode_frame(AVCodecContext *avctx, uint8_t *frame,
     }
 
     /* change max_framesize for small final frame */
-    if (avctx->frame_size < s->frame.blocksize) {
+    if (avctx->frame_size < s->max_blocksize) {
         s->max_framesize = ff_flac_get_max_frame_size(avctx->frame_size,
                                                       s->channels, 16);
     }
 
-    init_frame(s);
-
-    copy_samples(s, samples);
-
-    channel_decorrelation(s);
+    if (s->thread_context) {
+        /* the frames are returned with a delay of thread_count frames */
+        if (s->nb_queued == avctx->thread_count)
+            out_bytes = output_queued_frame(s, frame, buf_size);
+        queue_frame(s, samples);
+    } else {
+        init_frame(s);
 
-    frame_bytes = encode_frame(s);
+        copy_samples(s, samples);
 
-    /* fallback to verbatim mode if the compressed frame is larger than it
-       would be if encoded uncompressed. */
-    if (frame_bytes > s->max_framesize) {
-        s->frame.verbatim_only = 1;
-        frame_bytes = encode_frame(s);
-    }
+        out_bytes = encode_and_write_frame(s, frame, buf_size);
+        if (!out_bytes)
+            return 0;
 
-    if (buf_size < frame_bytes) {
-        av_log(avctx, AV_LOG_ERROR, "output buffer too small\n");
-        return 0;
+        avctx->coded_frame->pts = s->sample_count;
+        update_frame_size_range(s, out_bytes);
     }
-    out_bytes = write_frame(s, frame, buf_size);
 
     s->frame_count++;
-    avctx->coded_frame->pts = s->sample_count;
     s->sample_count += avctx->frame_size;
     update_md5_sum(s, samples);
-    if (out_bytes > s->max_encoded_framesize)
-        s->max_encoded_framesize = out_bytes;
-    if (out_bytes < s->min_framesize)
-        s->min_framesize = out_bytes;
 
     return out_bytes;
 }
@@ -1318,6 +1453,17 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
         FlacEncodeContext *s = avctx->priv_data;
         av_freep(&s->md5ctx);
         ff_lpc_end(&s->lpc_ctx);
+        if (s->thread_context) {
+            int i;
+            for (i = 0; i < avctx->thread_count; i++) {
+                if (s->thread_context[i]) {
+                    ff_lpc_end(&s->thread_context[i]->lpc_ctx);
+                    av_freep(&s->thread_context[i]->frame_buf);
+                    av_freep(&s->thread_context[i]);
+                }
+            }
+            av_freep(&s->thread_context);
+        }
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -39,9 +39,11 @@
 #   define ALT_BITSTREAM_READER
 #endif
 
-#if !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER)
+#if !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER) && !defined(A64_BITSTREAM_READER)
 #   if ARCH_ARM && !HAVE_FAST_UNALIGNED
 #       define A32_BITSTREAM_READER
+#   elif CONFIG_A64_BITSTREAM_READER && HAVE_FAST_64BIT
+#       define A64_BITSTREAM_READER
 #   else
 #       define ALT_BITSTREAM_READER
 //#define A32_BITSTREAM_READER
@@ -59,6 +61,10 @@ typedef struct GetBitContext {
     uint32_t cache0;
     uint32_t cache1;
     int bit_count;
+#elif defined A64_BITSTREAM_READER
+    int index;
+    int cache_end;      ///< index of the first bit after the ones in cache
+    uint64_t cache;     ///< next bits of the stream, the next one in the MSB
 #endif
     int size_in_bits;
 } GetBitContext;
@@ -95,7 +101,7 @@ UPDATE_CACHE(name, gb)
     after this call at least MIN_CACHE_BITS will be available,
 
 GET_CACHE(name, gb)
-    will output the contents of the internal cache, next bit is MSB of 32 or 64 bit (FIXME 64bit)
+    will output the contents of the internal cache, next bit is MSB of 32 bit
 
 SHOW_UBITS(name, gb, num)
     will return the next num bits
@@ -246,6 +252,59 @@ static inline void skip_bits_long(GetBitContext *s, int n){
     CLOSE_READER(re, s);
 }
 
+#elif defined A64_BITSTREAM_READER
+
+/* Only for big-endian bitstreams. The cache holds up to 64 bits and is
+ * reloaded only once fewer than 32 of them are left, so most UPDATE_CACHE
+ * calls are a compare instead of an unaligned load. */
+#   define MIN_CACHE_BITS 32
+
+#   define OPEN_READER(name, gb)                \
+    unsigned int name##_index = (gb)->index;    \
+    int name##_cache_end      = (gb)->cache_end;\
+    uint64_t name##_cache     = (gb)->cache
+
+#   define CLOSE_READER(name, gb) do {          \
+        (gb)->index     = name##_index;         \
+        (gb)->cache_end = name##_cache_end;     \
+        (gb)->cache     = name##_cache;         \
+    } while (0)
+
+#   define UPDATE_CACHE(name, gb) do {                                  \
+        if ((int)(name##_cache_end - name##_index) < 32) {              \
+            name##_cache = AV_RB64((gb)->buffer + (name##_index >> 3))  \
+                           << (name##_index & 7);                       \
+            name##_cache_end = (name##_index & ~7) + 64;                \
+        }                                                               \
+    } while (0)
+
+#   define SKIP_CACHE(name, gb, num) name##_cache <<= (num)
+
+#   define SKIP_COUNTER(name, gb, num) name##_index += (num)
+
+#   define SKIP_BITS(name, gb, num) do {        \
+        SKIP_CACHE(name, gb, num);              \
+        SKIP_COUNTER(name, gb, num);            \
+    } while (0)
+
+#   define LAST_SKIP_BITS(name, gb, num)  SKIP_BITS(name, gb, num)
+#   define LAST_SKIP_CACHE(name, gb, num) SKIP_CACHE(name, gb, num)
+
+#   define SHOW_UBITS(name, gb, num) ((uint32_t)(name##_cache >> (64 - (num))))
+
+#   define SHOW_SBITS(name, gb, num) ((int32_t)((int64_t)name##_cache >> (64 - (num))))
+
+#   define GET_CACHE(name, gb) ((uint32_t)(name##_cache >> 32))
+
+static inline int get_bits_count(const GetBitContext *s){
+    return s->index;
+}
+
+static inline void skip_bits_long(GetBitContext *s, int n){
+    s->index    += n;
+    s->cache_end = s->index;
+}
+
 #endif
 
 /**
@@ -406,6 +465,10 @@ static inline void init_get_bits(GetBitContext *s,
     s->buffer_ptr   = (uint32_t*)((intptr_t)buffer & ~3);
     s->bit_count    = 32 +     8*((intptr_t)buffer &  3);
     skip_bits_long(s, 0);
+#elif defined A64_BITSTREAM_READER
+    s->index        = 0;
+    s->cache_end    = 0;
+    s->cache        = 0;
 #endif
 }
 
@@ -151,6 +151,45 @@ static int get_consumed_bytes(MpegEncContext *s, int buf_size){
     }
 }
 
+/**
+ * Store the frame following the current one in a DivX 5.01+/XviD packed
+ * bitstream, so that the next call (possibly in another frame thread) can
+ * start before the current frame has been decoded.
+ * Start codes cannot occur inside the VOP data, so the split point is
+ * already known once the picture header has been read.
+ */
+static int split_packed_frames(MpegEncContext *s, const uint8_t *buf, int buf_size){
+    int current_pos= get_bits_count(&s->gb)>>3;
+    int startcode_found=0;
+
+    if(s->gb.buffer == buf && buf_size - current_pos > 5){
+        int i;
+        for(i=current_pos; i<buf_size-3; i++){
+            if(buf[i]==0 && buf[i+1]==0 && buf[i+2]==1 && buf[i+3]==0xB6){
+                startcode_found=1;
+                break;
+            }
+        }
+    }
+    if(s->gb.buffer != buf && buf_size>7 && s->xvid_build>=0){ //xvid style
+        startcode_found=1;
+        current_pos=0;
+    }
+
+    if(startcode_found){
+        av_fast_malloc(
+            &s->bitstream_buffer,
+            &s->allocated_bitstream_buffer_size,
+            buf_size - current_pos + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!s->bitstream_buffer)
+            return AVERROR(ENOMEM);
+        memcpy(s->bitstream_buffer, buf + current_pos, buf_size - current_pos);
+        memset(s->bitstream_buffer + buf_size - current_pos, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+        s->bitstream_buffer_size= buf_size - current_pos;
+    }
+    return 0;
+}
+
 static int decode_slice(MpegEncContext *s){
     const int part_mask= s->partitioned_frame ? (AC_END|AC_ERROR) : 0x7F;
     const int mb_size= 16>>s->avctx->lowres;
@@ -400,7 +439,10 @@ retry:
     }
 
     if(s->bitstream_buffer_size && (s->divx_packed || buf_size<20)){ //divx 5.01+/xvid frame reorder
-        init_get_bits(&s->gb, s->bitstream_buffer, s->bitstream_buffer_size*8);
+        /* bitstream_buffer may receive the next frame before this one is decoded */
+        FFSWAP(uint8_t*, s->bitstream_buffer, s->packed_buffer);
+        FFSWAP(unsigned int, s->allocated_bitstream_buffer_size, s->allocated_packed_buffer_size);
+        init_get_bits(&s->gb, s->packed_buffer, s->bitstream_buffer_size*8);
     }else
         init_get_bits(&s->gb, buf, buf_size*8);
     s->bitstream_buffer_size=0;
@@ -593,6 +635,13 @@ retry:
         || s->height != avctx->coded_height) {
         /* H.263 could change picture size any time */
         ParseContext pc= s->parse_context; //FIXME move these demuxng hack to avformat
+
+        /* the other frame threads keep tables of the old size */
+        if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME && avctx->width &&
+            (s->width != avctx->width || s->height != avctx->height)) {
+            av_log_missing_feature(avctx, "Width/height changing with frame threads is", 0);
+            return -1;
+        }
         s->parse_context.buffer=0;
         MPV_common_end(s);
         s->parse_context= pc;
@@ -646,7 +695,12 @@ retry:
     if(MPV_frame_start(s, avctx) < 0)
         return -1;
 
-    if (!s->divx_packed) ff_thread_finish_setup(avctx);
+    if(s->codec_id==CODEC_ID_MPEG4 && s->divx_packed){
+        ret = split_packed_frames(s, buf, buf_size);
+        if(ret<0) return ret;
+    }
+
+    ff_thread_finish_setup(avctx);
 
     if (CONFIG_MPEG4_VDPAU_DECODER && (s->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)) {
         //ff_vdpau_mpeg4_decode_picture(s, s->gb.buffer, s->gb.buffer_end - s->gb.buffer);
@@ -665,7 +719,7 @@ retry:
     if (CONFIG_WMV2_DECODER && s->msmpeg4_version==5){
         ret = ff_wmv2_decode_secondary_picture_header(s);
         if(ret<0) return ret;
-        if(ret==1) goto intrax8_decoded;
+        if(ret==1) goto frame_end;
     }
 
     /* decode each macroblock */
@@ -693,40 +747,7 @@ retry:
             s->error_status_table[s->mb_num-1]= AC_ERROR|DC_ERROR|MV_ERROR;
         }
 
-    assert(s->bitstream_buffer_size==0);
 frame_end:
-    /* divx 5.01+ bistream reorder stuff */
-    if(s->codec_id==CODEC_ID_MPEG4 && s->divx_packed){
-        int current_pos= get_bits_count(&s->gb)>>3;
-        int startcode_found=0;
-
-        if(buf_size - current_pos > 5){
-            int i;
-            for(i=current_pos; i<buf_size-3; i++){
-                if(buf[i]==0 && buf[i+1]==0 && buf[i+2]==1 && buf[i+3]==0xB6){
-                    startcode_found=1;
-                    break;
-                }
-            }
-        }
-        if(s->gb.buffer == s->bitstream_buffer && buf_size>7 && s->xvid_build>=0){ //xvid style
-            startcode_found=1;
-            current_pos=0;
-        }
-
-        if(startcode_found){
-            av_fast_malloc(
-                &s->bitstream_buffer,
-                &s->allocated_bitstream_buffer_size,
-                buf_size - current_pos + FF_INPUT_BUFFER_PADDING_SIZE);
-            if (!s->bitstream_buffer)
-                return AVERROR(ENOMEM);
-            memcpy(s->bitstream_buffer, buf + current_pos, buf_size - current_pos);
-            s->bitstream_buffer_size= buf_size - current_pos;
-        }
-    }
-
-intrax8_decoded:
     ff_er_frame_end(s);
 
     if (avctx->hwaccel) {
@@ -340,6 +340,8 @@ static void free_tables(H264Context *h, int free_rbsp){
         av_freep(&hx->top_borders[1]);
         av_freep(&hx->top_borders[0]);
         av_freep(&hx->s.obmc_scratchpad);
+        ff_thread_pass_free(&hx->deblock_pass);
+        av_freep(&hx->deblock_ctx);
         if (free_rbsp){
             av_freep(&hx->rbsp_buffer[1]);
             av_freep(&hx->rbsp_buffer[0]);
@@ -350,59 +352,107 @@ static void free_tables(H264Context *h, int free_rbsp){
     }
 }
 
-static void init_dequant8_coeff_table(H264Context *h){
-    int i,q,x;
+/* dequantization tables of the flat scaling matrices, shared by all contexts */
+static uint32_t dequant4_flat[QP_MAX_MAX+1][16];
+static uint32_t dequant8_flat[QP_MAX_MAX+1][64];
+
+static void fill_dequant4_table(uint32_t (*tab)[16], const uint8_t *matrix, int max_qp){
+    int q,x;
+    for(q=0; q<max_qp+1; q++){
+        int shift = div6[q] + 2;
+        int idx = rem6[q];
+        for(x=0; x<16; x++)
+            tab[q][(x>>2)|((x<<2)&0xF)] =
+                ((uint32_t)dequant4_coeff_init[idx][(x&1) + ((x>>2)&1)] *
+                matrix[x]) << shift;
+    }
+}
+
+static void fill_dequant8_table(uint32_t (*tab)[64], const uint8_t *matrix, int max_qp){
+    int q,x;
+    for(q=0; q<max_qp+1; q++){
+        int shift = div6[q];
+        int idx = rem6[q];
+        for(x=0; x<64; x++)
+            tab[q][(x>>3)|((x&7)<<3)] =
+                ((uint32_t)dequant8_coeff_init[idx][ dequant8_coeff_init_scan[((x>>1)&12) | (x&3)] ] *
+                matrix[x]) << shift;
+    }
+}
+
+static av_cold void init_flat_dequant_tables(void){
+    static int done = 0;
+    uint8_t flat[64];
+
+    if(done)
+        return;
+    memset(flat, 16, sizeof(flat));
+    fill_dequant4_table(dequant4_flat, flat, QP_MAX_MAX);
+    fill_dequant8_table(dequant8_flat, flat, QP_MAX_MAX);
+    done = 1;
+}
+
+static int is_flat(const uint8_t *matrix, int size){
+    int i;
+    for(i=0; i<size; i++)
+        if(matrix[i] != 16)
+            return 0;
+    return 1;
+}
+
+/* transform bypass modifies the tables, so it never uses the shared ones */
+static int init_dequant8_coeff_table(H264Context *h){
+    int i;
     const int max_qp = 51 + 6*(h->sps.bit_depth_luma-8);
-    h->dequant8_coeff[0] = h->dequant8_buffer[0];
-    h->dequant8_coeff[1] = h->dequant8_buffer[1];
 
     for(i=0; i<2; i++ ){
         if(i && !memcmp(h->pps.scaling_matrix8[0], h->pps.scaling_matrix8[1], 64*sizeof(uint8_t))){
-            h->dequant8_coeff[1] = h->dequant8_buffer[0];
+            h->dequant8_coeff[1] = h->dequant8_coeff[0];
             break;
         }
-
-        for(q=0; q<max_qp+1; q++){
-            int shift = div6[q];
-            int idx = rem6[q];
-            for(x=0; x<64; x++)
-                h->dequant8_coeff[i][q][(x>>3)|((x&7)<<3)] =
-                    ((uint32_t)dequant8_coeff_init[idx][ dequant8_coeff_init_scan[((x>>1)&12) | (x&3)] ] *
-                    h->pps.scaling_matrix8[i][x]) << shift;
+        if(!h->sps.transform_bypass && is_flat(h->pps.scaling_matrix8[i], 64)){
+            h->dequant8_coeff[i] = dequant8_flat;
+            continue;
         }
+        if(!h->dequant8_buffer && !(h->dequant8_buffer = av_malloc(2*sizeof(*h->dequant8_buffer))))
+            return AVERROR(ENOMEM);
+        h->dequant8_coeff[i] = h->dequant8_buffer[i];
+        fill_dequant8_table(h->dequant8_coeff[i], h->pps.scaling_matrix8[i], max_qp);
     }
+    return 0;
 }
 
-static void init_dequant4_coeff_table(H264Context *h){
-    int i,j,q,x;
+static int init_dequant4_coeff_table(H264Context *h){
+    int i,j;
     const int max_qp = 51 + 6*(h->sps.bit_depth_luma-8);
+
     for(i=0; i<6; i++ ){
-        h->dequant4_coeff[i] = h->dequant4_buffer[i];
         for(j=0; j<i; j++){
             if(!memcmp(h->pps.scaling_matrix4[j], h->pps.scaling_matrix4[i], 16*sizeof(uint8_t))){
-                h->dequant4_coeff[i] = h->dequant4_buffer[j];
+                h->dequant4_coeff[i] = h->dequant4_coeff[j];
                 break;
             }
         }
         if(j<i)
             continue;
-
-        for(q=0; q<max_qp+1; q++){
-            int shift = div6[q] + 2;
-            int idx = rem6[q];
-            for(x=0; x<16; x++)
-                h->dequant4_coeff[i][q][(x>>2)|((x<<2)&0xF)] =
-                    ((uint32_t)dequant4_coeff_init[idx][(x&1) + ((x>>2)&1)] *
-                    h->pps.scaling_matrix4[i][x]) << shift;
+        if(!h->sps.transform_bypass && is_flat(h->pps.scaling_matrix4[i], 16)){
+            h->dequant4_coeff[i] = dequant4_flat;
+            continue;
         }
+        if(!h->dequant4_buffer && !(h->dequant4_buffer = av_malloc(6*sizeof(*h->dequant4_buffer))))
+            return AVERROR(ENOMEM);
+        h->dequant4_coeff[i] = h->dequant4_buffer[i];
+        fill_dequant4_table(h->dequant4_coeff[i], h->pps.scaling_matrix4[i], max_qp);
     }
+    return 0;
 }
 
-static void init_dequant_tables(H264Context *h){
+static int init_dequant_tables(H264Context *h){
     int i,x;
-    init_dequant4_coeff_table(h);
-    if(h->pps.transform_8x8_mode)
-        init_dequant8_coeff_table(h);
+    if(init_dequant4_coeff_table(h) < 0)
+        return AVERROR(ENOMEM);
+    if(h->pps.transform_8x8_mode && init_dequant8_coeff_table(h) < 0)
+        return AVERROR(ENOMEM);
     if(h->sps.transform_bypass){
         for(i=0; i<6; i++)
             for(x=0; x<16; x++)
@@ -412,13 +462,53 @@ static void init_dequant_tables(H264Context *h){
                 for(x=0; x<64; x++)
                     h->dequant8_coeff[i][0][x] = 1<<6;
     }
+    return 0;
 }
 
+/**
+ * Point the dequantization tables of dst at copies of the ones of src.
+ * Only tables of non-flat scaling matrices need to be copied.
+ */
+static int copy_dequant_tables(H264Context *dst, H264Context *src){
+    int i;
+
+    if(src->dequant4_buffer){
+        if(!dst->dequant4_buffer && !(dst->dequant4_buffer = av_malloc(6*sizeof(*dst->dequant4_buffer))))
+            return AVERROR(ENOMEM);
+        memcpy(dst->dequant4_buffer, src->dequant4_buffer, 6*sizeof(*dst->dequant4_buffer));
+    }
+    if(src->dequant8_buffer){
+        if(!dst->dequant8_buffer && !(dst->dequant8_buffer = av_malloc(2*sizeof(*dst->dequant8_buffer))))
+            return AVERROR(ENOMEM);
+        memcpy(dst->dequant8_buffer, src->dequant8_buffer, 2*sizeof(*dst->dequant8_buffer));
+    }
+
+    for(i=0; i<6; i++){
+        dst->dequant4_coeff[i] = src->dequant4_coeff[i];
+        if(src->dequant4_coeff[i] && src->dequant4_coeff[i] != dequant4_flat)
+            dst->dequant4_coeff[i] = dst->dequant4_buffer[0] + (src->dequant4_coeff[i] - src->dequant4_buffer[0]);
+    }
+    for(i=0; i<2; i++){
+        dst->dequant8_coeff[i] = src->dequant8_coeff[i];
+        if(src->dequant8_coeff[i] && src->dequant8_coeff[i] != dequant8_flat)
+            dst->dequant8_coeff[i] = dst->dequant8_buffer[0] + (src->dequant8_coeff[i] - src->dequant8_buffer[0]);
+    }
+    return 0;
+}
+
+/**
+ * Number of slice contexts sharing the row tables of the main context.
+ * Frame thread copies and single threaded decoding only need one.
+ */
+static int slice_context_count(H264Context *h){
+    AVCodecContext *avctx = h->s.avctx;
+    return HAVE_THREADS && (avctx->active_thread_type&FF_THREAD_SLICE) ? avctx->thread_count : 1;
+}
 
 int ff_h264_alloc_tables(H264Context *h){
     MpegEncContext * const s = &h->s;
     const int big_mb_num= s->mb_stride * (s->mb_height+1);
-    const int row_mb_num= 2*s->mb_stride*s->avctx->thread_count;
+    const int row_mb_num= 2*s->mb_stride*slice_context_count(h);
     int x,y;
 
     FF_ALLOCZ_OR_GOTO(h->s.avctx, h->intra4x4_pred_mode, row_mb_num * 8  * sizeof(uint8_t), fail)
@@ -450,8 +540,8 @@ int ff_h264_alloc_tables(H264Context *h){
 
     s->obmc_scratchpad = NULL;
 
-    if(!h->dequant4_coeff[0])
-        init_dequant_tables(h);
+    if(!h->dequant4_coeff[0] && init_dequant_tables(h) < 0)
+        goto fail;
 
     return 0;
 fail:
@@ -459,6 +549,58 @@ fail:
     return -1;
 }
 
+/**
+ * Bytes allocated by ff_h264_alloc_tables(), context_init() and the slice
+ * thread contexts, see AVCodec.memory_usage.
+ */
+static int64_t h264_tables_size(H264Context *h){
+    MpegEncContext * const s = &h->s;
+    const int64_t big_mb_num= s->mb_stride * (s->mb_height+1);
+    const int64_t row_mb_num= 2*s->mb_stride*slice_context_count(h);
+    int64_t size = 0;
+    int i;
+
+    if(h->non_zero_count)
+        size += row_mb_num * 8 + big_mb_num * 32
+              + (big_mb_num+s->mb_stride) * sizeof(*h->slice_table_base)
+              + big_mb_num * (sizeof(uint16_t) + 1 + 4 + 1)
+              + 2 * 16*row_mb_num
+              + 2 * big_mb_num * sizeof(uint32_t);
+    if(h->dequant4_buffer)
+        size += 6*sizeof(*h->dequant4_buffer);
+    if(h->dequant8_buffer)
+        size += 2*sizeof(*h->dequant8_buffer);
+
+    for(i = 0; i < MAX_THREADS; i++){
+        H264Context *hx = h->thread_context[i];
+        if(!hx)
+            continue;
+        if(i)
+            size += sizeof(H264Context);
+        if(hx->top_borders[0])
+            size += 2 * s->mb_width * (16+8+8) * 2;
+        if(hx->s.obmc_scratchpad)
+            size += 16*2*s->linesize + 8*2*s->uvlinesize;
+        if(hx->deblock_ctx)
+            size += sizeof(H264Context);
+        size += hx->rbsp_buffer_size[0] + hx->rbsp_buffer_size[1];
+    }
+    for(i = 0; i < MAX_SPS_COUNT; i++)
+        if(h->sps_buffers[i])
+            size += sizeof(SPS);
+    for(i = 0; i < MAX_PPS_COUNT; i++)
+        if(h->pps_buffers[i])
+            size += sizeof(PPS);
+
+    return size;
+}
+
+static int64_t decode_memory_usage(AVCodecContext *avctx){
+    H264Context *h = avctx->priv_data;
+
+    return ff_mpv_memory_usage(&h->s) + h264_tables_size(h);
+}
+
 /**
  * Mimic alloc_tables(), but for every context thread.
  */
@@ -587,6 +729,7 @@ av_cold int ff_h264_decode_init(AVCodecContext *avctx){
     avctx->chroma_sample_location = AVCHROMA_LOC_LEFT;
 
     ff_h264_decode_init_vlc();
+    init_flat_dequant_tables();
 
     h->sps.bit_depth_luma = avctx->bits_per_raw_sample = 8;
     h->pixel_shift = 0;
@@ -624,16 +767,20 @@ static void copy_picture_range(Picture **to, Picture **from, int count, MpegEncC
     }
 }
 
-static void copy_parameter_set(void **to, void **from, int count, int size)
+static int copy_parameter_set(void **to, void **from, int count, int size)
 {
-    int i;
+    int i, copied = 0;
 
     for (i=0; i<count; i++){
         if (to[i] && !from[i]) av_freep(&to[i]);
         else if (from[i] && !to[i]) to[i] = av_malloc(size);
 
-        if (from[i]) memcpy(to[i], from[i], size);
+        if (from[i]){
+            memcpy(to[i], from[i], size);
+            copied += size;
+        }
     }
+    return copied;
 }
 
 static int decode_init_thread_copy(AVCodecContext *avctx){
@@ -642,16 +789,21 @@ static int decode_init_thread_copy(AVCodecContext *avctx){
     if (!avctx->is_copy) return 0;
     memset(h->sps_buffers, 0, sizeof(h->sps_buffers));
     memset(h->pps_buffers, 0, sizeof(h->pps_buffers));
+    h->ps_owner = NULL;
 
     return 0;
 }
 
-#define copy_fields(to, from, start_field, end_field) memcpy(&to->start_field, &from->start_field, (char*)&to->end_field - (char*)&to->start_field)
+#define copy_fields(to, from, start_field, end_field) do {\
+    int size = (char*)&to->end_field - (char*)&to->start_field;\
+    memcpy(&to->start_field, &from->start_field, size);\
+    copied += size;\
+} while(0)
 static int decode_update_thread_context(AVCodecContext *dst, const AVCodecContext *src){
     H264Context *h= dst->priv_data, *h1= src->priv_data;
     MpegEncContext * const s = &h->s, * const s1 = &h1->s;
     int inited = s->context_initialized, err;
-    int i;
+    int i, copied = 0;
 
     if(dst == src || !s1->context_initialized) return 0;
 
@@ -667,8 +819,12 @@ static int decode_update_thread_context(AVCodecContext *dst, const AVCodecContex
             av_freep(h->pps_buffers + i);
 
         memcpy(&h->s + 1, &h1->s + 1, sizeof(H264Context) - sizeof(MpegEncContext)); //copy all fields after MpegEnc
+        copied += sizeof(H264Context) - sizeof(MpegEncContext);
         memset(h->sps_buffers, 0, sizeof(h->sps_buffers));
         memset(h->pps_buffers, 0, sizeof(h->pps_buffers));
+        h->ps_owner        = NULL;
+        h->dequant4_buffer = NULL;
+        h->dequant8_buffer = NULL;
         ff_h264_alloc_tables(h);
         context_init(h);
 
@@ -676,12 +832,15 @@ static int decode_update_thread_context(AVCodecContext *dst, const AVCodecContex
             h->rbsp_buffer[i] = NULL;
             h->rbsp_buffer_size[i] = 0;
         }
+        h->deblock_pass = NULL;
+        h->deblock_ctx  = NULL;
 
         h->thread_context[0] = h;
 
         // frame_start may not be called for the next thread (if it's decoding a bottom field)
         // so this has to be allocated here
-        h->s.obmc_scratchpad = av_malloc(16*2*s->linesize + 8*2*s->uvlinesize);
+        if(!(s->avctx->flags2 & CODEC_FLAG2_LOW_MEMORY))
+            h->s.obmc_scratchpad = av_malloc(16*2*s->linesize + 8*2*s->uvlinesize);
 
         s->dsp.clear_blocks(h->mb);
     }
@@ -689,30 +848,37 @@ static int decode_update_thread_context(AVCodecContext *dst, const AVCodecContex
     //extradata/NAL handling
     h->is_avc          = h1->is_avc;
 
-    //SPS/PPS
-    copy_parameter_set((void**)h->sps_buffers, (void**)h1->sps_buffers, MAX_SPS_COUNT, sizeof(SPS));
-    h->sps             = h1->sps;
-    copy_parameter_set((void**)h->pps_buffers, (void**)h1->pps_buffers, MAX_PPS_COUNT, sizeof(PPS));
-    h->pps             = h1->pps;
-
-    //Dequantization matrices
-    //FIXME these are big - can they be only copied when PPS changes?
-    copy_fields(h, h1, dequant4_buffer, dequant4_coeff);
+    //SPS/PPS and dequantization matrices, only copied if they changed
+    if(h->ps_owner != h1->ps_owner || h->ps_generation != h1->ps_generation){
+        copied += copy_parameter_set((void**)h->sps_buffers, (void**)h1->sps_buffers, MAX_SPS_COUNT, sizeof(SPS));
+        copied += copy_parameter_set((void**)h->pps_buffers, (void**)h1->pps_buffers, MAX_PPS_COUNT, sizeof(PPS));
 
-    for(i=0; i<6; i++)
-        h->dequant4_coeff[i] = h->dequant4_buffer[0] + (h1->dequant4_coeff[i] - h1->dequant4_buffer[0]);
+        err = copy_dequant_tables(h, h1);
+        if(err) return err;
+        if(h1->dequant4_buffer)
+            copied += 6*sizeof(*h->dequant4_buffer);
+        if(h1->dequant8_buffer)
+            copied += 2*sizeof(*h->dequant8_buffer);
 
-    for(i=0; i<2; i++)
-        h->dequant8_coeff[i] = h->dequant8_buffer[0] + (h1->dequant8_coeff[i] - h1->dequant8_buffer[0]);
-
-    h->dequant_coeff_pps = h1->dequant_coeff_pps;
+        h->dequant_coeff_pps = h1->dequant_coeff_pps;
+        h->ps_owner          = h1->ps_owner;
+        h->ps_generation     = h1->ps_generation;
+    }
+    copy_fields(h, h1, sps, pps);
+    copy_fields(h, h1, pps, dequant4_buffer);
 
     //POC timing
     copy_fields(h, h1, poc_lsb, redundant_pic_count);
 
     //reference lists
-    copy_fields(h, h1, ref_count, intra_gb);
-    copy_fields(h, h1, short_ref, cabac_init_idc);
+    //the next thread rebuilds them for its first P or B slice, but the first
+    //entries are still used as the last/next picture of an I picture
+    copy_fields(h, h1, ref_count, ref_list);
+    memcpy(&h->ref_list[0][0], &h1->ref_list[0][0], sizeof(Picture));
+    memcpy(&h->ref_list[1][0], &h1->ref_list[1][0], sizeof(Picture));
+    copied += 2*sizeof(Picture);
+    copy_fields(h, h1, short_ref, default_ref_list);
+    copy_fields(h, h1, delayed_pic, cabac_init_idc);
 
     copy_picture_range(h->short_ref,   h1->short_ref,   32, s, s1);
     copy_picture_range(h->long_ref,    h1->long_ref,    32, s, s1);
@@ -720,6 +886,8 @@ static int decode_update_thread_context(AVCodecContext *dst, const AVCodecContex
 
     h->last_slice_type = h1->last_slice_type;
 
+    ff_thread_report_copied(dst, copied);
+
     if(!s->current_picture_ptr) return 0;
 
     if(!s->dropable) {
@@ -764,8 +932,9 @@ int ff_h264_frame_start(H264Context *h){
     }
 
     /* can't be in alloc_tables because linesize isn't known there.
-     * FIXME: redo bipred weight to not require extra buffer? */
-    for(i = 0; i < s->avctx->thread_count; i++)
+     * FIXME: redo bipred weight to not require extra buffer?
+     * In low memory mode it is only allocated for slices using weights. */
+    for(i = 0; i < s->avctx->thread_count && !(s->avctx->flags2 & CODEC_FLAG2_LOW_MEMORY); i++)
         if(h->thread_context[i] && !h->thread_context[i]->s.obmc_scratchpad)
             h->thread_context[i]->s.obmc_scratchpad = av_malloc(16*2*s->linesize + 8*2*s->uvlinesize);
 
@@ -1855,7 +2024,8 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
 
     if(h == h0 && h->dequant_coeff_pps != pps_id){
         h->dequant_coeff_pps = pps_id;
-        init_dequant_tables(h);
+        if(init_dequant_tables(h) < 0)
+            return AVERROR(ENOMEM);
     }
 
     s->mb_width= h->sps.mb_width;
@@ -1872,7 +2042,8 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
     if (s->context_initialized
         && (   s->width != s->avctx->width || s->height != s->avctx->height
             || av_cmp_q(h->sps.sar, s->avctx->sample_aspect_ratio))) {
-        if(h != h0) {
+        if(h != h0 || (HAVE_PTHREADS && s->avctx->active_thread_type&FF_THREAD_FRAME &&
+                       (s->width != s->avctx->width || s->height != s->avctx->height))) {
             av_log_missing_feature(s->avctx, "Width/height changing with threads is", 0);
             return -1;   // width / height changed during parallelized decoding
         }
@@ -2169,6 +2340,13 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
         }
     }
 
+    if(   !s->obmc_scratchpad
+       && (h->use_weight || (h->pps.weighted_bipred_idc==2 && h->slice_type_nos==FF_B_TYPE))){
+        s->obmc_scratchpad = av_malloc(16*2*s->linesize + 8*2*s->uvlinesize);
+        if(!s->obmc_scratchpad)
+            return AVERROR(ENOMEM);
+    }
+
     if(h->nal_ref_idc)
         ff_h264_decode_ref_pic_marking(h0, &s->gb);
 
@@ -2241,6 +2419,11 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
        ||(s->avctx->skip_loop_filter >= AVDISCARD_NONREF && h->nal_ref_idc == 0))
         h->deblocking_filter= 0;
 
+    if(h->deblocking_filter && s->avctx->deadline_level >= FF_DEADLINE_SKIP_LOOP_FILTER && h->nal_ref_idc == 0){
+        h->deblocking_filter= 0;
+        h0->deadline_degraded= FFMAX(h0->deadline_degraded, FF_DEADLINE_SKIP_LOOP_FILTER);
+    }
+
     if(h->deblocking_filter == 1 && h0->max_contexts > 1) {
         if(s->avctx->flags2 & CODEC_FLAG2_FAST) {
             /* Cheat slightly for speed:
@@ -2596,7 +2779,8 @@ static void loop_filter(H264Context *h){
                     linesize   = h->mb_linesize   = s->linesize;
                     uvlinesize = h->mb_uvlinesize = s->uvlinesize;
                 }
-                backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize, uvlinesize, 0);
+                if(!h->deblock_pipelined)
+                    backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize, uvlinesize, 0);
                 if(fill_filter_caches(h, mb_type))
                     continue;
                 h->chroma_qp[0] = get_chroma_qp(h, 0, s->current_picture.qscale_table[mb_xy]);
@@ -2662,8 +2846,65 @@ static void decode_finish_row(H264Context *h){
                              s->picture_structure==PICT_BOTTOM_FIELD);
 }
 
-static int decode_slice(struct AVCodecContext *avctx, void *arg){
-    H264Context *h = *(void**)arg;
+/**
+ * Filter the MBs of the current row up to s->mb_x, or only back up their
+ * unfiltered bottom lines for intra prediction if deblock_pass filters them.
+ */
+static void loop_filter_row(H264Context *h){
+    MpegEncContext * const s = &h->s;
+    const int end_mb_x = s->mb_x;
+    int mb_x;
+
+    if(!h->deblock_pipelined){
+        loop_filter(h);
+        return;
+    }
+
+    for(mb_x = s->resync_mb_y == s->mb_y ? s->resync_mb_x : 0; mb_x < end_mb_x; mb_x++){
+        s->mb_x = mb_x;
+        backup_mb_border(h, s->current_picture.data[0] + ((mb_x<<h->pixel_shift) + s->mb_y * s->linesize  ) * 16,
+                            s->current_picture.data[1] + ((mb_x<<h->pixel_shift) + s->mb_y * s->uvlinesize) * 8,
+                            s->current_picture.data[2] + ((mb_x<<h->pixel_shift) + s->mb_y * s->uvlinesize) * 8,
+                            s->linesize, s->uvlinesize, 0);
+    }
+    s->mb_x = end_mb_x;
+    if(end_mb_x < s->mb_width)
+        h->deblock_ctx->deblock_end_mb_x = end_mb_x;
+}
+
+/**
+ * Deblock the rows of a slice behind the thread decoding it.
+ * Runs on deblock_ctx. Row mb_y is filtered once row mb_y+1 is complete,
+ * as the intra prediction of row mb_y+1 swaps its bottom line in and out.
+ */
+static int deblock_slice_rows(AVCodecContext *avctx, void *arg){
+    H264Context *h = arg;
+    MpegEncContext * const s = &h->s;
+    int mb_y, progress = -1;
+
+    for(mb_y = s->resync_mb_y; ; mb_y++){
+        if(progress < mb_y + 2)
+            progress = ff_thread_pass_await(h->deblock_pass, mb_y + 2);
+        if(progress == INT_MAX && mb_y >= h->deblock_end_mb_y)
+            break;
+
+        s->mb_y = mb_y;
+        s->mb_x = s->mb_width;
+        loop_filter(h);
+        s->mb_x = 0;
+        decode_finish_row(h);
+    }
+
+    if(h->deblock_end_mb_x){
+        s->mb_y = mb_y;
+        s->mb_x = h->deblock_end_mb_x;
+        loop_filter(h);
+    }
+
+    return 0;
+}
+
+static int decode_slice_mbs(H264Context *h){
     MpegEncContext * const s = &h->s;
     const int part_mask= s->partitioned_frame ? (AC_END|AC_ERROR) : 0x7F;
 
@@ -2713,9 +2954,12 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg){
             }
 
             if( ++s->mb_x >= s->mb_width ) {
-                loop_filter(h);
+                loop_filter_row(h);
                 s->mb_x = 0;
-                decode_finish_row(h);
+                if(h->deblock_pipelined)
+                    ff_thread_pass_report(h->deblock_pass, s->mb_y + 1);
+                else
+                    decode_finish_row(h);
                 ++s->mb_y;
                 if(FIELD_OR_MBAFF_PICTURE) {
                     ++s->mb_y;
@@ -2726,7 +2970,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg){
 
             if( eos || s->mb_y >= s->mb_height ) {
                 if(s->mb_x)
-                    loop_filter(h);
+                    loop_filter_row(h);
                 tprintf(s->avctx, "slice end %d %d\n", get_bits_count(&s->gb), s->gb.size_in_bits);
                 ff_er_add_slice(s, s->resync_mb_x, s->resync_mb_y, s->mb_x-1, s->mb_y, (AC_END|DC_END|MV_END)&part_mask);
                 return 0;
@@ -2755,9 +2999,12 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg){
             }
 
             if(++s->mb_x >= s->mb_width){
-                loop_filter(h);
+                loop_filter_row(h);
                 s->mb_x=0;
-                decode_finish_row(h);
+                if(h->deblock_pipelined)
+                    ff_thread_pass_report(h->deblock_pass, s->mb_y + 1);
+                else
+                    decode_finish_row(h);
                 ++s->mb_y;
                 if(FIELD_OR_MBAFF_PICTURE) {
                     ++s->mb_y;
@@ -2784,7 +3031,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg){
                 tprintf(s->avctx, "slice end %d %d\n", get_bits_count(&s->gb), s->gb.size_in_bits);
                 if(get_bits_count(&s->gb) == s->gb.size_in_bits ){
                     if(s->mb_x)
-                        loop_filter(h);
+                        loop_filter_row(h);
                     ff_er_add_slice(s, s->resync_mb_x, s->resync_mb_y, s->mb_x-1, s->mb_y, (AC_END|DC_END|MV_END)&part_mask);
 
                     return 0;
@@ -2845,6 +3092,96 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg){
     return -1; //not reached
 }
 
+/**
+ * Copy the state that loop_filter() and decode_finish_row() read
+ * to the context of the deblocking pass.
+ */
+static void copy_deblock_ctx(H264Context *hd, H264Context *h){
+    MpegEncContext * const sd = &hd->s;
+    MpegEncContext * const s  = &h->s;
+
+    sd->avctx               = s->avctx;
+    sd->dsp.draw_edges      = s->dsp.draw_edges;
+    sd->current_picture     = s->current_picture;
+    sd->current_picture_ptr = s->current_picture_ptr;
+    sd->last_picture_ptr    = s->last_picture_ptr;
+    sd->picture_structure   = s->picture_structure;
+    sd->first_field         = s->first_field;
+    sd->pict_type           = s->pict_type;
+    sd->dropable            = s->dropable;
+    sd->low_delay           = s->low_delay;
+    sd->out_format          = s->out_format;
+    sd->flags               = s->flags;
+    sd->unrestricted_mv     = s->unrestricted_mv;
+    sd->intra_only          = s->intra_only;
+    sd->chroma_y_shift      = s->chroma_y_shift;
+    sd->linesize            = s->linesize;
+    sd->uvlinesize          = s->uvlinesize;
+    sd->h_edge_pos          = s->h_edge_pos;
+    sd->v_edge_pos          = s->v_edge_pos;
+    sd->mb_width            = s->mb_width;
+    sd->mb_height           = s->mb_height;
+    sd->mb_stride           = s->mb_stride;
+    sd->resync_mb_x         = s->resync_mb_x;
+    sd->resync_mb_y         = s->resync_mb_y;
+    sd->qscale              = s->qscale;
+
+    hd->h264dsp                = h->h264dsp;
+    hd->sps                    = h->sps;
+    hd->pps                    = h->pps;
+    hd->pixel_shift            = h->pixel_shift;
+    hd->deblocking_filter      = h->deblocking_filter;
+    hd->slice_alpha_c0_offset  = h->slice_alpha_c0_offset;
+    hd->slice_beta_offset      = h->slice_beta_offset;
+    hd->qp_thresh              = h->qp_thresh;
+    hd->slice_type             = h->slice_type;
+    hd->mb_aff_frame           = h->mb_aff_frame;
+    hd->mb_field_decoding_flag = h->mb_field_decoding_flag;
+    hd->mb_mbaff               = h->mb_mbaff;
+    hd->emu_edge_height        = h->emu_edge_height;
+    hd->b_stride               = h->b_stride;
+    hd->mb2b_xy                = h->mb2b_xy;
+    hd->slice_table            = h->slice_table;
+    hd->list_counts            = h->list_counts;
+    hd->cbp_table              = h->cbp_table;
+    hd->non_zero_count         = h->non_zero_count;
+    memcpy(hd->ref2frm, h->ref2frm, sizeof(h->ref2frm));
+
+    hd->deblock_pass      = h->deblock_pass;
+    hd->deblock_pipelined = 1;
+    hd->deblock_end_mb_x  = 0;
+}
+
+static int decode_slice(struct AVCodecContext *avctx, void *arg){
+    H264Context *h = *(void**)arg;
+    MpegEncContext * const s = &h->s;
+    H264Context *hd;
+    int ret;
+
+    if(!(avctx->active_thread_type&FF_THREAD_PIPELINE) || !h->deblocking_filter ||
+       FRAME_MBAFF || s->picture_structure != PICT_FRAME)
+        return decode_slice_mbs(h);
+
+    if(!h->deblock_ctx && !(h->deblock_ctx = av_mallocz(sizeof(H264Context))))
+        return decode_slice_mbs(h);
+    if(!h->deblock_pass && ff_thread_pass_init(avctx, &h->deblock_pass) < 0)
+        return decode_slice_mbs(h);
+
+    hd = h->deblock_ctx;
+    h->deblock_pipelined = 1;
+    copy_deblock_ctx(hd, h);
+    ff_thread_pass_start(h->deblock_pass, deblock_slice_rows, hd);
+
+    ret = decode_slice_mbs(h);
+
+    hd->deblock_end_mb_y = s->mb_y;
+    ff_thread_pass_report(h->deblock_pass, INT_MAX);
+    ff_thread_pass_finish(h->deblock_pass);
+    h->deblock_pipelined = 0;
+
+    return ret;
+}
+
 /**
  * Call decode_slice() for each context.
  *
@@ -2975,6 +3312,12 @@ static int decode_nal_units(H264Context *h, const uint8_t *buf, int buf_size){
            (avctx->skip_frame >= AVDISCARD_NONREF && h->nal_ref_idc  == 0))
             continue;
 
+        if(avctx->deadline_level >= FF_DEADLINE_DROP_NONREF && hx->nal_ref_idc == 0 &&
+           hx->nal_unit_type >= NAL_SLICE && hx->nal_unit_type <= NAL_DPC){
+            h->deadline_degraded = FF_DEADLINE_DROP_NONREF;
+            continue;
+        }
+
       again:
         err = 0;
         switch(hx->nal_unit_type){
@@ -3180,17 +3523,23 @@ static int decode_frame(AVCodecContext *avctx,
         return 0;
     }
 
+    h->deadline_degraded = 0;
     buf_index=decode_nal_units(h, buf, buf_size);
     if(buf_index < 0)
         return -1;
 
+    if(h->deadline_degraded == FF_DEADLINE_DROP_NONREF)
+        avctx->deadline_drop_count++;
+    else if(h->deadline_degraded == FF_DEADLINE_SKIP_LOOP_FILTER)
+        avctx->deadline_skip_loop_filter_count++;
+
     if (!s->current_picture_ptr && h->nal_unit_type == NAL_END_SEQUENCE) {
         buf_size = 0;
         goto out;
     }
 
     if(!(s->flags2 & CODEC_FLAG2_CHUNKS) && !s->current_picture_ptr){
-        if (avctx->skip_frame >= AVDISCARD_NONREF
+        if (avctx->skip_frame >= AVDISCARD_NONREF || h->deadline_degraded == FF_DEADLINE_DROP_NONREF
 #if FF_API_HURRY_UP
                 || s->hurry_up
 #endif
@@ -3424,6 +3773,9 @@ av_cold void ff_h264_free_context(H264Context *h)
 
     free_tables(h, 1); //FIXME cleanup init stuff perhaps
 
+    av_freep(&h->dequant4_buffer);
+    av_freep(&h->dequant8_buffer);
+
     for(i = 0; i < MAX_SPS_COUNT; i++)
         av_freep(h->sps_buffers + i);
 
@@ -3471,12 +3823,14 @@ AVCodec ff_h264_decoder = {
     NULL,
     ff_h264_decode_end,
     decode_frame,
-    /*CODEC_CAP_DRAW_HORIZ_BAND |*/ CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
+    /*CODEC_CAP_DRAW_HORIZ_BAND |*/ CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS |
+    CODEC_CAP_PIPELINE_THREADS,
     .flush= flush_dpb,
     .long_name = NULL_IF_CONFIG_SMALL("H.264 / AVC / MPEG-4 AVC / MPEG-4 part 10"),
     .init_thread_copy      = ONLY_IF_THREADS_ENABLED(decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(decode_update_thread_context),
     .profiles = NULL_IF_CONFIG_SMALL(profiles),
+    .memory_usage = decode_memory_usage,
 };
 
 #if CONFIG_H264_VDPAU_DECODER
@@ -3494,5 +3848,6 @@ AVCodec ff_h264_vdpau_decoder = {
     .long_name = NULL_IF_CONFIG_SMALL("H.264 / AVC / MPEG-4 AVC / MPEG-4 part 10 (VDPAU acceleration)"),
     .pix_fmts = (const enum PixelFormat[]){PIX_FMT_VDPAU_H264, PIX_FMT_NONE},
     .profiles = NULL_IF_CONFIG_SMALL(profiles),
+    .memory_usage = decode_memory_usage,
 };
 #endif
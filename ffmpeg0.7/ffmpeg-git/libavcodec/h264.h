@@ -355,8 +355,13 @@ typedef struct H264Context{
      */
     PPS pps; //FIXME move to Picture perhaps? (->no) do we need that?
 
-    uint32_t dequant4_buffer[6][QP_MAX_MAX+1][16]; //FIXME should these be moved down?
-    uint32_t dequant8_buffer[2][QP_MAX_MAX+1][64];
+    /**
+     * Dequantization tables of non-flat scaling matrices, [6] and [2] entries.
+     * Allocated when first needed, flat matrices use tables shared by all
+     * contexts. Slice thread contexts point into the main context's tables.
+     */
+    uint32_t (*dequant4_buffer)[QP_MAX_MAX+1][16];
+    uint32_t (*dequant8_buffer)[QP_MAX_MAX+1][64];
     uint32_t (*dequant4_coeff[6])[16];
     uint32_t (*dequant8_coeff[2])[64];
 
@@ -475,6 +480,15 @@ typedef struct H264Context{
 
     int dequant_coeff_pps;     ///< reinit tables when pps changes
 
+    /**
+     * The parameter sets and dequantization tables are identified by the
+     * context that last changed them and the value of its change counter.
+     * Frame threads only copy them if these differ.
+     */
+    void *ps_owner;
+    unsigned int ps_generation;
+    unsigned int ps_counter;   ///< number of changes made by this context
+
     uint16_t *slice_table_base;
 
 
@@ -595,6 +609,19 @@ typedef struct H264Context{
     int sei_buffering_period_present;  ///< Buffering period SEI flag
     int initial_cpb_removal_delay[32]; ///< Initial timestamps for CPBs
 
+    /**
+     * Pipelined deblocking, see FF_THREAD_PIPELINE.
+     * deblock_pass filters the rows with deblock_ctx, which gets the
+     * state the loop filter reads at the start of each slice.
+     */
+    struct ThreadPass *deblock_pass;
+    struct H264Context *deblock_ctx;
+    int deblock_pipelined;             ///< Set while the rows of the current slice are filtered by deblock_pass.
+    int deblock_end_mb_x;              ///< In deblock_ctx: number of MBs of the last, incomplete row to filter.
+    int deblock_end_mb_y;              ///< In deblock_ctx: first row that is not complete.
+
+    int deadline_degraded;             ///< FF_DEADLINE_* step taken for the current packet, 0 if none
+
     //SVQ3 specific fields
     int halfpel_flag;
     int thirdpel_flag;
@@ -780,6 +807,14 @@ static inline int get_chroma_qp(H264Context *h, int t, int qscale){
     return h->pps.chroma_qp_table[t][qscale];
 }
 
+/**
+ * Mark sps_buffers, pps_buffers and the dequantization tables as changed.
+ */
+static inline void param_sets_changed(H264Context *h){
+    h->ps_owner      = h;
+    h->ps_generation = ++h->ps_counter;
+}
+
 static inline void pred_pskip_motion(H264Context * const h, int * const mx, int * const my);
 
 static void fill_decode_neighbors(H264Context *h, int mb_type){
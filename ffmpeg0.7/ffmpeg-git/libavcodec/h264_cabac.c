@@ -36,9 +36,9 @@
 #include "golomb.h"
 
 #include "cabac.h"
-//#if ARCH_X86
-//#include "x86/h264_i386.h"
-//#endif
+#if ARCH_X86
+#include "x86/h264_i386.h"
+#endif
 
 //#undef NDEBUG
 #include <assert.h>
@@ -1037,7 +1037,7 @@ static av_always_inline void decode_cabac_residual_internal( H264Context *h, DCT
     uint8_t *last_coeff_ctx_base;
     uint8_t *abs_level_m1_ctx_base;
 
-#if !ARCH_X86
+#if !ARCH_X86 || ARCH_X86_64
 #define CABAC_ON_STACK
 #endif
 #ifdef CABAC_ON_STACK
@@ -1074,10 +1074,12 @@ static av_always_inline void decode_cabac_residual_internal( H264Context *h, DCT
             index[coeff_count++] = last;\
         }
         const uint8_t *sig_off = significant_coeff_flag_offset_8x8[MB_FIELD];
-#if ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
-        coeff_count= decode_significance_8x8_x86(CC, significant_coeff_ctx_base, index, sig_off);
+#ifdef decode_significance
+        coeff_count= decode_significance_8x8(CC, significant_coeff_ctx_base, index,
+                                             last_coeff_ctx_base, sig_off);
     } else {
-        coeff_count= decode_significance_x86(CC, max_coeff, significant_coeff_ctx_base, index);
+        coeff_count= decode_significance(CC, max_coeff, significant_coeff_ctx_base, index,
+                                         last_coeff_ctx_base-significant_coeff_ctx_base);
 #else
         DECODE_SIGNIFICANCE( 63, sig_off[last], last_coeff_flag_offset_8x8[last] );
     } else {
@@ -434,6 +434,7 @@ int ff_h264_decode_seq_parameter_set(H264Context *h){
     av_free(h->sps_buffers[sps_id]);
     h->sps_buffers[sps_id]= sps;
     h->sps = *sps;
+    param_sets_changed(h);
     return 0;
 fail:
     av_free(sps);
@@ -560,6 +561,7 @@ int ff_h264_decode_picture_parameter_set(H264Context *h, int bit_length){
 
     av_free(h->pps_buffers[pps_id]);
     h->pps_buffers[pps_id]= pps;
+    param_sets_changed(h);
     return 0;
 fail:
     av_free(pps);
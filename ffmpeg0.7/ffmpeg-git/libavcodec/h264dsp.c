@@ -26,6 +26,7 @@
  */
 
 #include <stdint.h>
+#include "libavutil/intreadwrite.h"
 #include "avcodec.h"
 #include "h264dsp.h"
 
@@ -41,6 +42,25 @@
 #include "h264dsp_internal.h"
 #undef BIT_DEPTH
 
+static int startcode_find_candidate_c(const uint8_t *buf, int size)
+{
+    int i = 0;
+
+#if HAVE_FAST_UNALIGNED
+#    if HAVE_FAST_64BIT
+    while (i + 8 <= size && !((~AV_RN64(buf + i) & (AV_RN64(buf + i) - 0x0101010101010101ULL)) & 0x8080808080808080ULL))
+        i += 8;
+#    else
+    while (i + 4 <= size && !((~AV_RN32(buf + i) & (AV_RN32(buf + i) - 0x01010101U)) & 0x80808080U))
+        i += 4;
+#    endif
+#endif
+    for (; i < size; i++)
+        if (!buf[i])
+            break;
+    return i;
+}
+
 void ff_h264dsp_init(H264DSPContext *c, const int bit_depth)
 {
 #undef FUNC
@@ -101,7 +121,12 @@ void ff_h264dsp_init(H264DSPContext *c, const int bit_depth)
             break;
     }
 
+    c->startcode_find_candidate = startcode_find_candidate_c;
+
     //if (ARCH_ARM) ff_h264dsp_init_arm(c, bit_depth);
     //if (HAVE_ALTIVEC) ff_h264dsp_init_ppc(c, bit_depth);
     //if (HAVE_MMX) ff_h264dsp_init_x86(c, bit_depth);
+#if HAVE_MMX
+    ff_h264dsp_startcode_init_x86(c);
+#endif
 }
@@ -0,0 +1,215 @@
+/*
+ * H.264 quarterpel motion compensation test and benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Checks the optimized put/avg_h264_qpel functions against the C versions
+ * and compares their speed.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/lfg.h"
+#include "avcodec.h"
+#include "dsputil.h"
+
+#undef exit
+#undef printf
+
+#define WIDTH  64
+#define HEIGHT 64
+
+#define NB_ITS       200
+#define NB_ITS_SPEED 4000
+#define NB_ROUNDS    5
+
+DECLARE_ALIGNED(16, static uint8_t, img)[WIDTH * HEIGHT];
+DECLARE_ALIGNED(16, static uint8_t, dst_init)[WIDTH * 16];
+DECLARE_ALIGNED(16, static uint8_t, dst_ref)[WIDTH * 16];
+DECLARE_ALIGNED(16, static uint8_t, dst_new)[WIDTH * 16];
+
+static const struct {
+    const char *name;
+    int flags;
+} cpus[] = {
+    { "MMX2",  AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 },
+    { "SSE2",  AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2 },
+    { "SSSE3", AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2 |
+               AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSSE3 },
+    { "AVX",   AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2 |
+               AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSSE3 | AV_CPU_FLAG_AVX },
+};
+
+static AVLFG prng;
+static int verbose;
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void fill_random(uint8_t *tab, int size)
+{
+    int i;
+    for (i = 0; i < size; i++)
+        tab[i] = av_lfg_get(&prng);
+}
+
+static uint8_t *random_block(int size)
+{
+    int x = 3 + av_lfg_get(&prng) % (WIDTH  - size - 6);
+    int y = 3 + av_lfg_get(&prng) % (HEIGHT - size - 6);
+    return img + y * WIDTH + x;
+}
+
+static int check(const char *name, int size, int mc,
+                 qpel_mc_func test_func, qpel_mc_func ref_func)
+{
+    int it, y;
+
+    for (it = 0; it < NB_ITS; it++) {
+        uint8_t *src = random_block(size);
+
+        fill_random(dst_init, sizeof(dst_init));
+        memcpy(dst_ref, dst_init, sizeof(dst_init));
+        memcpy(dst_new, dst_init, sizeof(dst_init));
+        ref_func (dst_ref, src, WIDTH);
+        test_func(dst_new, src, WIDTH);
+        emms_c();
+
+        for (y = 0; y < size; y++) {
+            if (memcmp(dst_ref + y * WIDTH, dst_new + y * WIDTH, size)) {
+                printf("error: %s %dx%d mc%d%d differs from C\n",
+                       name, size, size, mc & 3, mc >> 2);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* average time of one call in ns, best of NB_ROUNDS runs */
+static double speed(int size, qpel_mc_func func)
+{
+    uint8_t *src[16];
+    int64_t ti, best = INT64_MAX;
+    int it, round;
+
+    for (it = 0; it < 16; it++)
+        src[it] = random_block(size);
+
+    for (round = 0; round < NB_ROUNDS; round++) {
+        ti = gettime();
+        for (it = 0; it < NB_ITS_SPEED; it++)
+            func(dst_new, src[it & 15], WIDTH);
+        emms_c();
+        ti = gettime() - ti;
+        best = FFMIN(best, ti);
+    }
+
+    return best * 1000.0 / NB_ITS_SPEED;
+}
+
+static void help(void)
+{
+    printf("h264qpel-test [-h] [-v]\n"
+           "test and benchmark the H.264 quarterpel motion compensation functions\n"
+           "-v          print the time of each subpel position\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const char *ops[2] = { "put", "avg" };
+    AVCodecContext *avctx;
+    DSPContext cdsp, dsp;
+    double ref_time[2][3] = { { 0 } };
+    int cpu_flags = ff_get_cpu_flags_x86();
+    int c, i, op, idx, mc, errors = 0;
+
+    for (;;) {
+        c = getopt(argc, argv, "hv");
+        if (c == -1)
+            break;
+        switch (c) {
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+        case 'h':
+            help();
+            return 0;
+        }
+    }
+
+    printf("ffmpeg H.264 qpel test\n");
+
+    av_lfg_init(&prng, 1);
+    fill_random(img, sizeof(img));
+
+    avctx = avcodec_alloc_context();
+    avctx->dsp_mask = 0xffff;
+    dsputil_init(&cdsp, avctx);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(cpus); i++) {
+        if (~cpu_flags & cpus[i].flags)
+            continue;
+        /* av_get_cpu_flags() may not report anything, in which case the
+         * wanted set has to be forced instead of masked */
+        if (av_get_cpu_flags())
+            avctx->dsp_mask = 0xffff & ~cpus[i].flags;
+        else
+            avctx->dsp_mask = AV_CPU_FLAG_FORCE | cpus[i].flags;
+        dsputil_init(&dsp, avctx);
+
+        for (op = 0; op < 2; op++) {
+            qpel_mc_func (*ref)[16]  = op ? cdsp.avg_h264_qpel_pixels_tab : cdsp.put_h264_qpel_pixels_tab;
+            qpel_mc_func (*test)[16] = op ? dsp.avg_h264_qpel_pixels_tab  : dsp.put_h264_qpel_pixels_tab;
+
+            for (idx = 0; idx < 3; idx++) {
+                int size = 16 >> idx;
+                double total = 0;
+
+                for (mc = 0; mc < 16; mc++) {
+                    double t;
+                    errors += check(cpus[i].name, size, mc, test[idx][mc], ref[idx][mc]);
+                    t = speed(size, test[idx][mc]);
+                    if (verbose)
+                        printf("%-5s %s %2dx%-2d mc%d%d: %7.1f ns\n", cpus[i].name,
+                               ops[op], size, size, mc & 3, mc >> 2, t);
+                    total += t;
+                }
+                if (!i)
+                    ref_time[op][idx] = total;
+                printf("%-5s %s %2dx%-2d: %7.1f ns/call, %.2fx MMX2\n", cpus[i].name,
+                       ops[op], size, size, total / 16, ref_time[op][idx] / total);
+            }
+        }
+    }
+    av_free(avctx);
+
+    return !!errors;
+}
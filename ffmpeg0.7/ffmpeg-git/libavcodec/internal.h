@@ -50,4 +50,18 @@ FFMPEGLIB_API int ff_match_2uint16(const uint16_t (*tab)[2], int size, int a, in
 
 FFMPEGLIB_API unsigned int ff_toupper4(unsigned int x);
 
+/**
+ * Add the memory used by a single codec context to usage: the context and
+ * its priv_data, the tables reported by AVCodec.memory_usage and the
+ * buffers of the default get_buffer().
+ */
+void ff_codec_context_memory_usage(AVCodecContext *avctx, AVCodecMemoryUsage *usage);
+
+/**
+ * Same as av_resample() for interleaved stereo, src_size and dst_size
+ * count samples per channel.
+ */
+int ff_resample_stereo(struct AVResampleContext *c, short *dst, const short *src,
+                       int *consumed, int src_size, int dst_size, int update_ctx);
+
 #endif /* AVCODEC_INTERNAL_H */
@@ -372,6 +372,8 @@ AVCodec ff_jpegls_decoder = {
     NULL,
     ff_mjpeg_decode_end,
     ff_mjpeg_decode_frame,
-    CODEC_CAP_DR1,
+    CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
     .long_name = NULL_IF_CONFIG_SMALL("JPEG-LS"),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_mjpeg_update_thread_context),
 };
@@ -30,6 +30,10 @@
 #include "fft.h"
 #include "fft-internal.h"
 
+#if ARCH_X86
+#include "x86/mdct_float.h"
+#endif
+
 /**
  * @file
  * MDCT/IMDCT transforms.
@@ -84,6 +88,9 @@ av_cold int ff_mdct_init(FFTContext *s, int nbits, int inverse, double scale)
         s->tcos[i*tstep] = FIX15(-cos(alpha) * scale);
         s->tsin[i*tstep] = FIX15(-sin(alpha) * scale);
     }
+#ifdef mdct_init_simd
+    mdct_init_simd(s);
+#endif
     return 0;
  fail:
     ff_mdct_end(s);
@@ -145,7 +152,7 @@ void ff_imdct_calc_c(FFTContext *s, FFTSample *output, const FFTSample *input)
     int n2 = n >> 1;
     int n4 = n >> 2;
 
-    ff_imdct_half_c(s, output+n4, input);
+    s->imdct_half(s, output+n4, input);
 
     for(k = 0; k < n4; k++) {
         output[k] = -output[n2-k-1];
@@ -39,6 +39,7 @@
 #include "mjpeg.h"
 #include "mjpegdec.h"
 #include "jpeglsdec.h"
+#include "thread.h"
 
 
 static int build_vlc(VLC *vlc, const uint8_t *bits_table, const uint8_t *val_table,
@@ -115,6 +116,129 @@ av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static int copy_vlc(VLC *dst, const VLC *src)
+{
+    if (!src->table) {
+        free_vlc(dst);
+        memset(dst, 0, sizeof(*dst));
+        return 0;
+    }
+    if (dst->table_allocated < src->table_size) {
+        free_vlc(dst);
+        dst->table = av_malloc(src->table_size * sizeof(*dst->table));
+        if (!dst->table) {
+            dst->table_allocated = 0;
+            return AVERROR(ENOMEM);
+        }
+        dst->table_allocated = src->table_size;
+    }
+    dst->bits       = src->bits;
+    dst->table_size = src->table_size;
+    memcpy(dst->table, src->table, src->table_size * sizeof(*dst->table));
+    return 0;
+}
+
+av_cold int ff_mjpeg_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    VLC vlcs[3][4];
+    int i, j;
+
+    memcpy(vlcs, s->vlcs, sizeof(vlcs));
+
+    s->avctx = avctx;
+    s->buffer_size = 0;
+    s->buffer = NULL;
+    s->qscale_table = NULL;
+    s->ljpeg_buffer = NULL;
+    s->ljpeg_buffer_size = 0;
+    memset(s->blocks,   0, sizeof(s->blocks));
+    memset(s->last_nnz, 0, sizeof(s->last_nnz));
+    memset(s->vlcs,     0, sizeof(s->vlcs));
+    memset(&s->picture, 0, sizeof(s->picture));
+
+    /* the tables still point to the ones of the main context */
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 4; j++)
+            if (copy_vlc(&s->vlcs[i][j], &vlcs[i][j]) < 0)
+                return AVERROR(ENOMEM);
+    return 0;
+}
+
+static void release_picture(MJpegDecodeContext *s)
+{
+    if (s->picture_borrowed)
+        memset(&s->picture, 0, sizeof(s->picture));
+    else if (s->picture.data[0])
+        ff_thread_release_buffer(s->avctx, &s->picture);
+    s->picture_borrowed = 0;
+}
+
+/**
+ * Carry over the state a JPEG stream may keep between pictures:
+ * tables that are only sent once, the picture size and the flags
+ * set by APPx/COM markers.
+ * If the previous packet held only the first field of an interlaced
+ * picture, the second field is decoded into the same picture.
+ */
+int ff_mjpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    MJpegDecodeContext *s = dst->priv_data, *s1 = src->priv_data;
+    int i, j;
+
+    if (s == s1)
+        return 0;
+
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 4; j++)
+            if (copy_vlc(&s->vlcs[i][j], &s1->vlcs[i][j]) < 0)
+                return AVERROR(ENOMEM);
+
+    memcpy(s->quant_matrixes, s1->quant_matrixes, sizeof(s->quant_matrixes));
+    memcpy(s->qscale,         s1->qscale,         sizeof(s->qscale));
+
+    if (s->width != s1->width || !s->qscale_table) {
+        av_freep(&s->qscale_table);
+        s->qscale_table = av_mallocz((s1->width+15)/16);
+        if (!s->qscale_table)
+            return AVERROR(ENOMEM);
+    }
+    s->width         = s1->width;
+    s->height        = s1->height;
+    s->org_height    = s1->org_height;
+    s->first_picture = s1->first_picture;
+    s->interlaced    = s1->interlaced;
+    s->bottom_field  = s1->bottom_field;
+    if (s1->interlaced && s1->bottom_field == !s1->interlace_polarity &&
+        s1->picture.data[0]) {
+        release_picture(s);
+        s->picture = s1->picture;
+        s->picture_borrowed = 1;
+        memcpy(s->linesize, s1->linesize, sizeof(s->linesize));
+    } else {
+        if (s->picture_borrowed)
+            release_picture(s);
+        s->picture.interlaced_frame = s1->picture.interlaced_frame;
+        s->picture.top_field_first  = s1->picture.top_field_first;
+    }
+
+    s->rct                = s1->rct;
+    s->pegasus_rct        = s1->pegasus_rct;
+    s->buggy_avid         = s1->buggy_avid;
+    s->cs_itu601          = s1->cs_itu601;
+    s->interlace_polarity = s1->interlace_polarity;
+    s->flipped            = s1->flipped;
+
+    s->maxval = s1->maxval;
+    s->near   = s1->near;
+    s->t1     = s1->t1;
+    s->t2     = s1->t2;
+    s->t3     = s1->t3;
+    s->reset  = s1->reset;
+
+    return 0;
+}
+
 
 /* quantize tables */
 int ff_mjpeg_decode_dqt(MJpegDecodeContext *s)
@@ -342,11 +466,10 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
             s->avctx->pix_fmt = PIX_FMT_GRAY16;
     }
 
-    if(s->picture.data[0])
-        s->avctx->release_buffer(s->avctx, &s->picture);
+    release_picture(s);
 
     s->picture.reference= 0;
-    if(s->avctx->get_buffer(s->avctx, &s->picture) < 0){
+    if(ff_thread_get_buffer(s->avctx, &s->picture) < 0){
         av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return -1;
     }
@@ -1260,6 +1383,22 @@ found:
     return val;
 }
 
+/**
+ * Check whether anything after the current position may still change
+ * the state ff_mjpeg_update_thread_context() hands to the next frame.
+ */
+static int setup_markers_follow(const uint8_t *buf_ptr, const uint8_t *buf_end)
+{
+    int start_code;
+
+    while ((start_code = find_marker(&buf_ptr, buf_end)) >= 0) {
+        if (start_code != SOS && start_code != EOI && start_code != SOI &&
+            (start_code < RST0 || start_code > RST7))
+            return 1;
+    }
+    return 0;
+}
+
 int ff_mjpeg_decode_frame(AVCodecContext *avctx,
                               void *data, int *data_size,
                               AVPacket *avpkt)
@@ -1270,6 +1409,7 @@ int ff_mjpeg_decode_frame(AVCodecContext *avctx,
     const uint8_t *buf_end, *buf_ptr;
     int start_code;
     AVFrame *picture = data;
+    int setup_finished = 0;
 
     s->got_picture = 0; // picture from previous image can not be reused
     buf_ptr = buf;
@@ -1466,6 +1606,13 @@ eoi_parser:
                         av_log(avctx, AV_LOG_WARNING, "Can not process SOS before SOF, skipping\n");
                         break;
                     }
+                    /* with interlacing the next packet may continue this
+                     * picture, so it waits until this one is decoded */
+                    if (!setup_finished && avctx->active_thread_type&FF_THREAD_FRAME &&
+                        !s->interlaced && !setup_markers_follow(buf_ptr, buf_end)) {
+                        ff_thread_finish_setup(avctx);
+                        setup_finished = 1;
+                    }
                     ff_mjpeg_decode_sos(s);
                     /* buggy avid puts EOI every 10-20th frame */
                     /* if restart period is over process EOI */
@@ -1517,7 +1664,7 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     MJpegDecodeContext *s = avctx->priv_data;
     int i, j;
 
-    if (s->picture.data[0])
+    if (s->picture.data[0] && !s->picture_borrowed)
         avctx->release_buffer(avctx, &s->picture);
 
     av_free(s->buffer);
@@ -1545,10 +1692,12 @@ AVCodec ff_mjpeg_decoder = {
     NULL,
     ff_mjpeg_decode_end,
     ff_mjpeg_decode_frame,
-    CODEC_CAP_DR1,
+    CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
     NULL,
     .max_lowres = 3,
     .long_name = NULL_IF_CONFIG_SMALL("MJPEG (Motion JPEG)"),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_mjpeg_update_thread_context),
 };
 
 AVCodec ff_thp_decoder = {
@@ -1560,8 +1709,10 @@ AVCodec ff_thp_decoder = {
     NULL,
     ff_mjpeg_decode_end,
     ff_mjpeg_decode_frame,
-    CODEC_CAP_DR1,
+    CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
     NULL,
     .max_lowres = 3,
     .long_name = NULL_IF_CONFIG_SMALL("Nintendo Gamecube THP video"),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_mjpeg_update_thread_context),
 };
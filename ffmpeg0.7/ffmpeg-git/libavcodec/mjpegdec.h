@@ -102,12 +102,15 @@ typedef struct MJpegDecodeContext {
 
     int cur_scan; /* current scan, used by JPEG-LS */
     int flipped; /* true if picture is flipped */
+    int picture_borrowed; /* picture is released by the thread that decoded its first field */
 
     uint16_t (*ljpeg_buffer)[4];
     unsigned int ljpeg_buffer_size;
 } MJpegDecodeContext;
 
 int ff_mjpeg_decode_init(AVCodecContext *avctx);
+int ff_mjpeg_decode_init_thread_copy(AVCodecContext *avctx);
+int ff_mjpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src);
 int ff_mjpeg_decode_end(AVCodecContext *avctx);
 int ff_mjpeg_decode_frame(AVCodecContext *avctx,
                           void *data, int *data_size,
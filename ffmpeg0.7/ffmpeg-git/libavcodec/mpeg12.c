@@ -1195,8 +1195,15 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx, const AVCode
     err = ff_mpeg_update_thread_context(avctx, avctx_from);
     if(err) return err;
 
-    if(!ctx->mpeg_enc_ctx_allocated)
-        memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+    /* sync and the saved sequence parameters must follow a flush */
+    memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+
+    /* sequence headers and quant matrix extensions persist across pictures */
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+    s->closed_gop = s1->closed_gop;
 
     if(!(s->pict_type == FF_B_TYPE || s->low_delay))
         s->picture_number++;
@@ -1278,6 +1285,9 @@ static int mpeg_decode_postinit(AVCodecContext *avctx){
     Mpeg1Context *s1 = avctx->priv_data;
     MpegEncContext *s = &s1->mpeg_enc_ctx;
     uint8_t old_permutation[64];
+    /* the other frame threads may still reference the old pictures */
+    int size_change = s1->mpeg_enc_ctx_allocated &&
+                      HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME;
 
     if (
         (s1->mpeg_enc_ctx_allocated == 0)||
@@ -1290,7 +1300,7 @@ static int mpeg_decode_postinit(AVCodecContext *avctx){
         0)
     {
 
-        if (s1->mpeg_enc_ctx_allocated) {
+        if (s1->mpeg_enc_ctx_allocated && !size_change) {
             ParseContext pc= s->parse_context;
             s->parse_context.buffer=0;
             MPV_common_end(s);
@@ -1380,7 +1390,10 @@ static int mpeg_decode_postinit(AVCodecContext *avctx){
          * if DCT permutation is changed. */
         memcpy(old_permutation,s->dsp.idct_permutation,64*sizeof(uint8_t));
 
-        if (MPV_common_init(s) < 0)
+        if (size_change) {
+            if (MPV_common_frame_size_change(s) < 0)
+                return -2;
+        } else if (MPV_common_init(s) < 0)
             return -2;
 
         quant_matrix_rebuild(s->intra_matrix,       old_permutation,s->dsp.idct_permutation);
@@ -1670,7 +1683,10 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
 
         *s->current_picture_ptr->pan_scan= s1->pan_scan;
 
-        if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+        /* for field pairs the next thread must not start
+         * before the second field has toggled first_field back */
+        if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME &&
+            s->picture_structure==PICT_FRAME)
             ff_thread_finish_setup(avctx);
     }else{ //second field
             int i;
@@ -1680,6 +1696,9 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
                 return -1;
             }
 
+            if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+                ff_thread_finish_setup(avctx);
+
             for(i=0; i<4; i++){
                 s->current_picture.data[i] = s->current_picture_ptr->data[i];
                 if(s->picture_structure == PICT_BOTTOM_FIELD){
@@ -2474,7 +2493,7 @@ static int decode_chunks(AVCodecContext *avctx,
                             break;
                     }
                 }
-                if(s2->pict_type==FF_I_TYPE)
+                if(s2->pict_type==FF_I_TYPE && !s->sync)
                     s->sync=1;
                 if(s2->next_picture_ptr==NULL){
                 /* Skip P-frames if we do not have a reference frame or we have an invalid header. */
@@ -2590,7 +2609,8 @@ AVCodec ff_mpeg1video_decoder = {
     NULL,
     mpeg_decode_end,
     mpeg_decode_frame,
-    CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 | CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY,
+    CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 | CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
+    CODEC_CAP_FRAME_THREADS,
     .flush= flush,
     .max_lowres= 3,
     .long_name= NULL_IF_CONFIG_SMALL("MPEG-1 video"),
@@ -2606,11 +2626,13 @@ AVCodec ff_mpeg2video_decoder = {
     NULL,
     mpeg_decode_end,
     mpeg_decode_frame,
-    CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 | CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY,
+    CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 | CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
+    CODEC_CAP_FRAME_THREADS,
     .flush= flush,
     .max_lowres= 3,
     .long_name= NULL_IF_CONFIG_SMALL("MPEG-2 video"),
     .profiles = NULL_IF_CONFIG_SMALL(mpeg2_video_profiles),
+    .update_thread_context= ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context)
 };
 
 //legacy decoder
@@ -2623,10 +2645,12 @@ AVCodec ff_mpegvideo_decoder = {
     NULL,
     mpeg_decode_end,
     mpeg_decode_frame,
-    CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 | CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY,
+    CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 | CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
+    CODEC_CAP_FRAME_THREADS,
     .flush= flush,
     .max_lowres= 3,
     .long_name= NULL_IF_CONFIG_SMALL("MPEG-1 video"),
+    .update_thread_context= ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context)
 };
 
 #if CONFIG_MPEG_XVMC_DECODER
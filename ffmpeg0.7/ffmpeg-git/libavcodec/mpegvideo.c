@@ -460,9 +460,35 @@ void ff_update_duplicate_context(MpegEncContext *dst, MpegEncContext *src){
 //STOP_TIMER("update_duplicate_context") //about 10k cycles / 0.01 sec for 1000frames on 1ghz with 2 threads
 }
 
+/**
+ * Reallocate the context tables for the current frame size, keeping the
+ * picture array. The tables of the pictures are reallocated when they are
+ * reused, see ff_find_unused_picture().
+ */
+static int reinit_tables(MpegEncContext *s)
+{
+    Picture *picture = s->picture;
+    ParseContext pc = s->parse_context;
+    int i, err;
+
+    for(i=0; i<s->picture_count; i++)
+        picture[i].needs_realloc = 1;
+
+    s->picture = NULL;
+    s->parse_context.buffer = NULL;
+    MPV_common_end(s);
+    s->parse_context = pc;
+
+    err = MPV_common_init(s);
+    av_free(s->picture);
+    s->picture = picture;
+    return err;
+}
+
 int ff_mpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
 {
     MpegEncContext *s = dst->priv_data, *s1 = src->priv_data;
+    int i, err, copied = 0;
 
     if(dst == src || !s1->context_initialized) return 0;
 
@@ -475,8 +501,17 @@ int ff_mpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src
         s->picture_range_end    += MAX_PICTURE_COUNT;
         s->bitstream_buffer      = NULL;
         s->bitstream_buffer_size = s->allocated_bitstream_buffer_size = 0;
+        s->packed_buffer         = NULL;
+        s->allocated_packed_buffer_size = 0;
 
         MPV_common_init(s);
+    }else if(s->width != s1->width || s->height != s1->height || s->mb_height != s1->mb_height){
+        /* the previous thread changed the frame size, see MPV_common_frame_size_change() */
+        s->width                = s1->width;
+        s->height               = s1->height;
+        s->progressive_sequence = s1->progressive_sequence;
+        err = reinit_tables(s);
+        if(err < 0) return err;
     }
 
     s->avctx->coded_height  = s1->avctx->coded_height;
@@ -488,8 +523,17 @@ int ff_mpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src
     s->picture_number       = s1->picture_number;
     s->input_picture_number = s1->input_picture_number;
 
-    memcpy(s->picture, s1->picture, s1->picture_count * sizeof(Picture));
+    /* Only the first few pictures of each thread's range are ever used,
+     * the tables of a picture stay allocated once it was used. */
+    for(i=0; i<s1->picture_count; i++){
+        if(!s1->picture[i].qscale_table && !s1->picture[i].data[0] &&
+           !s ->picture[i].qscale_table && !s ->picture[i].data[0])
+            continue;
+        s->picture[i] = s1->picture[i];
+        copied += sizeof(Picture);
+    }
     memcpy(&s->last_picture, &s1->last_picture, (char*)&s1->last_picture_ptr - (char*)&s1->last_picture);
+    copied += (char*)&s1->last_picture_ptr - (char*)&s1->last_picture;
 
     s->last_picture_ptr     = REBASE_PICTURE(s1->last_picture_ptr,    s, s1);
     s->current_picture_ptr  = REBASE_PICTURE(s1->current_picture_ptr, s, s1);
@@ -509,20 +553,23 @@ int ff_mpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src
     s->low_delay            = s1->low_delay;
     s->dropable             = s1->dropable;
 
-    //DivX handling (doesn't work)
+    //DivX handling
     s->divx_packed          = s1->divx_packed;
 
-    if(s1->bitstream_buffer){
+    if(s1->bitstream_buffer_size){
         if (s1->bitstream_buffer_size + FF_INPUT_BUFFER_PADDING_SIZE > s->allocated_bitstream_buffer_size)
             av_fast_malloc(&s->bitstream_buffer, &s->allocated_bitstream_buffer_size, s1->allocated_bitstream_buffer_size);
         s->bitstream_buffer_size  = s1->bitstream_buffer_size;
         memcpy(s->bitstream_buffer, s1->bitstream_buffer, s1->bitstream_buffer_size);
         memset(s->bitstream_buffer+s->bitstream_buffer_size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
-    }
+    }else
+        s->bitstream_buffer_size  = 0;
 
     //MPEG2/interlacing info
     memcpy(&s->progressive_sequence, &s1->progressive_sequence, (char*)&s1->rtp_mode - (char*)&s1->progressive_sequence);
 
+    ff_thread_report_copied(dst, copied + s->bitstream_buffer_size);
+
     if(!s1->first_field){
         s->last_pict_type= s1->pict_type;
         if (s1->current_picture_ptr) s->last_lambda_for[s1->pict_type] = s1->current_picture_ptr->quality;
@@ -770,6 +817,95 @@ av_cold int MPV_common_init(MpegEncContext *s)
     return -1;
 }
 
+static int64_t picture_memory_usage(MpegEncContext *s, Picture *pic)
+{
+    const int big_mb_num    = s->mb_stride*(s->mb_height+1) + 1;
+    const int mb_array_size = s->mb_stride*s->mb_height;
+    const int b8_array_size = s->b8_stride*s->mb_height*2;
+    const int b4_array_size = s->b4_stride*s->mb_height*4;
+    int64_t size = 0;
+
+    if (!pic->qscale_table)
+        return 0;
+
+    if (pic->mb_var)
+        size += mb_array_size * (2*sizeof(int16_t) + sizeof(int8_t));
+    size += mb_array_size * sizeof(uint8_t)+2;
+    size += mb_array_size * sizeof(uint8_t);
+    size += (big_mb_num + s->mb_stride) * sizeof(uint32_t);
+    if (pic->motion_val_base[0]) {
+        if (pic->motion_subsample_log2 == 2)
+            size += 2 * 2 * (b4_array_size+4) * sizeof(int16_t);
+        else
+            size += 2 * 2 * (b8_array_size+4) * sizeof(int16_t);
+        size += 2 * 4*mb_array_size * sizeof(uint8_t);
+    }
+    if (pic->dct_coeff)
+        size += 64 * mb_array_size * sizeof(DCTELEM)*6;
+    size += sizeof(AVPanScan);
+
+    return size;
+}
+
+int64_t ff_mpv_memory_usage(MpegEncContext *s)
+{
+    const int mb_array_size = s->mb_height * s->mb_stride;
+    const int mv_table_size = (s->mb_height+2) * s->mb_stride + 1;
+    const int y_size  = s->b8_stride * (2 * s->mb_height + 1);
+    const int c_size  = s->mb_stride * (s->mb_height + 1);
+    const int yc_size = y_size + 2 * c_size;
+    int threads = 1;
+    int64_t size = 0;
+    int i;
+
+    if (!s->context_initialized)
+        return 0;
+
+    size += s->picture_count * sizeof(Picture);
+    for (i = s->picture_range_start; i < s->picture_range_end; i++)
+        size += picture_memory_usage(s, &s->picture[i]);
+
+    size += (s->mb_num+1) * sizeof(int);                // mb_index2xy
+    size += mb_array_size * sizeof(uint8_t);            // error_status_table
+    size += mb_array_size + mb_array_size+2;            // mbintra_table, mbskip_table
+    size += PREV_PICT_TYPES_BUFFER_SIZE;
+    if (s->dc_val_base)
+        size += yc_size * sizeof(int16_t);
+    if (s->coded_block_base)
+        size += y_size + 2 * mb_array_size * sizeof(uint8_t);
+    if (s->p_field_select_table[0])
+        size += 2 * (2 * (3 * mv_table_size * 2 * sizeof(int16_t) + mb_array_size * 2 * sizeof(uint8_t))
+                     + mb_array_size * 2 * sizeof(uint8_t));
+    if (s->encoding) {
+        size += 6 * mv_table_size * 2 * sizeof(int16_t);
+        size += mb_array_size * (sizeof(uint16_t) + sizeof(int));
+        size += 2 * 64*32 * (sizeof(int) + 2*sizeof(uint16_t));
+        size += 2 * MAX_PICTURE_COUNT * sizeof(Picture*);
+    }
+    for (i = 0; i < 3; i++)
+        if (s->visualization_buffer[i])
+            size += (s->mb_width*16 + 2*EDGE_WIDTH) * s->mb_height*16 + 2*EDGE_WIDTH;
+
+    if (HAVE_THREADS && s->avctx->active_thread_type&FF_THREAD_SLICE)
+        threads = s->avctx->thread_count;
+    for (i = 0; i < threads; i++) {
+        MpegEncContext *t = s->thread_context[i];
+        if (!t)
+            continue;
+        if (i)
+            size += sizeof(MpegEncContext);
+        size += (s->width+64)*2*21*2;                   // edge_emu_buffer
+        size += (s->width+64)*4*16*2*sizeof(uint8_t);   // me.scratchpad
+        size += 64*12*2 * sizeof(DCTELEM);              // blocks
+        if (t->ac_val_base)
+            size += yc_size * sizeof(int16_t) * 16;
+        if (t->me.map)
+            size += 2 * ME_MAP_SIZE*sizeof(uint32_t);
+    }
+
+    return size;
+}
+
 /* init common structure for both encoder and decoder */
 void MPV_common_end(MpegEncContext *s)
 {
@@ -823,6 +959,8 @@ void MPV_common_end(MpegEncContext *s)
     av_freep(&s->prev_pict_types);
     av_freep(&s->bitstream_buffer);
     s->allocated_bitstream_buffer_size=0;
+    av_freep(&s->packed_buffer);
+    s->allocated_packed_buffer_size=0;
 
     av_freep(&s->avctx->stats_out);
     av_freep(&s->ac_stats);
@@ -856,6 +994,25 @@ void MPV_common_end(MpegEncContext *s)
         avcodec_default_free_buffers(s->avctx);
 }
 
+/**
+ * Reinitialize the context for a new frame size or interlacing mode while
+ * frame threading. The other threads may still reference the pictures,
+ * so the picture array is kept and only the reference pictures are
+ * released. The next threads follow in ff_mpeg_update_thread_context().
+ */
+int MPV_common_frame_size_change(MpegEncContext *s)
+{
+    int i;
+
+    for(i=0; i<s->picture_count; i++){
+        if(s->picture[i].data[0] && s->picture[i].reference &&
+           (s->picture[i].type == FF_BUFFER_TYPE_INTERNAL || s->picture[i].type == FF_BUFFER_TYPE_USER))
+            free_frame_buffer(s, &s->picture[i]);
+    }
+
+    return reinit_tables(s);
+}
+
 void init_rl(RLTable *rl, uint8_t static_store[2][2*MAX_RUN + MAX_LEVEL + 3])
 {
     int8_t max_level[MAX_RUN+1], max_run[MAX_LEVEL+1];
@@ -962,7 +1119,7 @@ void ff_release_unused_pictures(MpegEncContext *s, int remove_current)
     }
 }
 
-int ff_find_unused_picture(MpegEncContext *s, int shared){
+static int find_unused_picture(MpegEncContext *s, int shared){
     int i;
 
     if(shared){
@@ -994,6 +1151,18 @@ int ff_find_unused_picture(MpegEncContext *s, int shared){
     return -1;
 }
 
+int ff_find_unused_picture(MpegEncContext *s, int shared){
+    int i= find_unused_picture(s, shared);
+    Picture *pic= &s->picture[i];
+
+    if(pic->needs_realloc){
+        free_picture(s, pic);
+        avcodec_get_frame_defaults((AVFrame*)pic);
+        pic->needs_realloc= 0;
+    }
+    return i;
+}
+
 static void update_noise_reduction(MpegEncContext *s){
     int intra, i;
 
@@ -1172,7 +1341,8 @@ void MPV_frame_end(MpegEncContext *s)
     //just to make sure that all data is rendered.
     if(CONFIG_MPEG_XVMC_DECODER && s->avctx->xvmc_acceleration){
         //ff_xvmc_field_end(s);
-   }else if((s->error_count || s->encoding || !(s->avctx->codec->capabilities&CODEC_CAP_DRAW_HORIZ_BAND))
+   }else if((s->error_count || (s->encoding && !(s->avctx->active_thread_type&FF_THREAD_FRAME))
+             || (!s->encoding && !(s->avctx->codec->capabilities&CODEC_CAP_DRAW_HORIZ_BAND)))
        && !s->avctx->hwaccel
        && !(s->avctx->codec->capabilities&CODEC_CAP_HWACCEL_VDPAU)
        && s->unrestricted_mv
@@ -1205,7 +1375,8 @@ void MPV_frame_end(MpegEncContext *s)
     assert(i<MAX_PICTURE_COUNT);
 #endif
 
-    if(s->encoding){
+    /* frame threads release them in their next setup, see MPV_encode_picture() */
+    if(s->encoding && !(s->avctx->active_thread_type&FF_THREAD_FRAME)){
         /* release non-reference frames */
         for(i=0; i<s->picture_count; i++){
             if(s->picture[i].data[0] && !s->picture[i].reference /*&& s->picture[i].type!=FF_BUFFER_TYPE_SHARED*/){
@@ -1221,7 +1392,7 @@ void MPV_frame_end(MpegEncContext *s)
 #endif
     s->avctx->coded_frame= (AVFrame*)s->current_picture_ptr;
 
-    if (s->codec_id != CODEC_ID_H264 && s->current_picture.reference) {
+    if (s->codec_id != CODEC_ID_H264 && !s->encoding && s->current_picture.reference) {
         ff_thread_report_progress((AVFrame*)s->current_picture_ptr, s->mb_height-1, 0);
     }
 }
@@ -1894,7 +2065,7 @@ static inline void MPV_motion_lowres(MpegEncContext *s,
 int MPV_lowest_referenced_row(MpegEncContext *s, int dir)
 {
     int my_max = INT_MIN, my_min = INT_MAX, qpel_shift = !s->quarter_sample;
-    int my, off, i, mvs;
+    int my, off, i, mvs, field_off = 0;
 
     if (s->picture_structure != PICT_FRAME) goto unhandled;
 
@@ -1908,6 +2079,12 @@ int MPV_lowest_referenced_row(MpegEncContext *s, int dir)
         case MV_TYPE_8X8:
             mvs = 4;
             break;
+        case MV_TYPE_FIELD:
+            /* vectors are in field lines, and may select the opposite field */
+            mvs = 2;
+            qpel_shift++;
+            field_off = 4;
+            break;
         default:
             goto unhandled;
     }
@@ -1918,7 +2095,7 @@ int MPV_lowest_referenced_row(MpegEncContext *s, int dir)
         my_min = FFMIN(my_min, my);
     }
 
-    off = (FFMAX(-my_min, my_max) + 63) >> 6;
+    off = (FFMAX(-my_min, my_max) + field_off + 63) >> 6;
 
     return FFMIN(FFMAX(s->mb_y + off, 0), s->mb_height-1);
 unhandled:
@@ -2619,6 +2796,6 @@ void ff_set_qscale(MpegEncContext * s, int qscale)
 
 void MPV_report_decode_progress(MpegEncContext *s)
 {
-    if (s->pict_type != FF_B_TYPE && !s->partitioned_frame)
+    if (s->pict_type != FF_B_TYPE && !s->partitioned_frame && !s->first_field)
         ff_thread_report_progress((AVFrame*)s->current_picture_ptr, s->mb_y, 0);
 }
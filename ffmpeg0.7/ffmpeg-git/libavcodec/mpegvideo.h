@@ -135,6 +135,7 @@ typedef struct Picture{
     int32_t *mb_cmp_score;      ///< Table for MB cmp scores, for mb decision FIXME remove
     int b_frame_score;          /* */
     struct MpegEncContext *owner2; ///< pointer to the MpegEncContext that allocated this picture
+    int needs_realloc;          ///< tables are for an old frame size, reallocate them when the picture is reused
 } Picture;
 
 /**
@@ -364,6 +365,9 @@ typedef struct MpegEncContext {
     int16_t (*b_field_mv_table[2][2][2])[2];///< MV table (4MV per MB) interlaced b-frame encoding
     uint8_t (*p_field_select_table[2]);
     uint8_t (*b_field_select_table[2][2]);
+    struct MpegEncContext *mv_table_src; ///< frame thread whose encoding still clears the p_mv_table of intra MBs
+    Picture *mv_table_src_pic;           ///< picture of mv_table_src, its progress tells which rows are final
+    int mv_table_rows;                   ///< number of p_mv_table rows taken over from mv_table_src
     int me_method;                       ///< ME algorithm
     int mv_dir;
 #define MV_DIR_FORWARD   1
@@ -465,8 +469,14 @@ typedef struct MpegEncContext {
     int64_t total_bits;
     int frame_bits;                ///< bits used for the current frame
     int next_lambda;               ///< next lambda used for retrying to encode a frame
+    int rc_synced;                 ///< set once the rate control state of the previous frame thread was taken over
     RateControlContext rc_context; ///< contains stuff only accessed in ratecontrol.c
 
+    /* b_frame_strategy 2 lookahead, see estimate_best_b_count() */
+    uint8_t *brd_input[FF_MAX_B_FRAMES+1];   ///< downscaled input pictures, kept until they are coded
+    int brd_input_number[FF_MAX_B_FRAMES+1]; ///< display_picture_number of brd_input[], -1 if unused
+    uint8_t *brd_next;                       ///< downscaled next_picture_ptr
+
     /* statistics, used for 2-pass encoding */
     int mv_bits;
     int header_bits;
@@ -573,6 +583,8 @@ typedef struct MpegEncContext {
     uint8_t *bitstream_buffer; //Divx 5.01 puts several frames in a single one, this is used to reorder them
     int bitstream_buffer_size;
     unsigned int allocated_bitstream_buffer_size;
+    uint8_t *packed_buffer;             ///< reordered frame being decoded while the next one is stored in bitstream_buffer
+    unsigned int allocated_packed_buffer_size;
 
     int xvid_build;
 
@@ -695,12 +707,19 @@ typedef struct MpegEncContext {
 FFMPEGLIB_API void MPV_decode_defaults(MpegEncContext *s);
 FFMPEGLIB_API int MPV_common_init(MpegEncContext *s);
 FFMPEGLIB_API void MPV_common_end(MpegEncContext *s);
+FFMPEGLIB_API int MPV_common_frame_size_change(MpegEncContext *s);
+/**
+ * Return the number of bytes allocated by MPV_common_init() and
+ * ff_alloc_picture() for this context, not counting the frame buffers.
+ */
+FFMPEGLIB_API int64_t ff_mpv_memory_usage(MpegEncContext *s);
 FFMPEGLIB_API void MPV_decode_mb(MpegEncContext *s, DCTELEM block[12][64]);
 FFMPEGLIB_API int MPV_frame_start(MpegEncContext *s, AVCodecContext *avctx);
 FFMPEGLIB_API void MPV_frame_end(MpegEncContext *s);
 FFMPEGLIB_API int MPV_encode_init(AVCodecContext *avctx);
 FFMPEGLIB_API int MPV_encode_end(AVCodecContext *avctx);
 FFMPEGLIB_API int MPV_encode_picture(AVCodecContext *avctx, unsigned char *buf, int buf_size, void *data);
+FFMPEGLIB_API int MPV_encode_update_thread_context(AVCodecContext *dst, const AVCodecContext *src);
 FFMPEGLIB_API void MPV_common_init_mmx(MpegEncContext *s);
 FFMPEGLIB_API void MPV_common_init_axp(MpegEncContext *s);
 FFMPEGLIB_API void MPV_common_init_mlib(MpegEncContext *s);
@@ -0,0 +1,191 @@
+/*
+ * frame-threaded MPEG video encoding test
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Encodes a synthetic sequence with one thread and with frame threads and
+ * checks that the output is identical, for the options which carry state
+ * from one frame to the next: macroblock decision, B-frame strategy 1,
+ * rate control and the VBV.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/md5.h"
+#include "libavutil/mem.h"
+#include "avcodec.h"
+
+#undef printf
+
+#define WIDTH      176
+#define HEIGHT     144
+#define NB_FRAMES   40
+#define NB_THREADS   4
+#define BUF_SIZE   (1 << 20)
+
+static const struct {
+    enum CodecID codec_id;
+    int max_b_frames;
+    int mb_decision;
+    int b_frame_strategy;
+    int bit_rate;
+    int rc_buffer_size;
+} tests[] = {
+    { CODEC_ID_MPEG4,      2, FF_MB_DECISION_RD, 0,      0,      0 },
+    { CODEC_ID_MPEG4,      0, FF_MB_DECISION_RD, 0,      0,      0 },
+    { CODEC_ID_MPEG2VIDEO, 0, FF_MB_DECISION_RD, 0,      0,      0 },
+    { CODEC_ID_MPEG2VIDEO, 2, FF_MB_DECISION_RD, 0, 800000,      0 },
+    { CODEC_ID_MPEG4,      2, 0,                 1, 800000,      0 },
+    { CODEC_ID_MPEG4,      2, FF_MB_DECISION_RD, 1, 800000, 2000000 },
+};
+
+static AVFrame *frames[NB_FRAMES];
+static uint8_t *outbuf;
+
+/**
+ * Fills the frames with a moving gradient, a block of noise which is
+ * coded intra in P- and B-frames, and a scene change in the middle.
+ */
+static int alloc_frames(void)
+{
+    AVLFG prng;
+    int i, x, y;
+
+    av_lfg_init(&prng, 1);
+
+    for (i = 0; i < NB_FRAMES; i++) {
+        AVFrame *f = frames[i] = avcodec_alloc_frame();
+        int scene = i >= NB_FRAMES / 2;
+
+        if (!f || avpicture_alloc((AVPicture*)f, PIX_FMT_YUV420P, WIDTH, HEIGHT) < 0)
+            return -1;
+
+        for (y = 0; y < HEIGHT; y++) {
+            for (x = 0; x < WIDTH; x++) {
+                uint8_t *p = f->data[0] + y * f->linesize[0] + x;
+                if (x >= 48 + 2 * i && x < 80 + 2 * i && y >= 32 && y < 64)
+                    *p = av_lfg_get(&prng);
+                else if (scene)
+                    *p = (x * y + 3 * i) >> 4;
+                else
+                    *p = x + 2 * y + 3 * i;
+            }
+        }
+        for (y = 0; y < HEIGHT / 2; y++) {
+            for (x = 0; x < WIDTH / 2; x++) {
+                f->data[1][y * f->linesize[1] + x] = 128 + ((x + i) & 31) - scene * 64;
+                f->data[2][y * f->linesize[2] + x] = 128 + ((y - i) & 31);
+            }
+        }
+        f->pts = i;
+    }
+    return 0;
+}
+
+static int encode(AVCodec *codec, int test, int threads, uint8_t *md5)
+{
+    AVCodecContext *c = avcodec_alloc_context();
+    struct AVMD5 *ctx = av_malloc(av_md5_size);
+    int i, size, ret = -1;
+
+    if (!c || !ctx)
+        goto end;
+
+    c->width            = WIDTH;
+    c->height           = HEIGHT;
+    c->time_base        = (AVRational){ 1, 25 };
+    c->pix_fmt          = PIX_FMT_YUV420P;
+    c->gop_size         = 12;
+    c->max_b_frames     = tests[test].max_b_frames;
+    c->mb_decision      = tests[test].mb_decision;
+    c->b_frame_strategy = tests[test].b_frame_strategy;
+    c->thread_count     = threads;
+    c->thread_type      = FF_THREAD_FRAME;
+    if (tests[test].bit_rate) {
+        c->bit_rate       = tests[test].bit_rate;
+        c->rc_buffer_size = tests[test].rc_buffer_size;
+        c->rc_max_rate    = tests[test].rc_buffer_size ? c->bit_rate * 3 / 2 : 0;
+        c->rc_initial_buffer_occupancy = c->rc_buffer_size * 3 / 4;
+    } else {
+        c->flags         |= CODEC_FLAG_QSCALE;
+        c->global_quality = FF_QP2LAMBDA * 4;
+    }
+
+    if (avcodec_open(c, codec) < 0)
+        goto end;
+
+    av_md5_init(ctx);
+    for (i = 0; i < NB_FRAMES; i++) {
+        size = avcodec_encode_video(c, outbuf, BUF_SIZE, frames[i]);
+        if (size < 0)
+            goto close;
+        av_md5_update(ctx, outbuf, size);
+    }
+    while ((size = avcodec_encode_video(c, outbuf, BUF_SIZE, NULL)) > 0)
+        av_md5_update(ctx, outbuf, size);
+    av_md5_final(ctx, md5);
+    ret = size;
+
+close:
+    avcodec_close(c);
+end:
+    av_free(c);
+    av_free(ctx);
+    return ret;
+}
+
+int main(void)
+{
+    uint8_t md5[16], ref_md5[16];
+    int i, errors = 0;
+
+    avcodec_init();
+    avcodec_register_all();
+
+    outbuf = av_malloc(BUF_SIZE);
+    if (!outbuf || alloc_frames() < 0) {
+        printf("error: out of memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        AVCodec *codec = avcodec_find_encoder(tests[i].codec_id);
+
+        if (!codec)
+            continue;
+        if (encode(codec, i, 1, ref_md5) < 0 || encode(codec, i, NB_THREADS, md5) < 0) {
+            printf("error: %s test %d failed to encode\n", codec->name, i);
+            errors++;
+        } else if (memcmp(md5, ref_md5, 16)) {
+            printf("error: %s test %d differs with %d frame threads\n",
+                   codec->name, i, NB_THREADS);
+            errors++;
+        }
+    }
+
+    for (i = 0; i < NB_FRAMES; i++) {
+        avpicture_free((AVPicture*)frames[i]);
+        av_free(frames[i]);
+    }
+    av_free(outbuf);
+    return !!errors;
+}
@@ -469,7 +469,7 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
         }
     }
 
-    if(s->avctx->thread_count > 1 && s->codec_id != CODEC_ID_MPEG4
+    if(s->avctx->active_thread_type&FF_THREAD_SLICE && s->codec_id != CODEC_ID_MPEG4
        && s->codec_id != CODEC_ID_MPEG1VIDEO && s->codec_id != CODEC_ID_MPEG2VIDEO
        && (s->codec_id != CODEC_ID_H263P || !(s->flags & CODEC_FLAG_H263P_SLICE_STRUCT))){
         av_log(avctx, AV_LOG_ERROR, "multi threaded encoding not supported by codec\n");
@@ -481,7 +481,7 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
         return -1;
     }
 
-    if(s->avctx->thread_count > 1)
+    if(s->avctx->active_thread_type&FF_THREAD_SLICE)
         s->rtp_mode= 1;
 
     if(!avctx->time_base.den || !avctx->time_base.num){
@@ -762,12 +762,243 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
     return 0;
 }
 
+/**
+ * Copies the motion estimation state of the previous frame, its vectors
+ * are the predictors of the next search.
+ * @return number of bytes copied
+ */
+static int copy_motion_state(MpegEncContext *s, const MpegEncContext *s1)
+{
+    const int mv_table_size = ((s->mb_height+2) * s->mb_stride + 1) * 2 * sizeof(int16_t);
+    int i, j, k, copied;
+
+    s->f_code = s1->f_code;
+    s->b_code = s1->b_code;
+    s->me.penalty_factor     = s1->me.penalty_factor;
+    s->me.sub_penalty_factor = s1->me.sub_penalty_factor;
+    s->me.mb_penalty_factor  = s1->me.mb_penalty_factor;
+
+    memcpy(s->p_mv_table_base,            s1->p_mv_table_base,            mv_table_size);
+    memcpy(s->b_forw_mv_table_base,       s1->b_forw_mv_table_base,       mv_table_size);
+    memcpy(s->b_back_mv_table_base,       s1->b_back_mv_table_base,       mv_table_size);
+    memcpy(s->b_bidir_forw_mv_table_base, s1->b_bidir_forw_mv_table_base, mv_table_size);
+    memcpy(s->b_bidir_back_mv_table_base, s1->b_bidir_back_mv_table_base, mv_table_size);
+    memcpy(s->b_direct_mv_table_base,     s1->b_direct_mv_table_base,     mv_table_size);
+    copied = 6*mv_table_size;
+
+    if(s->p_field_select_table[0]){
+        const int select_size = s->mb_stride*s->mb_height * 2 * sizeof(uint8_t);
+        for(i=0; i<2; i++){
+            for(j=0; j<2; j++){
+                for(k=0; k<2; k++)
+                    memcpy(s->b_field_mv_table_base[i][j][k], s1->b_field_mv_table_base[i][j][k], mv_table_size);
+                memcpy(s->p_field_mv_table_base[i][j], s1->p_field_mv_table_base[i][j], mv_table_size);
+                memcpy(s->b_field_select_table[i][j],  s1->b_field_select_table[i][j],  select_size);
+            }
+            memcpy(s->p_field_select_table[i], s1->p_field_select_table[i], select_size);
+        }
+        copied += 12*mv_table_size + 6*select_size;
+    }
+    return copied;
+}
+
+/**
+ * Copies the state the setup of the previous frame left to the context
+ * of the next encoding thread. The rate control state is only final once
+ * the previous frame is encoded, see sync_rate_control().
+ */
+int MPV_encode_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    MpegEncContext *s = dst->priv_data, *s1 = src->priv_data;
+    int i, copied = 0;
+
+    if(dst == src)
+        return 0;
+
+    /* every thread allocates its pictures in its own part of picture[] */
+    if(dst->is_copy && !s->picture_range_start){
+        s->picture_range_start = s1->picture_range_start + MAX_PICTURE_COUNT;
+        s->picture_range_end   = s1->picture_range_end   + MAX_PICTURE_COUNT;
+    }
+
+    for(i=0; i<s1->picture_count; i++){
+        if(!s1->picture[i].qscale_table && !s1->picture[i].data[0] &&
+           !s ->picture[i].qscale_table && !s ->picture[i].data[0])
+            continue;
+        s->picture[i] = s1->picture[i];
+        copied += sizeof(Picture);
+    }
+    memcpy(&s->last_picture, &s1->last_picture, (char*)&s1->last_picture_ptr - (char*)&s1->last_picture);
+    copied += (char*)&s1->last_picture_ptr - (char*)&s1->last_picture;
+
+    s->last_picture_ptr     = REBASE_PICTURE(s1->last_picture_ptr,    s, s1);
+    s->current_picture_ptr  = REBASE_PICTURE(s1->current_picture_ptr, s, s1);
+    s->next_picture_ptr     = REBASE_PICTURE(s1->next_picture_ptr,    s, s1);
+
+    for(i=0; i<MAX_PICTURE_COUNT; i++){
+        s->input_picture[i]           = REBASE_PICTURE(s1->input_picture[i],           s, s1);
+        s->reordered_input_picture[i] = REBASE_PICTURE(s1->reordered_input_picture[i], s, s1);
+    }
+
+    memcpy(&s->input_picture_number, &s1->input_picture_number,
+           (char*)&s1->user_specified_pts - (char*)&s1->input_picture_number + sizeof(s1->user_specified_pts));
+    memcpy(s->prev_pict_types, s1->prev_pict_types, PREV_PICT_TYPES_BUFFER_SIZE);
+    memcpy(&s->time_increment_bits, &s1->time_increment_bits, (char*)&s1->shape - (char*)&s1->time_increment_bits);
+    s->gop_picture_number = s1->gop_picture_number;
+    s->no_rounding        = s1->no_rounding;
+    s->qscale             = s1->qscale;
+    s->chroma_qscale      = s1->chroma_qscale;
+    s->lambda             = s1->lambda;
+    s->lambda2            = s1->lambda2;
+
+    copied += copy_motion_state(s, s1);
+
+    /* the intra MBs of the previous frame are only known once it is encoded */
+    if(s1->new_picture.data[0]){
+        s->mv_table_src     = s1;
+        s->mv_table_src_pic = REBASE_PICTURE(s1->current_picture_ptr, s, s1);
+        s->mv_table_rows    = 0;
+    }else
+        s->mv_table_src     = NULL;
+
+    ff_thread_report_copied(dst, copied);
+
+    memcpy(s->last_lambda_for, s1->last_lambda_for, sizeof(s->last_lambda_for));
+    s->last_pict_type       = s1->last_pict_type;
+    s->last_non_b_pict_type = s1->last_non_b_pict_type;
+
+    /* done by MPV_frame_end() after the setup */
+    if(s1->new_picture.data[0]){
+        s->last_pict_type= s1->pict_type;
+        s->last_lambda_for[s1->pict_type] = s1->current_picture_ptr->quality;
+
+        if(s1->pict_type!=FF_B_TYPE){
+            s->last_non_b_pict_type= s1->pict_type;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Takes over the rate control state from the thread that encoded the
+ * previous frame, once it is done. Called once per frame, as late as
+ * possible, before rate control is used. With a VBV this is before the
+ * next frame is selected, as retries can still change the previous one.
+ */
+static void sync_rate_control(MpegEncContext *s)
+{
+    AVCodecContext *prev;
+    MpegEncContext *s1;
+
+    if(s->rc_synced || (s->fixed_qscale && !s->avctx->rc_buffer_size))
+        return;
+    s->rc_synced = 1;
+
+    prev = ff_thread_await_previous_frame(s->avctx);
+    if(!prev)
+        return;
+    s1 = prev->priv_data;
+
+    memcpy(&s->rc_context.buffer_index, &s1->rc_context.buffer_index,
+           (char*)&s1->rc_context.non_lavc_opaque - (char*)&s1->rc_context.buffer_index);
+    s->total_bits = s1->total_bits;
+    s->frame_bits = s1->frame_bits;
+
+    s->last_pict_type       = s1->last_pict_type;
+    s->last_non_b_pict_type = s1->last_non_b_pict_type;
+    memcpy(s->last_lambda_for, s1->last_lambda_for, sizeof(s->last_lambda_for));
+
+    /* a VBV retry repeats the setup of the previous frame with a higher lambda */
+    if(s->avctx->rc_buffer_size){
+        s->picture_in_gop_number = s1->picture_in_gop_number;
+        s->no_rounding   = s1->no_rounding;
+        s->qscale        = s1->qscale;
+        s->chroma_qscale = s1->chroma_qscale;
+        s->lambda        = s1->lambda;
+        s->lambda2       = s1->lambda2;
+        copy_motion_state(s, s1);
+        s->mv_table_src  = NULL;
+    }
+}
+
+/**
+ * Takes over the rows of p_mv_table up to mb_y from the previous frame
+ * thread once it has encoded them, the motion estimation uses them as
+ * predictors and the encoding clears the vectors of intra MBs.
+ */
+static void await_predictor_rows(MpegEncContext *s, int mb_y)
+{
+    MpegEncContext *s1 = s->mv_table_src;
+
+    if(!s1)
+        return;
+
+    mb_y = FFMIN(mb_y, s->mb_height-1) + 1;
+    if(mb_y <= s->mv_table_rows)
+        return;
+
+    ff_thread_await_progress((AVFrame*)s->mv_table_src_pic, mb_y - 1, 0);
+    memcpy(s ->p_mv_table + s->mv_table_rows*s->mb_stride,
+           s1->p_mv_table + s->mv_table_rows*s->mb_stride,
+           (mb_y - s->mv_table_rows)*s->mb_stride*sizeof(*s->p_mv_table));
+    s->mv_table_rows = mb_y;
+}
+
+/**
+ * Waits until the reference pictures are reconstructed down to the lowest
+ * row the motion estimation of macroblock row mb_y may read.
+ */
+static void await_reference_rows(MpegEncContext *s, int mb_y)
+{
+    int range= s->avctx->me_range >> (1 + !!s->quarter_sample);
+    int row= INT_MAX;
+
+    if(!(s->avctx->active_thread_type&FF_THREAD_FRAME))
+        return;
+
+    /* direct mode vectors reach 16 pixels beyond the range,
+     * subpel interpolation a few more */
+    if(range && mb_y < INT_MAX)
+        row= FFMIN(mb_y + ((range + 16 + 15 + 4)>>4), s->mb_height-1);
+
+    if(s->last_picture_ptr)
+        ff_thread_await_progress((AVFrame*)s->last_picture_ptr, row, 0);
+    if(s->pict_type == FF_B_TYPE && s->next_picture_ptr)
+        ff_thread_await_progress((AVFrame*)s->next_picture_ptr, row, 0);
+}
+
+/**
+ * Draws the edges of the rows that are final after row mb_y was encoded
+ * and lets later frame threads use them. The loop filter changes the
+ * previous row while encoding this one.
+ */
+static void report_encoded_rows(MpegEncContext *s, int mb_y)
+{
+    int first= FFMAX(mb_y - s->loop_filter, 0);
+    int last = mb_y == s->mb_height-1 ? mb_y : mb_y - s->loop_filter;
+    int y;
+
+    for(y=first; y<=last; y++)
+        ff_draw_horiz_band(s, y*16, 16);
+
+    /* a retry for the VBV could still change the picture, non-reference
+     * pictures are only awaited for their motion vectors */
+    if(last >= 0 && !s->avctx->rc_buffer_size)
+        ff_thread_report_progress((AVFrame*)s->current_picture_ptr, last, 0);
+}
+
 av_cold int MPV_encode_end(AVCodecContext *avctx)
 {
     MpegEncContext *s = avctx->priv_data;
+    int i;
 
     ff_rate_control_uninit(s);
 
+    for(i=0; i<FF_MAX_B_FRAMES+1; i++)
+        av_freep(&s->brd_input[i]);
+    av_freep(&s->brd_next);
+
     MPV_common_end(s);
     if ((CONFIG_MJPEG_ENCODER || CONFIG_LJPEG_ENCODER) && s->out_format == FMT_MJPEG)
         ff_mjpeg_encode_close(s);
@@ -846,6 +1077,7 @@ static int load_input_picture(MpegEncContext *s, AVFrame *pic_arg){
 
   if(pic_arg){
     if(encoding_delay && !(s->flags&CODEC_FLAG_INPUT_PRESERVED)) direct=0;
+    if(s->avctx->active_thread_type&FF_THREAD_FRAME) direct=0;
     if(pic_arg->linesize[0] != s->linesize) direct=0;
     if(pic_arg->linesize[1] != s->uvlinesize) direct=0;
     if(pic_arg->linesize[2] != s->uvlinesize) direct=0;
@@ -921,6 +1153,16 @@ static int load_input_picture(MpegEncContext *s, AVFrame *pic_arg){
     return 0;
 }
 
+/**
+ * Returns the offset of the input image in the buffer of p, copies are
+ * stored INPLACE_OFFSET bytes in so they can be encoded in place.
+ */
+static int input_picture_offset(MpegEncContext *s, Picture *p){
+    if(p->type == FF_BUFFER_TYPE_SHARED || s->avctx->rc_buffer_size)
+        return 0;
+    return INPLACE_OFFSET;
+}
+
 static int skip_check(MpegEncContext *s, Picture *p, Picture *ref){
     int x, y, plane;
     int score=0;
@@ -954,27 +1196,79 @@ static int skip_check(MpegEncContext *s, Picture *p, Picture *ref){
     return 0;
 }
 
-static int estimate_best_b_count(MpegEncContext *s){
-    AVCodec *codec= avcodec_find_encoder(s->avctx->codec_id);
-    AVCodecContext *c= avcodec_alloc_context();
+/**
+ * One B-frame count tried by estimate_best_b_count().
+ */
+typedef struct BFrameTrial {
+    MpegEncContext *s;
+    AVCodecContext *c;      ///< encoder used for this trial only
+    const AVFrame *input;   ///< downscaled next_picture_ptr and input pictures
+    int b_count;            ///< number of consecutive B-frames tried
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd;             ///< rate-distortion cost of the trial
+} BFrameTrial;
+
+static int encode_b_frame_trial(AVCodecContext *avctx, void *arg){
+    BFrameTrial *t= arg;
+    MpegEncContext *s= t->s;
+    AVCodecContext *c= t->c;
     AVFrame input[FF_MAX_B_FRAMES+2];
-    const int scale= s->avctx->brd_scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
     int outbuf_size= s->width * s->height; //FIXME
     uint8_t *outbuf= av_malloc(outbuf_size);
-    int64_t best_rd= INT64_MAX;
-    int best_b_count= -1;
+    int i, out_size;
+    int64_t rd=0;
 
-    assert(scale>=0 && scale <=3);
+    t->rd= INT64_MAX;
+    if(!outbuf)
+        return AVERROR(ENOMEM);
 
-//    emms_c();
-    p_lambda= s->last_lambda_for[FF_P_TYPE]; //s->next_picture_ptr->quality;
-    b_lambda= s->last_lambda_for[FF_B_TYPE]; //p_lambda *FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
-    if(!b_lambda) b_lambda= p_lambda; //FIXME we should do this somewhere else
-    lambda2= (b_lambda*b_lambda + (1<<FF_LAMBDA_SHIFT)/2 ) >> FF_LAMBDA_SHIFT;
+    /* pict_type and quality differ between the trials */
+    memcpy(input, t->input, (s->max_b_frames+2) * sizeof(*input));
+
+    c->error[0]= c->error[1]= c->error[2]= 0;
+
+    input[0].pict_type= FF_I_TYPE;
+    input[0].quality= 1 * FF_QP2LAMBDA;
+    out_size = avcodec_encode_video(c, outbuf, outbuf_size, &input[0]);
+//    rd += (out_size * t->lambda2) >> FF_LAMBDA_SHIFT;
+
+    for(i=0; i<s->max_b_frames+1; i++){
+        int is_p= i % (t->b_count+1) == t->b_count || i==s->max_b_frames;
+
+        input[i+1].pict_type= is_p ? FF_P_TYPE : FF_B_TYPE;
+        input[i+1].quality= is_p ? t->p_lambda : t->b_lambda;
+        out_size = avcodec_encode_video(c, outbuf, outbuf_size, &input[i+1]);
+        rd += (out_size * t->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    while(out_size){
+        out_size = avcodec_encode_video(c, outbuf, outbuf_size, NULL);
+        rd += (out_size * t->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+
+    t->rd= rd;
+    av_free(outbuf);
+    return 0;
+}
+
+static void shrink_picture(MpegEncContext *s, AVFrame *dst, Picture *src, int offset, int w, int h){
+    const int scale= s->avctx->brd_scale;
+
+    s->dsp.shrink[scale](dst->data[0], dst->linesize[0], src->data[0] + offset, src->linesize[0], w, h);
+    s->dsp.shrink[scale](dst->data[1], dst->linesize[1], src->data[1] + offset, src->linesize[1], w>>1, h>>1);
+    s->dsp.shrink[scale](dst->data[2], dst->linesize[2], src->data[2] + offset, src->linesize[2], w>>1, h>>1);
+}
+
+static AVCodecContext *open_b_frame_encoder(MpegEncContext *s, AVCodec *codec, int w, int h){
+    AVCodecContext *c= avcodec_alloc_context();
 
-    c->width = s->width >> scale;
-    c->height= s->height>> scale;
+    if(!c)
+        return NULL;
+    c->width = w;
+    c->height= h;
     c->flags= CODEC_FLAG_QSCALE | CODEC_FLAG_PSNR | CODEC_FLAG_INPUT_PRESERVED /*| CODEC_FLAG_EMU_EDGE*/;
     c->flags|= s->avctx->flags & CODEC_FLAG_QPEL;
     c->mb_decision= s->avctx->mb_decision;
@@ -985,82 +1279,142 @@ static int estimate_best_b_count(MpegEncContext *s){
     c->time_base= s->avctx->time_base;
     c->max_b_frames= s->max_b_frames;
 
-    if (avcodec_open(c, codec) < 0)
-        return -1;
+    if (avcodec_open(c, codec) < 0){
+        av_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+/**
+ * Try every possible number of B-frames before the next P-frame by
+ * encoding the downscaled input pictures, and return the one with the
+ * lowest rate-distortion cost.
+ *
+ * The trials run one after another with one encoder. With
+ * CODEC_FLAG2_PARALLEL_BRD each trial has its own encoder and they run in
+ * parallel on the slice threads; a trial then does not start from the
+ * state the previous ones left, so the decisions can differ. The
+ * downscaled input pictures are kept in a lookahead buffer, so each input
+ * picture is downscaled only once.
+ */
+static int estimate_best_b_count(MpegEncContext *s){
+    AVCodec *codec= avcodec_find_encoder(s->avctx->codec_id);
+    AVFrame input[FF_MAX_B_FRAMES+2];
+    BFrameTrial trial[FF_MAX_B_FRAMES+1];
+    int slot[FF_MAX_B_FRAMES+1], used[FF_MAX_B_FRAMES+1]={0};
+    const int scale= s->avctx->brd_scale;
+    const int w= s->width >> scale;
+    const int h= s->height>> scale;
+    const int ysize= w*h;
+    const int csize= (w/2)*(h/2);
+    const int parallel= s->avctx->flags2 & CODEC_FLAG2_PARALLEL_BRD;
+    int i, j, k, p_lambda, b_lambda, lambda2, trials=0, ret=0;
+    int64_t best_rd= INT64_MAX;
+    int best_b_count= -1;
+
+    assert(scale>=0 && scale <=3);
+
+//    emms_c();
+    p_lambda= s->last_lambda_for[FF_P_TYPE]; //s->next_picture_ptr->quality;
+    b_lambda= s->last_lambda_for[FF_B_TYPE]; //p_lambda *FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
+    if(!b_lambda) b_lambda= p_lambda; //FIXME we should do this somewhere else
+    lambda2= (b_lambda*b_lambda + (1<<FF_LAMBDA_SHIFT)/2 ) >> FF_LAMBDA_SHIFT;
+
+    if(!s->brd_next){
+        for(i=0; i<s->max_b_frames+1; i++){
+            s->brd_input_number[i]= -1;
+            if(!s->brd_input[i] && !(s->brd_input[i]= av_malloc(ysize + 2*csize)))
+                return -1;
+        }
+        if(!(s->brd_next= av_malloc(ysize + 2*csize)))
+            return -1;
+    }
+
+    /* reuse the pictures downscaled by earlier calls */
+    for(i=0; i<s->max_b_frames+1; i++){
+        slot[i]= -1;
+        if(!s->input_picture[i])
+            continue;
+        for(k=0; k<s->max_b_frames+1; k++){
+            if(s->brd_input_number[k] == s->input_picture[i]->display_picture_number){
+                slot[i]= k;
+                used[k]= 1;
+                break;
+            }
+        }
+    }
 
     for(i=0; i<s->max_b_frames+2; i++){
-        int ysize= c->width*c->height;
-        int csize= (c->width/2)*(c->height/2);
-        Picture pre_input, *pre_input_ptr= i ? s->input_picture[i-1] : s->next_picture_ptr;
+        Picture *pre_input_ptr= i ? s->input_picture[i-1] : s->next_picture_ptr;
+        int fresh= 1;
 
         avcodec_get_frame_defaults(&input[i]);
-        input[i].data[0]= av_malloc(ysize + 2*csize);
+        if(!i){
+            input[i].data[0]= s->brd_next;
+        }else{
+            if(slot[i-1] < 0){
+                for(k=0; used[k]; k++);
+                used[k]= 1;
+                slot[i-1]= k;
+                s->brd_input_number[k]= pre_input_ptr ? pre_input_ptr->display_picture_number : -1;
+            }else
+                fresh= 0;
+            input[i].data[0]= s->brd_input[slot[i-1]];
+        }
         input[i].data[1]= input[i].data[0] + ysize;
         input[i].data[2]= input[i].data[1] + csize;
-        input[i].linesize[0]= c->width;
+        input[i].linesize[0]= w;
         input[i].linesize[1]=
-        input[i].linesize[2]= c->width/2;
-
-        if(pre_input_ptr && (!i || s->input_picture[i-1])) {
-            pre_input= *pre_input_ptr;
-
-            if(pre_input.type != FF_BUFFER_TYPE_SHARED && i) {
-                pre_input.data[0]+=INPLACE_OFFSET;
-                pre_input.data[1]+=INPLACE_OFFSET;
-                pre_input.data[2]+=INPLACE_OFFSET;
-            }
+        input[i].linesize[2]= w/2;
 
-            s->dsp.shrink[scale](input[i].data[0], input[i].linesize[0], pre_input.data[0], pre_input.linesize[0], c->width, c->height);
-            s->dsp.shrink[scale](input[i].data[1], input[i].linesize[1], pre_input.data[1], pre_input.linesize[1], c->width>>1, c->height>>1);
-            s->dsp.shrink[scale](input[i].data[2], input[i].linesize[2], pre_input.data[2], pre_input.linesize[2], c->width>>1, c->height>>1);
-        }
+        if(pre_input_ptr && fresh)
+            shrink_picture(s, &input[i], pre_input_ptr,
+                           pre_input_ptr->type != FF_BUFFER_TYPE_SHARED && i ? INPLACE_OFFSET : 0, w, h);
     }
 
     for(j=0; j<s->max_b_frames+1; j++){
-        int64_t rd=0;
-
         if(!s->input_picture[j])
             break;
 
-        c->error[0]= c->error[1]= c->error[2]= 0;
-
-        input[0].pict_type= FF_I_TYPE;
-        input[0].quality= 1 * FF_QP2LAMBDA;
-        out_size = avcodec_encode_video(c, outbuf, outbuf_size, &input[0]);
-//        rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for(i=0; i<s->max_b_frames+1; i++){
-            int is_p= i % (j+1) == j || i==s->max_b_frames;
-
-            input[i+1].pict_type= is_p ? FF_P_TYPE : FF_B_TYPE;
-            input[i+1].quality= is_p ? p_lambda : b_lambda;
-            out_size = avcodec_encode_video(c, outbuf, outbuf_size, &input[i+1]);
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
-
-        /* get the delayed frames */
-        while(out_size){
-            out_size = avcodec_encode_video(c, outbuf, outbuf_size, NULL);
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
+        if(parallel || !j){
+            trial[j].c= open_b_frame_encoder(s, codec, w, h);
+            if(!trial[j].c){
+                ret= -1;
+                break;
+            }
+        }else
+            trial[j].c= trial[0].c;
+
+        trial[j].s= s;
+        trial[j].input= input;
+        trial[j].b_count= j;
+        trial[j].p_lambda= p_lambda;
+        trial[j].b_lambda= b_lambda;
+        trial[j].lambda2= lambda2;
+        trials++;
+    }
 
-        rd += c->error[0] + c->error[1] + c->error[2];
+    if(!ret){
+        if(parallel)
+            s->avctx->execute(s->avctx, encode_b_frame_trial, trial, NULL, trials, sizeof(BFrameTrial));
+        else
+            for(j=0; j<trials; j++)
+                encode_b_frame_trial(s->avctx, &trial[j]);
+    }
 
-        if(rd < best_rd){
-            best_rd= rd;
+    for(j=0; j<trials; j++){
+        if(!ret && trial[j].rd < best_rd){
+            best_rd= trial[j].rd;
             best_b_count= j;
         }
+        if(parallel || !j){
+            avcodec_close(trial[j].c);
+            av_freep(&trial[j].c);
+        }
     }
 
-    av_freep(&outbuf);
-    avcodec_close(c);
-    av_freep(&c);
-
-    for(i=0; i<s->max_b_frames+2; i++){
-        av_freep(&input[i].data[0]);
-    }
-
-    return best_b_count;
+    return ret < 0 ? -1 : best_b_count;
 }
 
 static int select_input_picture(MpegEncContext *s){
@@ -1080,6 +1434,7 @@ static int select_input_picture(MpegEncContext *s){
             int b_frames;
 
             if(s->avctx->frame_skip_threshold || s->avctx->frame_skip_factor){
+                ff_thread_await_progress((AVFrame*)s->next_picture_ptr, INT_MAX, 0);
                 if(s->picture_in_gop_number < s->gop_size && skip_check(s, s->input_picture[0], s->next_picture_ptr)){
                 //FIXME check that te gop check above is +-1 correct
 //av_log(NULL, AV_LOG_DEBUG, "skip %p %"PRId64"\n", s->input_picture[0]->data[0], s->input_picture[0]->pts);
@@ -1092,10 +1447,11 @@ static int select_input_picture(MpegEncContext *s){
                         assert(   s->input_picture[0]->type==FF_BUFFER_TYPE_USER
                                || s->input_picture[0]->type==FF_BUFFER_TYPE_INTERNAL);
 
-                        s->avctx->release_buffer(s->avctx, (AVFrame*)s->input_picture[0]);
+                        ff_thread_release_buffer(s->avctx, (AVFrame*)s->input_picture[0]);
                     }
 
                     emms_c();
+                    sync_rate_control(s);
                     ff_vbv_update(s, 0);
 
                     goto no_output_pic;
@@ -1125,8 +1481,8 @@ static int select_input_picture(MpegEncContext *s){
                 for(i=1; i<s->max_b_frames+1; i++){
                     if(s->input_picture[i] && s->input_picture[i]->b_frame_score==0){
                         s->input_picture[i]->b_frame_score=
-                            get_intra_count(s, s->input_picture[i  ]->data[0],
-                                               s->input_picture[i-1]->data[0], s->linesize) + 1;
+                            get_intra_count(s, s->input_picture[i  ]->data[0] + input_picture_offset(s, s->input_picture[i  ]),
+                                               s->input_picture[i-1]->data[0] + input_picture_offset(s, s->input_picture[i-1]), s->linesize) + 1;
                     }
                 }
                 for(i=0; i<s->max_b_frames+1; i++){
@@ -1140,6 +1496,7 @@ static int select_input_picture(MpegEncContext *s){
                     s->input_picture[i]->b_frame_score=0;
                 }
             }else if(s->avctx->b_frame_strategy==2){
+                ff_thread_await_progress((AVFrame*)s->next_picture_ptr, INT_MAX, 0);
                 b_frames= estimate_best_b_count(s);
             }else{
                 av_log(s->avctx, AV_LOG_ERROR, "illegal b frame strategy\n");
@@ -1205,7 +1562,7 @@ no_output_pic:
 
             /* mark us unused / free shared pic */
             if(s->reordered_input_picture[0]->type == FF_BUFFER_TYPE_INTERNAL)
-                s->avctx->release_buffer(s->avctx, (AVFrame*)s->reordered_input_picture[0]);
+                ff_thread_release_buffer(s->avctx, (AVFrame*)s->reordered_input_picture[0]);
             for(i=0; i<4; i++)
                 s->reordered_input_picture[0]->data[i]= NULL;
             s->reordered_input_picture[0]->type= 0;
@@ -1224,6 +1581,8 @@ no_output_pic:
                 s->new_picture.data[i]+= INPLACE_OFFSET;
             }
         }
+        /* the encoding thread releases it, see ff_release_unused_pictures() */
+        s->current_picture_ptr->owner2= s;
         ff_copy_picture(&s->current_picture, s->current_picture_ptr);
 
         s->picture_number= s->new_picture.display_picture_number;
@@ -1251,6 +1610,14 @@ int MPV_encode_picture(AVCodecContext *avctx,
         init_put_bits(&s->thread_context[i]->pb, start, end - start);
     }
 
+    s->rc_synced= 0;
+    if(avctx->rc_buffer_size)
+        sync_rate_control(s);
+
+    /* non-reference pictures are kept until the next frame of this thread */
+    if(avctx->active_thread_type&FF_THREAD_FRAME)
+        ff_release_unused_pictures(s, 0);
+
     s->picture_in_gop_number++;
 
     if(load_input_picture(s, pic_arg) < 0)
@@ -1315,6 +1682,9 @@ vbv_retry:
             assert(s->avctx->rc_max_rate);
         }
 
+        if(s->current_picture.reference)
+            ff_thread_report_progress((AVFrame*)s->current_picture_ptr, INT_MAX, 0);
+
         if(s->flags&CODEC_FLAG_PASS1)
             ff_write_pass1_stats(s);
 
@@ -1388,6 +1758,9 @@ vbv_retry:
         avctx->frame_bits  = s->frame_bits;
     }else{
         assert((put_bits_ptr(&s->pb) == s->pb.buf));
+        sync_rate_control(s);
+        /* the next frame thread takes the vectors over from this one */
+        await_predictor_rows(s, INT_MAX);
         s->frame_bits=0;
     }
     assert((s->frame_bits&7)==0);
@@ -1986,6 +2359,8 @@ static int estimate_motion_thread(AVCodecContext *c, void *arg){
     s->me.dia_size= s->avctx->dia_size;
     s->first_slice_line=1;
     for(s->mb_y= s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
+        await_reference_rows(s, s->mb_y);
+        await_predictor_rows(s, s->mb_y + 1 + s->avctx->last_predictor_count);
         s->mb_x=0; //for block init below
         ff_init_block_index(s);
         for(s->mb_x=0; s->mb_x < s->mb_width; s->mb_x++) {
@@ -2657,6 +3032,8 @@ static int encode_thread(AVCodecContext *c, void *arg){
             }
 //printf("MB %d %d bits\n", s->mb_x+s->mb_y*s->mb_stride, put_bits_count(&s->pb));
         }
+        if(s->avctx->active_thread_type&FF_THREAD_FRAME)
+            report_encoded_rows(s, mb_y);
     }
 
     //not beautiful here but we must write it before flushing so it has to be here
@@ -2825,6 +3202,8 @@ static int encode_picture(MpegEncContext *s, int picture_number)
         s->lambda2= (s->lambda2* (int64_t)s->avctx->me_penalty_compensation + 128)>>8;
         if(s->pict_type != FF_B_TYPE && s->avctx->me_threshold==0){
             if((s->avctx->pre_me && s->last_non_b_pict_type==FF_I_TYPE) || s->avctx->pre_me==2){
+                await_reference_rows(s, INT_MAX);
+                await_predictor_rows(s, INT_MAX);
                 s->avctx->execute(s->avctx, pre_estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
             }
         }
@@ -2908,6 +3287,9 @@ static int encode_picture(MpegEncContext *s, int picture_number)
         }
     }
 
+    if(!s->next_lambda)
+        sync_rate_control(s);
+
     if (estimate_qp(s, 0) < 0)
         return -1;
 
@@ -2979,6 +3361,7 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     for(i=1; i<context_count; i++){
         update_duplicate_context_after_me(s->thread_context[i], s);
     }
+    ff_thread_finish_setup(s->avctx);
     s->avctx->execute(s->avctx, encode_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
     for(i=1; i<context_count; i++){
         merge_context_after_encode(s, s->thread_context[i]);
@@ -3791,7 +4174,9 @@ AVCodec ff_h263_encoder = {
     MPV_encode_picture,
     MPV_encode_end,
     .pix_fmts= (const enum PixelFormat[]){PIX_FMT_YUV420P, PIX_FMT_NONE},
+    .capabilities= CODEC_CAP_FRAME_THREADS,
     .long_name= NULL_IF_CONFIG_SMALL("H.263 / H.263-1996"),
+    .update_thread_context= ONLY_IF_THREADS_ENABLED(MPV_encode_update_thread_context)
 };
 
 AVCodec ff_h263p_encoder = {
@@ -3803,7 +4188,9 @@ AVCodec ff_h263p_encoder = {
     MPV_encode_picture,
     MPV_encode_end,
     .pix_fmts= (const enum PixelFormat[]){PIX_FMT_YUV420P, PIX_FMT_NONE},
+    .capabilities= CODEC_CAP_FRAME_THREADS,
     .long_name= NULL_IF_CONFIG_SMALL("H.263+ / H.263-1998 / H.263 version 2"),
+    .update_thread_context= ONLY_IF_THREADS_ENABLED(MPV_encode_update_thread_context)
 };
 
 AVCodec ff_msmpeg4v1_encoder = {
@@ -23,6 +23,7 @@
 #include "bytestream.h"
 #include "png.h"
 #include "dsputil.h"
+#include "thread.h"
 
 /* TODO:
  * - add 2, 4 and 16 bit depth support
@@ -496,10 +497,10 @@ static int decode_frame(AVCodecContext *avctx,
                     goto fail;
                 }
                 if(p->data[0])
-                    avctx->release_buffer(avctx, p);
+                    ff_thread_release_buffer(avctx, p);
 
                 p->reference= 0;
-                if(avctx->get_buffer(avctx, p) < 0){
+                if(ff_thread_get_buffer(avctx, p) < 0){
                     av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
                     goto fail;
                 }
@@ -507,6 +508,8 @@ static int decode_frame(AVCodecContext *avctx,
                 p->key_frame= 1;
                 p->interlaced_frame = !!s->interlace_type;
 
+                ff_thread_finish_setup(avctx);
+
                 /* compute the compressed row size */
                 if (!s->interlace_type) {
                     s->crow_size = s->row_size + 1;
@@ -607,6 +610,7 @@ static int decode_frame(AVCodecContext *avctx,
             uint8_t *pd = s->current_picture->data[0];
             uint8_t *pd_last = s->last_picture->data[0];
 
+            ff_thread_await_progress(s->last_picture, INT_MAX, 0);
             for(j=0; j < s->height; j++) {
                 for(i=0; i < s->width * s->bpp; i++) {
                     pd[i] += pd_last[i];
@@ -622,6 +626,8 @@ static int decode_frame(AVCodecContext *avctx,
 
     ret = s->bytestream - s->bytestream_start;
  the_end:
+    if (p->data[0])
+        ff_thread_report_progress(p, INT_MAX, 0);
     inflateEnd(&s->zstream);
     av_free(crow_buf_base);
     s->crow_buf = NULL;
@@ -645,14 +651,41 @@ static av_cold int png_dec_init(AVCodecContext *avctx){
     return 0;
 }
 
+static av_cold int png_dec_init_thread_copy(AVCodecContext *avctx)
+{
+    PNGDecContext *s = avctx->priv_data;
+
+    s->current_picture = &s->picture1;
+    s->last_picture = &s->picture2;
+    avctx->coded_frame = s->current_picture;
+
+    return 0;
+}
+
+static int png_dec_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    PNGDecContext *s = dst->priv_data, *s1 = src->priv_data;
+
+    /* the previous picture is passed along from thread to thread,
+     * so only the context that decodes next releases it */
+    *s->current_picture = *s1->current_picture;
+    *s->last_picture    = *s1->last_picture;
+    memcpy(s->palette, s1->palette, sizeof(s->palette));
+
+    return 0;
+}
+
 static av_cold int png_dec_end(AVCodecContext *avctx)
 {
     PNGDecContext *s = avctx->priv_data;
 
+    if (avctx->is_copy)
+        return 0;
+
     if (s->picture1.data[0])
-        avctx->release_buffer(avctx, &s->picture1);
+        ff_thread_release_buffer(avctx, &s->picture1);
     if (s->picture2.data[0])
-        avctx->release_buffer(avctx, &s->picture2);
+        ff_thread_release_buffer(avctx, &s->picture2);
 
     return 0;
 }
@@ -666,8 +699,10 @@ AVCodec ff_png_decoder = {
     NULL,
     png_dec_end,
     decode_frame,
-    CODEC_CAP_DR1 /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
+    CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
     NULL,
     .max_lowres = 5,
     .long_name = NULL_IF_CONFIG_SMALL("PNG image"),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(png_dec_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(png_dec_update_thread_context),
 };
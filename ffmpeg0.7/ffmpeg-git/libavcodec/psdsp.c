@@ -0,0 +1,252 @@
+/*
+ * AAC Parametric Stereo DSP functions
+ * Copyright (c) 2010 Alex Converse <alex.converse@gmail.com>
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "psdsp.h"
+
+static void ps_add_squares_c(float *dst, const float (*src)[2], int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        dst[i] += src[i][0] * src[i][0] + src[i][1] * src[i][1];
+}
+
+static void ps_mul_pair_single_c(float (*dst)[2], const float (*src0)[2],
+                                 const float *src1, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        dst[i][0] = src0[i][0] * src1[i];
+        dst[i][1] = src0[i][1] * src1[i];
+    }
+}
+
+static void ps_hybrid_analysis_c(float (*out)[2], const float (*in)[2],
+                                 const float (*filter)[7][2], int stride, int n)
+{
+    int i, j;
+    for (i = 0; i < n; i++) {
+        float sum_re = filter[i][6][0] * in[6][0], sum_im = filter[i][6][0] * in[6][1];
+        for (j = 0; j < 6; j++) {
+            float in0_re = in[j][0];
+            float in0_im = in[j][1];
+            float in1_re = in[12-j][0];
+            float in1_im = in[12-j][1];
+            sum_re += filter[i][j][0] * (in0_re + in1_re) - filter[i][j][1] * (in0_im - in1_im);
+            sum_im += filter[i][j][0] * (in0_im + in1_im) + filter[i][j][1] * (in0_re - in1_re);
+        }
+        out[i * stride][0] = sum_re;
+        out[i * stride][1] = sum_im;
+    }
+}
+
+static void ps_hybrid_analysis_ileave_c(float (*out)[32][2], float L[2][38][64],
+                                        int i, int len)
+{
+    int j;
+    for (; i < 64; i++) {
+        for (j = 0; j < len; j++) {
+            out[i][j][0] = L[0][j][i];
+            out[i][j][1] = L[1][j][i];
+        }
+    }
+}
+
+static void ps_hybrid_synthesis_deint_c(float out[2][38][64], float (*in)[32][2],
+                                        int i, int len)
+{
+    int n;
+    for (; i < 64; i++) {
+        for (n = 0; n < len; n++) {
+            out[0][n][i] = in[i][n][0];
+            out[1][n][i] = in[i][n][1];
+        }
+    }
+}
+
+static void ps_stereo_interpolate_c(float (*l)[2], float (*r)[2],
+                                    float h[2][4], float h_step[2][4], int len)
+{
+    float h11r = h[0][0], h12r = h[0][1], h21r = h[0][2], h22r = h[0][3];
+    float h11r_step = h_step[0][0], h12r_step = h_step[0][1];
+    float h21r_step = h_step[0][2], h22r_step = h_step[0][3];
+    int n;
+    for (n = 0; n < len; n++) {
+        //l is s, r is d
+        float l_re = l[n][0];
+        float l_im = l[n][1];
+        float r_re = r[n][0];
+        float r_im = r[n][1];
+        h11r += h11r_step;
+        h12r += h12r_step;
+        h21r += h21r_step;
+        h22r += h22r_step;
+        l[n][0] = h11r*l_re + h21r*r_re;
+        l[n][1] = h11r*l_im + h21r*r_im;
+        r[n][0] = h12r*l_re + h22r*r_re;
+        r[n][1] = h12r*l_im + h22r*r_im;
+    }
+}
+
+static void ps_stereo_interpolate_ipdopd_c(float (*l)[2], float (*r)[2],
+                                           float h[2][4], float h_step[2][4],
+                                           int len)
+{
+    float h11r = h[0][0], h12r = h[0][1], h21r = h[0][2], h22r = h[0][3];
+    float h11i = h[1][0], h12i = h[1][1], h21i = h[1][2], h22i = h[1][3];
+    float h11r_step = h_step[0][0], h12r_step = h_step[0][1];
+    float h21r_step = h_step[0][2], h22r_step = h_step[0][3];
+    float h11i_step = h_step[1][0], h12i_step = h_step[1][1];
+    float h21i_step = h_step[1][2], h22i_step = h_step[1][3];
+    int n;
+    for (n = 0; n < len; n++) {
+        //l is s, r is d
+        float l_re = l[n][0];
+        float l_im = l[n][1];
+        float r_re = r[n][0];
+        float r_im = r[n][1];
+        h11r += h11r_step;
+        h12r += h12r_step;
+        h21r += h21r_step;
+        h22r += h22r_step;
+        h11i += h11i_step;
+        h12i += h12i_step;
+        h21i += h21i_step;
+        h22i += h22i_step;
+
+        l[n][0] = h11r*l_re + h21r*r_re - h11i*l_im - h21i*r_im;
+        l[n][1] = h11r*l_im + h21r*r_im + h11i*l_re + h21i*r_re;
+        r[n][0] = h12r*l_re + h22r*r_re - h12i*l_im - h22i*r_im;
+        r[n][1] = h12r*l_im + h22r*r_im + h12i*l_re + h22i*r_re;
+    }
+}
+
+static av_cold void psdsp_init_c(PSDSPContext *s)
+{
+    s->add_squares            = ps_add_squares_c;
+    s->mul_pair_single        = ps_mul_pair_single_c;
+    s->hybrid_analysis        = ps_hybrid_analysis_c;
+    s->hybrid_analysis_ileave = ps_hybrid_analysis_ileave_c;
+    s->hybrid_synthesis_deint = ps_hybrid_synthesis_deint_c;
+    s->stereo_interpolate[0]  = ps_stereo_interpolate_c;
+    s->stereo_interpolate[1]  = ps_stereo_interpolate_ipdopd_c;
+}
+
+av_cold void ff_psdsp_init(PSDSPContext *s)
+{
+    psdsp_init_c(s);
+#if HAVE_MMX
+    ff_psdsp_init_x86(s);
+#endif
+}
+
+#ifdef TEST
+#include <string.h>
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+
+static AVLFG prng;
+
+static void fill(float *buf, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        buf[i] = (av_lfg_get(&prng) / (float)UINT32_MAX - 0.5f) * 4000.0f;
+}
+
+static int check(const char *name, const void *a, const void *b, int size)
+{
+    if (memcmp(a, b, size)) {
+        av_log(NULL, AV_LOG_ERROR, "%s differs from the C version\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Compare the functions of ff_psdsp_init() bit by bit with the C versions
+ * on random input. Only errors are printed.
+ */
+int main(void)
+{
+    static float in[91][32][2], L[2][38][64];
+    static float ref[91][32][2], out[91][32][2];
+    static float ref_qmf[2][38][64], out_qmf[2][38][64];
+    float filter[12][7][2], h[2][4], h_step[2][4];
+    PSDSPContext c, s;
+    int it, i, len, errors = 0;
+
+    av_lfg_init(&prng, 1);
+    psdsp_init_c(&c);
+    ff_psdsp_init(&s);
+
+    for (it = 0; it < 100 && !errors; it++) {
+        fill(in[0][0], 91 * 32 * 2);
+        fill(L[0][0], 2 * 38 * 64);
+        fill(filter[0][0], 12 * 7 * 2);
+        len = 32 - 4 * (it & 1);
+
+        memcpy(ref, in, 32 * sizeof(float));
+        memcpy(out, in, 32 * sizeof(float));
+        c.add_squares(ref[0][0], (const float (*)[2])in[1], len);
+        s.add_squares(out[0][0], (const float (*)[2])in[1], len);
+        errors += check("add_squares", ref, out, len * sizeof(float));
+
+        c.mul_pair_single(ref[0], (const float (*)[2])in[1], in[2][0], len);
+        s.mul_pair_single(out[0], (const float (*)[2])in[1], in[2][0], len);
+        errors += check("mul_pair_single", ref, out, 2 * len * sizeof(float));
+
+        for (i = 0; i < 8; i++) {
+            const float (*x)[2] = (const float (*)[2])in[i];
+            c.hybrid_analysis(ref[0] + i, x + it % 20,
+                              (const float (*)[7][2])filter, 32, 12);
+            s.hybrid_analysis(out[0] + i, x + it % 20,
+                              (const float (*)[7][2])filter, 32, 12);
+            c.hybrid_analysis(ref[20] + 8 * i, x, (const float (*)[7][2])filter, 1, 8);
+            s.hybrid_analysis(out[20] + 8 * i, x, (const float (*)[7][2])filter, 1, 8);
+        }
+        errors += check("hybrid_analysis", ref, out, 22 * sizeof(ref[0]));
+
+        c.hybrid_analysis_ileave(ref + 27 - 2 * (it & 1), L, 5 - 2 * (it & 1), len);
+        s.hybrid_analysis_ileave(out + 27 - 2 * (it & 1), L, 5 - 2 * (it & 1), len);
+        errors += check("hybrid_analysis_ileave", ref, out, sizeof(ref));
+
+        memset(ref_qmf, 0, sizeof(ref_qmf));
+        memset(out_qmf, 0, sizeof(out_qmf));
+        c.hybrid_synthesis_deint(ref_qmf, in + 27 - 2 * (it & 1), 5 - 2 * (it & 1), len);
+        s.hybrid_synthesis_deint(out_qmf, in + 27 - 2 * (it & 1), 5 - 2 * (it & 1), len);
+        errors += check("hybrid_synthesis_deint", ref_qmf, out_qmf, sizeof(ref_qmf));
+
+        for (i = 0; i < 2; i++) {
+            fill(h[0], 8);
+            fill(h_step[0], 8);
+            memcpy(ref, in, 2 * sizeof(in[0]));
+            memcpy(out, in, 2 * sizeof(in[0]));
+            c.stereo_interpolate[i](ref[0] + 1, ref[1] + 1, h, h_step, 1 + it % 31);
+            s.stereo_interpolate[i](out[0] + 1, out[1] + 1, h, h_step, 1 + it % 31);
+            errors += check(i ? "stereo_interpolate_ipdopd" : "stereo_interpolate",
+                            ref, out, 2 * sizeof(ref[0]));
+        }
+    }
+    return !!errors;
+}
+#endif /* TEST */
@@ -0,0 +1,72 @@
+/*
+ * AAC Parametric Stereo DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_PSDSP_H
+#define AVCODEC_PSDSP_H
+
+/**
+ * All functions give exactly the same results as the C versions, the
+ * optimized versions only change the order of independent operations.
+ */
+typedef struct PSDSPContext {
+    /**
+     * Add the power of n complex values to dst, n a multiple of 4.
+     */
+    void (*add_squares)(float *dst, const float (*src)[2], int n);
+    /**
+     * Multiply n complex values by real values, n a multiple of 4.
+     */
+    void (*mul_pair_single)(float (*dst)[2], const float (*src0)[2],
+                            const float *src1, int n);
+    /**
+     * Filter one sample of a subband with n complex 13 tap filters, n even.
+     * @param out    output of the first filter, the others follow at
+     *               multiples of stride
+     * @param in     13 input samples
+     * @param filter first 7 taps of each filter, the others are symmetric
+     */
+    void (*hybrid_analysis)(float (*out)[2], const float (*in)[2],
+                            const float (*filter)[7][2], int stride, int n);
+    /**
+     * Copy the QMF subbands i..63 of L into the hybrid buffer out.
+     */
+    void (*hybrid_analysis_ileave)(float (*out)[32][2], float L[2][38][64],
+                                   int i, int len);
+    /**
+     * Copy the hybrid bands i..63 of in into the QMF subbands of out.
+     */
+    void (*hybrid_synthesis_deint)(float out[2][38][64], float (*in)[32][2],
+                                   int i, int len);
+    /**
+     * Mix len samples of one band of the left and right channels with
+     * linearly interpolated coefficients.
+     * @param h      real and imaginary parts of h11, h12, h21 and h22
+     * @param h_step their increments per sample, added before each sample
+     * The first function ignores the imaginary parts, the second one is
+     * used with IPD/OPD.
+     */
+    void (*stereo_interpolate[2])(float (*l)[2], float (*r)[2],
+                                  float h[2][4], float h_step[2][4], int len);
+} PSDSPContext;
+
+void ff_psdsp_init(PSDSPContext *s);
+void ff_psdsp_init_x86(PSDSPContext *s);
+
+#endif /* AVCODEC_PSDSP_H */
@@ -29,10 +29,24 @@
  * @see doc/multithreading.txt
  */
 
+#include "config.h"
+
+#if HAVE_SCHED_SETAFFINITY
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
 #include <pthread.h>
+#if HAVE_GETSYSTEMINFO || HAVE_SETTHREADAFFINITYMASK
+#include <windows.h>
+#endif
+#if HAVE_SYSCONF
+#include <unistd.h>
+#endif
 
 #include "avcodec.h"
+#include "internal.h"
 #include "thread.h"
+#include "libavutil/time.h"
 #pragma check_stack(off)
 #pragma comment(lib, "pthreadVC2.lib")
 
@@ -40,6 +54,64 @@
 typedef int (action_func)(AVCodecContext *c, void *arg);
 typedef int (action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr);
 
+/**
+ * Unit of work queued on the shared thread pool.
+ * Tasks are embedded in the context that submits them, so queueing never allocates.
+ */
+typedef struct PoolTask {
+    struct PoolTask *prev, *next;
+    void (*run)(struct PoolTask *task);
+    void *opaque;                   ///< Context the task works on.
+    int id;                         ///< Thread number passed to execute2() jobs.
+    int queue;                      ///< Queue the task is waiting in, -1 if it is not queued.
+} PoolTask;
+
+typedef struct PoolTaskList {
+    PoolTask *head, *tail;
+    int count;
+} PoolTaskList;
+
+/// Queue index used for frame decoding tasks.
+#define POOL_FRAME_QUEUE (-2)
+
+/**
+ * Process-wide pool of worker threads shared by all codec contexts,
+ * see avcodec_thread_pool_init().
+ *
+ * Every worker owns a deque of execute() helper tasks, runs the newest one
+ * first and steals the oldest tasks of the other workers when its own deque
+ * is empty. Frame decoding tasks wait on earlier frames of the same stream,
+ * so they go into one FIFO instead: a frame task then only ever waits on
+ * tasks that are already running, which cannot deadlock however few workers
+ * the pool has.
+ */
+typedef struct PoolWorker {
+    struct ThreadPool *pool;
+    pthread_t thread;
+    int id;
+} PoolWorker;
+
+typedef struct ThreadPool {
+    PoolWorker *workers;
+    int nb_workers;
+    int flags;
+
+    pthread_mutex_t lock;           ///< Protects all queues, counters and stats.
+    pthread_cond_t  work_cond;      ///< Signaled when a task is queued or the pool shuts down.
+
+    PoolTaskList *deques;           ///< Per-worker deques of execute() helpers.
+    PoolTaskList  frame_queue;      ///< FIFO of frame decoding tasks.
+    int next_deque;                 ///< Deque the next helper is queued in.
+
+    int users;                      ///< Codec contexts currently using the pool.
+    int die;                        ///< Set when the workers should exit.
+
+    AVCodecThreadPoolStats stats;
+} ThreadPool;
+
+static pthread_mutex_t pool_init_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadPool *thread_pool;
+
 typedef struct ThreadContext {
     pthread_t *workers;
     action_func *func;
@@ -55,6 +127,16 @@ typedef struct ThreadContext {
     pthread_mutex_t current_job_lock;
     int current_job;
     int done;
+
+    ThreadPool *pool;               ///< Shared pool running the jobs, NULL if the context owns its workers.
+    PoolTask *helpers;              ///< Tasks running jobs on the pool alongside the calling thread.
+    int helpers_active;             ///< Helpers that are queued or running.
+
+    int *row_progress;              ///< Progress of each row, see ff_thread_report_row().
+    int row_count;
+    int row_waiters;                ///< Jobs sleeping in ff_thread_await_row().
+    pthread_mutex_t progress_lock;  ///< Protects row_progress and row_waiters.
+    pthread_cond_t progress_cond;
 } ThreadContext;
 
 /// Max number of frame buffers that can be allocated when using frame threads.
@@ -80,6 +162,8 @@ typedef struct PerThreadContext {
     int            allocated_buf_size; ///< Size allocated for avpkt.data
 
     AVFrame frame;                  ///< Output frame (for decoding) or input (for encoding).
+    uint8_t *frame_buf;             ///< Copy of the pixels of the input frame (for encoding).
+    int      allocated_frame_size;  ///< Size allocated for frame_buf
     int     got_frame;              ///< The output of got_picture_ptr from the last avcodec_decode_video() call.
     int     result;                 ///< The result of the last codec decode/encode() call.
 
@@ -107,6 +191,13 @@ typedef struct PerThreadContext {
     uint8_t progress_used[MAX_BUFFERS];
 
     AVFrame *requested_frame;       ///< AVFrame the codec passed to get_buffer()
+
+    PoolTask task;                  ///< Decoding task queued on the shared pool.
+
+    struct PerThreadContext *prev;  ///< The thread the previous frame was submitted to, see ff_thread_await_previous_frame().
+
+    int64_t decode_start;           ///< av_gettime() when decoding of the current packet started.
+    AVCodecThreadStats stats;       ///< Protected by FrameThreadContext.stats_mutex.
 } PerThreadContext;
 
 /**
@@ -127,8 +218,323 @@ typedef struct FrameThreadContext {
                                     */
 
     int die;                       ///< Set when threads should exit.
+
+    ThreadPool *pool;              ///< Shared pool decoding the packets, NULL if each context has its own thread.
+
+    int frames_updated;            ///< Number of update_thread_context() calls between threads.
+
+    pthread_mutex_t stats_mutex;   ///< Mutex used to protect the stats of all threads.
 } FrameThreadContext;
 
+/**
+ * The PerThreadContext decoding on the calling thread, or NULL.
+ * ff_thread_await_progress() uses it to charge the wait to the waiting
+ * thread rather than to the owner of the reference frame.
+ */
+static pthread_key_t  frame_worker_key;
+static pthread_once_t frame_worker_key_once = PTHREAD_ONCE_INIT;
+
+static void frame_worker_key_init(void)
+{
+    pthread_key_create(&frame_worker_key, NULL);
+}
+
+static int get_cpu_count(void)
+{
+#if HAVE_GETSYSTEMINFO
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#elif HAVE_SYSCONF && defined(_SC_NPROCESSORS_ONLN)
+    return FFMAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+#else
+    return 1;
+#endif
+}
+
+static void pin_thread_to_cpu(int cpu)
+{
+#if HAVE_SETTHREADAFFINITYMASK
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (cpu % (8 * sizeof(DWORD_PTR))));
+#elif HAVE_SCHED_SETAFFINITY
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+static PoolTaskList *pool_queue(ThreadPool *pool, int queue)
+{
+    return queue == POOL_FRAME_QUEUE ? &pool->frame_queue : &pool->deques[queue];
+}
+
+static void pool_list_remove(PoolTaskList *list, PoolTask *task)
+{
+    if (task->prev) task->prev->next = task->next;
+    else            list->head       = task->next;
+    if (task->next) task->next->prev = task->prev;
+    else            list->tail       = task->prev;
+    task->prev = task->next = NULL;
+    task->queue = -1;
+    list->count--;
+}
+
+/**
+ * Queue a task on the pool.
+ *
+ * @param queue POOL_FRAME_QUEUE for frame decoding tasks,
+ *              -1 to pick a worker deque round-robin
+ */
+static void pool_submit(ThreadPool *pool, PoolTask *task, int queue)
+{
+    PoolTaskList *list;
+    int depth;
+
+    pthread_mutex_lock(&pool->lock);
+    if (queue == -1) {
+        queue = pool->next_deque;
+        pool->next_deque = (queue + 1) % pool->nb_workers;
+    }
+    list = pool_queue(pool, queue);
+
+    task->queue = queue;
+    task->next  = NULL;
+    task->prev  = list->tail;
+    if (list->tail) list->tail->next = task;
+    else            list->head       = task;
+    list->tail = task;
+    list->count++;
+
+    depth = ++pool->stats.queue_depth;
+    pool->stats.max_queue_depth = FFMAX(pool->stats.max_queue_depth, depth);
+    pool->stats.tasks_submitted++;
+
+    pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Remove a task from the pool if no worker has picked it up yet.
+ *
+ * @return 1 if the task was removed, 0 if it is running or has already run
+ */
+static int pool_cancel(ThreadPool *pool, PoolTask *task)
+{
+    int removed = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    if (task->queue != -1) {
+        pool_list_remove(pool_queue(pool, task->queue), task);
+        pool->stats.queue_depth--;
+        removed = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return removed;
+}
+
+/// Pick the next task for a worker; must be called with pool->lock held.
+static PoolTask *pool_take_task(ThreadPool *pool, int self)
+{
+    PoolTaskList *list = &pool->deques[self];
+    PoolTask *task = list->tail;
+    int i;
+
+    if (!task) {
+        list = &pool->frame_queue;
+        task = list->head;
+    }
+
+    for (i = 1; !task && i < pool->nb_workers; i++) {
+        list = &pool->deques[(self + i) % pool->nb_workers];
+        task = list->head;
+        if (task) pool->stats.steals++;
+    }
+
+    if (task) {
+        pool_list_remove(list, task);
+        pool->stats.queue_depth--;
+    }
+
+    return task;
+}
+
+static void* attribute_align_arg pool_worker(void *arg)
+{
+    PoolWorker *w = arg;
+    ThreadPool *pool = w->pool;
+    int self = w->id;
+
+    if (pool->flags & AVCODEC_THREAD_POOL_PIN)
+        pin_thread_to_cpu(self);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        PoolTask *task = pool_take_task(pool, self);
+
+        if (!task) {
+            if (pool->die) break;
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+            continue;
+        }
+
+        pool->stats.active_workers++;
+        pthread_mutex_unlock(&pool->lock);
+
+        /* the task may be freed by its owner as soon as run() returns */
+        task->run(task);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->stats.active_workers--;
+        pool->stats.tasks_run++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void pool_free(ThreadPool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->die = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nb_workers; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    av_free(pool->deques);
+    av_free(pool->workers);
+    av_free(pool);
+}
+
+int avcodec_thread_pool_init(int nb_workers, int flags)
+{
+    ThreadPool *pool;
+    int i, err = 0;
+
+    if (nb_workers < 0)
+        return AVERROR(EINVAL);
+    if (!nb_workers)
+        nb_workers = get_cpu_count();
+
+    pthread_mutex_lock(&pool_init_lock);
+    if (thread_pool) {
+        err = AVERROR(EEXIST);
+        goto end;
+    }
+
+    pool = av_mallocz(sizeof(ThreadPool));
+    if (!pool) {
+        err = AVERROR(ENOMEM);
+        goto end;
+    }
+    pool->workers = av_mallocz(sizeof(PoolWorker)   * nb_workers);
+    pool->deques  = av_mallocz(sizeof(PoolTaskList) * nb_workers);
+    if (!pool->workers || !pool->deques) {
+        av_free(pool->workers);
+        av_free(pool->deques);
+        av_free(pool);
+        err = AVERROR(ENOMEM);
+        goto end;
+    }
+    pool->flags = flags;
+    pool->stats.nb_workers = nb_workers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+
+    pool->nb_workers = nb_workers;
+    for (i = 0; i < nb_workers; i++) {
+        PoolWorker *w = &pool->workers[i];
+
+        w->pool = pool;
+        w->id   = i;
+        if (pthread_create(&w->thread, NULL, pool_worker, w)) {
+            pool->nb_workers = i;
+            err = AVERROR(EAGAIN);
+            break;
+        }
+    }
+
+    if (err)
+        pool_free(pool);
+    else
+        thread_pool = pool;
+
+end:
+    pthread_mutex_unlock(&pool_init_lock);
+    return err;
+}
+
+int avcodec_thread_pool_uninit(void)
+{
+    ThreadPool *pool;
+
+    pthread_mutex_lock(&pool_init_lock);
+    pool = thread_pool;
+    if (pool && pool->users) {
+        pthread_mutex_unlock(&pool_init_lock);
+        av_log(NULL, AV_LOG_ERROR, "thread pool is still used by %d codec contexts\n", pool->users);
+        return AVERROR(EBUSY);
+    }
+    thread_pool = NULL;
+    pthread_mutex_unlock(&pool_init_lock);
+
+    if (pool)
+        pool_free(pool);
+
+    return 0;
+}
+
+int avcodec_thread_pool_get_stats(AVCodecThreadPoolStats *stats)
+{
+    int err = 0;
+
+    pthread_mutex_lock(&pool_init_lock);
+    if (thread_pool) {
+        pthread_mutex_lock(&thread_pool->lock);
+        *stats = thread_pool->stats;
+        stats->users = thread_pool->users;
+        pthread_mutex_unlock(&thread_pool->lock);
+    } else {
+        err = AVERROR(EINVAL);
+    }
+    pthread_mutex_unlock(&pool_init_lock);
+
+    return err;
+}
+
+/// Attach a codec context to the shared pool, if one is running.
+static ThreadPool *pool_attach(void)
+{
+    ThreadPool *pool;
+
+    pthread_mutex_lock(&pool_init_lock);
+    pool = thread_pool;
+    if (pool) {
+        pthread_mutex_lock(&pool->lock);
+        pool->users++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool_init_lock);
+
+    return pool;
+}
+
+static void pool_detach(ThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->users--;
+    pthread_mutex_unlock(&pool->lock);
+}
+
 static void* attribute_align_arg worker(void *v)
 {
     AVCodecContext *avctx = v;
@@ -173,21 +579,93 @@ static void thread_free(AVCodecContext *avctx)
     ThreadContext *c = avctx->thread_opaque;
     int i;
 
-    pthread_mutex_lock(&c->current_job_lock);
-    c->done = 1;
-    pthread_cond_broadcast(&c->current_job_cond);
-    pthread_mutex_unlock(&c->current_job_lock);
+    if (c->pool) {
+        pool_detach(c->pool);
+    } else {
+        pthread_mutex_lock(&c->current_job_lock);
+        c->done = 1;
+        pthread_cond_broadcast(&c->current_job_cond);
+        pthread_mutex_unlock(&c->current_job_lock);
 
-    for (i=0; i<avctx->thread_count; i++)
-         pthread_join(c->workers[i], NULL);
+        for (i=0; i<avctx->thread_count; i++)
+             pthread_join(c->workers[i], NULL);
+    }
 
     pthread_mutex_destroy(&c->current_job_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
+    pthread_mutex_destroy(&c->progress_lock);
+    pthread_cond_destroy(&c->progress_cond);
     av_free(c->workers);
+    av_free(c->helpers);
+    av_free(c->row_progress);
     av_freep(&avctx->thread_opaque);
 }
 
+/**
+ * Run jobs of the current execute() call until none are left.
+ * Jobs are handed out in increasing order, so a job waiting on an
+ * earlier one always waits on a job that is already running.
+ */
+static void pool_run_jobs(AVCodecContext *avctx, ThreadContext *c, int threadnr)
+{
+    int job;
+
+    for (;;) {
+        pthread_mutex_lock(&c->current_job_lock);
+        job = c->current_job++;
+        pthread_mutex_unlock(&c->current_job_lock);
+
+        if (job >= c->job_count)
+            break;
+
+        c->rets[job%c->rets_count] = c->func ? c->func(avctx, (char*)c->args + job*c->job_size):
+                                               c->func2(avctx, c->args, job, threadnr);
+    }
+}
+
+static void pool_helper_task(PoolTask *task)
+{
+    AVCodecContext *avctx = task->opaque;
+    ThreadContext *c = avctx->thread_opaque;
+
+    pool_run_jobs(avctx, c, task->id);
+
+    pthread_mutex_lock(&c->current_job_lock);
+    if (!--c->helpers_active)
+        pthread_cond_signal(&c->last_job_cond);
+    pthread_mutex_unlock(&c->current_job_lock);
+}
+
+/**
+ * execute() on the shared pool: the calling thread runs jobs itself and
+ * queues up to thread_count - 1 helpers, which take jobs as long as any
+ * are left. Helpers no worker had time for are withdrawn at the end.
+ */
+static void pool_execute(AVCodecContext *avctx, ThreadContext *c)
+{
+    int i, nb_helpers = FFMIN(avctx->thread_count, c->job_count) - 1;
+
+    c->helpers_active = nb_helpers;
+    for (i = 0; i < nb_helpers; i++)
+        pool_submit(c->pool, &c->helpers[i], -1);
+
+    pool_run_jobs(avctx, c, 0);
+
+    for (i = 0; i < nb_helpers; i++) {
+        if (pool_cancel(c->pool, &c->helpers[i])) {
+            pthread_mutex_lock(&c->current_job_lock);
+            c->helpers_active--;
+            pthread_mutex_unlock(&c->current_job_lock);
+        }
+    }
+
+    pthread_mutex_lock(&c->current_job_lock);
+    while (c->helpers_active)
+        pthread_cond_wait(&c->last_job_cond, &c->current_job_lock);
+    pthread_mutex_unlock(&c->current_job_lock);
+}
+
 static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
     ThreadContext *c= avctx->thread_opaque;
@@ -201,7 +679,7 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
 
     pthread_mutex_lock(&c->current_job_lock);
 
-    c->current_job = avctx->thread_count;
+    c->current_job = c->pool ? 0 : avctx->thread_count;
     c->job_count = job_count;
     c->job_size = job_size;
     c->args = arg;
@@ -213,6 +691,13 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
         c->rets = &dummy_ret;
         c->rets_count = 1;
     }
+
+    if (c->pool) {
+        pthread_mutex_unlock(&c->current_job_lock);
+        pool_execute(avctx, c);
+        return 0;
+    }
+
     pthread_cond_broadcast(&c->current_job_cond);
 
     avcodec_thread_park_workers(c, avctx->thread_count);
@@ -227,6 +712,56 @@ static int avcodec_thread_execute2(AVCodecContext *avctx, action_func2* func2, v
     return avcodec_thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
 
+int ff_thread_init_rows(AVCodecContext *avctx, int count)
+{
+    ThreadContext *c = avctx->thread_opaque;
+    int i;
+
+    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || !c)
+        return AVERROR(EINVAL);
+
+    if (count > c->row_count) {
+        av_freep(&c->row_progress);
+        c->row_count = 0;
+        c->row_progress = av_malloc(count * sizeof(*c->row_progress));
+        if (!c->row_progress)
+            return AVERROR(ENOMEM);
+        c->row_count = count;
+    }
+
+    for (i = 0; i < count; i++)
+        c->row_progress[i] = -1;
+
+    return 0;
+}
+
+void ff_thread_report_row(AVCodecContext *avctx, int row, int progress)
+{
+    ThreadContext *c = avctx->thread_opaque;
+
+    pthread_mutex_lock(&c->progress_lock);
+    c->row_progress[row] = progress;
+    if (c->row_waiters)
+        pthread_cond_broadcast(&c->progress_cond);
+    pthread_mutex_unlock(&c->progress_lock);
+}
+
+void ff_thread_await_row(AVCodecContext *avctx, int row, int progress)
+{
+    ThreadContext *c = avctx->thread_opaque;
+    volatile int *row_progress = c->row_progress;
+
+    if (row_progress[row] >= progress)
+        return;
+
+    pthread_mutex_lock(&c->progress_lock);
+    c->row_waiters++;
+    while (row_progress[row] < progress)
+        pthread_cond_wait(&c->progress_cond, &c->progress_lock);
+    c->row_waiters--;
+    pthread_mutex_unlock(&c->progress_lock);
+}
+
 static int thread_init(AVCodecContext *avctx)
 {
     int i;
@@ -254,6 +789,28 @@ static int thread_init(AVCodecContext *avctx)
     pthread_cond_init(&c->current_job_cond, NULL);
     pthread_cond_init(&c->last_job_cond, NULL);
     pthread_mutex_init(&c->current_job_lock, NULL);
+    pthread_cond_init(&c->progress_cond, NULL);
+    pthread_mutex_init(&c->progress_lock, NULL);
+
+    c->pool = pool_attach();
+    if (c->pool) {
+        c->helpers = av_mallocz(sizeof(PoolTask) * (thread_count - 1));
+        if (!c->helpers) {
+            ff_thread_free(avctx);
+            return -1;
+        }
+        for (i = 0; i < thread_count - 1; i++) {
+            c->helpers[i].run    = pool_helper_task;
+            c->helpers[i].opaque = avctx;
+            c->helpers[i].id     = i + 1;
+            c->helpers[i].queue  = -1;
+        }
+
+        avctx->execute = avcodec_thread_execute;
+        avctx->execute2 = avcodec_thread_execute2;
+        return 0;
+    }
+
     pthread_mutex_lock(&c->current_job_lock);
     for (i=0; i<thread_count; i++) {
         if(pthread_create(&c->workers[i], NULL, worker, avctx)) {
@@ -272,18 +829,61 @@ static int thread_init(AVCodecContext *avctx)
 }
 
 /**
- * Codec worker thread.
+ * Decode the packet, or encode the frame, submitted to a frame thread.
  *
  * Automatically calls ff_thread_finish_setup() if the codec does
  * not provide an update_thread_context method, or if the codec returns
  * before calling it.
  */
-static attribute_align_arg void *frame_worker_thread(void *arg)
+static void frame_worker_decode(PerThreadContext *p)
 {
-    PerThreadContext *p = arg;
     FrameThreadContext *fctx = p->parent;
     AVCodecContext *avctx = p->avctx;
     AVCodec *codec = avctx->codec;
+    int64_t decode_time;
+
+    pthread_setspecific(frame_worker_key, p);
+    p->decode_start = av_gettime();
+
+    if (!codec->update_thread_context && avctx->thread_safe_callbacks)
+        ff_thread_finish_setup(avctx);
+
+    pthread_mutex_lock(&p->mutex);
+    if (codec->encode) {
+        p->result = codec->encode(avctx, p->avpkt.data, p->avpkt.size,
+                                  p->frame.data[0] ? &p->frame : NULL);
+    } else {
+        avcodec_get_frame_defaults(&p->frame);
+        p->got_frame = 0;
+        p->result = codec->decode(avctx, &p->frame, &p->got_frame, &p->avpkt);
+    }
+
+    if (p->state == STATE_SETTING_UP) ff_thread_finish_setup(avctx);
+
+    decode_time = av_gettime() - p->decode_start;
+    pthread_mutex_lock(&fctx->stats_mutex);
+    p->stats.packets++;
+    p->stats.decode_time += decode_time;
+    pthread_mutex_unlock(&fctx->stats_mutex);
+    pthread_setspecific(frame_worker_key, NULL);
+
+    p->state = STATE_INPUT_READY;
+
+    /* the user's thread and the next encoding thread may both be waiting */
+    pthread_mutex_lock(&p->progress_mutex);
+    pthread_cond_broadcast(&p->output_cond);
+    pthread_mutex_unlock(&p->progress_mutex);
+
+    pthread_mutex_unlock(&p->mutex);
+}
+
+/**
+ * Codec worker thread.
+ */
+static attribute_align_arg void *frame_worker_thread(void *arg)
+{
+    PerThreadContext *p = arg;
+    FrameThreadContext *fctx = p->parent;
 
     while (1) {
         if (p->state == STATE_INPUT_READY && !fctx->die) {
@@ -295,28 +895,20 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
 
         if (fctx->die) break;
 
-        if (!codec->update_thread_context && avctx->thread_safe_callbacks)
-            ff_thread_finish_setup(avctx);
-
-        pthread_mutex_lock(&p->mutex);
-        avcodec_get_frame_defaults(&p->frame);
-        p->got_frame = 0;
-        p->result = codec->decode(avctx, &p->frame, &p->got_frame, &p->avpkt);
-
-        if (p->state == STATE_SETTING_UP) ff_thread_finish_setup(avctx);
-
-        p->state = STATE_INPUT_READY;
-
-        pthread_mutex_lock(&p->progress_mutex);
-        pthread_cond_signal(&p->output_cond);
-        pthread_mutex_unlock(&p->progress_mutex);
-
-        pthread_mutex_unlock(&p->mutex);
+        frame_worker_decode(p);
     }
 
     return NULL;
 }
 
+/// Frame decoding task run by the shared pool, see frame_worker_thread().
+static void frame_worker_task(PoolTask *task)
+{
+    PerThreadContext *p = task->opaque;
+
+    frame_worker_decode(p);
+}
+
 /**
  * Updates the next thread's AVCodecContext with values from the reference thread's context.
  *
@@ -333,6 +925,8 @@ static int update_context_from_thread(AVCodecContext *dst, AVCodecContext *src,
         dst->time_base = src->time_base;
         dst->width     = src->width;
         dst->height    = src->height;
+        dst->coded_width  = src->coded_width;
+        dst->coded_height = src->coded_height;
         dst->pix_fmt   = src->pix_fmt;
 
         dst->has_b_frames = src->has_b_frames;
@@ -358,7 +952,8 @@ static int update_context_from_thread(AVCodecContext *dst, AVCodecContext *src,
 
     if (for_user) {
         dst->coded_frame   = src->coded_frame;
-        dst->has_b_frames += src->thread_count - 1;
+        if (!dst->codec->encode)
+            dst->has_b_frames += src->thread_count - 1;
     } else {
         if (dst->codec->update_thread_context)
             err = dst->codec->update_thread_context(dst, src);
@@ -397,6 +992,7 @@ static void update_context_from_user(AVCodecContext *dst, AVCodecContext *src)
 
     dst->frame_number     = src->frame_number;
     dst->reordered_opaque = src->reordered_opaque;
+    dst->deadline_level   = src->deadline_level;
 #undef copy_fields
 }
 
@@ -425,45 +1021,64 @@ static void release_delayed_buffers(PerThreadContext *p)
     }
 }
 
-static int submit_packet(PerThreadContext *p, AVPacket *avpkt)
+/**
+ * Waits for the thread the previous packet was submitted to to finish its setup
+ * and updates p->avctx from it. Called with p->mutex locked.
+ */
+static int update_from_prev_thread(PerThreadContext *p)
 {
     FrameThreadContext *fctx = p->parent;
     PerThreadContext *prev_thread = fctx->prev_thread;
-    AVCodec *codec = p->avctx->codec;
-    uint8_t *buf = p->avpkt.data;
-
-    if (!avpkt->size && !(codec->capabilities & CODEC_CAP_DELAY)) return 0;
-
-    pthread_mutex_lock(&p->mutex);
 
     release_delayed_buffers(p);
 
+    p->prev = prev_thread;
+
     if (prev_thread) {
+        int64_t copied = p->stats.bytes_copied;
         int err;
         if (prev_thread->state == STATE_SETTING_UP) {
+            int64_t t = av_gettime();
             pthread_mutex_lock(&prev_thread->progress_mutex);
             while (prev_thread->state == STATE_SETTING_UP)
                 pthread_cond_wait(&prev_thread->progress_cond, &prev_thread->progress_mutex);
             pthread_mutex_unlock(&prev_thread->progress_mutex);
+            t = av_gettime() - t;
+
+            pthread_mutex_lock(&fctx->stats_mutex);
+            p->stats.setup_wait_time += t;
+            pthread_mutex_unlock(&fctx->stats_mutex);
         }
 
         err = update_context_from_thread(p->avctx, prev_thread->avctx, 0);
-        if (err) {
-            pthread_mutex_unlock(&p->mutex);
+        if (err)
             return err;
-        }
+
+        fctx->frames_updated++;
+        if (p->avctx->debug & FF_DEBUG_THREADS)
+            av_log(p->avctx, AV_LOG_DEBUG, "update_thread_context() copied %"PRId64" bytes\n",
+                   p->stats.bytes_copied - copied);
     }
 
-    av_fast_malloc(&buf, &p->allocated_buf_size, avpkt->size + FF_INPUT_BUFFER_PADDING_SIZE);
-    p->avpkt = *avpkt;
-    p->avpkt.data = buf;
-    memcpy(buf, avpkt->data, avpkt->size);
-    memset(buf + avpkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    return 0;
+}
+
+/**
+ * Starts the thread on the input copied to p.
+ * Called with p->mutex locked, which is unlocked.
+ */
+static void start_thread(PerThreadContext *p)
+{
+    FrameThreadContext *fctx = p->parent;
 
     p->state = STATE_SETTING_UP;
-    pthread_cond_signal(&p->input_cond);
+    if (!fctx->pool)
+        pthread_cond_signal(&p->input_cond);
     pthread_mutex_unlock(&p->mutex);
 
+    if (fctx->pool)
+        pool_submit(fctx->pool, &p->task, POOL_FRAME_QUEUE);
+
     /*
      * If the client doesn't have a thread-safe get_buffer(),
      * then decoding threads call back to the main thread,
@@ -487,10 +1102,54 @@ static int submit_packet(PerThreadContext *p, AVPacket *avpkt)
     }
 
     fctx->prev_thread = p;
+}
+
+static int submit_packet(PerThreadContext *p, AVPacket *avpkt)
+{
+    AVCodec *codec = p->avctx->codec;
+    uint8_t *buf = p->avpkt.data;
+    int err;
+
+    if (!avpkt->size && !(codec->capabilities & CODEC_CAP_DELAY)) return 0;
+
+    pthread_mutex_lock(&p->mutex);
+
+    err = update_from_prev_thread(p);
+    if (err) {
+        pthread_mutex_unlock(&p->mutex);
+        return err;
+    }
+
+    av_fast_malloc(&buf, &p->allocated_buf_size, avpkt->size + FF_INPUT_BUFFER_PADDING_SIZE);
+    p->avpkt = *avpkt;
+    p->avpkt.data = buf;
+    memcpy(buf, avpkt->data, avpkt->size);
+    memset(buf + avpkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    start_thread(p);
 
     return 0;
 }
 
+/// Waits for the thread to finish the packet or frame submitted to it.
+static void wait_for_output(PerThreadContext *p)
+{
+    FrameThreadContext *fctx = p->parent;
+
+    if (p->state != STATE_INPUT_READY) {
+        int64_t t = av_gettime();
+        pthread_mutex_lock(&p->progress_mutex);
+        while (p->state != STATE_INPUT_READY)
+            pthread_cond_wait(&p->output_cond, &p->progress_mutex);
+        pthread_mutex_unlock(&p->progress_mutex);
+        t = av_gettime() - t;
+
+        pthread_mutex_lock(&fctx->stats_mutex);
+        p->stats.output_wait_time += t;
+        pthread_mutex_unlock(&fctx->stats_mutex);
+    }
+}
+
 int ff_thread_decode_frame(AVCodecContext *avctx,
                            AVFrame *picture, int *got_picture_ptr,
                            AVPacket *avpkt)
@@ -532,17 +1191,17 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     do {
         p = &fctx->threads[finished++];
 
-        if (p->state != STATE_INPUT_READY) {
-            pthread_mutex_lock(&p->progress_mutex);
-            while (p->state != STATE_INPUT_READY)
-                pthread_cond_wait(&p->output_cond, &p->progress_mutex);
-            pthread_mutex_unlock(&p->progress_mutex);
-        }
+        wait_for_output(p);
 
         *picture = p->frame;
         *got_picture_ptr = p->got_frame;
         picture->pkt_dts = p->avpkt.dts;
 
+        avctx->deadline_skip_loop_filter_count += p->avctx->deadline_skip_loop_filter_count;
+        avctx->deadline_drop_count             += p->avctx->deadline_drop_count;
+        p->avctx->deadline_skip_loop_filter_count = 0;
+        p->avctx->deadline_drop_count             = 0;
+
         /*
          * A later call with avkpt->size == 0 may loop over all threads,
          * including this one, searching for a frame to return before being
@@ -563,6 +1222,144 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     return p->result;
 }
 
+/**
+ * Copies the input frame to the encoding thread and starts it.
+ * A NULL pict flushes the frames delayed by the encoder.
+ */
+static int submit_frame(PerThreadContext *p, const AVFrame *pict, int buf_size)
+{
+    AVCodecContext *avctx = p->avctx;
+    int err;
+
+    pthread_mutex_lock(&p->mutex);
+
+    err = update_from_prev_thread(p);
+    if (err) {
+        pthread_mutex_unlock(&p->mutex);
+        return err;
+    }
+
+    av_fast_malloc(&p->avpkt.data, &p->allocated_buf_size, buf_size);
+    p->avpkt.size = buf_size;
+
+    if (pict) {
+        int size = avpicture_get_size(avctx->pix_fmt, avctx->width, avctx->height);
+
+        av_fast_malloc(&p->frame_buf, &p->allocated_frame_size, size);
+        if (!p->avpkt.data || !p->frame_buf) {
+            pthread_mutex_unlock(&p->mutex);
+            return AVERROR(ENOMEM);
+        }
+
+        p->frame = *pict;
+        avpicture_fill((AVPicture*)&p->frame, p->frame_buf, avctx->pix_fmt,
+                       avctx->width, avctx->height);
+        av_picture_copy((AVPicture*)&p->frame, (const AVPicture*)pict,
+                        avctx->pix_fmt, avctx->width, avctx->height);
+    } else {
+        if (!p->avpkt.data) {
+            pthread_mutex_unlock(&p->mutex);
+            return AVERROR(ENOMEM);
+        }
+        memset(p->frame.data, 0, sizeof(p->frame.data));
+    }
+
+    start_thread(p);
+
+    return 0;
+}
+
+int ff_thread_encode_frame(AVCodecContext *avctx, uint8_t *buf, int buf_size,
+                           const AVFrame *pict)
+{
+    FrameThreadContext *fctx = avctx->thread_opaque;
+    int finished = fctx->next_finished;
+    PerThreadContext *p;
+    int ret;
+
+    /*
+     * Submit the frame to the next encoding thread.
+     */
+
+    p = &fctx->threads[fctx->next_decoding];
+    update_context_from_user(p->avctx, avctx);
+    ret = submit_frame(p, pict, buf_size);
+    if (ret < 0) return ret;
+
+    fctx->next_decoding++;
+
+    if (fctx->delaying && pict) {
+        if (fctx->next_decoding >= (avctx->thread_count-1)) fctx->delaying = 0;
+
+        return 0;
+    }
+
+    /*
+     * Return the output of the oldest thread. When flushing, skip
+     * threads without output like ff_thread_decode_frame() does.
+     */
+
+    do {
+        p = &fctx->threads[finished++];
+
+        wait_for_output(p);
+
+        ret = p->result;
+        if (ret > buf_size) {
+            av_log(avctx, AV_LOG_ERROR, "encoded frame too large for the output buffer\n");
+            ret = -1;
+        } else if (ret > 0) {
+            memcpy(buf, p->avpkt.data, ret);
+
+            memcpy(&avctx->mv_bits, &p->avctx->mv_bits,
+                   (char*)&avctx->frame_bits - (char*)&avctx->mv_bits + sizeof(avctx->frame_bits));
+            avctx->vbv_delay = p->avctx->vbv_delay;
+            if (avctx->flags & CODEC_FLAG_PSNR) {
+                int i;
+                for (i = 0; i < 4; i++)
+                    avctx->error[i] += p->avctx->coded_frame->error[i];
+            }
+        }
+
+        /* don't return the same output again when flushing */
+        p->result = 0;
+
+        if (finished >= avctx->thread_count) finished = 0;
+    } while (!pict && !ret && finished != fctx->next_finished);
+
+    update_context_from_thread(avctx, p->avctx, 1);
+
+    if (fctx->next_decoding >= avctx->thread_count) fctx->next_decoding = 0;
+
+    fctx->next_finished = finished;
+
+    return ret;
+}
+
+AVCodecContext *ff_thread_await_previous_frame(AVCodecContext *avctx)
+{
+    PerThreadContext *p = avctx->thread_opaque, *prev;
+
+    if (!(avctx->active_thread_type&FF_THREAD_FRAME) || !p->prev) return NULL;
+
+    prev = p->prev;
+
+    if (prev->state != STATE_INPUT_READY) {
+        int64_t t = av_gettime();
+        pthread_mutex_lock(&prev->progress_mutex);
+        while (prev->state != STATE_INPUT_READY)
+            pthread_cond_wait(&prev->output_cond, &prev->progress_mutex);
+        pthread_mutex_unlock(&prev->progress_mutex);
+        t = av_gettime() - t;
+
+        pthread_mutex_lock(&p->parent->stats_mutex);
+        p->stats.setup_wait_time += t;
+        pthread_mutex_unlock(&p->parent->stats_mutex);
+    }
+
+    return prev->avctx;
+}
+
 void ff_thread_report_progress(AVFrame *f, int n, int field)
 {
     PerThreadContext *p;
@@ -583,20 +1380,50 @@ void ff_thread_report_progress(AVFrame *f, int n, int field)
 
 void ff_thread_await_progress(AVFrame *f, int n, int field)
 {
-    PerThreadContext *p;
+    PerThreadContext *p, *waiter;
     int *progress = f->thread_opaque;
+    int64_t t;
 
     if (!progress || progress[field] >= n) return;
 
     p = f->owner->thread_opaque;
+    waiter = pthread_getspecific(frame_worker_key);
 
     if (f->owner->debug&FF_DEBUG_THREADS)
         av_log(f->owner, AV_LOG_DEBUG, "thread awaiting %d field %d from %p\n", n, field, progress);
 
+    t = av_gettime();
     pthread_mutex_lock(&p->progress_mutex);
     while (progress[field] < n)
         pthread_cond_wait(&p->progress_cond, &p->progress_mutex);
     pthread_mutex_unlock(&p->progress_mutex);
+    t = av_gettime() - t;
+
+    if (waiter) {
+        AVCodecThreadStats *stats = &waiter->stats;
+
+        pthread_mutex_lock(&waiter->parent->stats_mutex);
+        stats->progress_wait_time += t;
+        stats->progress_waits++;
+        if (t > stats->max_progress_wait) {
+            stats->max_progress_wait = t;
+            stats->max_wait_frame    = f->coded_picture_number;
+            stats->max_wait_row      = n;
+            stats->max_wait_field    = field;
+        }
+        pthread_mutex_unlock(&waiter->parent->stats_mutex);
+    }
+}
+
+void ff_thread_report_copied(AVCodecContext *avctx, int bytes)
+{
+    PerThreadContext *p = avctx->thread_opaque;
+
+    if (!(avctx->active_thread_type&FF_THREAD_FRAME)) return;
+
+    pthread_mutex_lock(&p->parent->stats_mutex);
+    p->stats.bytes_copied += bytes;
+    pthread_mutex_unlock(&p->parent->stats_mutex);
 }
 
 void ff_thread_finish_setup(AVCodecContext *avctx) {
@@ -604,6 +1431,14 @@ void ff_thread_finish_setup(AVCodecContext *avctx) {
 
     if (!(avctx->active_thread_type&FF_THREAD_FRAME)) return;
 
+    if (p->state == STATE_SETTING_UP) {
+        int64_t setup_time = av_gettime() - p->decode_start;
+
+        pthread_mutex_lock(&p->parent->stats_mutex);
+        p->stats.setup_time += setup_time;
+        pthread_mutex_unlock(&p->parent->stats_mutex);
+    }
+
     pthread_mutex_lock(&p->progress_mutex);
     p->state = STATE_SETUP_FINISHED;
     pthread_cond_broadcast(&p->progress_cond);
@@ -638,16 +1473,32 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
     if (fctx->prev_thread)
         update_context_from_thread(fctx->threads->avctx, fctx->prev_thread->avctx, 0);
 
+    if ((avctx->debug & FF_DEBUG_THREADS) && fctx->frames_updated) {
+        int64_t copied = 0;
+        for (i = 0; i < thread_count; i++)
+            copied += fctx->threads[i].stats.bytes_copied;
+        av_log(avctx, AV_LOG_DEBUG, "update_thread_context() copied %"PRId64" bytes per frame on average\n",
+               copied / fctx->frames_updated);
+    }
+
     fctx->die = 1;
 
+    /* the first encoding thread frees the extradata it shares with the user */
+    if (codec->encode && avctx->extradata == fctx->threads[0].avctx->extradata) {
+        avctx->extradata      = NULL;
+        avctx->extradata_size = 0;
+    }
+
     for (i = 0; i < thread_count; i++) {
         PerThreadContext *p = &fctx->threads[i];
 
+        /* with the shared pool, this waits for the last task to let go of p */
         pthread_mutex_lock(&p->mutex);
         pthread_cond_signal(&p->input_cond);
         pthread_mutex_unlock(&p->mutex);
 
-        pthread_join(p->thread, NULL);
+        if (!fctx->pool)
+            pthread_join(p->thread, NULL);
 
         if (codec->close)
             codec->close(p->avctx);
@@ -668,6 +1519,7 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
         pthread_cond_destroy(&p->progress_cond);
         pthread_cond_destroy(&p->output_cond);
         av_freep(&p->avpkt.data);
+        av_freep(&p->frame_buf);
 
         if (i)
             av_freep(&p->avctx->priv_data);
@@ -677,6 +1529,9 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
 
     av_freep(&fctx->threads);
     pthread_mutex_destroy(&fctx->buffer_mutex);
+    pthread_mutex_destroy(&fctx->stats_mutex);
+    if (fctx->pool)
+        pool_detach(fctx->pool);
     av_freep(&avctx->thread_opaque);
 }
 
@@ -686,6 +1541,7 @@ static int frame_thread_init(AVCodecContext *avctx)
     AVCodec *codec = avctx->codec;
     AVCodecContext *src = avctx;
     FrameThreadContext *fctx;
+    void *user_priv = NULL;
     int i, err = 0;
 
     if (thread_count <= 1) {
@@ -693,12 +1549,34 @@ static int frame_thread_init(AVCodecContext *avctx)
         return 0;
     }
 
+    /*
+     * Every encoding thread is initialized like the user's context was,
+     * so keep the private options the user set before init changes them.
+     */
+    if (codec->encode) {
+        user_priv = av_malloc(codec->priv_data_size);
+        if (!user_priv)
+            return AVERROR(ENOMEM);
+        memcpy(user_priv, avctx->priv_data, codec->priv_data_size);
+    }
+
     avctx->thread_opaque = fctx = av_mallocz(sizeof(FrameThreadContext));
 
     fctx->threads = av_mallocz(sizeof(PerThreadContext) * thread_count);
     pthread_mutex_init(&fctx->buffer_mutex, NULL);
+    pthread_mutex_init(&fctx->stats_mutex, NULL);
     fctx->delaying = 1;
 
+    pthread_once(&frame_worker_key_once, frame_worker_key_init);
+
+    /*
+     * Pool tasks must never wait on the user's thread, or tasks of several
+     * contexts driven from one thread could wait on each other, so
+     * get_buffer() has to be callable from the workers.
+     */
+    if (avctx->thread_safe_callbacks || avctx->get_buffer == avcodec_default_get_buffer)
+        fctx->pool = pool_attach();
+
     for (i = 0; i < thread_count; i++) {
         AVCodecContext *copy = av_malloc(sizeof(AVCodecContext));
         PerThreadContext *p  = &fctx->threads[i];
@@ -723,6 +1601,22 @@ static int frame_thread_init(AVCodecContext *avctx)
                 err = codec->init(copy);
 
             update_context_from_thread(avctx, copy, 1);
+
+            /* global headers written by the first thread */
+            avctx->extradata      = copy->extradata;
+            avctx->extradata_size = copy->extradata_size;
+        } else if (codec->encode) {
+            *copy = *avctx;
+            copy->thread_opaque  = p;
+            copy->pkt            = &p->avpkt;
+            copy->coded_frame    = NULL;
+            copy->extradata      = NULL;
+            copy->extradata_size = 0;
+            copy->is_copy        = 1;
+            copy->priv_data      = av_malloc(codec->priv_data_size);
+            memcpy(copy->priv_data, user_priv, codec->priv_data_size);
+
+            err = codec->init(copy);
         } else {
             copy->is_copy   = 1;
             copy->priv_data = av_malloc(codec->priv_data_size);
@@ -734,12 +1628,19 @@ static int frame_thread_init(AVCodecContext *avctx)
 
         if (err) goto error;
 
-        pthread_create(&p->thread, NULL, frame_worker_thread, p);
+        if (fctx->pool) {
+            p->task.run    = frame_worker_task;
+            p->task.opaque = p;
+            p->task.queue  = -1;
+        } else
+            pthread_create(&p->thread, NULL, frame_worker_thread, p);
     }
 
+    av_free(user_priv);
     return 0;
 
 error:
+    av_free(user_priv);
     frame_thread_free(avctx, i+1);
 
     return err;
@@ -761,6 +1662,58 @@ void ff_thread_flush(AVCodecContext *avctx)
     fctx->prev_thread = NULL;
 }
 
+void ff_thread_memory_usage(AVCodecContext *avctx, AVCodecMemoryUsage *usage)
+{
+    FrameThreadContext *fctx = avctx->thread_opaque;
+    int i;
+
+    park_frame_worker_threads(fctx, avctx->thread_count);
+
+    /* the first thread shares priv_data with the user's context */
+    usage->contexts += sizeof(*avctx);
+
+    pthread_mutex_lock(&fctx->buffer_mutex);
+    for (i = 0; i < avctx->thread_count; i++)
+        ff_codec_context_memory_usage(fctx->threads[i].avctx, usage);
+    pthread_mutex_unlock(&fctx->buffer_mutex);
+}
+
+int ff_thread_get_stats(AVCodecContext *avctx, int thread, AVCodecThreadStats *stats)
+{
+    FrameThreadContext *fctx = avctx->thread_opaque;
+    int i;
+
+    if (thread < -1 || thread >= avctx->thread_count)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&fctx->stats_mutex);
+    if (thread >= 0) {
+        *stats = fctx->threads[thread].stats;
+    } else {
+        for (i = 0; i < avctx->thread_count; i++) {
+            const AVCodecThreadStats *s = &fctx->threads[i].stats;
+
+            stats->packets            += s->packets;
+            stats->decode_time        += s->decode_time;
+            stats->setup_time         += s->setup_time;
+            stats->progress_wait_time += s->progress_wait_time;
+            stats->progress_waits     += s->progress_waits;
+            stats->setup_wait_time    += s->setup_wait_time;
+            stats->output_wait_time   += s->output_wait_time;
+            stats->bytes_copied       += s->bytes_copied;
+            if (s->max_progress_wait > stats->max_progress_wait) {
+                stats->max_progress_wait = s->max_progress_wait;
+                stats->max_wait_frame    = s->max_wait_frame;
+                stats->max_wait_row      = s->max_wait_row;
+                stats->max_wait_field    = s->max_wait_field;
+            }
+        }
+    }
+    pthread_mutex_unlock(&fctx->stats_mutex);
+
+    return 0;
+}
+
 static int *allocate_progress(PerThreadContext *p)
 {
     int i;
@@ -861,12 +1814,183 @@ void ff_thread_release_buffer(AVCodecContext *avctx, AVFrame *f)
     memset(f->data, 0, sizeof(f->data));
 }
 
+/**
+ * Context for a pass over a frame that runs behind the decoding thread,
+ * see ff_thread_pass_init().
+ */
+typedef struct ThreadPass {
+    AVCodecContext *avctx;
+    int (*func)(AVCodecContext *avctx, void *arg);
+    void *arg;
+    int ret;                        ///< Return value of the last func() call.
+
+    pthread_mutex_t lock;           ///< Protects the fields below.
+    pthread_cond_t  cond;           ///< Signaled when progress or state changes.
+    int progress;                   ///< Progress reported by the decoding thread.
+    int queued;                     ///< Set when the own thread should run func().
+    int running;                    ///< Set from ff_thread_pass_start() until func() has returned.
+    int die;                        ///< Set when the own thread should exit.
+
+    ThreadPool *pool;               ///< Pool running the pass, or NULL if it has its own thread.
+    PoolTask task;
+    pthread_t thread;
+} ThreadPass;
+
+static void pass_run(ThreadPass *pass)
+{
+    int ret = pass->func(pass->avctx, pass->arg);
+
+    pthread_mutex_lock(&pass->lock);
+    pass->ret     = ret;
+    pass->running = 0;
+    pthread_cond_broadcast(&pass->cond);
+    pthread_mutex_unlock(&pass->lock);
+}
+
+static void pass_task(PoolTask *task)
+{
+    pass_run(task->opaque);
+}
+
+static void* attribute_align_arg pass_worker(void *arg)
+{
+    ThreadPass *pass = arg;
+
+    pthread_mutex_lock(&pass->lock);
+    for (;;) {
+        while (!pass->queued && !pass->die)
+            pthread_cond_wait(&pass->cond, &pass->lock);
+        if (pass->die)
+            break;
+        pass->queued = 0;
+        pthread_mutex_unlock(&pass->lock);
+
+        pass_run(pass);
+
+        pthread_mutex_lock(&pass->lock);
+    }
+    pthread_mutex_unlock(&pass->lock);
+
+    return NULL;
+}
+
+int ff_thread_pass_init(AVCodecContext *avctx, ThreadPass **pass)
+{
+    ThreadPass *p;
+
+    if (!(avctx->active_thread_type&FF_THREAD_PIPELINE))
+        return AVERROR(EINVAL);
+
+    p = av_mallocz(sizeof(ThreadPass));
+    if (!p)
+        return AVERROR(ENOMEM);
+
+    p->avctx = avctx;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+
+    p->pool = pool_attach();
+    if (p->pool) {
+        p->task.run    = pass_task;
+        p->task.opaque = p;
+        p->task.queue  = -1;
+    } else if (pthread_create(&p->thread, NULL, pass_worker, p)) {
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->cond);
+        av_free(p);
+        return AVERROR(EAGAIN);
+    }
+
+    *pass = p;
+    return 0;
+}
+
+void ff_thread_pass_start(ThreadPass *pass,
+                          int (*func)(AVCodecContext *avctx, void *arg), void *arg)
+{
+    pthread_mutex_lock(&pass->lock);
+    pass->func     = func;
+    pass->arg      = arg;
+    pass->progress = -1;
+    pass->running  = 1;
+    if (!pass->pool) {
+        pass->queued = 1;
+        pthread_cond_broadcast(&pass->cond);
+    }
+    pthread_mutex_unlock(&pass->lock);
+
+    if (pass->pool)
+        pool_submit(pass->pool, &pass->task, -1);
+}
+
+void ff_thread_pass_report(ThreadPass *pass, int progress)
+{
+    pthread_mutex_lock(&pass->lock);
+    pass->progress = progress;
+    pthread_cond_broadcast(&pass->cond);
+    pthread_mutex_unlock(&pass->lock);
+}
+
+int ff_thread_pass_await(ThreadPass *pass, int progress)
+{
+    pthread_mutex_lock(&pass->lock);
+    while (pass->progress < progress)
+        pthread_cond_wait(&pass->cond, &pass->lock);
+    progress = pass->progress;
+    pthread_mutex_unlock(&pass->lock);
+
+    return progress;
+}
+
+int ff_thread_pass_finish(ThreadPass *pass)
+{
+    int ret;
+
+    /* no worker had time for it, so nothing can be gained by waiting */
+    if (pass->pool && pool_cancel(pass->pool, &pass->task)) {
+        pass_run(pass);
+        return pass->ret;
+    }
+
+    pthread_mutex_lock(&pass->lock);
+    while (pass->running)
+        pthread_cond_wait(&pass->cond, &pass->lock);
+    ret = pass->ret;
+    pthread_mutex_unlock(&pass->lock);
+
+    return ret;
+}
+
+void ff_thread_pass_free(ThreadPass **pass)
+{
+    ThreadPass *p = *pass;
+
+    if (!p)
+        return;
+
+    if (p->pool) {
+        pool_detach(p->pool);
+    } else {
+        pthread_mutex_lock(&p->lock);
+        p->die = 1;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+        pthread_join(p->thread, NULL);
+    }
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->cond);
+    av_freep(pass);
+}
+
 /**
  * Set the threading algorithms used.
  *
  * Threading requires more than one thread.
  * Frame threading requires entire frames to be passed to the codec,
  * and introduces extra decoding delay, so is incompatible with low_delay.
+ * Encoders only use frame threading if it is the only method requested,
+ * and not for two-pass encoding, whose statistics must be written in order.
  *
  * @param avctx The context.
  */
@@ -876,13 +2000,27 @@ static void validate_thread_parameters(AVCodecContext *avctx)
                                 && !(avctx->flags & CODEC_FLAG_TRUNCATED)
                                 && !(avctx->flags & CODEC_FLAG_LOW_DELAY)
                                 && !(avctx->flags2 & CODEC_FLAG2_CHUNKS);
+    int frame_threading_requested = avctx->thread_type & FF_THREAD_FRAME;
+
+    if (avctx->codec->encode) {
+        frame_threading_supported &= !(avctx->flags & (CODEC_FLAG_PASS1|CODEC_FLAG_PASS2));
+        /* Partial macroblocks read the input beyond the picture, the
+         * threads encode a padded copy which would give a different output. */
+        frame_threading_supported &= !((avctx->width | avctx->height) & 15);
+        frame_threading_requested  = (avctx->thread_type & (FF_THREAD_FRAME|FF_THREAD_SLICE)) == FF_THREAD_FRAME;
+    }
+
     if (avctx->thread_count == 1) {
         avctx->active_thread_type = 0;
-    } else if (frame_threading_supported && (avctx->thread_type & FF_THREAD_FRAME)) {
+    } else if (frame_threading_supported && frame_threading_requested) {
         avctx->active_thread_type = FF_THREAD_FRAME;
     } else if (avctx->thread_type & FF_THREAD_SLICE) {
         avctx->active_thread_type = FF_THREAD_SLICE;
     }
+
+    if (avctx->thread_count > 1 && (avctx->thread_type & FF_THREAD_PIPELINE)
+        && (avctx->codec->capabilities & CODEC_CAP_PIPELINE_THREADS))
+        avctx->active_thread_type |= FF_THREAD_PIPELINE;
 }
 
 int ff_thread_init(AVCodecContext *avctx)
@@ -38,13 +38,31 @@
 //#define ALT_BITSTREAM_WRITER
 //#define ALIGNED_BITSTREAM_WRITER
 
+/* The bits are collected in a 64-bit word if --enable-a64-bitstream-writer
+ * was given, which halves the number of stores to the output buffer. */
+#if CONFIG_A64_BITSTREAM_WRITER && HAVE_FAST_64BIT
+typedef uint64_t BitBuf;
+#   define BUF_BITS 64
+#else
+typedef uint32_t BitBuf;
+#   define BUF_BITS 32
+#endif
+
+/* Writes past the end of the buffer are caught and dropped in debug builds
+ * and, with --enable-safe-bitstream-writer, in release builds too. */
+#if CONFIG_SAFE_BITSTREAM_WRITER || !defined(NDEBUG)
+#   define PUT_BITS_CHECK_END 1
+#else
+#   define PUT_BITS_CHECK_END 0
+#endif
+
 /* buf and buf_end must be present and used by every alternative writer. */
 typedef struct PutBitContext {
 #ifdef ALT_BITSTREAM_WRITER
     uint8_t *buf, *buf_end;
     int index;
 #else
-    uint32_t bit_buf;
+    BitBuf bit_buf;
     int bit_left;
     uint8_t *buf, *buf_ptr, *buf_end;
 #endif
@@ -73,7 +91,7 @@ static inline void init_put_bits(PutBitContext *s, uint8_t *buffer, int buffer_s
 //    memset(buffer, 0, buffer_size);
 #else
     s->buf_ptr = s->buf;
-    s->bit_left=32;
+    s->bit_left=BUF_BITS;
     s->bit_buf=0;
 #endif
 }
@@ -86,7 +104,7 @@ static inline int put_bits_count(PutBitContext *s)
 #ifdef ALT_BITSTREAM_WRITER
     return s->index;
 #else
-    return (s->buf_ptr - s->buf) * 8 + 32 - s->bit_left;
+    return (s->buf_ptr - s->buf) * 8 + BUF_BITS - s->bit_left;
 #endif
 }
 
@@ -99,20 +117,24 @@ static inline void flush_put_bits(PutBitContext *s)
     align_put_bits(s);
 #else
 #ifndef BITSTREAM_WRITER_LE
-    s->bit_buf<<= s->bit_left;
+    if (s->bit_left < BUF_BITS)
+        s->bit_buf<<= s->bit_left;
 #endif
-    while (s->bit_left < 32) {
-        /* XXX: should test end of buffer */
+    while (s->bit_left < BUF_BITS) {
+        if (PUT_BITS_CHECK_END && s->buf_ptr >= s->buf_end) {
+            av_log(NULL, AV_LOG_ERROR, "put_bits buffer too small\n");
+            break;
+        }
 #ifdef BITSTREAM_WRITER_LE
         *s->buf_ptr++=s->bit_buf;
         s->bit_buf>>=8;
 #else
-        *s->buf_ptr++=s->bit_buf >> 24;
+        *s->buf_ptr++=s->bit_buf >> (BUF_BITS - 8);
         s->bit_buf<<=8;
 #endif
         s->bit_left+=8;
     }
-    s->bit_left=32;
+    s->bit_left=BUF_BITS;
     s->bit_buf=0;
 #endif
 }
@@ -149,7 +171,7 @@ void ff_copy_bits(PutBitContext *pb, const uint8_t *src, int length);
 static inline void put_bits(PutBitContext *s, int n, unsigned int value)
 #ifndef ALT_BITSTREAM_WRITER
 {
-    unsigned int bit_buf;
+    BitBuf bit_buf;
     int bit_left;
 
     //    printf("put_bits=%d %x\n", n, value);
@@ -161,17 +183,24 @@ static inline void put_bits(PutBitContext *s, int n, unsigned int value)
     //    printf("n=%d value=%x cnt=%d buf=%x\n", n, value, bit_cnt, bit_buf);
     /* XXX: optimize */
 #ifdef BITSTREAM_WRITER_LE
-    bit_buf |= value << (32 - bit_left);
+    bit_buf |= (BitBuf)value << (BUF_BITS - bit_left);
     if (n >= bit_left) {
+        if (!PUT_BITS_CHECK_END || s->buf_end - s->buf_ptr >= (int)sizeof(BitBuf)) {
+#if BUF_BITS == 64
+            AV_WL64(s->buf_ptr, bit_buf);
+#else
 #if !HAVE_FAST_UNALIGNED
-        if (3 & (intptr_t) s->buf_ptr) {
-            AV_WL32(s->buf_ptr, bit_buf);
-        } else
+            if (3 & (intptr_t) s->buf_ptr) {
+                AV_WL32(s->buf_ptr, bit_buf);
+            } else
 #endif
-        *(uint32_t *)s->buf_ptr = av_le2ne32(bit_buf);
-        s->buf_ptr+=4;
-        bit_buf = (bit_left==32)?0:value >> bit_left;
-        bit_left+=32;
+            *(uint32_t *)s->buf_ptr = av_le2ne32(bit_buf);
+#endif
+            s->buf_ptr+=sizeof(BitBuf);
+        } else
+            av_log(NULL, AV_LOG_ERROR, "put_bits buffer too small\n");
+        bit_buf = (bit_left==BUF_BITS)?0:value >> bit_left;
+        bit_left+=BUF_BITS;
     }
     bit_left-=n;
 #else
@@ -181,15 +210,22 @@ static inline void put_bits(PutBitContext *s, int n, unsigned int value)
     } else {
         bit_buf<<=bit_left;
         bit_buf |= value >> (n - bit_left);
+        if (!PUT_BITS_CHECK_END || s->buf_end - s->buf_ptr >= (int)sizeof(BitBuf)) {
+#if BUF_BITS == 64
+            AV_WB64(s->buf_ptr, bit_buf);
+#else
 #if !HAVE_FAST_UNALIGNED
-        if (3 & (intptr_t) s->buf_ptr) {
-            AV_WB32(s->buf_ptr, bit_buf);
-        } else
+            if (3 & (intptr_t) s->buf_ptr) {
+                AV_WB32(s->buf_ptr, bit_buf);
+            } else
 #endif
-        *(uint32_t *)s->buf_ptr = av_be2ne32(bit_buf);
-        //printf("bitbuf = %08x\n", bit_buf);
-        s->buf_ptr+=4;
-        bit_left+=32 - n;
+            *(uint32_t *)s->buf_ptr = av_be2ne32(bit_buf);
+#endif
+            //printf("bitbuf = %08x\n", bit_buf);
+            s->buf_ptr+=sizeof(BitBuf);
+        } else
+            av_log(NULL, AV_LOG_ERROR, "put_bits buffer too small\n");
+        bit_left+=BUF_BITS - n;
         bit_buf = value;
     }
 #endif
@@ -309,7 +345,7 @@ static inline void skip_put_bytes(PutBitContext *s, int n)
         FIXME may need some cleaning of the buffer
         s->index += n<<3;
 #else
-        assert(s->bit_left==32);
+        assert(s->bit_left==BUF_BITS);
         s->buf_ptr += n;
 #endif
 }
@@ -325,9 +361,14 @@ static inline void skip_put_bits(PutBitContext *s, int n)
     s->index += n;
 #else
     s->bit_left -= n;
+#if BUF_BITS == 64
+    s->buf_ptr-= 8*(s->bit_left>>6);
+    s->bit_left &= 63;
+#else
     s->buf_ptr-= 4*(s->bit_left>>5);
     s->bit_left &= 31;
 #endif
+#endif
 }
 
 /**
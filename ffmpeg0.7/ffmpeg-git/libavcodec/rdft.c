@@ -20,9 +20,14 @@
  */
 #include <stdlib.h>
 #include <math.h>
+#include "libavutil/cpu.h"
 #include "libavutil/mathematics.h"
 #include "rdft.h"
 
+#if ARCH_X86
+#include "x86/rdft.h"
+#endif
+
 /**
  * @file
  * (Inverse) Real Discrete Fourier Transforms.
@@ -54,7 +59,7 @@ static SINTABLE_CONST FFTSample * const ff_sin_tabs[] = {
  * the two real FFTs into one complex FFT. Unmangle the results.
  * ref: http://www.engineeringproductivitytools.com/stuff/T0001/PT10.HTM
  */
-static void ff_rdft_calc_c(RDFTContext* s, FFTSample* data)
+static av_always_inline void rdft_calc(RDFTContext* s, FFTSample* data, int simd)
 {
     int i, i1, i2;
     FFTComplex ev, od;
@@ -73,7 +78,12 @@ static void ff_rdft_calc_c(RDFTContext* s, FFTSample* data)
     ev.re = data[0];
     data[0] = ev.re+data[1];
     data[1] = ev.re-data[1];
-    for (i = 1; i < (n>>2); i++) {
+    i = 1;
+#ifdef rdft_butterflies_simd
+    if (simd)
+        i = rdft_butterflies_simd(s, data);
+#endif
+    for (; i < (n>>2); i++) {
         i1 = 2*i;
         i2 = n-i1;
         /* Separate even and odd FFTs */
@@ -96,6 +106,18 @@ static void ff_rdft_calc_c(RDFTContext* s, FFTSample* data)
     }
 }
 
+static void ff_rdft_calc_c(RDFTContext* s, FFTSample* data)
+{
+    rdft_calc(s, data, 0);
+}
+
+#ifdef rdft_butterflies_simd
+static void rdft_calc_simd(RDFTContext* s, FFTSample* data)
+{
+    rdft_calc(s, data, 1);
+}
+#endif
+
 av_cold int ff_rdft_init(RDFTContext *s, int nbits, enum RDFTransformType trans)
 {
     int n = 1 << nbits;
@@ -121,6 +143,10 @@ av_cold int ff_rdft_init(RDFTContext *s, int nbits, enum RDFTransformType trans)
     }
 #endif
     s->rdft_calc   = ff_rdft_calc_c;
+#ifdef rdft_butterflies_simd
+    if (av_get_cpu_flags() & rdft_butterflies_simd_flags)
+        s->rdft_calc = rdft_calc_simd;
+#endif
 
     //if (ARCH_ARM) ff_rdft_init_arm(s);
 
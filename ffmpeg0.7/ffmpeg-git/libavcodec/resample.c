@@ -26,6 +26,7 @@
 
 #include "avcodec.h"
 #include "audioconvert.h"
+#include "internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
 
@@ -41,8 +42,8 @@ static const AVClass audioresample_context_class = { "ReSampleContext", context_
 
 struct ReSampleContext {
     struct AVResampleContext *resample_context;
-    short *temp[2];
-    int temp_len;
+    short *temp;                     ///< unconsumed input, interleaved if stereo
+    int temp_len;                    ///< length of temp per channel
     float ratio;
     /* channel convert */
     int input_channels, output_channels, filter_channels;
@@ -104,35 +105,14 @@ static void mono_to_stereo(short *output, short *input, int n1)
     }
 }
 
-/* XXX: should use more abstract 'N' channels system */
-static void stereo_split(short *output1, short *output2, short *input, int n)
-{
-    int i;
-
-    for(i=0;i<n;i++) {
-        *output1++ = *input++;
-        *output2++ = *input++;
-    }
-}
-
-static void stereo_mux(short *output, short *input1, short *input2, int n)
-{
-    int i;
-
-    for(i=0;i<n;i++) {
-        *output++ = *input1++;
-        *output++ = *input2++;
-    }
-}
-
-static void ac3_5p1_mux(short *output, short *input1, short *input2, int n)
+static void ac3_5p1_mux(short *output, short *input, int n)
 {
     int i;
     short l,r;
 
     for(i=0;i<n;i++) {
-      l=*input1++;
-      r=*input2++;
+      l=*input++;
+      r=*input++;
       *output++ = l;           /* left */
       *output++ = (l/2)+(r/2); /* center */
       *output++ = r;           /* right */
@@ -180,7 +160,8 @@ ReSampleContext *av_audio_resample_init(int output_channels, int input_channels,
 
     if (s->sample_fmt[0] != AV_SAMPLE_FMT_S16) {
         if (!(s->convert_ctx[0] = av_audio_convert_alloc(AV_SAMPLE_FMT_S16, 1,
-                                                         s->sample_fmt[0], 1, NULL, 0))) {
+                                                         s->sample_fmt[0], 1, NULL,
+                                                         av_get_cpu_flags()))) {
             av_log(s, AV_LOG_ERROR,
                    "Cannot convert %s sample format to s16 sample format\n",
                    av_get_sample_fmt_name(s->sample_fmt[0]));
@@ -191,7 +172,8 @@ ReSampleContext *av_audio_resample_init(int output_channels, int input_channels,
 
     if (s->sample_fmt[1] != AV_SAMPLE_FMT_S16) {
         if (!(s->convert_ctx[1] = av_audio_convert_alloc(s->sample_fmt[1], 1,
-                                                         AV_SAMPLE_FMT_S16, 1, NULL, 0))) {
+                                                         AV_SAMPLE_FMT_S16, 1, NULL,
+                                                         av_get_cpu_flags()))) {
             av_log(s, AV_LOG_ERROR,
                    "Cannot convert s16 sample format to %s sample format\n",
                    av_get_sample_fmt_name(s->sample_fmt[1]));
@@ -233,10 +215,9 @@ ReSampleContext *audio_resample_init(int output_channels, int input_channels,
 /* XXX: optimize it ! */
 int audio_resample(ReSampleContext *s, short *output, short *input, int nb_samples)
 {
-    int i, nb_samples1;
-    short *bufin[2];
-    short *bufout[2];
-    short *buftmp2[2], *buftmp3[2];
+    int nb_samples1, consumed;
+    short *bufin, *bufout;
+    short *buftmp2, *buftmp3;
     short *output_bak = NULL;
     int lenout;
 
@@ -292,53 +273,46 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         output = s->buffer[1];
     }
 
+    /* Stereo is resampled interleaved, so the input only needs to be
+       appended to the unconsumed samples and the output needs no muxing
+       for 2 channels. */
     /* XXX: move those malloc to resample init code */
-    for(i=0; i<s->filter_channels; i++){
-        bufin[i]= av_malloc( (nb_samples + s->temp_len) * sizeof(short) );
-        memcpy(bufin[i], s->temp[i], s->temp_len * sizeof(short));
-        buftmp2[i] = bufin[i] + s->temp_len;
-    }
+    bufin= av_malloc( (nb_samples + s->temp_len) * s->filter_channels * sizeof(short) );
+    memcpy(bufin, s->temp, s->temp_len * s->filter_channels * sizeof(short));
+    buftmp2 = bufin + s->temp_len * s->filter_channels;
 
     /* make some zoom to avoid round pb */
-    bufout[0]= av_malloc( lenout * sizeof(short) );
-    bufout[1]= av_malloc( lenout * sizeof(short) );
+    bufout= av_malloc( lenout * sizeof(short) );
 
     if (s->input_channels == 2 &&
         s->output_channels == 1) {
-        buftmp3[0] = output;
-        stereo_to_mono(buftmp2[0], input, nb_samples);
+        buftmp3 = output;
+        stereo_to_mono(buftmp2, input, nb_samples);
     } else if (s->output_channels >= 2 && s->input_channels == 1) {
-        buftmp3[0] = bufout[0];
-        memcpy(buftmp2[0], input, nb_samples*sizeof(short));
-    } else if (s->output_channels >= 2) {
-        buftmp3[0] = bufout[0];
-        buftmp3[1] = bufout[1];
-        stereo_split(buftmp2[0], buftmp2[1], input, nb_samples);
+        buftmp3 = bufout;
+        memcpy(buftmp2, input, nb_samples*sizeof(short));
+    } else if (s->output_channels > 2) {
+        buftmp3 = bufout;
+        memcpy(buftmp2, input, nb_samples*2*sizeof(short));
     } else {
-        buftmp3[0] = output;
-        memcpy(buftmp2[0], input, nb_samples*sizeof(short));
+        buftmp3 = output;
+        memcpy(buftmp2, input, nb_samples*s->filter_channels*sizeof(short));
     }
 
     nb_samples += s->temp_len;
 
-    /* resample each channel */
-    nb_samples1 = 0; /* avoid warning */
-    for(i=0;i<s->filter_channels;i++) {
-        int consumed;
-        int is_last= i+1 == s->filter_channels;
-
-        nb_samples1 = av_resample(s->resample_context, buftmp3[i], bufin[i], &consumed, nb_samples, lenout, is_last);
-        s->temp_len= nb_samples - consumed;
-        s->temp[i]= av_realloc(s->temp[i], s->temp_len*sizeof(short));
-        memcpy(s->temp[i], bufin[i] + consumed, s->temp_len*sizeof(short));
-    }
+    if (s->filter_channels == 2)
+        nb_samples1 = ff_resample_stereo(s->resample_context, buftmp3, bufin, &consumed, nb_samples, lenout / 2, 1);
+    else
+        nb_samples1 = av_resample(s->resample_context, buftmp3, bufin, &consumed, nb_samples, lenout, 1);
+    s->temp_len= nb_samples - consumed;
+    s->temp= av_realloc(s->temp, s->temp_len*s->filter_channels*sizeof(short));
+    memcpy(s->temp, bufin + consumed*s->filter_channels, s->temp_len*s->filter_channels*sizeof(short));
 
     if (s->output_channels == 2 && s->input_channels == 1) {
-        mono_to_stereo(output, buftmp3[0], nb_samples1);
-    } else if (s->output_channels == 2) {
-        stereo_mux(output, buftmp3[0], buftmp3[1], nb_samples1);
+        mono_to_stereo(output, buftmp3, nb_samples1);
     } else if (s->output_channels == 6) {
-        ac3_5p1_mux(output, buftmp3[0], buftmp3[1], nb_samples1);
+        ac3_5p1_mux(output, buftmp3, nb_samples1);
     }
 
     if (s->sample_fmt[1] != AV_SAMPLE_FMT_S16) {
@@ -354,19 +328,15 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         }
     }
 
-    for(i=0; i<s->filter_channels; i++)
-        av_free(bufin[i]);
-
-    av_free(bufout[0]);
-    av_free(bufout[1]);
+    av_free(bufin);
+    av_free(bufout);
     return nb_samples1;
 }
 
 void audio_resample_close(ReSampleContext *s)
 {
     av_resample_close(s->resample_context);
-    av_freep(&s->temp[0]);
-    av_freep(&s->temp[1]);
+    av_freep(&s->temp);
     av_freep(&s->buffer[0]);
     av_freep(&s->buffer[1]);
     av_audio_convert_free(s->convert_ctx[0]);
@@ -27,6 +27,7 @@
 
 #include "avcodec.h"
 #include "dsputil.h"
+#include "internal.h"
 
 #ifndef CONFIG_RESAMPLE_HP
 #define FILTER_SHIFT 15
@@ -55,6 +56,7 @@
 #define WINDOW_TYPE 24
 #endif
 
+#include "resample2.h"
 
 typedef struct AVResampleContext{
     const AVClass *av_class;
@@ -69,6 +71,19 @@ typedef struct AVResampleContext{
     int phase_shift;
     int phase_mask;
     int linear;
+
+    /* Without compensation the phases repeat with a fixed period. The filters
+     * of one period are kept in the order they are used, padded to a multiple
+     * of 8 taps, so the loop needs no phase arithmetic. */
+    FELEM *fixed_bank;
+    int *fixed_step;          ///< input samples to advance after each filter
+    int *fixed_phase;         ///< phase of each filter
+    int *fixed_frac;          ///< frac before each filter
+    int fixed_length;         ///< number of filters in a period, 0 if none
+    int fixed_taps;           ///< padded filter length
+    int fixed_pos;            ///< position of the current phase
+
+    ResampleDSPContext dsp;   ///< only used with 16 bit taps
 }AVResampleContext;
 
 /**
@@ -186,6 +201,116 @@ static int build_filter(FELEM *filter, double factor, int tap_count, int phase_c
     return 0;
 }
 
+/**
+ * Fill the fixed ratio tables starting with the given phase and frac.
+ */
+static void build_fixed_ratio(AVResampleContext *c, int phase, int frac)
+{
+    int dst_incr_frac= c->ideal_dst_incr % c->src_incr;
+    int dst_incr=      c->ideal_dst_incr / c->src_incr;
+    int p;
+
+    for (p = 0; p < c->fixed_length; p++) {
+        FELEM *filter = c->fixed_bank + p * c->fixed_taps;
+        int index = phase + dst_incr;
+
+        memcpy(filter, c->filter_bank + c->filter_length * phase,
+               c->filter_length * sizeof(FELEM));
+        memset(filter + c->filter_length, 0,
+               (c->fixed_taps - c->filter_length) * sizeof(FELEM));
+        c->fixed_phase[p] = phase;
+        c->fixed_frac[p]  = frac;
+
+        frac += dst_incr_frac;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+        c->fixed_step[p] = index >> c->phase_shift;
+        phase = index & c->phase_mask;
+    }
+    c->fixed_pos = 0;
+}
+
+/**
+ * Set up the fixed ratio tables if the period is not longer than the
+ * filter bank. The period is the same whatever phase it starts at.
+ */
+static void init_fixed_ratio(AVResampleContext *c)
+{
+    int dst_incr_frac= c->ideal_dst_incr % c->src_incr;
+    int dst_incr=      c->ideal_dst_incr / c->src_incr;
+    int phase = 0, frac = 0, len = 0;
+
+    do {
+        int index = phase + dst_incr;
+        frac += dst_incr_frac;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+        phase = index & c->phase_mask;
+        if (++len > c->phase_mask + 1)
+            return;
+    } while (phase || frac);
+
+    c->fixed_taps  = FFALIGN(c->filter_length, 8);
+    c->fixed_bank  = av_malloc(len * c->fixed_taps * sizeof(FELEM));
+    c->fixed_step  = av_malloc(len * sizeof(int));
+    c->fixed_phase = av_malloc(len * sizeof(int));
+    c->fixed_frac  = av_malloc(len * sizeof(int));
+    if (!c->fixed_bank || !c->fixed_step || !c->fixed_phase || !c->fixed_frac) {
+        av_freep(&c->fixed_bank);
+        av_freep(&c->fixed_step);
+        av_freep(&c->fixed_phase);
+        av_freep(&c->fixed_frac);
+        return;
+    }
+    c->fixed_length = len;
+    build_fixed_ratio(c, 0, 0);
+}
+
+/**
+ * Return the position of the given phase and frac in the fixed ratio
+ * tables, rebuilding them if it is not part of their period.
+ */
+static int find_fixed_pos(AVResampleContext *c, int phase, int frac)
+{
+    int p = c->fixed_pos;
+
+    if (c->fixed_phase[p] == phase && c->fixed_frac[p] == frac)
+        return p;
+    for (p = 0; p < c->fixed_length; p++)
+        if (c->fixed_phase[p] == phase && c->fixed_frac[p] == frac)
+            return p;
+    build_fixed_ratio(c, phase, frac);
+    return 0;
+}
+
+#ifndef CONFIG_RESAMPLE_HP
+static int resample_filter_c(const short *src, const int16_t *filter, int len)
+{
+    int i, val = 0;
+
+    for (i = 0; i < len; i++)
+        val += src[i] * filter[i];
+    return val;
+}
+
+static void resample_filter2_c(int *val, const short *src,
+                               const int16_t *filter, int len)
+{
+    int i, v0 = 0, v1 = 0;
+
+    for (i = 0; i < len; i++) {
+        v0 += src[2 * i    ] * filter[i];
+        v1 += src[2 * i + 1] * filter[i];
+    }
+    val[0] = v0;
+    val[1] = v1;
+}
+#endif
+
 AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter_size, int phase_shift, int linear, double cutoff){
     AVResampleContext *c= av_mallocz(sizeof(AVResampleContext));
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
@@ -211,6 +336,17 @@ AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter_size,
     c->ideal_dst_incr= c->dst_incr= in_rate * phase_count;
     c->index= -phase_count*((c->filter_length-1)/2);
 
+#ifndef CONFIG_RESAMPLE_HP
+    c->dsp.filter = resample_filter_c;
+    c->dsp.filter2= resample_filter2_c;
+#if HAVE_MMX
+    ff_resample_dsp_init_x86(&c->dsp);
+#endif
+#endif
+
+    if (!linear)
+        init_fixed_ratio(c);
+
     return c;
 error:
     av_free(c->filter_bank);
@@ -220,6 +356,10 @@ error:
 
 void av_resample_close(AVResampleContext *c){
     av_freep(&c->filter_bank);
+    av_freep(&c->fixed_bank);
+    av_freep(&c->fixed_step);
+    av_freep(&c->fixed_phase);
+    av_freep(&c->fixed_frac);
     av_freep(&c);
 }
 
@@ -229,13 +369,58 @@ void av_resample_compensate(AVResampleContext *c, int sample_delta, int compensa
     c->dst_incr = c->ideal_dst_incr - c->ideal_dst_incr * (int64_t)sample_delta / compensation_distance;
 }
 
-int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int src_size, int dst_size, int update_ctx){
-    int dst_index, i;
+/**
+ * Filter len frames of interleaved samples with one filter.
+ */
+static av_always_inline void filter_samples(AVResampleContext *c, FELEM2 *val,
+                                            const short *src, const FELEM *filter,
+                                            int len, int channels)
+{
+    int i, ch;
+
+#ifndef CONFIG_RESAMPLE_HP
+    if (channels == 1) {
+        val[0] = c->dsp.filter(src, filter, len);
+        return;
+    }
+    if (channels == 2) {
+        c->dsp.filter2(val, src, filter, len);
+        return;
+    }
+#endif
+    for (ch = 0; ch < channels; ch++) {
+        FELEM2 v = 0;
+        for (i = 0; i < len; i++)
+            v += src[channels * i + ch] * (FELEM2)filter[i];
+        val[ch] = v;
+    }
+}
+
+static av_always_inline void store_sample(short *dst, FELEM2 val)
+{
+#ifdef CONFIG_RESAMPLE_AUDIOPHILE_KIDDY_MODE
+    *dst = av_clip_int16(lrintf(val));
+#else
+    val = (val + (1<<(FILTER_SHIFT-1)))>>FILTER_SHIFT;
+    *dst = (unsigned)(val + 32768) > 65535 ? (val>>31) ^ 32767 : val;
+#endif
+}
+
+/**
+ * Resample 1 or 2 interleaved channels, see av_resample().
+ * src_size and dst_size are in frames.
+ */
+static av_always_inline int resample(AVResampleContext *c, short *dst, const short *src,
+                                     int *consumed, int src_size, int dst_size,
+                                     int update_ctx, int channels)
+{
+    int dst_index, i, ch;
     int index= c->index;
     int frac= c->frac;
     int dst_incr_frac= c->dst_incr % c->src_incr;
     int dst_incr=      c->dst_incr / c->src_incr;
     int compensation_distance= c->compensation_distance;
+    FELEM2 val[2];
 
   if(compensation_distance == 0 && c->filter_length == 1 && c->phase_shift==0){
         int64_t index2= ((int64_t)index)<<32;
@@ -243,43 +428,63 @@ int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int
         dst_size= FFMIN(dst_size, (src_size-1-index) * (int64_t)c->src_incr / c->dst_incr);
 
         for(dst_index=0; dst_index < dst_size; dst_index++){
-            dst[dst_index] = src[index2>>32];
+            for (ch = 0; ch < channels; ch++)
+                dst[channels*dst_index + ch] = src[channels*(index2>>32) + ch];
             index2 += incr;
         }
         frac += dst_index * dst_incr_frac;
         index += dst_index * dst_incr;
         index += frac / c->src_incr;
         frac %= c->src_incr;
+  }else if(compensation_distance == 0 && c->fixed_length && index >= 0 &&
+           c->dst_incr == c->ideal_dst_incr){
+        int sample_index= index >> c->phase_shift;
+        int pos= find_fixed_pos(c, index & c->phase_mask, frac);
+
+        for(dst_index=0; dst_index < dst_size; dst_index++){
+            const FELEM *filter= c->fixed_bank + c->fixed_taps*pos;
+
+            if(sample_index + c->filter_length > src_size)
+                break;
+            /* the padding taps are 0, use them if the samples exist */
+            filter_samples(c, val, src + channels*sample_index, filter,
+                           sample_index + c->fixed_taps <= src_size ?
+                           c->fixed_taps : c->filter_length, channels);
+            for (ch = 0; ch < channels; ch++)
+                store_sample(&dst[channels*dst_index + ch], val[ch]);
+
+            sample_index += c->fixed_step[pos];
+            if (++pos == c->fixed_length)
+                pos = 0;
+        }
+        index= (sample_index << c->phase_shift) + c->fixed_phase[pos];
+        frac = c->fixed_frac[pos];
+        c->fixed_pos= pos;
   }else{
     for(dst_index=0; dst_index < dst_size; dst_index++){
         FELEM *filter= c->filter_bank + c->filter_length*(index & c->phase_mask);
         int sample_index= index >> c->phase_shift;
-        FELEM2 val=0;
 
         if(sample_index < 0){
-            for(i=0; i<c->filter_length; i++)
-                val += src[FFABS(sample_index + i) % src_size] * filter[i];
+            for (ch = 0; ch < channels; ch++) {
+                val[ch] = 0;
+                for(i=0; i<c->filter_length; i++)
+                    val[ch] += src[channels*(FFABS(sample_index + i) % src_size) + ch] * filter[i];
+            }
         }else if(sample_index + c->filter_length > src_size){
             break;
         }else if(c->linear){
-            FELEM2 v2=0;
-            for(i=0; i<c->filter_length; i++){
-                val += src[sample_index + i] * (FELEM2)filter[i];
-                v2  += src[sample_index + i] * (FELEM2)filter[i + c->filter_length];
-            }
-            val+=(v2-val)*(FELEML)frac / c->src_incr;
+            FELEM2 v2[2];
+            filter_samples(c, val, src + channels*sample_index, filter, c->filter_length, channels);
+            filter_samples(c, v2, src + channels*sample_index, filter + c->filter_length, c->filter_length, channels);
+            for (ch = 0; ch < channels; ch++)
+                val[ch] += (v2[ch]-val[ch])*(FELEML)frac / c->src_incr;
         }else{
-            for(i=0; i<c->filter_length; i++){
-                val += src[sample_index + i] * (FELEM2)filter[i];
-            }
+            filter_samples(c, val, src + channels*sample_index, filter, c->filter_length, channels);
         }
 
-#ifdef CONFIG_RESAMPLE_AUDIOPHILE_KIDDY_MODE
-        dst[dst_index] = av_clip_int16(lrintf(val));
-#else
-        val = (val + (1<<(FILTER_SHIFT-1)))>>FILTER_SHIFT;
-        dst[dst_index] = (unsigned)(val + 32768) > 65535 ? (val>>31) ^ 32767 : val;
-#endif
+        for (ch = 0; ch < channels; ch++)
+            store_sample(&dst[channels*dst_index + ch], val[ch]);
 
         frac += dst_incr_frac;
         index += dst_incr;
@@ -318,3 +523,98 @@ av_log(NULL, AV_LOG_DEBUG, "%d %d %d\n", c->dst_incr, c->ideal_dst_incr, c->comp
 
     return dst_index;
 }
+
+int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int src_size, int dst_size, int update_ctx){
+    return resample(c, dst, src, consumed, src_size, dst_size, update_ctx, 1);
+}
+
+int ff_resample_stereo(AVResampleContext *c, short *dst, const short *src, int *consumed, int src_size, int dst_size, int update_ctx){
+    return resample(c, dst, src, consumed, src_size, dst_size, update_ctx, 2);
+}
+
+#ifdef TEST
+#include "libavutil/lfg.h"
+
+#define SAMPLES 8192
+
+/**
+ * Resample a random stereo signal in random chunks, interleaved with the
+ * fixed ratio tables and per channel without them, which must give the
+ * same output. Only errors are printed.
+ */
+static int test_ratio(AVLFG *prng, int out_rate, int in_rate, int linear, int compensate)
+{
+    static short in[2 * SAMPLES], planar[2][SAMPLES];
+    static short out[2 * 2 * SAMPLES], ref[2][2 * SAMPLES];
+    AVResampleContext *c, *r[2];
+    int pos[3] = { 0 }, n_out[3] = { 0 };
+    int i, ch, size, consumed, end = 0;
+
+    for (i = 0; i < SAMPLES; i++) {
+        in[2 * i]     = planar[0][i] = av_lfg_get(prng);
+        in[2 * i + 1] = planar[1][i] = av_lfg_get(prng) >> 20;
+    }
+
+    c = av_resample_init(out_rate, in_rate, 16, 10, linear, 0.8);
+    for (ch = 0; ch < 2; ch++) {
+        r[ch] = av_resample_init(out_rate, in_rate, 16, 10, linear, 0.8);
+        r[ch]->fixed_length = 0;
+    }
+
+    while (end < SAMPLES) {
+        end += 1 + av_lfg_get(prng) % 700;
+        end  = FFMIN(end, SAMPLES);
+        if (compensate && end > SAMPLES / 2 && compensate--) {
+            av_resample_compensate(c, 30, 500);
+            av_resample_compensate(r[0], 30, 500);
+            av_resample_compensate(r[1], 30, 500);
+        }
+        size = ff_resample_stereo(c, out + 2 * n_out[2], in + 2 * pos[2], &consumed,
+                                  end - pos[2], 2 * SAMPLES - n_out[2], 1);
+        n_out[2] += size;
+        pos[2]   += consumed;
+        for (ch = 0; ch < 2; ch++) {
+            size = av_resample(r[ch], ref[ch] + n_out[ch], planar[ch] + pos[ch], &consumed,
+                               end - pos[ch], 2 * SAMPLES - n_out[ch], 1);
+            n_out[ch] += size;
+            pos[ch]   += consumed;
+        }
+    }
+
+    av_resample_close(c);
+    av_resample_close(r[0]);
+    av_resample_close(r[1]);
+
+    if (n_out[0] != n_out[2] || n_out[1] != n_out[2]) {
+        av_log(NULL, AV_LOG_ERROR, "%d -> %d: %d samples instead of %d\n",
+               in_rate, out_rate, n_out[2], n_out[0]);
+        return 1;
+    }
+    for (i = 0; i < n_out[2]; i++) {
+        if (out[2 * i] != ref[0][i] || out[2 * i + 1] != ref[1][i]) {
+            av_log(NULL, AV_LOG_ERROR, "%d -> %d%s: sample %d differs\n",
+                   in_rate, out_rate, linear ? " linear" : "", i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static const int rates[][2] = {
+        { 48000, 44100 }, { 44100, 48000 }, { 44100, 22050 }, { 48000, 8000 },
+        { 8000, 44100 }, { 32000, 48000 }, { 44100, 44100 }, { 44100, 47999 },
+    };
+    AVLFG prng;
+    int i, errors = 0;
+
+    av_lfg_init(&prng, 1);
+    for (i = 0; i < FF_ARRAY_ELEMS(rates); i++) {
+        errors += test_ratio(&prng, rates[i][0], rates[i][1], 0, 0);
+        errors += test_ratio(&prng, rates[i][0], rates[i][1], 0, 1);
+        errors += test_ratio(&prng, rates[i][0], rates[i][1], 1, 0);
+    }
+    return !!errors;
+}
+#endif /* TEST */
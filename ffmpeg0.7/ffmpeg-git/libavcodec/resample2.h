@@ -0,0 +1,43 @@
+/*
+ * audio resampling DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_RESAMPLE2_H
+#define AVCODEC_RESAMPLE2_H
+
+#include <stdint.h>
+
+/**
+ * Filters for 16 bit taps. The sums are computed modulo 2^32, so all
+ * versions give the same results.
+ */
+typedef struct ResampleDSPContext {
+    /**
+     * Dot product of len 16 bit samples and filter taps.
+     */
+    int (*filter)(const short *src, const int16_t *filter, int len);
+    /**
+     * Dot products of len interleaved stereo samples with the same filter.
+     */
+    void (*filter2)(int *val, const short *src, const int16_t *filter, int len);
+} ResampleDSPContext;
+
+void ff_resample_dsp_init_x86(ResampleDSPContext *c);
+
+#endif /* AVCODEC_RESAMPLE2_H */
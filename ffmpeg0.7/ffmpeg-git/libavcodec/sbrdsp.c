@@ -0,0 +1,300 @@
+/*
+ * AAC Spectral Band Replication DSP functions
+ * Copyright (c) 2008-2009 Robert Swain ( rob opendot cl )
+ * Copyright (c) 2009-2010 Alex Converse <alex.converse@gmail.com>
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "sbrdsp.h"
+
+static void sbr_sum64x5_c(float *z)
+{
+    int k;
+    for (k = 0; k < 64; k++) {
+        float f = z[k] + z[k + 64] + z[k + 128] + z[k + 192] + z[k + 256];
+        z[k] = f;
+    }
+}
+
+static void sbr_qmf_pre_shuffle_c(float *z)
+{
+    int k;
+    z[64] = z[0];
+    for (k = 1; k < 32; k++) {
+        z[64+2*k-1] =  z[   k];
+        z[64+2*k  ] = -z[64-k];
+    }
+    z[64+63] = z[32];
+}
+
+static void sbr_qmf_post_shuffle_c(float W[32][2], const float *z)
+{
+    int k;
+    for (k = 0; k < 32; k++) {
+        W[k][0] = -z[63-k];
+        W[k][1] = z[k];
+    }
+}
+
+static void sbr_neg_odd_64_c(float *x)
+{
+    int i;
+    for (i = 1; i < 64; i += 2)
+        x[i] = -x[i];
+}
+
+static void sbr_qmf_deint_neg_c(float *v, const float *src)
+{
+    int i;
+    for (i = 0; i < 32; i++) {
+        v[     i] =  src[63 - 2*i];
+        v[63 - i] = -src[62 - 2*i];
+    }
+}
+
+static void sbr_qmf_deint_bfly_c(float *v, const float *src0, const float *src1)
+{
+    int i;
+    for (i = 0; i < 64; i++) {
+        v[      i] = src0[i] - src1[63 - i];
+        v[127 - i] = src0[i] + src1[63 - i];
+    }
+}
+
+static av_always_inline void autocorrelate(const float x[40][2],
+                                           float phi[3][2][2], int lag)
+{
+    int i;
+    float real_sum = 0.0f;
+    float imag_sum = 0.0f;
+    if (lag) {
+        for (i = 1; i < 38; i++) {
+            real_sum += x[i][0] * x[i+lag][0] + x[i][1] * x[i+lag][1];
+            imag_sum += x[i][0] * x[i+lag][1] - x[i][1] * x[i+lag][0];
+        }
+        phi[2-lag][1][0] = real_sum + x[ 0][0] * x[lag][0] + x[ 0][1] * x[lag][1];
+        phi[2-lag][1][1] = imag_sum + x[ 0][0] * x[lag][1] - x[ 0][1] * x[lag][0];
+        if (lag == 1) {
+            phi[0][0][0] = real_sum + x[38][0] * x[39][0] + x[38][1] * x[39][1];
+            phi[0][0][1] = imag_sum + x[38][0] * x[39][1] - x[38][1] * x[39][0];
+        }
+    } else {
+        for (i = 1; i < 38; i++) {
+            real_sum += x[i][0] * x[i][0] + x[i][1] * x[i][1];
+        }
+        phi[2][1][0] = real_sum + x[ 0][0] * x[ 0][0] + x[ 0][1] * x[ 0][1];
+        phi[1][0][0] = real_sum + x[38][0] * x[38][0] + x[38][1] * x[38][1];
+    }
+}
+
+static void sbr_autocorrelate_c(const float x[40][2], float phi[3][2][2])
+{
+    autocorrelate(x, phi, 0);
+    autocorrelate(x, phi, 1);
+    autocorrelate(x, phi, 2);
+}
+
+static void sbr_hf_gen_c(float (*X_high)[2], const float (*X_low)[2],
+                         const float alpha[4], int start, int end)
+{
+    int i;
+    for (i = start; i < end; i++) {
+        X_high[i][0] =
+            X_low[i - 2][0] * alpha[0] -
+            X_low[i - 2][1] * alpha[1] +
+            X_low[i - 1][0] * alpha[2] -
+            X_low[i - 1][1] * alpha[3] +
+            X_low[i][0];
+        X_high[i][1] =
+            X_low[i - 2][1] * alpha[0] +
+            X_low[i - 2][0] * alpha[1] +
+            X_low[i - 1][1] * alpha[2] +
+            X_low[i - 1][0] * alpha[3] +
+            X_low[i][1];
+    }
+}
+
+static void sbr_hf_g_filt_c(float (*Y)[2], const float (*X_high)[40][2],
+                            const float *g_filt, int m_max, int ixh)
+{
+    int m;
+    for (m = 0; m < m_max; m++) {
+        Y[m][0] = X_high[m][ixh][0] * g_filt[m];
+        Y[m][1] = X_high[m][ixh][1] * g_filt[m];
+    }
+}
+
+static void sbr_hf_apply_noise_c(float (*Y)[2], const float *s_m,
+                                 const float *q_filt,
+                                 const float (*noise_table)[2], int noise,
+                                 int phi_re, int phi_im, int m_max)
+{
+    int m;
+    for (m = 0; m < m_max; m++) {
+        noise = (noise + 1) & 0x1ff;
+        if (s_m[m]) {
+            Y[m][0] += s_m[m] * phi_re;
+            Y[m][1] += s_m[m] * phi_im;
+        } else {
+            Y[m][0] += q_filt[m] * noise_table[noise][0];
+            Y[m][1] += q_filt[m] * noise_table[noise][1];
+        }
+        phi_im = -phi_im;
+    }
+}
+
+static av_cold void sbrdsp_init_c(SBRDSPContext *s)
+{
+    s->sum64x5          = sbr_sum64x5_c;
+    s->qmf_pre_shuffle  = sbr_qmf_pre_shuffle_c;
+    s->qmf_post_shuffle = sbr_qmf_post_shuffle_c;
+    s->neg_odd_64       = sbr_neg_odd_64_c;
+    s->qmf_deint_neg    = sbr_qmf_deint_neg_c;
+    s->qmf_deint_bfly   = sbr_qmf_deint_bfly_c;
+    s->autocorrelate    = sbr_autocorrelate_c;
+    s->hf_gen           = sbr_hf_gen_c;
+    s->hf_g_filt        = sbr_hf_g_filt_c;
+    s->hf_apply_noise   = sbr_hf_apply_noise_c;
+}
+
+av_cold void ff_sbrdsp_init(SBRDSPContext *s)
+{
+    sbrdsp_init_c(s);
+#if HAVE_MMX
+    ff_sbrdsp_init_x86(s);
+#endif
+}
+
+#ifdef TEST
+#include <string.h>
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+
+#undef printf
+
+static AVLFG prng;
+
+static void fill(float *buf, int n, int zeros)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        buf[i] = (av_lfg_get(&prng) / (float)UINT32_MAX - 0.5f) * 4000.0f;
+        if (zeros && !(av_lfg_get(&prng) & 3))
+            buf[i] = 0.0f;
+    }
+}
+
+static int check(const char *name, const void *a, const void *b, int size)
+{
+    if (memcmp(a, b, size)) {
+        av_log(NULL, AV_LOG_ERROR, "%s differs from the C version\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Compare the functions of ff_sbrdsp_init() bit by bit with the C
+ * versions on random input. Only errors are printed.
+ */
+int main(void)
+{
+    SBRDSPContext c, s;
+    DECLARE_ALIGNED(16, float, in)[2][64 * 40 * 2];
+    DECLARE_ALIGNED(16, float, ref)[64 * 40 * 2];
+    DECLARE_ALIGNED(16, float, out)[64 * 40 * 2];
+    DECLARE_ALIGNED(16, float, noise_table)[512][2];
+    float alpha[4];
+    int it, start, end, m_max, noise, errors = 0;
+
+    av_lfg_init(&prng, 1);
+    sbrdsp_init_c(&c);
+    ff_sbrdsp_init(&s);
+    fill(noise_table[0], 1024, 0);
+
+    for (it = 0; it < 200 && !errors; it++) {
+        fill(in[0], 64 * 40 * 2, 0);
+        fill(in[1], 64 * 40 * 2, 1);
+
+        memcpy(ref, in[0], 320 * sizeof(float));
+        memcpy(out, in[0], 320 * sizeof(float));
+        c.sum64x5(ref);
+        s.sum64x5(out);
+        errors += check("sum64x5", ref, out, 320 * sizeof(float));
+
+        memcpy(ref, in[0], 128 * sizeof(float));
+        memcpy(out, in[0], 128 * sizeof(float));
+        c.qmf_pre_shuffle(ref);
+        s.qmf_pre_shuffle(out);
+        errors += check("qmf_pre_shuffle", ref, out, 128 * sizeof(float));
+
+        c.qmf_post_shuffle((float (*)[2])ref, in[0]);
+        s.qmf_post_shuffle((float (*)[2])out, in[0]);
+        errors += check("qmf_post_shuffle", ref, out, 64 * sizeof(float));
+
+        memcpy(ref, in[0], 64 * sizeof(float));
+        memcpy(out, in[0], 64 * sizeof(float));
+        c.neg_odd_64(ref);
+        s.neg_odd_64(out);
+        errors += check("neg_odd_64", ref, out, 64 * sizeof(float));
+
+        c.qmf_deint_neg(ref, in[0]);
+        s.qmf_deint_neg(out, in[0]);
+        errors += check("qmf_deint_neg", ref, out, 64 * sizeof(float));
+
+        c.qmf_deint_bfly(ref, in[0], in[1]);
+        s.qmf_deint_bfly(out, in[0], in[1]);
+        errors += check("qmf_deint_bfly", ref, out, 128 * sizeof(float));
+
+        c.autocorrelate((const float (*)[2])in[it & 1], (float (*)[2][2])ref);
+        s.autocorrelate((const float (*)[2])in[it & 1], (float (*)[2][2])out);
+        errors += check("autocorrelate", ref, out, 12 * sizeof(float));
+
+        fill(alpha, 4, 0);
+        start = 2 + 2 * (av_lfg_get(&prng) % 8);
+        end   = start + 2 * (av_lfg_get(&prng) % (20 - start / 2));
+        memset(ref, 0, 80 * sizeof(float));
+        memset(out, 0, 80 * sizeof(float));
+        c.hf_gen((float (*)[2])ref, (const float (*)[2])in[0], alpha, start, end);
+        s.hf_gen((float (*)[2])out, (const float (*)[2])in[0], alpha, start, end);
+        errors += check("hf_gen", ref, out, 80 * sizeof(float));
+
+        m_max = 1 + av_lfg_get(&prng) % 48;
+        c.hf_g_filt((float (*)[2])ref, (const float (*)[40][2])in[0], in[1],
+                    m_max, it % 40);
+        s.hf_g_filt((float (*)[2])out, (const float (*)[40][2])in[0], in[1],
+                    m_max, it % 40);
+        errors += check("hf_g_filt", ref, out, 2 * m_max * sizeof(float));
+
+        noise = av_lfg_get(&prng) & 0x1ff;
+        memcpy(ref, in[0], 2 * m_max * sizeof(float));
+        memcpy(out, in[0], 2 * m_max * sizeof(float));
+        c.hf_apply_noise((float (*)[2])ref, in[1], in[1] + 64,
+                         (const float (*)[2])noise_table, noise,
+                         it % 3 - 1, it / 3 % 3 - 1, m_max);
+        s.hf_apply_noise((float (*)[2])out, in[1], in[1] + 64,
+                         (const float (*)[2])noise_table, noise,
+                         it % 3 - 1, it / 3 % 3 - 1, m_max);
+        errors += check("hf_apply_noise", ref, out, 2 * m_max * sizeof(float));
+    }
+    return !!errors;
+}
+#endif /* TEST */
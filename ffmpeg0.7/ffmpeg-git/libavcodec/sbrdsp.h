@@ -0,0 +1,91 @@
+/*
+ * AAC Spectral Band Replication DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_SBRDSP_H
+#define AVCODEC_SBRDSP_H
+
+#include <stdint.h>
+
+/**
+ * All functions give exactly the same results as the C versions, the
+ * optimized versions only change the order of independent operations.
+ */
+typedef struct SBRDSPContext {
+    /**
+     * Sum the five 64 value blocks of the analysis QMF window output
+     * into the first one.
+     */
+    void (*sum64x5)(float *z);
+    /**
+     * Shuffle the windowed analysis QMF input z[0..63] into z[64..127]
+     * for the IMDCT.
+     */
+    void (*qmf_pre_shuffle)(float *z);
+    /**
+     * Shuffle the analysis QMF IMDCT output into 32 complex subbands.
+     */
+    void (*qmf_post_shuffle)(float W[32][2], const float *z);
+    /**
+     * Negate the odd values of a 64 value block.
+     */
+    void (*neg_odd_64)(float *x);
+    /**
+     * Deinterleave the downsampled synthesis QMF IMDCT output into 64 values.
+     */
+    void (*qmf_deint_neg)(float *v, const float *src);
+    /**
+     * Combine the two synthesis QMF IMDCT outputs into 128 values.
+     */
+    void (*qmf_deint_bfly)(float *v, const float *src0, const float *src1);
+    /**
+     * Autocorrelation of a subband for lags 0, 1 and 2 (14496-3 sp04 p214).
+     */
+    void (*autocorrelate)(const float x[40][2], float phi[3][2][2]);
+    /**
+     * Generate one high band subband from a low band one with the
+     * prediction coefficients alpha1 * bw^2 and alpha0 * bw (14496-3 sp04 p215).
+     * @param start first sample to generate, even
+     * @param end   end of the generated samples, even
+     */
+    void (*hf_gen)(float (*X_high)[2], const float (*X_low)[2],
+                   const float alpha[4], int start, int end);
+    /**
+     * Apply the filtered gains to one time slot of the high band.
+     * @param ixh time slot in X_high
+     */
+    void (*hf_g_filt)(float (*Y)[2], const float (*X_high)[40][2],
+                      const float *g_filt, int m_max, int ixh);
+    /**
+     * Add the sinusoids, or the noise where there are none, to one time
+     * slot of the high band (14496-3 sp04 p220).
+     * @param noise  noise table index before the first subband
+     * @param phi_re real part of the sinusoid phase
+     * @param phi_im imaginary part of the sinusoid phase for the first
+     *               subband, its sign alternates between subbands
+     */
+    void (*hf_apply_noise)(float (*Y)[2], const float *s_m, const float *q_filt,
+                           const float (*noise_table)[2], int noise,
+                           int phi_re, int phi_im, int m_max);
+} SBRDSPContext;
+
+void ff_sbrdsp_init(SBRDSPContext *s);
+void ff_sbrdsp_init_x86(SBRDSPContext *s);
+
+#endif /* AVCODEC_SBRDSP_H */
@@ -0,0 +1,222 @@
+/*
+ * start code search test and benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Checks ff_find_start_code() and H264DSPContext.startcode_find_candidate
+ * against a byte-wise reference and measures their throughput, either on
+ * random data or on the elementary stream files given on the command line.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "avcodec.h"
+#include "h264dsp.h"
+#include "mpegvideo.h"
+
+#undef exit
+#undef printf
+#undef fprintf
+
+#define RANDOM_SIZE (16 << 20)
+#define NB_ROUNDS   5
+
+static AVLFG prng;
+static H264DSPContext h264dsp;
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* byte-wise reference with the same semantics as ff_find_start_code() */
+static const uint8_t *find_start_code_ref(const uint8_t *p, const uint8_t *end,
+                                          uint32_t *state)
+{
+    while (p < end) {
+        *state = (*state << 8) | *p++;
+        if ((*state & 0xFFFFFF00) == 0x100)
+            break;
+    }
+    return p;
+}
+
+typedef const uint8_t *(*find_func)(const uint8_t *p, const uint8_t *end,
+                                    uint32_t *state);
+
+/* random data with zero runs and start codes, roughly like coded video */
+static void fill_es(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++) {
+        unsigned r = av_lfg_get(&prng);
+        buf[i] = r;
+        if (!(r & 0x3F00))
+            buf[i] = 0;
+    }
+    for (i = 0; i + 4 < size; i += 1 + av_lfg_get(&prng) % 8192)
+        AV_WB32(buf + i, 0x100 | (av_lfg_get(&prng) & 0xFF));
+}
+
+static int check(const uint8_t *buf, int size)
+{
+    int it;
+
+    for (it = 0; it < 2000; it++) {
+        int start = av_lfg_get(&prng) % size;
+        int len   = av_lfg_get(&prng) % FFMIN(size - start, 300);
+        const uint8_t *p = buf + start, *end = p + len, *q = p;
+        uint32_t state = av_lfg_get(&prng), ref_state = state;
+        int i;
+
+        for (i = 0; i < len && buf[start + i]; i++)
+            ;
+        if (h264dsp.startcode_find_candidate(p, len) != i) {
+            printf("error: startcode_find_candidate() at %d+%d\n", start, len);
+            return 1;
+        }
+
+        while (p < end) {
+            p = ff_find_start_code    (p, end, &state);
+            q = find_start_code_ref(q, end, &ref_state);
+            if (p != q || state != ref_state) {
+                printf("error: ff_find_start_code() at %d+%d: "
+                       "%d %08x != %d %08x\n", start, len,
+                       (int)(p - buf), state, (int)(q - buf), ref_state);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* throughput in MB/s, best of NB_ROUNDS */
+static double speed(const uint8_t *buf, int size, find_func find, int *count)
+{
+    int64_t ti, best = INT64_MAX;
+    int round;
+
+    for (round = 0; round < NB_ROUNDS; round++) {
+        const uint8_t *p = buf, *end = buf + size;
+        uint32_t state = -1;
+
+        *count = 0;
+        ti = gettime();
+        while (p < end) {
+            p = find(p, end, &state);
+            *count += (state & 0xFFFFFF00) == 0x100;
+        }
+        ti = gettime() - ti;
+        best = FFMIN(best, ti);
+    }
+    return size / (double)FFMAX(best, 1);
+}
+
+static double speed_candidate(const uint8_t *buf, int size)
+{
+    int64_t ti, best = INT64_MAX;
+    int round;
+
+    for (round = 0; round < NB_ROUNDS; round++) {
+        int i = 0;
+
+        ti = gettime();
+        while (i < size)
+            i += h264dsp.startcode_find_candidate(buf + i, size - i) + 1;
+        ti = gettime() - ti;
+        best = FFMIN(best, ti);
+    }
+    return size / (double)FFMAX(best, 1);
+}
+
+static int run(const char *name, const uint8_t *buf, int size)
+{
+    static const struct {
+        const char *name;
+        find_func find;
+    } funcs[] = {
+        { "bytewise",            find_start_code_ref },
+        { "ff_find_start_code",  ff_find_start_code  },
+    };
+    int i, count, ref_count = -1;
+
+    printf("%s: %d bytes\n", name, size);
+    if (check(buf, size))
+        return 1;
+    for (i = 0; i < FF_ARRAY_ELEMS(funcs); i++) {
+        double mbps = speed(buf, size, funcs[i].find, &count);
+        if (ref_count >= 0 && count != ref_count) {
+            printf("error: %s found %d start codes, expected %d\n",
+                   funcs[i].name, count, ref_count);
+            return 1;
+        }
+        ref_count = count;
+        printf("  %-28s %8.1f MB/s\n", funcs[i].name, mbps);
+    }
+    printf("  %-28s %8.1f MB/s\n", "startcode_find_candidate",
+           speed_candidate(buf, size));
+    printf("  %d start codes\n", ref_count);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *buf;
+    int i, size, errors = 0;
+
+    av_lfg_init(&prng, 1);
+    ff_h264dsp_init(&h264dsp, 8);
+
+    if (argc < 2) {
+        buf = av_malloc(RANDOM_SIZE);
+        fill_es(buf, RANDOM_SIZE);
+        errors = run("random", buf, RANDOM_SIZE);
+        av_free(buf);
+        return errors;
+    }
+
+    for (i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) {
+            perror(argv[i]);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        buf = av_malloc(size + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (size <= 0 || fread(buf, 1, size, f) != size) {
+            fprintf(stderr, "%s: read error\n", argv[i]);
+            return 1;
+        }
+        fclose(f);
+        errors += run(argv[i], buf, size);
+        av_free(buf);
+    }
+    return !!errors;
+}
@@ -38,6 +38,19 @@
  */
 void ff_thread_flush(AVCodecContext *avctx);
 
+/**
+ * Waits for decoding threads to finish and adds the memory used
+ * by all frame thread contexts to usage.
+ * Called by avcodec_get_memory_usage().
+ */
+void ff_thread_memory_usage(AVCodecContext *avctx, AVCodecMemoryUsage *usage);
+
+/**
+ * Gets the statistics of one frame thread, or their sum if thread is -1.
+ * Called by avcodec_get_thread_stats().
+ */
+int ff_thread_get_stats(AVCodecContext *avctx, int thread, AVCodecThreadStats *stats);
+
 /**
  * Submits a new frame to a decoding thread.
  * Returns the next available frame in picture. *got_picture_ptr
@@ -48,6 +61,28 @@ void ff_thread_flush(AVCodecContext *avctx);
 int ff_thread_decode_frame(AVCodecContext *avctx, AVFrame *picture,
                            int *got_picture_ptr, AVPacket *avpkt);
 
+/**
+ * Submits a new frame to an encoding thread.
+ * Returns the output of the oldest thread, or 0 while the first
+ * frames are being encoded or no output is left when flushing.
+ *
+ * Parameters are the same as avcodec_encode_video().
+ */
+int ff_thread_encode_frame(AVCodecContext *avctx, uint8_t *buf, int buf_size,
+                           const AVFrame *pict);
+
+/**
+ * Waits for the thread encoding the previous frame to finish it,
+ * e.g. to continue from the rate control state it left.
+ * This ends the overlap with the previous frame, so call it as late
+ * as possible.
+ *
+ * @param avctx The context of the current thread.
+ * @return The context of the previous thread, or NULL if there is none
+ * or frame threading is not active.
+ */
+AVCodecContext *ff_thread_await_previous_frame(AVCodecContext *avctx);
+
 /**
  * If the codec defines update_thread_context(), call this
  * when they are ready for the next thread to start decoding
@@ -58,6 +93,15 @@ int ff_thread_decode_frame(AVCodecContext *avctx, AVFrame *picture,
  */
 void ff_thread_finish_setup(AVCodecContext *avctx);
 
+/**
+ * Account for bytes copied by the update_thread_context() method.
+ * The number of bytes copied per frame is logged with FF_DEBUG_THREADS.
+ *
+ * @param avctx The destination context.
+ * @param bytes The number of bytes copied.
+ */
+void ff_thread_report_copied(AVCodecContext *avctx, int bytes);
+
 /**
  * Notifies later decoding threads when part of their reference picture
  * is ready.
@@ -108,6 +152,89 @@ int ff_thread_get_buffer(AVCodecContext *avctx, AVFrame *f);
  */
 void ff_thread_release_buffer(AVCodecContext *avctx, AVFrame *f);
 
+/**
+ * Resets the progress counters of count rows, e.g. macroblock rows
+ * decoded by the jobs of one execute2() call, to -1.
+ * Jobs are started in increasing order, so a job may wait on the rows
+ * of earlier jobs with ff_thread_await_row(), but not on later ones.
+ * Only valid if FF_THREAD_SLICE is in avctx->active_thread_type.
+ *
+ * @param avctx The context.
+ * @param count The number of rows.
+ * @return 0 on success, a negative error code otherwise.
+ */
+int ff_thread_init_rows(AVCodecContext *avctx, int count);
+
+/**
+ * Notifies jobs waiting on a row how far it has been decoded.
+ * Values, in arbitrary units, must not decrease.
+ *
+ * @param avctx The context.
+ * @param row The row being decoded.
+ * @param progress The progress made in it.
+ */
+void ff_thread_report_row(AVCodecContext *avctx, int row, int progress);
+
+/**
+ * Waits until ff_thread_report_row() was called for the row with
+ * the same or a higher value of progress.
+ *
+ * @param avctx The context.
+ * @param row The row being referenced; it must belong to an earlier job.
+ * @param progress Value to wait for.
+ */
+void ff_thread_await_row(AVCodecContext *avctx, int row, int progress);
+
+struct ThreadPass;
+
+/**
+ * Allocates a pass, which runs a function on another thread behind the
+ * decoding thread, e.g. to deblock the rows it has reconstructed.
+ * The pass runs on the shared pool if one is running, or else on its own thread.
+ * Only valid if FF_THREAD_PIPELINE is in avctx->active_thread_type.
+ *
+ * @param avctx The context.
+ * @param pass Set to the new pass.
+ * @return 0 on success, a negative error code otherwise; the caller must
+ * then do the work itself.
+ */
+int ff_thread_pass_init(AVCodecContext *avctx, struct ThreadPass **pass);
+
+/**
+ * Starts func(avctx, arg) on the pass thread and resets its progress to -1.
+ * The pass must not be running.
+ */
+void ff_thread_pass_start(struct ThreadPass *pass,
+                          int (*func)(AVCodecContext *avctx, void *arg), void *arg);
+
+/**
+ * Notifies the pass how far the decoding thread has got.
+ * Values must not decrease; INT_MAX means that the decoding thread is done.
+ */
+void ff_thread_pass_report(struct ThreadPass *pass, int progress);
+
+/**
+ * Called from the pass function to wait until the decoding thread has
+ * reported at least the given progress.
+ *
+ * @return The progress reported so far.
+ */
+int ff_thread_pass_await(struct ThreadPass *pass, int progress);
+
+/**
+ * Waits for the pass function to return. If it has not started yet,
+ * it is run on the calling thread instead.
+ * Call ff_thread_pass_report(pass, INT_MAX) first.
+ *
+ * @return The return value of the pass function.
+ */
+int ff_thread_pass_finish(struct ThreadPass *pass);
+
+/**
+ * Frees a pass that is not running and sets *pass to NULL.
+ */
+void ff_thread_pass_free(struct ThreadPass **pass);
+
 int ff_thread_init(AVCodecContext *s);
 void ff_thread_free(AVCodecContext *s);
 
@@ -32,6 +32,7 @@
 #include "libavutil/audioconvert.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 #include "avcodec.h"
 #include "dsputil.h"
 #include "libavutil/opt.h"
@@ -120,6 +121,7 @@ typedef struct InternalBuffer{
     int linesize[4];
     int width, height;
     enum PixelFormat pix_fmt;
+    int size;                   ///< allocated bytes, summed over base[]
 }InternalBuffer;
 
 #define INTERNAL_BUFFER_SIZE 32
@@ -264,12 +266,8 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
     picture_number= &(((InternalBuffer*)s->internal_buffer)[INTERNAL_BUFFER_SIZE]).last_pic_num; //FIXME ugly hack
     (*picture_number)++;
 
+    /* with frame threads this runs under the buffer lock, like release_buffer */
     if(buf->base[0] && (buf->width != w || buf->height != h || buf->pix_fmt != s->pix_fmt)){
-        if(s->active_thread_type&FF_THREAD_FRAME) {
-            av_log_missing_feature(s, "Width/height changing with frame threads is", 0);
-            return -1;
-        }
-
         for(i=0; i<4; i++){
             av_freep(&buf->base[i]);
             buf->data[i]= NULL;
@@ -319,6 +317,7 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
         size[i] = tmpsize - (picture.data[i] - picture.data[0]);
 
         buf->last_pic_num= -256*256*256*64;
+        buf->size= 0;
         memset(buf->base, 0, sizeof(buf->base));
         memset(buf->data, 0, sizeof(buf->data));
 
@@ -330,6 +329,7 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
 
             buf->base[i]= av_malloc(size[i]+16); //FIXME 16
             if(buf->base[i]==NULL) return -1;
+            buf->size += size[i]+16;
             memset(buf->base[i], 128, size[i]);
 
             // no edge if EDGE EMU or not planar YUV
@@ -383,6 +383,21 @@ void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic){
     last = &((InternalBuffer*)s->internal_buffer)[s->internal_buffer_count];
 
     FFSWAP(InternalBuffer, *buf, *last);
+
+    /* keep a single unused buffer around in low memory mode */
+    if(s->flags2 & CODEC_FLAG2_LOW_MEMORY){
+        for(i=s->internal_buffer_count+1; i<INTERNAL_BUFFER_SIZE; i++){
+            int j;
+            buf= &((InternalBuffer*)s->internal_buffer)[i];
+            if(!buf->base[0])
+                break;
+            for(j=0; j<4; j++){
+                av_freep(&buf->base[j]);
+                buf->data[j]= NULL;
+            }
+            buf->size= 0;
+        }
+    }
     }
 
     for(i=0; i<4; i++){
@@ -625,8 +640,13 @@ int attribute_align_arg avcodec_encode_video(AVCodecContext *avctx, uint8_t *buf
     }
     if(av_image_check_size(avctx->width, avctx->height, 0, avctx))
         return -1;
-    if((avctx->codec->capabilities & CODEC_CAP_DELAY) || pict){
-        int ret = avctx->codec->encode(avctx, buf, buf_size, pict);
+    if((avctx->codec->capabilities & CODEC_CAP_DELAY) || pict
+        || (avctx->active_thread_type&FF_THREAD_FRAME)){
+        int ret;
+        if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+            ret = ff_thread_encode_frame(avctx, buf, buf_size, pict);
+        else
+            ret = avctx->codec->encode(avctx, buf, buf_size, (void*)pict); //the encoders do not write to the input
         avctx->frame_number++;
         emms_c(); //needed to avoid an emms_c() call before every return;
 
@@ -699,6 +719,25 @@ int attribute_align_arg avcodec_decode_video(AVCodecContext *avctx, AVFrame *pic
 }
 #endif
 
+/// Number of frames that have to be on time before deadline_level is lowered.
+#define DEADLINE_RECOVERY_FRAMES 8
+
+static void update_deadline_level(AVCodecContext *avctx)
+{
+    if (!avctx->frame_deadline) {
+        avctx->deadline_level   = 0;
+        avctx->deadline_on_time = 0;
+    } else if (av_gettime() > avctx->frame_deadline) {
+        if (avctx->deadline_level < FF_DEADLINE_DROP_NONREF)
+            avctx->deadline_level++;
+        avctx->deadline_on_time = 0;
+    } else if (avctx->deadline_level &&
+               ++avctx->deadline_on_time >= DEADLINE_RECOVERY_FRAMES) {
+        avctx->deadline_level--;
+        avctx->deadline_on_time = 0;
+    }
+}
+
 int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *picture,
                          int *got_picture_ptr,
                          AVPacket *avpkt)
@@ -723,6 +762,7 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
 
         emms_c(); //needed to avoid an emms_c() call before every return;
 
+        update_deadline_level(avctx);
 
         if (*got_picture_ptr){
             avctx->frame_number++;
@@ -1140,6 +1180,47 @@ void avcodec_default_free_buffers(AVCodecContext *s){
     s->internal_buffer_count=0;
 }
 
+void ff_codec_context_memory_usage(AVCodecContext *avctx, AVCodecMemoryUsage *usage)
+{
+    int i;
+
+    usage->contexts += sizeof(*avctx);
+    if (avctx->codec) {
+        usage->contexts += avctx->codec->priv_data_size;
+        if (avctx->codec->memory_usage && avctx->priv_data)
+            usage->tables += avctx->codec->memory_usage(avctx);
+    }
+    if (avctx->internal_buffer)
+        for (i = 0; i < INTERNAL_BUFFER_SIZE; i++)
+            usage->frames += ((InternalBuffer*)avctx->internal_buffer)[i].size;
+}
+
+int avcodec_get_memory_usage(AVCodecContext *avctx, AVCodecMemoryUsage *usage)
+{
+    memset(usage, 0, sizeof(*usage));
+
+    if (!avctx->codec)
+        return AVERROR(EINVAL);
+
+    if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+        ff_thread_memory_usage(avctx, usage);
+    else
+        ff_codec_context_memory_usage(avctx, usage);
+
+    usage->total = usage->contexts + usage->tables + usage->frames;
+    return 0;
+}
+
+int avcodec_get_thread_stats(AVCodecContext *avctx, int thread, AVCodecThreadStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    if (HAVE_PTHREADS && avctx->codec && avctx->active_thread_type&FF_THREAD_FRAME)
+        return ff_thread_get_stats(avctx, thread, stats);
+
+    return AVERROR(EINVAL);
+}
+
 char av_get_pict_type_char(int pict_type){
     switch(pict_type){
     case FF_I_TYPE: return 'I';
@@ -1335,6 +1416,15 @@ void ff_thread_finish_setup(AVCodecContext *avctx)
 {
 }
 
+AVCodecContext *ff_thread_await_previous_frame(AVCodecContext *avctx)
+{
+    return NULL;
+}
+
+void ff_thread_report_copied(AVCodecContext *avctx, int bytes)
+{
+}
+
 void ff_thread_report_progress(AVFrame *f, int progress, int field)
 {
 }
@@ -1343,6 +1433,62 @@ void ff_thread_await_progress(AVFrame *f, int progress, int field)
 {
 }
 
+int ff_thread_init_rows(AVCodecContext *avctx, int count)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_thread_report_row(AVCodecContext *avctx, int row, int progress)
+{
+}
+
+void ff_thread_await_row(AVCodecContext *avctx, int row, int progress)
+{
+}
+
+int ff_thread_pass_init(AVCodecContext *avctx, struct ThreadPass **pass)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_thread_pass_start(struct ThreadPass *pass,
+                          int (*func)(AVCodecContext *avctx, void *arg), void *arg)
+{
+}
+
+void ff_thread_pass_report(struct ThreadPass *pass, int progress)
+{
+}
+
+int ff_thread_pass_await(struct ThreadPass *pass, int progress)
+{
+    return INT_MAX;
+}
+
+int ff_thread_pass_finish(struct ThreadPass *pass)
+{
+    return 0;
+}
+
+void ff_thread_pass_free(struct ThreadPass **pass)
+{
+}
+
+int avcodec_thread_pool_init(int nb_workers, int flags)
+{
+    return AVERROR(ENOSYS);
+}
+
+int avcodec_thread_pool_uninit(void)
+{
+    return 0;
+}
+
+int avcodec_thread_pool_get_stats(AVCodecThreadPoolStats *stats)
+{
+    return AVERROR(ENOSYS);
+}
+
 #endif
 
 #if LIBAVCODEC_VERSION_MAJOR < 53
@@ -273,6 +273,16 @@ typedef struct VC1Context{
     int use_ic;                   ///< use intensity compensation in B-frames
     int rnd;                      ///< rounding control
 
+    /** Picture header state handed to the next frame thread, saved right
+     *  after the frame header because slice headers parse it again while
+     *  the next thread may already be copying it */
+    //@{
+    int next_use_ic, next_rnd;
+    uint8_t next_mv_mode, next_mv_mode2, next_mvrange, next_respic;
+    uint8_t next_lumscale, next_lumshift;
+    uint8_t next_luty[256], next_lutuv[256];
+    //@}
+
     /** Frame decoding info for S/M profiles only */
     //@{
     uint8_t rangeredfrm; ///< out_sample = CLIP((in_sample-128)*2+128)
@@ -338,7 +348,7 @@ static av_always_inline const uint8_t* find_next_marker(const uint8_t *src, cons
 
     if(end-src < 4) return end;
     while(src < end){
-        mrk = (mrk << 8) | *src++;
+        src = ff_find_start_code(src, end, &mrk);
         if(IS_MARKER(mrk))
             return src-4;
     }
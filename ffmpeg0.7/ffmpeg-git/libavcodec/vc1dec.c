@@ -38,6 +38,7 @@
 #include "simple_idct.h"
 #include "mathops.h"
 #include "vdpau_internal.h"
+#include "thread.h"
 
 #undef NDEBUG
 #include <assert.h>
@@ -187,6 +188,26 @@ static void vc1_loop_filter_iblk(VC1Context *v, int pq)
     }
 }
 
+/** Wait until a reference picture is decoded down to the given luma line
+ * (frame threading only).
+ */
+static av_always_inline void vc1_await_ref_lines(VC1Context *v, Picture *ref, int y)
+{
+    ff_thread_await_progress((AVFrame*)ref, FFMIN(y >> 4, v->s.mb_height - 1), 0);
+}
+
+/** Report decoding progress after a macroblock row has been finished.
+ * Overlap smoothing and the loop filter of a row still modify the bottom
+ * lines of the row above it, so only that one is reported as complete.
+ */
+static void vc1_report_decode_progress(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    if (s->pict_type != FF_B_TYPE && s->mb_y > 0)
+        ff_thread_report_progress((AVFrame*)s->current_picture_ptr, s->mb_y - 1, 0);
+}
+
 /** Do motion compensation over 1 macroblock
  * Mostly adapted hpel_motion and qpel_motion from mpegvideo.c
  */
@@ -242,6 +263,9 @@ static void vc1_mc_1mv(VC1Context *v, int dir)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_ref_lines(v, dir ? s->next_picture_ptr : s->last_picture_ptr,
+                        FFMAX(src_y + 17 + s->mspel, (uvsrc_y + 9) << 1));
+
     srcY += src_y * s->linesize + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -367,6 +391,8 @@ static void vc1_mc_4mv_luma(VC1Context *v, int n)
         src_y   = av_clip(  src_y, -18, s->avctx->coded_height + 1);
     }
 
+    vc1_await_ref_lines(v, s->last_picture_ptr, src_y + 9 + s->mspel);
+
     srcY += src_y * s->linesize + src_x;
 
     if(v->rangeredfrm || (v->mv_mode == MV_PMODE_INTENSITY_COMP)
@@ -505,6 +531,8 @@ static void vc1_mc_4mv_chroma(VC1Context *v)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_ref_lines(v, s->last_picture_ptr, (uvsrc_y + 9) << 1);
+
     srcU = s->last_picture.data[1] + uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV = s->last_picture.data[2] + uvsrc_y * s->uvlinesize + uvsrc_x;
     if(v->rangeredfrm || (v->mv_mode == MV_PMODE_INTENSITY_COMP)
@@ -831,6 +859,9 @@ static void vc1_interp_mc(VC1Context *v)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_ref_lines(v, s->next_picture_ptr,
+                        FFMAX(src_y + 17 + s->mspel, (uvsrc_y + 9) << 1));
+
     srcY += src_y * s->linesize + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -981,6 +1012,7 @@ static inline void vc1_pred_b_mv(VC1Context *v, int dmv_x[2], int dmv_y[2], int
         s->current_picture.motion_val[1][xy][1] = 0;
         return;
     }
+    ff_thread_await_progress((AVFrame*)s->next_picture_ptr, s->mb_y, 0);
     s->mv[0][0][0] = scale_mv(s->next_picture.motion_val[1][xy][0], v->bfraction, 0, s->quarter_sample);
     s->mv[0][0][1] = scale_mv(s->next_picture.motion_val[1][xy][1], v->bfraction, 0, s->quarter_sample);
     s->mv[1][0][0] = scale_mv(s->next_picture.motion_val[1][xy][0], v->bfraction, 1, s->quarter_sample);
@@ -2760,6 +2792,7 @@ static void vc1_decode_i_blocks(VC1Context *v)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_decode_progress(v);
 
         s->first_slice_line = 0;
     }
@@ -2915,6 +2948,7 @@ static void vc1_decode_i_blocks_adv(VC1Context *v, int mby_start, int mby_end)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     if (v->s.loop_filter)
@@ -2975,6 +3009,7 @@ static void vc1_decode_p_blocks(VC1Context *v, int mby_start, int mby_end)
         memmove(v->is_intra_base, v->is_intra, sizeof(v->is_intra_base[0])*s->mb_stride);
         memmove(v->luma_mv_base, v->luma_mv, sizeof(v->luma_mv_base[0])*s->mb_stride);
         if (s->mb_y != mby_start) ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     if (apply_loop_filter) {
@@ -3055,10 +3090,12 @@ static void vc1_decode_skip_blocks(VC1Context *v)
         s->mb_x = 0;
         ff_init_block_index(s);
         ff_update_block_index(s);
+        ff_thread_await_progress((AVFrame*)s->last_picture_ptr, s->mb_y, 0);
         memcpy(s->dest[0], s->last_picture.data[0] + s->mb_y * 16 * s->linesize, s->linesize * 16);
         memcpy(s->dest[1], s->last_picture.data[1] + s->mb_y * 8 * s->uvlinesize, s->uvlinesize * 8);
         memcpy(s->dest[2], s->last_picture.data[2] + s->mb_y * 8 * s->uvlinesize, s->uvlinesize * 8);
         ff_draw_horiz_band(s, s->mb_y * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     s->pict_type = FF_P_TYPE;
@@ -3207,6 +3244,44 @@ static void vc1_parse_sprites(VC1Context *v, GetBitContext* gb)
         av_log(v->s.avctx, AV_LOG_WARNING, "Buffer not fully read\n");
 }
 
+/** Allocate the per-context macroblock info tables
+ * @param v The VC1Context whose MpegEncContext is already initialized
+ * @return Status
+ */
+static av_cold int vc1_alloc_tables(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    /* Allocate mb bitplanes */
+    v->mv_type_mb_plane = av_malloc(s->mb_stride * s->mb_height);
+    v->direct_mb_plane = av_malloc(s->mb_stride * s->mb_height);
+    v->acpred_plane = av_malloc(s->mb_stride * s->mb_height);
+    v->over_flags_plane = av_malloc(s->mb_stride * s->mb_height);
+
+    v->cbp_base = av_malloc(sizeof(v->cbp_base[0]) * 2 * s->mb_stride);
+    v->cbp = v->cbp_base + s->mb_stride;
+    v->ttblk_base = av_malloc(sizeof(v->ttblk_base[0]) * 2 * s->mb_stride);
+    v->ttblk = v->ttblk_base + s->mb_stride;
+    v->is_intra_base = av_malloc(sizeof(v->is_intra_base[0]) * 2 * s->mb_stride);
+    v->is_intra = v->is_intra_base + s->mb_stride;
+    v->luma_mv_base = av_malloc(sizeof(v->luma_mv_base[0]) * 2 * s->mb_stride);
+    v->luma_mv = v->luma_mv_base + s->mb_stride;
+
+    /* allocate block type info in that way so it could be used with s->block_index[] */
+    v->mb_type_base = av_malloc(s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride * (s->mb_height + 1) * 2);
+    v->mb_type[0] = v->mb_type_base + s->b8_stride + 1;
+    v->mb_type[1] = v->mb_type_base + s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride + 1;
+    v->mb_type[2] = v->mb_type[1] + s->mb_stride * (s->mb_height + 1);
+
+    if (!v->mv_type_mb_plane || !v->direct_mb_plane || !v->acpred_plane ||
+        !v->over_flags_plane || !v->cbp_base || !v->ttblk_base ||
+        !v->is_intra_base || !v->luma_mv_base || !v->mb_type_base)
+        return -1;
+
+    ff_intrax8_common_init(&v->x8,s);
+    return 0;
+}
+
 /** Initialize a VC1/WMV3 decoder
  * @todo TODO: Handle VC-1 IDUs (Transport level?)
  * @todo TODO: Decypher remaining bits in extra_data
@@ -3335,27 +3410,6 @@ static av_cold int vc1_decode_init(AVCodecContext *avctx)
         v->top_blk_sh  = 0;
     }
 
-    /* Allocate mb bitplanes */
-    v->mv_type_mb_plane = av_malloc(s->mb_stride * s->mb_height);
-    v->direct_mb_plane = av_malloc(s->mb_stride * s->mb_height);
-    v->acpred_plane = av_malloc(s->mb_stride * s->mb_height);
-    v->over_flags_plane = av_malloc(s->mb_stride * s->mb_height);
-
-    v->cbp_base = av_malloc(sizeof(v->cbp_base[0]) * 2 * s->mb_stride);
-    v->cbp = v->cbp_base + s->mb_stride;
-    v->ttblk_base = av_malloc(sizeof(v->ttblk_base[0]) * 2 * s->mb_stride);
-    v->ttblk = v->ttblk_base + s->mb_stride;
-    v->is_intra_base = av_malloc(sizeof(v->is_intra_base[0]) * 2 * s->mb_stride);
-    v->is_intra = v->is_intra_base + s->mb_stride;
-    v->luma_mv_base = av_malloc(sizeof(v->luma_mv_base[0]) * 2 * s->mb_stride);
-    v->luma_mv = v->luma_mv_base + s->mb_stride;
-
-    /* allocate block type info in that way so it could be used with s->block_index[] */
-    v->mb_type_base = av_malloc(s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride * (s->mb_height + 1) * 2);
-    v->mb_type[0] = v->mb_type_base + s->b8_stride + 1;
-    v->mb_type[1] = v->mb_type_base + s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride + 1;
-    v->mb_type[2] = v->mb_type[1] + s->mb_stride * (s->mb_height + 1);
-
     /* Init coded blocks info */
     if (v->profile == PROFILE_ADVANCED)
     {
@@ -3365,7 +3419,93 @@ static av_cold int vc1_decode_init(AVCodecContext *avctx)
 //            return -1;
     }
 
-    ff_intrax8_common_init(&v->x8,s);
+    return vc1_alloc_tables(v);
+}
+
+static av_cold int vc1_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    VC1Context *v = avctx->priv_data;
+
+    if (!avctx->is_copy) return 0;
+
+    /* The MpegEncContext and the macroblock tables still belong to the
+     * context this one was copied from; they are allocated on the first
+     * call to vc1_decode_update_thread_context(). */
+    memset(&v->s, 0, sizeof(v->s));
+    v->s.avctx = avctx;
+    v->mv_type_mb_plane = v->direct_mb_plane = NULL;
+    v->acpred_plane = v->over_flags_plane = NULL;
+    v->cbp_base = NULL;
+    v->ttblk_base = NULL;
+    v->is_intra_base = NULL;
+    v->luma_mv_base = NULL;
+    v->mb_type_base = NULL;
+    v->x8.prediction_table = NULL;
+
+    return 0;
+}
+
+/**
+ * Save the picture header state read by vc1_decode_update_thread_context().
+ * The slice headers of advanced profile frames repeat the picture header,
+ * so this is also the state after the last slice.
+ */
+static void vc1_save_header_state(VC1Context *v)
+{
+    v->next_rnd      = v->rnd;
+    v->next_mvrange  = v->mvrange;
+    v->next_respic   = v->respic;
+    v->next_mv_mode  = v->mv_mode;
+    v->next_mv_mode2 = v->mv_mode2;
+    v->next_use_ic   = v->use_ic;
+    v->next_lumscale = v->lumscale;
+    v->next_lumshift = v->lumshift;
+    memcpy(v->next_luty,  v->luty,  sizeof(v->luty));
+    memcpy(v->next_lutuv, v->lutuv, sizeof(v->lutuv));
+}
+
+#define copy_fields(to, from, start_field, end_field) memcpy(&to->start_field, &from->start_field, (char*)&to->end_field - (char*)&to->start_field)
+static int vc1_decode_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    VC1Context *v = dst->priv_data, *v1 = src->priv_data;
+    MpegEncContext *s = &v->s;
+    int inited = s->context_initialized, err;
+
+    if (dst == src || !v1->s.context_initialized) return 0;
+
+    err = ff_mpeg_update_thread_context(dst, src);
+    if (err) return err;
+
+    if (!inited && vc1_alloc_tables(v) < 0)
+        return AVERROR(ENOMEM);
+
+    //sequence header and entry point, the latter may be updated in-band
+    copy_fields(v, v1, res_sprite, mv_mode);
+    v->broken_link      = v1->broken_link;
+    v->closed_entry     = v1->closed_entry;
+    v->range_mapy_flag  = v1->range_mapy_flag;
+    v->range_mapuv_flag = v1->range_mapuv_flag;
+    v->range_mapy       = v1->range_mapy;
+    v->range_mapuv      = v1->range_mapuv;
+    s->loop_filter      = v1->s.loop_filter;
+    s->h_edge_pos       = v1->s.h_edge_pos;
+    s->v_edge_pos       = v1->s.v_edge_pos;
+
+    //picture header state inherited by the following pictures
+    v->rnd      = v1->next_rnd;
+    v->mvrange  = v1->next_mvrange;
+    v->respic   = v1->next_respic;
+    v->mv_mode  = v1->next_mv_mode;
+    v->mv_mode2 = v1->next_mv_mode2;
+
+    //intensity compensation of the anchor, applied again in B-frames
+    v->use_ic   = v1->next_use_ic;
+    v->lumscale = v1->next_lumscale;
+    v->lumshift = v1->next_lumshift;
+    memcpy(v->luty,  v1->next_luty,  sizeof(v->luty));
+    memcpy(v->lutuv, v1->next_lutuv, sizeof(v->lutuv));
+    vc1_save_header_state(v);
+
     return 0;
 }
 
@@ -3497,6 +3637,7 @@ static int vc1_decode_frame(AVCodecContext *avctx,
             goto err;
         }
     }
+    vc1_save_header_state(v);
 
     if (v->res_sprite && s->pict_type!=FF_I_TYPE) {
         av_log(v->s.avctx, AV_LOG_WARNING, "Sprite decoder: expected I-frame\n");
@@ -3546,6 +3687,8 @@ static int vc1_decode_frame(AVCodecContext *avctx,
         goto err;
     }
 
+    ff_thread_finish_setup(avctx);
+
     s->me.qpel_put= s->dsp.put_qpel_pixels_tab;
     s->me.qpel_avg= s->dsp.avg_qpel_pixels_tab;
 
@@ -3651,11 +3794,13 @@ AVCodec ff_vc1_decoder = {
     NULL,
     vc1_decode_end,
     vc1_decode_frame,
-    CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("SMPTE VC-1"),
     .pix_fmts = ff_hwaccel_pixfmt_list_420,
-    .profiles = NULL_IF_CONFIG_SMALL(profiles)
+    .profiles = NULL_IF_CONFIG_SMALL(profiles),
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(vc1_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_decode_update_thread_context)
 };
 
 #if CONFIG_WMV3_DECODER
@@ -3668,11 +3813,13 @@ AVCodec ff_wmv3_decoder = {
     NULL,
     vc1_decode_end,
     vc1_decode_frame,
-    CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("Windows Media Video 9"),
     .pix_fmts = ff_hwaccel_pixfmt_list_420,
-    .profiles = NULL_IF_CONFIG_SMALL(profiles)
+    .profiles = NULL_IF_CONFIG_SMALL(profiles),
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(vc1_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_decode_update_thread_context)
 };
 #endif
 
@@ -79,14 +79,36 @@ typedef struct {
     uint8_t mode;
     uint8_t ref_frame;
     uint8_t partitioning;
+    uint8_t segment;
+    uint8_t chroma_pred_mode;    ///< 8x8c pred mode
+    uint8_t intra4x4_pred_mode_mb[16];
     VP56mv mv;
     VP56mv bmv[16];
 } VP8Macroblock;
 
+/**
+ * Scratch state of a thread reconstructing macroblocks.
+ */
+typedef struct {
+    /**
+     * This is the index plus one of the last non-zero coeff
+     * for each of the blocks in the current macroblock.
+     * So, 0 -> no coeffs
+     *     1 -> dc-only (special transform)
+     *     2+-> full transform
+     */
+    DECLARE_ALIGNED(16, uint8_t, non_zero_count_cache)[6][4];
+    DECLARE_ALIGNED(16, DCTELEM, block)[6][4][16];
+    DECLARE_ALIGNED(16, DCTELEM, block_dc)[16];
+    DECLARE_ALIGNED(8, uint8_t, left_nnz)[9];
+    uint8_t *edge_emu_buffer;
+    VP8FilterStrength *filter_strength;
+} VP8ThreadData;
+
 typedef struct {
     AVCodecContext *avctx;
     AVFrame *framep[4];
-    uint8_t *edge_emu_buffer;
+    AVFrame *next_framep[4];
 
     uint16_t mb_width;   /* number of horizontal MB */
     uint16_t mb_height;  /* number of vertical MB */
@@ -96,8 +118,6 @@ typedef struct {
     uint8_t keyframe;
     uint8_t deblock_filter;
     uint8_t mbskip_enabled;
-    uint8_t segment;             ///< segment of the current macroblock
-    uint8_t chroma_pred_mode;    ///< 8x8c pred mode of the current macroblock
     uint8_t profile;
     VP56mv mv_min;
     VP56mv mv_max;
@@ -125,11 +145,9 @@ typedef struct {
     } filter;
 
     VP8Macroblock *macroblocks;
-    VP8FilterStrength *filter_strength;
 
     uint8_t *intra4x4_pred_mode_top;
     uint8_t intra4x4_pred_mode_left[4];
-    uint8_t *segmentation_map;
 
     /**
      * Macroblocks can have one of 4 different quants in a frame when
@@ -180,20 +198,8 @@ typedef struct {
      * per macroblock. We keep the last row in top_nnz.
      */
     uint8_t (*top_nnz)[9];
-    DECLARE_ALIGNED(8, uint8_t, left_nnz)[9];
 
-    /**
-     * This is the index plus one of the last non-zero coeff
-     * for each of the blocks in the current macroblock.
-     * So, 0 -> no coeffs
-     *     1 -> dc-only (special transform)
-     *     2+-> full transform
-     */
-    DECLARE_ALIGNED(16, uint8_t, non_zero_count_cache)[6][4];
     VP56RangeCoder c;   ///< header context, includes mb modes and motion vectors
-    DECLARE_ALIGNED(16, DCTELEM, block)[6][4][16];
-    DECLARE_ALIGNED(16, DCTELEM, block_dc)[16];
-    uint8_t intra4x4_pred_mode_mb[16];
 
     /**
      * These are all of the updatable probabilities for binary decisions.
@@ -235,7 +241,36 @@ typedef struct {
     VP8DSPContext vp8dsp;
     H264PredContext hpc;
     vp8_mc_func put_pixels_tab[3][3][3];
-    AVFrame frames[4];
+
+    /**
+     * Reference frames, plus one spare slot so that the previous frame can
+     * still be read by a frame thread while the next one is being set up.
+     * The per-macroblock segmentation map of each frame is kept in its
+     * ref_index[0].
+     */
+    AVFrame frames[5];
+
+    /**
+     * Segmentation maps of released frames, kept for reuse by the next
+     * allocated frame. Like frames[], this is passed on between frame threads.
+     */
+    uint8_t *segmentation_maps[5];
+    int num_maps_to_be_freed;
+
+    /**
+     * Scratch state for each thread reconstructing macroblocks; only the
+     * first is used unless the rows are decoded by slice threads.
+     */
+    VP8ThreadData *thread_data;
+    int num_thread_data;
+
+    /**
+     * With slice threads, the modes of all macroblocks of the frame are
+     * parsed from the header partition first and kept here, so that the rows
+     * of the coefficient partitions can be reconstructed in a wavefront.
+     */
+    VP8Macroblock *macroblocks_frame;
+    AVFrame *prev_frame;    ///< frame decoded before the current one, for its segmentation map
 } VP8Context;
 
 #endif
@@ -0,0 +1,144 @@
+/*
+ * SSE2 AAC encoder quantization
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/aacenc.h"
+
+/* All functions give the same results as the C versions. */
+
+static void abs_pow34_sse2(float *out, const float *in, int size)
+{
+    x86_reg i = -4 * (x86_reg)size;
+
+    __asm__ volatile(
+        "pcmpeqd      %%xmm7, %%xmm7    \n\t"
+        "psrld            $1, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups     (%2,%0), %%xmm0     \n\t"
+        "andps        %%xmm7, %%xmm0    \n\t"
+        "sqrtps       %%xmm0, %%xmm1    \n\t"
+        "mulps        %%xmm0, %%xmm1    \n\t"
+        "sqrtps       %%xmm1, %%xmm1    \n\t"
+        "movups       %%xmm1, (%1,%0)   \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(out + size), "r"(in + size)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",) "memory"
+    );
+}
+
+/**
+ * The quantized values are rounded and clipped in double precision like
+ * in the C version, two per conversion.
+ */
+static void quantize_bands_sse2(int *out, const float *in,
+                                const float *scaled, int size, float Q34,
+                                int is_signed, int maxval)
+{
+    static const double rounding = 0.4054;
+    const double qmax = maxval;
+    x86_reg i = -4 * (x86_reg)size;
+
+    __asm__ volatile(
+        "movss            %4, %%xmm7    \n\t"
+        "shufps      $0, %%xmm7, %%xmm7 \n\t"
+        "movsd            %5, %%xmm6    \n\t"
+        "unpcklpd     %%xmm6, %%xmm6    \n\t"
+        "movsd            %6, %%xmm5    \n\t"
+        "unpcklpd     %%xmm5, %%xmm5    \n\t"
+        "movd            %7, %%xmm4     \n\t"
+        "pshufd  $0, %%xmm4, %%xmm4     \n\t"
+        "xorps        %%xmm3, %%xmm3    \n\t"
+        "1:                             \n\t"
+        "movups     (%2,%0), %%xmm0     \n\t"
+        "mulps        %%xmm7, %%xmm0    \n\t"
+        "cvtps2pd     %%xmm0, %%xmm1    \n\t"
+        "movhlps      %%xmm0, %%xmm0    \n\t"
+        "cvtps2pd     %%xmm0, %%xmm2    \n\t"
+        "addpd        %%xmm6, %%xmm1    \n\t"
+        "addpd        %%xmm6, %%xmm2    \n\t"
+        "minpd        %%xmm5, %%xmm1    \n\t"
+        "minpd        %%xmm5, %%xmm2    \n\t"
+        "cvttpd2dq    %%xmm1, %%xmm1    \n\t"
+        "cvttpd2dq    %%xmm2, %%xmm2    \n\t"
+        "punpcklqdq   %%xmm2, %%xmm1    \n\t"
+        /* negate where in < 0, if signed */
+        "movups     (%3,%0), %%xmm0     \n\t"
+        "cmpltps      %%xmm3, %%xmm0    \n\t"
+        "pand         %%xmm4, %%xmm0    \n\t"
+        "pxor         %%xmm0, %%xmm1    \n\t"
+        "psubd        %%xmm0, %%xmm1    \n\t"
+        "movdqu       %%xmm1, (%1,%0)   \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(out + size), "r"(scaled + size), "r"(in + size),
+          "m"(Q34), "m"(rounding), "m"(qmax), "r"(is_signed ? -1 : 0)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+/**
+ * Maximum of group_len rows of swb_size values, 128 values apart.
+ */
+static float find_max_val_sse2(int group_len, int swb_size,
+                               const float *scaled)
+{
+    const float *p = scaled + swb_size;
+    x86_reg w = group_len, i;
+    float maxval;
+
+    __asm__ volatile(
+        "xorps        %%xmm0, %%xmm0    \n\t"
+        "1:                             \n\t"
+        "mov              %4, %1        \n\t"
+        "2:                             \n\t"
+        "movups     (%2,%1), %%xmm1     \n\t"
+        "maxps        %%xmm1, %%xmm0    \n\t"
+        "add             $16, %1        \n\t"
+        " js              2b            \n\t"
+        "add            $512, %2        \n\t"
+        "dec              %0            \n\t"
+        " jg              1b            \n\t"
+        "movhlps      %%xmm0, %%xmm1    \n\t"
+        "maxps        %%xmm1, %%xmm0    \n\t"
+        "pshufd  $1, %%xmm0, %%xmm1     \n\t"
+        "maxss        %%xmm1, %%xmm0    \n\t"
+        "movss        %%xmm0, %3        \n\t"
+        : "+&r"(w), "=&r"(i), "+&r"(p), "=m"(maxval)
+        : "r"(-4 * (x86_reg)swb_size)
+        : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+    );
+    return maxval;
+}
+
+void ff_aac_coder_init_x86(AACEncContext *s)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE2) {
+        s->abs_pow34    = abs_pow34_sse2;
+        s->quant_bands  = quantize_bands_sse2;
+        s->find_max_val = find_max_val_sse2;
+    }
+}
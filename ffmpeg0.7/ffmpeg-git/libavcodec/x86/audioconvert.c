@@ -0,0 +1,380 @@
+/*
+ * SSE2 audio sample format conversion
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/audioconvert.h"
+
+/* All functions work on a nonzero multiple of 8 samples or frames.
+ * The conversions give the same results as the C expressions in
+ * audioconvert.c: the integer to float ones are exact up to the final
+ * rounding, and the float to integer ones round to nearest like lrint().
+ * Values above the integer range are clamped before the conversion, values
+ * below it and NaNs turn into the most negative integer, like the clipped
+ * result of lrint(). */
+
+static const float conv_sse2_flt[4][4] = {
+    { 1.0 / (1U << 31), 1.0 / (1U << 31), 1.0 / (1U << 31), 1.0 / (1U << 31) },
+    { 1 << 15, 1 << 15, 1 << 15, 1 << 15 },
+    { INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX },
+    { 1U << 31, 1U << 31, 1U << 31, 1U << 31 },
+};
+
+static const double conv_sse2_dbl[5][2] = {
+    { 1.0 / (1U << 31), 1.0 / (1U << 31) },
+    { 1 << 15, 1 << 15 },
+    { INT16_MAX, INT16_MAX },
+    { 1U << 31, 1U << 31 },
+    { INT32_MAX, INT32_MAX },
+};
+
+/* %0 counts the samples up to 0, %1 and %2 point to the ends of the output
+ * and the input, %3 and %4 to the float and double constants. */
+#define CONV_SSE2(name, otype, itype, setup, body)                      \
+static void conv_ ## name ## _sse2(uint8_t *po, const uint8_t *pi, int len)\
+{                                                                       \
+    x86_reg i = -(x86_reg)len;                                          \
+                                                                        \
+    __asm__ volatile(                                                   \
+        setup                                                           \
+        "1:                                 \n\t"                       \
+        body                                                            \
+        "add                $8, %0          \n\t"                       \
+        " js               1b               \n\t"                       \
+        : "+&r"(i)                                                      \
+        : "r"(po + len * sizeof(otype)), "r"(pi + len * sizeof(itype)), \
+          "r"(conv_sse2_flt), "r"(conv_sse2_dbl)                        \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",     \
+                       "%xmm5", "%xmm6", "%xmm7",) "memory"             \
+    );                                                                  \
+}
+
+/* 8 16 bit samples in (%2,%0,2) to x << 16 in xmm1 and xmm2 */
+#define LOAD_S16_SHL16                                  \
+        "movdqu      (%2,%0,2), %%xmm0      \n\t"       \
+        "pxor          %%xmm1, %%xmm1       \n\t"       \
+        "pxor          %%xmm2, %%xmm2       \n\t"       \
+        "punpcklwd     %%xmm0, %%xmm1       \n\t"       \
+        "punpckhwd     %%xmm0, %%xmm2       \n\t"
+
+/* 4 32 bit integers in reg to doubles in xmm3 and xmm4, times xmm7 */
+#define CVT_S32_TO_DBL(reg)                             \
+        "cvtdq2pd       " reg ", %%xmm3     \n\t"       \
+        "pshufd  $0x4e, " reg ", " reg "    \n\t"       \
+        "cvtdq2pd       " reg ", %%xmm4     \n\t"       \
+        "mulpd         %%xmm7, %%xmm3       \n\t"       \
+        "mulpd         %%xmm7, %%xmm4       \n\t"
+
+CONV_SSE2(s16_to_s32, int32_t, int16_t, "",
+        LOAD_S16_SHL16
+        "movdqu        %%xmm1,   (%1,%0,4)  \n\t"
+        "movdqu        %%xmm2, 16(%1,%0,4)  \n\t"
+)
+
+CONV_SSE2(s16_to_flt, float, int16_t,
+        "movups          (%3), %%xmm7       \n\t",
+        LOAD_S16_SHL16
+        "cvtdq2ps      %%xmm1, %%xmm1       \n\t"
+        "cvtdq2ps      %%xmm2, %%xmm2       \n\t"
+        "mulps         %%xmm7, %%xmm1       \n\t"
+        "mulps         %%xmm7, %%xmm2       \n\t"
+        "movups        %%xmm1,   (%1,%0,4)  \n\t"
+        "movups        %%xmm2, 16(%1,%0,4)  \n\t"
+)
+
+CONV_SSE2(s16_to_dbl, double, int16_t,
+        "movupd          (%4), %%xmm7       \n\t",
+        LOAD_S16_SHL16
+        CVT_S32_TO_DBL("%%xmm1")
+        "movupd        %%xmm3,   (%1,%0,8)  \n\t"
+        "movupd        %%xmm4, 16(%1,%0,8)  \n\t"
+        CVT_S32_TO_DBL("%%xmm2")
+        "movupd        %%xmm3, 32(%1,%0,8)  \n\t"
+        "movupd        %%xmm4, 48(%1,%0,8)  \n\t"
+)
+
+CONV_SSE2(s32_to_s16, int16_t, int32_t, "",
+        "movdqu      (%2,%0,4), %%xmm0      \n\t"
+        "movdqu    16(%2,%0,4), %%xmm1      \n\t"
+        "psrad            $16, %%xmm0       \n\t"
+        "psrad            $16, %%xmm1       \n\t"
+        "packssdw      %%xmm1, %%xmm0       \n\t"
+        "movdqu        %%xmm0, (%1,%0,2)    \n\t"
+)
+
+CONV_SSE2(s32_to_flt, float, int32_t,
+        "movups          (%3), %%xmm7       \n\t",
+        "cvtdq2ps    (%2,%0,4), %%xmm0      \n\t"
+        "cvtdq2ps  16(%2,%0,4), %%xmm1      \n\t"
+        "mulps         %%xmm7, %%xmm0       \n\t"
+        "mulps         %%xmm7, %%xmm1       \n\t"
+        "movups        %%xmm0,   (%1,%0,4)  \n\t"
+        "movups        %%xmm1, 16(%1,%0,4)  \n\t"
+)
+
+CONV_SSE2(s32_to_dbl, double, int32_t,
+        "movupd          (%4), %%xmm7       \n\t",
+        "movdqu      (%2,%0,4), %%xmm1      \n\t"
+        "movdqu    16(%2,%0,4), %%xmm2      \n\t"
+        CVT_S32_TO_DBL("%%xmm1")
+        "movupd        %%xmm3,   (%1,%0,8)  \n\t"
+        "movupd        %%xmm4, 16(%1,%0,8)  \n\t"
+        CVT_S32_TO_DBL("%%xmm2")
+        "movupd        %%xmm3, 32(%1,%0,8)  \n\t"
+        "movupd        %%xmm4, 48(%1,%0,8)  \n\t"
+)
+
+/* the clamp value is the first operand of min so that NaNs are kept */
+CONV_SSE2(flt_to_s16, int16_t, float,
+        "movups        16(%3), %%xmm6       \n\t"
+        "movups        32(%3), %%xmm7       \n\t",
+        "movups      (%2,%0,4), %%xmm0      \n\t"
+        "movups    16(%2,%0,4), %%xmm1      \n\t"
+        "mulps         %%xmm6, %%xmm0       \n\t"
+        "mulps         %%xmm6, %%xmm1       \n\t"
+        "movaps        %%xmm7, %%xmm2       \n\t"
+        "movaps        %%xmm7, %%xmm3       \n\t"
+        "minps         %%xmm0, %%xmm2       \n\t"
+        "minps         %%xmm1, %%xmm3       \n\t"
+        "cvtps2dq      %%xmm2, %%xmm2       \n\t"
+        "cvtps2dq      %%xmm3, %%xmm3       \n\t"
+        "packssdw      %%xmm3, %%xmm2       \n\t"
+        "movdqu        %%xmm2, (%1,%0,2)    \n\t"
+)
+
+/* values >= 2^31 convert to 0x80000000, the mask turns them into INT32_MAX */
+#define FLT_TO_S32(src, dst)                            \
+        "movups  " src "(%2,%0,4), %%xmm0   \n\t"       \
+        "mulps         %%xmm7, %%xmm0       \n\t"       \
+        "movaps        %%xmm7, %%xmm1       \n\t"       \
+        "cmpleps       %%xmm0, %%xmm1       \n\t"       \
+        "cvtps2dq      %%xmm0, %%xmm0       \n\t"       \
+        "pxor          %%xmm1, %%xmm0       \n\t"       \
+        "movdqu        %%xmm0, " dst "(%1,%0,4) \n\t"
+
+CONV_SSE2(flt_to_s32, int32_t, float,
+        "movups        48(%3), %%xmm7       \n\t",
+        FLT_TO_S32("  ", "  ")
+        FLT_TO_S32("16", "16")
+)
+
+CONV_SSE2(flt_to_dbl, double, float, "",
+        "movups      (%2,%0,4), %%xmm0      \n\t"
+        "movups    16(%2,%0,4), %%xmm2      \n\t"
+        "cvtps2pd      %%xmm0, %%xmm1       \n\t"
+        "movhlps       %%xmm0, %%xmm0       \n\t"
+        "cvtps2pd      %%xmm0, %%xmm0       \n\t"
+        "cvtps2pd      %%xmm2, %%xmm3       \n\t"
+        "movhlps       %%xmm2, %%xmm2       \n\t"
+        "cvtps2pd      %%xmm2, %%xmm2       \n\t"
+        "movupd        %%xmm1,   (%1,%0,8)  \n\t"
+        "movupd        %%xmm0, 16(%1,%0,8)  \n\t"
+        "movupd        %%xmm3, 32(%1,%0,8)  \n\t"
+        "movupd        %%xmm2, 48(%1,%0,8)  \n\t"
+)
+
+/* 2 doubles at src to 2 integers in the low half of dst, scaled by xmm6
+ * and clamped to xmm7 */
+#define DBL_TO_S32(src, dst)                            \
+        "movupd  " src "(%2,%0,8), %%xmm0   \n\t"       \
+        "mulpd         %%xmm6, %%xmm0       \n\t"       \
+        "movapd        %%xmm7, " dst "      \n\t"       \
+        "minpd         %%xmm0, " dst "      \n\t"       \
+        "cvtpd2dq      " dst ", " dst "     \n\t"
+
+CONV_SSE2(dbl_to_s16, int16_t, double,
+        "movupd        16(%4), %%xmm6       \n\t"
+        "movupd        32(%4), %%xmm7       \n\t",
+        DBL_TO_S32("  ", "%%xmm1")
+        DBL_TO_S32("16", "%%xmm2")
+        DBL_TO_S32("32", "%%xmm3")
+        DBL_TO_S32("48", "%%xmm4")
+        "punpcklqdq    %%xmm2, %%xmm1       \n\t"
+        "punpcklqdq    %%xmm4, %%xmm3       \n\t"
+        "packssdw      %%xmm3, %%xmm1       \n\t"
+        "movdqu        %%xmm1, (%1,%0,2)    \n\t"
+)
+
+CONV_SSE2(dbl_to_s32, int32_t, double,
+        "movupd        48(%4), %%xmm6       \n\t"
+        "movupd        64(%4), %%xmm7       \n\t",
+        DBL_TO_S32("  ", "%%xmm1")
+        DBL_TO_S32("16", "%%xmm2")
+        DBL_TO_S32("32", "%%xmm3")
+        DBL_TO_S32("48", "%%xmm4")
+        "punpcklqdq    %%xmm2, %%xmm1       \n\t"
+        "punpcklqdq    %%xmm4, %%xmm3       \n\t"
+        "movdqu        %%xmm1,   (%1,%0,4)  \n\t"
+        "movdqu        %%xmm3, 16(%1,%0,4)  \n\t"
+)
+
+CONV_SSE2(dbl_to_flt, float, double, "",
+        "cvtpd2ps    (%2,%0,8), %%xmm0      \n\t"
+        "cvtpd2ps  16(%2,%0,8), %%xmm1      \n\t"
+        "cvtpd2ps  32(%2,%0,8), %%xmm2      \n\t"
+        "cvtpd2ps  48(%2,%0,8), %%xmm3      \n\t"
+        "movlhps       %%xmm1, %%xmm0       \n\t"
+        "movlhps       %%xmm3, %%xmm2       \n\t"
+        "movups        %%xmm0,   (%1,%0,4)  \n\t"
+        "movups        %%xmm2, 16(%1,%0,4)  \n\t"
+)
+
+/**
+ * Split len interleaved stereo frames of 16 bit samples.
+ */
+static void unzip16_sse2(int16_t *out0, int16_t *out1, const int16_t *in, int len)
+{
+    x86_reg i = -(x86_reg)len;
+
+    __asm__ volatile(
+        "1:                                 \n\t"
+        "movdqu      (%3,%0,4), %%xmm0      \n\t"
+        "movdqu    16(%3,%0,4), %%xmm1      \n\t"
+        "movdqa        %%xmm0, %%xmm2       \n\t"
+        "movdqa        %%xmm1, %%xmm3       \n\t"
+        "pslld            $16, %%xmm0       \n\t"
+        "pslld            $16, %%xmm1       \n\t"
+        "psrad            $16, %%xmm0       \n\t"
+        "psrad            $16, %%xmm1       \n\t"
+        "psrad            $16, %%xmm2       \n\t"
+        "psrad            $16, %%xmm3       \n\t"
+        "packssdw      %%xmm1, %%xmm0       \n\t"
+        "packssdw      %%xmm3, %%xmm2       \n\t"
+        "movdqu        %%xmm0, (%1,%0,2)    \n\t"
+        "movdqu        %%xmm2, (%2,%0,2)    \n\t"
+        "add                $8, %0          \n\t"
+        " js               1b               \n\t"
+        : "+&r"(i)
+        : "r"(out0 + len), "r"(out1 + len), "r"(in + 2 * len)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+
+/**
+ * Interleave len frames of two channels of 16 bit samples.
+ */
+static void zip16_sse2(int16_t *out, const int16_t *in0, const int16_t *in1, int len)
+{
+    x86_reg i = -(x86_reg)len;
+
+    __asm__ volatile(
+        "1:                                 \n\t"
+        "movdqu      (%2,%0,2), %%xmm0      \n\t"
+        "movdqu      (%3,%0,2), %%xmm1      \n\t"
+        "movdqa        %%xmm0, %%xmm2       \n\t"
+        "punpcklwd     %%xmm1, %%xmm0       \n\t"
+        "punpckhwd     %%xmm1, %%xmm2       \n\t"
+        "movdqu        %%xmm0,   (%1,%0,4)  \n\t"
+        "movdqu        %%xmm2, 16(%1,%0,4)  \n\t"
+        "add                $8, %0          \n\t"
+        " js               1b               \n\t"
+        : "+&r"(i)
+        : "r"(out + 2 * len), "r"(in0 + len), "r"(in1 + len)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+    );
+}
+
+/**
+ * Split len interleaved stereo frames of 32 bit samples.
+ */
+static void unzip32_sse2(int32_t *out0, int32_t *out1, const int32_t *in, int len)
+{
+    x86_reg i = -(x86_reg)len;
+
+    __asm__ volatile(
+        "1:                                 \n\t"
+        "movups      (%3,%0,8), %%xmm0      \n\t"
+        "movups    16(%3,%0,8), %%xmm1      \n\t"
+        "movups    32(%3,%0,8), %%xmm2      \n\t"
+        "movups    48(%3,%0,8), %%xmm3      \n\t"
+        "movaps        %%xmm0, %%xmm4       \n\t"
+        "movaps        %%xmm2, %%xmm5       \n\t"
+        "shufps  $0x88, %%xmm1, %%xmm0      \n\t"
+        "shufps  $0x88, %%xmm3, %%xmm2      \n\t"
+        "shufps  $0xdd, %%xmm1, %%xmm4      \n\t"
+        "shufps  $0xdd, %%xmm3, %%xmm5      \n\t"
+        "movups        %%xmm0,   (%1,%0,4)  \n\t"
+        "movups        %%xmm2, 16(%1,%0,4)  \n\t"
+        "movups        %%xmm4,   (%2,%0,4)  \n\t"
+        "movups        %%xmm5, 16(%2,%0,4)  \n\t"
+        "add                $8, %0          \n\t"
+        " js               1b               \n\t"
+        : "+&r"(i)
+        : "r"(out0 + len), "r"(out1 + len), "r"(in + 2 * len)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+          "memory"
+    );
+}
+
+/**
+ * Interleave len frames of two channels of 32 bit samples.
+ */
+static void zip32_sse2(int32_t *out, const int32_t *in0, const int32_t *in1, int len)
+{
+    x86_reg i = -(x86_reg)len;
+
+    __asm__ volatile(
+        "1:                                 \n\t"
+        "movups      (%2,%0,4), %%xmm0      \n\t"
+        "movups    16(%2,%0,4), %%xmm2      \n\t"
+        "movups      (%3,%0,4), %%xmm4      \n\t"
+        "movups    16(%3,%0,4), %%xmm5      \n\t"
+        "movaps        %%xmm0, %%xmm1       \n\t"
+        "movaps        %%xmm2, %%xmm3       \n\t"
+        "unpcklps      %%xmm4, %%xmm0       \n\t"
+        "unpckhps      %%xmm4, %%xmm1       \n\t"
+        "unpcklps      %%xmm5, %%xmm2       \n\t"
+        "unpckhps      %%xmm5, %%xmm3       \n\t"
+        "movups        %%xmm0,   (%1,%0,8)  \n\t"
+        "movups        %%xmm1, 16(%1,%0,8)  \n\t"
+        "movups        %%xmm2, 32(%1,%0,8)  \n\t"
+        "movups        %%xmm3, 48(%1,%0,8)  \n\t"
+        "add                $8, %0          \n\t"
+        " js               1b               \n\t"
+        : "+&r"(i)
+        : "r"(out + 2 * len), "r"(in0 + len), "r"(in1 + len)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+          "memory"
+    );
+}
+
+void ff_audio_convert_init_x86(AudioConvertDSPContext *c, int flags)
+{
+    if (flags & AV_CPU_FLAG_SSE2) {
+#define CONV_FUNC(ofmt, ifmt, func) \
+        c->conv[AV_SAMPLE_FMT_ ## ofmt][AV_SAMPLE_FMT_ ## ifmt] = conv_ ## func ## _sse2;
+        CONV_FUNC(S32, S16, s16_to_s32)
+        CONV_FUNC(FLT, S16, s16_to_flt)
+        CONV_FUNC(DBL, S16, s16_to_dbl)
+        CONV_FUNC(S16, S32, s32_to_s16)
+        CONV_FUNC(FLT, S32, s32_to_flt)
+        CONV_FUNC(DBL, S32, s32_to_dbl)
+        CONV_FUNC(S16, FLT, flt_to_s16)
+        CONV_FUNC(S32, FLT, flt_to_s32)
+        CONV_FUNC(DBL, FLT, flt_to_dbl)
+        CONV_FUNC(S16, DBL, dbl_to_s16)
+        CONV_FUNC(S32, DBL, dbl_to_s32)
+        CONV_FUNC(FLT, DBL, dbl_to_flt)
+        c->unzip16 = unzip16_sse2;
+        c->unzip32 = unzip32_sse2;
+        c->zip16   = zip16_sse2;
+        c->zip32   = zip32_sse2;
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * H.26L/H.264/AVC/JVT/14496-10/... encoder/decoder
+ * Copyright (c) 2003 Michael Niedermayer <michaelni@gmx.at>
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * x86-64 optimized CABAC decoding engine.
+ *
+ * Unlike the 32-bit version in cabac.h this does not need absolute
+ * relocations, so it also works in PIC builds. The decoder state (low,
+ * range and the bytestream pointer) and the table addresses are passed in
+ * registers chosen by the compiler, which allows it to keep the whole state
+ * in registers across consecutive calls.
+ */
+
+#ifndef AVCODEC_X86_CABAC_H
+#define AVCODEC_X86_CABAC_H
+
+#include "libavcodec/cabac.h"
+#include "libavutil/attributes.h"
+#include "libavutil/x86_cpu.h"
+#include "config.h"
+
+#if ARCH_X86_64 && HAVE_INLINE_ASM
+
+#define BRANCHLESS_GET_CABAC_UPDATE_X86_64(ret, retq, low, range, tmp)\
+        "mov    "tmp"       , %%ecx                                     \n\t"\
+        "shl    $17         , "tmp"                                     \n\t"\
+        "cmp    "low"       , "tmp"                                     \n\t"\
+        "cmova  %%ecx       , "range"                                   \n\t"\
+        "sbb    %%rcx       , %%rcx                                     \n\t"\
+        "and    %%ecx       , "tmp"                                     \n\t"\
+        "sub    "tmp"       , "low"                                     \n\t"\
+        "xor    %%rcx       , "retq"                                    \n\t"
+
+/**
+ * Decode one bin.
+ * ret/range/tmp are 32-bit registers, retq/rangeq the 64-bit names of the
+ * same registers, tmpbyte the low byte of tmp; statep is the address of the
+ * context state, byte the register holding the bytestream pointer and
+ * lps_tab, norm_tab, mlps_tab the registers holding ff_h264_lps_range,
+ * ff_h264_norm_shift and ff_h264_mlps_state. %rcx is clobbered.
+ * The decoded bit is left in bit 0 of ret.
+ */
+#define BRANCHLESS_GET_CABAC_X86_64(ret, retq, statep, low, lowword, range, rangeq,\
+                                    tmp, tmpbyte, byte, lps_tab, norm_tab, mlps_tab)\
+        "movzbl "statep"    , "ret"                                     \n\t"\
+        "mov    "range"     , "tmp"                                     \n\t"\
+        "and    $0xC0       , "range"                                   \n\t"\
+        "lea    ("retq", "rangeq", 2), %%rcx                            \n\t"\
+        "movzbl ("lps_tab", %%rcx), "range"                             \n\t"\
+        "sub    "range"     , "tmp"                                     \n\t"\
+        BRANCHLESS_GET_CABAC_UPDATE_X86_64(ret, retq, low, range, tmp)  \
+        "movzbl ("norm_tab", "rangeq"), %%ecx                           \n\t"\
+        "shl    %%cl        , "range"                                   \n\t"\
+        "movzbl 128("mlps_tab", "retq"), "tmp"                          \n\t"\
+        "shl    %%cl        , "low"                                     \n\t"\
+        "mov    "tmpbyte"   , "statep"                                  \n\t"\
+        "test   "lowword"   , "lowword"                                 \n\t"\
+        " jnz   1f                                                      \n\t"\
+        "movzwl ("byte")    , "tmp"                                     \n\t"\
+        "add    $2          , "byte"                                    \n\t"\
+        "lea    -1("low")   , %%ecx                                     \n\t"\
+        "xor    "low"       , %%ecx                                     \n\t"\
+        "shr    $15         , %%ecx                                     \n\t"\
+        "bswap  "tmp"                                                   \n\t"\
+        "shr    $15         , "tmp"                                     \n\t"\
+        "movzbl ("norm_tab", %%rcx), %%ecx                              \n\t"\
+        "sub    $0xFFFF     , "tmp"                                     \n\t"\
+        "neg    %%ecx                                                   \n\t"\
+        "add    $7          , %%ecx                                     \n\t"\
+        "shl    %%cl        , "tmp"                                     \n\t"\
+        "add    "tmp"       , "low"                                     \n\t"\
+        "1:                                                             \n\t"
+
+#define get_cabac_inline get_cabac_inline_x86
+static av_always_inline int get_cabac_inline_x86(CABACContext *c,
+                                                 uint8_t * const state)
+{
+    int bit, tmp;
+
+    __asm__ volatile(
+        BRANCHLESS_GET_CABAC_X86_64("%0", "%q0", "%4", "%1", "%w1",
+                                    "%2", "%q2", "%3", "%b3",
+                                    "%5", "%6", "%7", "%8")
+        : "=&r"(bit), "+&r"(c->low), "+&r"(c->range), "=&r"(tmp),
+          "+m"(*state), "+&r"(c->bytestream)
+        : "r"(ff_h264_lps_range), "r"(ff_h264_norm_shift),
+          "r"(ff_h264_mlps_state)
+        : "%rcx"
+    );
+    return bit & 1;
+}
+
+/* The bypass bins are decoded before the refill, which gives the same
+ * result because the low 16 bits of low cannot change the comparison
+ * with range << 17. */
+#define get_cabac_bypass get_cabac_bypass_x86
+static av_always_inline int get_cabac_bypass_x86(CABACContext *c)
+{
+    x86_reg tmp;
+    int bit;
+
+    __asm__ volatile(
+        "mov        %4, %k1         \n\t"
+        "shl       $17, %k1         \n\t"
+        "add    %%eax, %%eax        \n\t"
+        "sub      %k1, %%eax        \n\t"
+        "cltd                       \n\t"
+        "and   %%edx, %k1           \n\t"
+        "add      %k1, %%eax        \n\t"
+        "lea  1(%%rdx), %0          \n\t"
+        "test   %%ax, %%ax          \n\t"
+        " jnz       1f              \n\t"
+        "movzwl   (%2), %%edx       \n\t"
+        "bswap  %%edx               \n\t"
+        "shr       $15, %%edx       \n\t"
+        "add        $2, %2          \n\t"
+        "sub   $0xFFFF, %%eax       \n\t"
+        "add    %%edx, %%eax        \n\t"
+        "1:                         \n\t"
+        : "=&r"(bit), "=&r"(tmp), "+&r"(c->bytestream), "+a"(c->low)
+        : "rm"(c->range)
+        : "%rdx"
+    );
+    return bit;
+}
+
+#define get_cabac_bypass_sign get_cabac_bypass_sign_x86
+static av_always_inline int get_cabac_bypass_sign_x86(CABACContext *c, int val)
+{
+    x86_reg tmp;
+
+    __asm__ volatile(
+        "mov        %4, %k1         \n\t"
+        "shl       $17, %k1         \n\t"
+        "add    %%eax, %%eax        \n\t"
+        "sub      %k1, %%eax        \n\t"
+        "cltd                       \n\t"
+        "and   %%edx, %k1           \n\t"
+        "add      %k1, %%eax        \n\t"
+        "xor    %%edx, %0           \n\t"
+        "sub    %%edx, %0           \n\t"
+        "test   %%ax, %%ax          \n\t"
+        " jnz       1f              \n\t"
+        "movzwl   (%2), %%edx       \n\t"
+        "bswap  %%edx               \n\t"
+        "shr       $15, %%edx       \n\t"
+        "add        $2, %2          \n\t"
+        "sub   $0xFFFF, %%eax       \n\t"
+        "add    %%edx, %%eax        \n\t"
+        "1:                         \n\t"
+        : "+&r"(val), "=&r"(tmp), "+&r"(c->bytestream), "+a"(c->low)
+        : "rm"(c->range)
+        : "%rdx"
+    );
+    return val;
+}
+
+#endif /* ARCH_X86_64 && HAVE_INLINE_ASM */
+#endif /* AVCODEC_X86_CABAC_H */
@@ -2742,6 +2742,11 @@ void dsputil_init_mmx(DSPContext* c, AVCodecContext *avctx)
         }
         if(mm_flags & AV_CPU_FLAG_SSE2){
             if (!h264_high_depth) {
+#if HAVE_YASM
+            H264_QPEL_FUNCS(1, 0, sse2);
+            H264_QPEL_FUNCS(2, 0, sse2);
+            H264_QPEL_FUNCS(3, 0, sse2);
+#endif
             H264_QPEL_FUNCS(0, 1, sse2);
             H264_QPEL_FUNCS(0, 2, sse2);
             H264_QPEL_FUNCS(0, 3, sse2);
@@ -2756,6 +2761,28 @@ void dsputil_init_mmx(DSPContext* c, AVCodecContext *avctx)
             H264_QPEL_FUNCS(3, 3, sse2);
             }
         }
+#if HAVE_YASM && HAVE_AVX
+        /* before SSSE3, which keeps its h and hv filters */
+        if (mm_flags & AV_CPU_FLAG_AVX) {
+            if (!h264_high_depth) {
+            H264_QPEL_FUNCS(0, 1, avx);
+            H264_QPEL_FUNCS(0, 2, avx);
+            H264_QPEL_FUNCS(0, 3, avx);
+            H264_QPEL_FUNCS(1, 0, avx);
+            H264_QPEL_FUNCS(1, 1, avx);
+            H264_QPEL_FUNCS(1, 2, avx);
+            H264_QPEL_FUNCS(1, 3, avx);
+            H264_QPEL_FUNCS(2, 0, avx);
+            H264_QPEL_FUNCS(2, 1, avx);
+            H264_QPEL_FUNCS(2, 2, avx);
+            H264_QPEL_FUNCS(2, 3, avx);
+            H264_QPEL_FUNCS(3, 0, avx);
+            H264_QPEL_FUNCS(3, 1, avx);
+            H264_QPEL_FUNCS(3, 2, avx);
+            H264_QPEL_FUNCS(3, 3, avx);
+            }
+        }
+#endif
 #if HAVE_SSSE3
         if(mm_flags & AV_CPU_FLAG_SSSE3){
             if (!h264_high_depth) {
@@ -0,0 +1,109 @@
+/*
+ * AVX FFT pass
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_X86_FFT_FLOAT_H
+#define AVCODEC_X86_FFT_FLOAT_H
+
+#include <stdint.h>
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/fft.h"
+#include "config.h"
+
+/* the AVX state needs OS support, so the caller checks fft_pass_simd_flags */
+#if ARCH_X86_64 && HAVE_INLINE_ASM && HAVE_AVX
+
+#define fft_pass_simd       fft_pass_avx
+#define fft_pass_simd_flags AV_CPU_FLAG_AVX
+
+/* duplicate each of 4 twiddles into a re/im pair, in order and reversed */
+static const int32_t fft_avx_dup[8]     = { 0, 0, 1, 1, 2, 2, 3, 3 };
+static const int32_t fft_avx_dup_rev[8] = { 3, 3, 2, 2, 1, 1, 0, 0 };
+
+#define FFT_AVX_LOAD_W                                  \
+    "vbroadcastf128    (%1), %%ymm6            \n\t"    \
+    "vbroadcastf128 -12(%2), %%ymm7            \n\t"    \
+    "vpermilps          %5, %%ymm6, %%ymm6     \n\t"    \
+    "vpermilps          %6, %%ymm7, %%ymm7     \n\t"
+
+/**
+ * One split-radix pass over 4 butterflies per iteration, with the same
+ * arithmetic as the C TRANSFORM() macros.
+ * z[0...8n-1], w[1...2n-1], n a multiple of 2
+ */
+static void fft_pass_avx(FFTComplex *z, const FFTSample *wre, unsigned int n)
+{
+    const FFTSample *wim = wre + 2 * n;
+    x86_reg o1 = 16 * (x86_reg)n;
+    x86_reg i  = n >> 1;
+
+    __asm__ volatile(
+        "vpcmpeqd     %%xmm13, %%xmm13, %%xmm13 \n\t"
+        "vpsllq          $63, %%xmm13, %%xmm13  \n\t"
+        "vinsertf128      $1, %%xmm13, %%ymm13, %%ymm13 \n\t"
+        FFT_AVX_LOAD_W
+        /* the first butterfly is TRANSFORM_ZERO(), w = 1 */
+        "vxorps        %%ymm0, %%ymm0, %%ymm0   \n\t"
+        "vblendps         $3, %%ymm0, %%ymm7, %%ymm7 \n\t"
+        "jmp               2f                   \n\t"
+        "1:                                     \n\t"
+        FFT_AVX_LOAD_W
+        "2:                                     \n\t"
+        "vmovups  (%0,%4,2), %%ymm2             \n\t"
+        "vmovups    (%0,%7), %%ymm3             \n\t"
+        "vpermilps     $0xb1, %%ymm2, %%ymm0    \n\t"
+        "vpermilps     $0xb1, %%ymm3, %%ymm1    \n\t"
+        "vmulps        %%ymm6, %%ymm2, %%ymm2   \n\t"
+        "vmulps        %%ymm6, %%ymm3, %%ymm3   \n\t"
+        "vmulps        %%ymm7, %%ymm0, %%ymm0   \n\t"
+        "vmulps        %%ymm7, %%ymm1, %%ymm1   \n\t"
+        "vxorps       %%ymm13, %%ymm0, %%ymm0   \n\t"
+        "vaddps        %%ymm0, %%ymm2, %%ymm2   \n\t" /* t1, t2 */
+        "vaddsubps     %%ymm1, %%ymm3, %%ymm3   \n\t" /* t5, t6 */
+        "vaddps        %%ymm2, %%ymm3, %%ymm0   \n\t" /* t5 + t1, t6 + t2 */
+        "vxorps       %%ymm13, %%ymm2, %%ymm2   \n\t"
+        "vxorps       %%ymm13, %%ymm3, %%ymm3   \n\t"
+        "vsubps        %%ymm2, %%ymm3, %%ymm1   \n\t" /* t3, t4 */
+        "vpermilps     $0xb1, %%ymm1, %%ymm1    \n\t"
+        "vmovups        (%0), %%ymm2            \n\t"
+        "vmovups    (%0,%4), %%ymm3             \n\t"
+        "vsubps        %%ymm0, %%ymm2, %%ymm4   \n\t"
+        "vaddps        %%ymm0, %%ymm2, %%ymm2   \n\t"
+        "vsubps        %%ymm1, %%ymm3, %%ymm5   \n\t"
+        "vaddps        %%ymm1, %%ymm3, %%ymm3   \n\t"
+        "vmovups       %%ymm2, (%0)             \n\t"
+        "vmovups       %%ymm3, (%0,%4)          \n\t"
+        "vmovups       %%ymm4, (%0,%4,2)        \n\t"
+        "vmovups       %%ymm5, (%0,%7)          \n\t"
+        "add              $32, %0               \n\t"
+        "add              $16, %1               \n\t"
+        "sub              $16, %2               \n\t"
+        "sub               $1, %3               \n\t"
+        " jg               1b                   \n\t"
+        "vzeroupper                             \n\t"
+        : "+r"(z), "+r"(wre), "+r"(wim), "+r"(i)
+        : "r"(o1), "m"(*fft_avx_dup), "m"(*fft_avx_dup_rev), "r"(3 * o1)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",
+                       "%xmm6", "%xmm7", "%xmm13",) "memory"
+    );
+}
+
+#endif /* ARCH_X86_64 && HAVE_INLINE_ASM && HAVE_AVX */
+#endif /* AVCODEC_X86_FFT_FLOAT_H */
@@ -0,0 +1,74 @@
+/*
+ * SSE2 FLAC encoder Rice cost
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/flac.h"
+
+/* sums 8 values per iteration, the remaining ones in C */
+static uint32_t rice_sum_sse2(const int32_t *res, int n, int k)
+{
+    int m = n & ~7;
+    x86_reg i = -4 * (x86_reg)m;
+    uint32_t sum = 0;
+
+    if (m)
+    __asm__ volatile(
+        "movd             %3, %%xmm6    \n\t"
+        "pxor         %%xmm7, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movdqu     (%2,%0), %%xmm0     \n\t"
+        "movdqu   16(%2,%0), %%xmm1     \n\t"
+        "movdqa       %%xmm0, %%xmm2    \n\t"
+        "movdqa       %%xmm1, %%xmm3    \n\t"
+        "paddd        %%xmm0, %%xmm0    \n\t"
+        "paddd        %%xmm1, %%xmm1    \n\t"
+        "psrad           $31, %%xmm2    \n\t"
+        "psrad           $31, %%xmm3    \n\t"
+        "pxor         %%xmm2, %%xmm0    \n\t"
+        "pxor         %%xmm3, %%xmm1    \n\t"
+        "psrld        %%xmm6, %%xmm0    \n\t"
+        "psrld        %%xmm6, %%xmm1    \n\t"
+        "paddd        %%xmm0, %%xmm7    \n\t"
+        "paddd        %%xmm1, %%xmm7    \n\t"
+        "add             $32, %0        \n\t"
+        " js              1b            \n\t"
+        "pshufd  $0x0E, %%xmm7, %%xmm0  \n\t"
+        "paddd        %%xmm0, %%xmm7    \n\t"
+        "pshufd  $0x01, %%xmm7, %%xmm0  \n\t"
+        "paddd        %%xmm0, %%xmm7    \n\t"
+        "movd         %%xmm7, %1        \n\t"
+        : "+&r"(i), "=r"(sum)
+        : "r"(res + m), "r"(k)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm6", "%xmm7",)
+          "memory"
+    );
+    for (; m < n; m++)
+        sum += (uint32_t)((2 * res[m]) ^ (res[m] >> 31)) >> k;
+    return sum;
+}
+
+void ff_flacenc_dsp_init_x86(FLACEncDSPContext *c)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE2)
+        c->rice_sum = rice_sum_sse2;
+}
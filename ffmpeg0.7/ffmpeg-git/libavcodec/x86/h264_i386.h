@@ -31,9 +31,129 @@
 
 #include "libavcodec/cabac.h"
 
+#if ARCH_X86_64 && HAVE_INLINE_ASM
+/* The CABAC state stays in the registers chosen by get_cabac_inline_x86()
+ * for the whole block; last_off is the distance between the significance
+ * and the last significant coefficient contexts. */
+#define decode_significance decode_significance_x86
+static av_always_inline int decode_significance_x86(CABACContext *c, int max_coeff,
+                                                    uint8_t *significant_coeff_ctx_base,
+                                                    int *index, x86_reg last_off)
+{
+    uint8_t *end = significant_coeff_ctx_base + max_coeff - 1;
+    uint8_t *state = significant_coeff_ctx_base;
+    int *idx = index;
+    int bit, tmp;
+
+    __asm__ volatile(
+        "2:                                     \n\t"
+
+        BRANCHLESS_GET_CABAC_X86_64("%0", "%q0", "(%5)", "%1", "%w1",
+                                    "%2", "%q2", "%3", "%b3",
+                                    "%4", "%10", "%11", "%12")
+
+        "test $1, %0                            \n\t"
+        " jz 3f                                 \n\t"
+        "add  %8, %5                            \n\t"
+
+        BRANCHLESS_GET_CABAC_X86_64("%0", "%q0", "(%5)", "%1", "%w1",
+                                    "%2", "%q2", "%3", "%b3",
+                                    "%4", "%10", "%11", "%12")
+
+        "sub  %8, %5                            \n\t"
+        "mov  %5, %%rcx                         \n\t"
+        "sub  %9, %%rcx                         \n\t"
+        "movl %%ecx, (%6)                       \n\t"
+        "add  $4, %6                            \n\t"
+
+        "test $1, %0                            \n\t"
+        " jnz 4f                                \n\t"
+
+        "3:                                     \n\t"
+        "add  $1, %5                            \n\t"
+        "cmp  %7, %5                            \n\t"
+        " jb 2b                                 \n\t"
+        "mov  %5, %%rcx                         \n\t"
+        "sub  %9, %%rcx                         \n\t"
+        "movl %%ecx, (%6)                       \n\t"
+        "add  $4, %6                            \n\t"
+        "4:                                     \n\t"
+        : "=&r"(bit), "+&r"(c->low), "+&r"(c->range), "=&r"(tmp),
+          "+&r"(c->bytestream), "+&r"(state), "+&r"(idx)
+        : "rm"(end), "rm"(last_off), "rm"(significant_coeff_ctx_base),
+          "r"(ff_h264_lps_range), "r"(ff_h264_norm_shift),
+          "r"(ff_h264_mlps_state)
+        : "%rcx", "memory"
+    );
+    return idx - index;
+}
+
+#define decode_significance_8x8(c, sig, index, last, sig_off) \
+    decode_significance_8x8_x86(c, sig, index, last, sig_off, last_coeff_flag_offset_8x8)
+static av_always_inline int decode_significance_8x8_x86(CABACContext *c,
+                                                        uint8_t *significant_coeff_ctx_base,
+                                                        int *index,
+                                                        uint8_t *last_coeff_ctx_base,
+                                                        const uint8_t *sig_off,
+                                                        const uint8_t *last_off)
+{
+    x86_reg last = 0, ctx;
+    int *idx = index;
+    int bit, tmp;
+
+    __asm__ volatile(
+        "2:                                     \n\t"
+
+        "mov    %9, %7                          \n\t"
+        "movzbl (%7, %5), %k7                   \n\t"
+        "add    %8, %7                          \n\t"
+
+        BRANCHLESS_GET_CABAC_X86_64("%0", "%q0", "(%7)", "%1", "%w1",
+                                    "%2", "%q2", "%3", "%b3",
+                                    "%4", "%12", "%13", "%14")
+
+        "test $1, %0                            \n\t"
+        " jz 3f                                 \n\t"
+
+        "mov    %11, %7                         \n\t"
+        "movzbl (%7, %5), %k7                   \n\t"
+        "add    %10, %7                         \n\t"
+
+        BRANCHLESS_GET_CABAC_X86_64("%0", "%q0", "(%7)", "%1", "%w1",
+                                    "%2", "%q2", "%3", "%b3",
+                                    "%4", "%12", "%13", "%14")
+
+        "movl %k5, (%6)                         \n\t"
+        "add  $4, %6                            \n\t"
+
+        "test $1, %0                            \n\t"
+        " jnz 4f                                \n\t"
+
+        "3:                                     \n\t"
+        "add  $1, %5                            \n\t"
+        "cmp  $63, %5                           \n\t"
+        " jb 2b                                 \n\t"
+        "movl %k5, (%6)                         \n\t"
+        "add  $4, %6                            \n\t"
+        "4:                                     \n\t"
+        : "=&r"(bit), "+&r"(c->low), "+&r"(c->range), "=&r"(tmp),
+          "+&r"(c->bytestream), "+&r"(last), "+&r"(idx), "=&r"(ctx)
+        : "rm"(significant_coeff_ctx_base), "rm"(sig_off),
+          "rm"(last_coeff_ctx_base), "rm"(last_off),
+          "r"(ff_h264_lps_range), "r"(ff_h264_norm_shift),
+          "r"(ff_h264_mlps_state)
+        : "%rcx", "memory"
+    );
+    return idx - index;
+}
+
+#elif ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
 //FIXME use some macros to avoid duplicating get_cabac (cannot be done yet
 //as that would make optimization work hard)
-#if ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
+#define decode_significance(c, max_coeff, sig, index, last_off) \
+    decode_significance_x86(c, max_coeff, sig, index)
+#define decode_significance_8x8(c, sig, index, last, sig_off) \
+    decode_significance_8x8_x86(c, sig, index, sig_off)
 static int decode_significance_x86(CABACContext *c, int max_coeff,
                                    uint8_t *significant_coeff_ctx_base,
                                    int *index){
@@ -147,7 +267,8 @@ static int decode_significance_8x8_x86(CABACContext *c,
     );
     return coeff_count;
 }
-#endif /* ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE */
+#endif /* ARCH_X86_64 && HAVE_INLINE_ASM */
+       /* ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE */
        /* !defined(BROKEN_RELOCATIONS) */
 
 #endif /* AVCODEC_X86_H264_I386_H */
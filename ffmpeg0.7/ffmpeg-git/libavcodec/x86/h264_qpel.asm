@@ -0,0 +1,353 @@
+;*****************************************************************************
+;* SSE2/AVX-optimized H.264 quarterpel motion compensation
+;*****************************************************************************
+;* Copyright (c) 2004-2005 Michael Niedermayer, Loren Merritt
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "x86inc.asm"
+
+SECTION .text
+
+cextern pw_5
+cextern pw_16
+
+; All functions below work on 8 pixel wide columns; the 16 pixel wide
+; versions of the lowpass filters are built from two columns in
+; h264_qpel_mmx.c. The intermediate int16_t buffer of the hv filter has a
+; fixed stride of 24 coefficients (48 bytes), as in the inline asm versions.
+
+%macro op_puth 3
+    movh        %1, %2
+%endmacro
+
+%macro op_avgh 3
+    movh        %3, %1
+    pavgb       %2, %3
+    movh        %1, %2
+%endmacro
+
+%macro op_put 3
+    movu        %1, %2
+%endmacro
+
+%macro op_avg 3
+    movu        %3, %1
+    pavgb       %2, %3
+    movu        %1, %2
+%endmacro
+
+; 6-tap filter of the bytes at %1-2 .. %1+10, result in m0 as words before
+; the final shift; m7 must be zero
+%macro FILT_H 1
+    movh        m0, [%1-2]
+    movh        m1, [%1-1]
+    movh        m2, [%1  ]
+    movh        m3, [%1+1]
+    movh        m4, [%1+2]
+    movh        m5, [%1+3]
+    punpcklbw   m2, m7
+    punpcklbw   m3, m7
+    punpcklbw   m1, m7
+    punpcklbw   m4, m7
+    punpcklbw   m0, m7
+    punpcklbw   m5, m7
+    paddw       m2, m3          ; c+d
+    paddw       m1, m4          ; b+e
+    paddw       m0, m5          ; a+f
+    psllw       m2, 2
+    psubw       m2, m1
+    pmullw      m2, [pw_5]
+    paddw       m0, [pw_16]
+    paddw       m0, m2
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void h264_qpel8_h_lowpass(uint8_t *dst, uint8_t *src, int dstStride,
+;                           int srcStride, int h)
+;-----------------------------------------------------------------------------
+%macro QPEL8_H_LOWPASS 2
+cglobal %1_h264_qpel8_h_lowpass_%2, 5,5,8
+    movsxdifnidn r2, r2d
+    movsxdifnidn r3, r3d
+    pxor        m7, m7
+.loop:
+    FILT_H      r1
+    psraw       m0, 5
+    packuswb    m0, m0
+    op_%1h    [r0], m0, m1
+    add         r0, r2
+    add         r1, r3
+    dec         r4d
+    jg .loop
+    REP_RET
+
+;-----------------------------------------------------------------------------
+; void h264_qpel8_h_lowpass_l2(uint8_t *dst, uint8_t *src, uint8_t *src2,
+;                              int dstStride, int src2Stride, int h)
+; src has the same stride as dst
+;-----------------------------------------------------------------------------
+cglobal %1_h264_qpel8_h_lowpass_l2_%2, 6,6,8
+    movsxdifnidn r3, r3d
+    movsxdifnidn r4, r4d
+    pxor        m7, m7
+.loop:
+    FILT_H      r1
+    movh        m1, [r2]
+    psraw       m0, 5
+    packuswb    m0, m0
+    pavgb       m0, m1
+    op_%1h    [r0], m0, m1
+    add         r0, r3
+    add         r1, r3
+    add         r2, r4
+    dec         r5d
+    jg .loop
+    REP_RET
+%endmacro
+
+; m0..m4 hold rows a..e as words, row f is loaded from [r1]; the
+; unshifted result is left in m6 and the rows are rotated for the next call
+%macro FILT_V 0
+    movh        m5, [r1]
+    paddw       m6, m2, m3      ; c+d
+    punpcklbw   m5, m7
+    psllw       m6, 2
+    psubw       m6, m1
+    psubw       m6, m4
+    pmullw      m6, [pw_5]
+    paddw       m0, [pw_16]
+    add         r1, r3
+    paddw       m0, m5          ; a+f+16
+    paddw       m6, m0
+%endmacro
+
+%macro LOAD_V 0
+    pxor        m7, m7
+    movh        m0, [r1]
+    movh        m1, [r1+r3]
+    lea         r1, [r1+2*r3]
+    movh        m2, [r1]
+    movh        m3, [r1+r3]
+    lea         r1, [r1+2*r3]
+    movh        m4, [r1]
+    add         r1, r3
+    punpcklbw   m0, m7
+    punpcklbw   m1, m7
+    punpcklbw   m2, m7
+    punpcklbw   m3, m7
+    punpcklbw   m4, m7
+%endmacro
+
+%macro V_ROW 1
+    FILT_V
+    psraw       m6, 5
+    packuswb    m6, m6
+    op_%1h    [r0], m6, m0
+    add         r0, r2
+    SWAP 0, 1, 2, 3, 4, 5
+%endmacro
+
+%macro HV1_ROW 0
+    FILT_V
+    mova      [r0], m6
+    add         r0, 48
+    SWAP 0, 1, 2, 3, 4, 5
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void h264_qpel8_v_lowpass(uint8_t *dst, uint8_t *src, int dstStride,
+;                           int srcStride, int h)
+; h is 8 or 16
+;-----------------------------------------------------------------------------
+%macro QPEL8_V_LOWPASS 2
+cglobal %1_h264_qpel8_v_lowpass_%2, 5,5,8
+    movsxdifnidn r2, r2d
+    movsxdifnidn r3, r3d
+    sub         r1, r3
+    sub         r1, r3
+    LOAD_V
+%rep 8
+    V_ROW       %1
+%endrep
+    cmp         r4d, 16
+    jne .end
+%rep 8
+    V_ROW       %1
+%endrep
+.end:
+    REP_RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void h264_qpel8_hv1_lowpass(int16_t *tmp, uint8_t *src, int srcStride, int h)
+; vertical pass of one 8 pixel wide column, src points 2 rows above the block
+; h is 8 or 16
+;-----------------------------------------------------------------------------
+%macro QPEL8_HV1_LOWPASS 1
+cglobal put_h264_qpel8_hv1_lowpass_%1, 4,4,8
+    movsxdifnidn r2, r2d
+    xchg        r2, r3          ; FILT_V expects the source stride in r3
+    LOAD_V
+%rep 8
+    HV1_ROW
+%endrep
+    cmp         r2d, 16
+    jne .end
+%rep 8
+    HV1_ROW
+%endrep
+.end:
+    REP_RET
+%endmacro
+
+; horizontal pass over 8 words of the tmp row at %1, result in m0 as
+; unclipped words
+%macro FILT_HV2 1
+    movu        m0, [%1   ]
+    movu        m3, [%1+10]
+    movu        m1, [%1+ 2]
+    movu        m4, [%1+ 8]
+    movu        m2, [%1+ 4]
+    movu        m5, [%1+ 6]
+    paddw       m0, m3          ; a+f
+    paddw       m1, m4          ; b+e
+    paddw       m2, m5          ; c+d
+    psubw       m0, m1
+    psraw       m0, 2
+    psubw       m0, m1
+    paddsw      m0, m2
+    psraw       m0, 2
+    paddw       m0, m2
+    psraw       m0, 6
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void h264_qpel8_hv2_lowpass(uint8_t *dst, int16_t *tmp, int dstStride, int h)
+; void h264_qpel16_hv2_lowpass(uint8_t *dst, int16_t *tmp, int dstStride, int h)
+;-----------------------------------------------------------------------------
+%macro QPEL_HV2_LOWPASS 2
+cglobal %1_h264_qpel8_hv2_lowpass_%2, 4,4,8
+    movsxdifnidn r2, r2d
+.loop:
+    FILT_HV2    r1
+    packuswb    m0, m0
+    op_%1h    [r0], m0, m1
+    add         r1, 48
+    add         r0, r2
+    dec         r3d
+    jg .loop
+    REP_RET
+
+cglobal %1_h264_qpel16_hv2_lowpass_%2, 4,4,8
+    movsxdifnidn r2, r2d
+.loop:
+    FILT_HV2    r1
+    mova        m6, m0
+    FILT_HV2    r1+16
+    packuswb    m6, m0
+    op_%1     [r0], m6, m1
+    add         r1, 48
+    add         r0, r2
+    dec         r3d
+    jg .loop
+    REP_RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void pixels8_l2_shift5(uint8_t *dst, int16_t *src16, uint8_t *src8,
+;                        int dstStride, int src8Stride, int h)
+; void pixels16_l2_shift5(...)
+; src16 has a stride of 24 coefficients
+;-----------------------------------------------------------------------------
+%macro PIXELS_L2_SHIFT5 2
+cglobal %1_pixels8_l2_shift5_%2, 6,6,2
+    movsxdifnidn r3, r3d
+    movsxdifnidn r4, r4d
+.loop:
+    movu        m0, [r1]
+    movh        m1, [r2]
+    psraw       m0, 5
+    packuswb    m0, m0
+    pavgb       m0, m1
+    op_%1h    [r0], m0, m1
+    add         r1, 48
+    add         r2, r4
+    add         r0, r3
+    dec         r5d
+    jg .loop
+    REP_RET
+
+cglobal %1_pixels16_l2_shift5_%2, 6,6,2
+    movsxdifnidn r3, r3d
+    movsxdifnidn r4, r4d
+.loop:
+    movu        m0, [r1]
+    movu        m1, [r1+16]
+    psraw       m0, 5
+    psraw       m1, 5
+    packuswb    m0, m1
+    movu        m1, [r2]
+    pavgb       m0, m1
+    op_%1     [r0], m0, m1
+    add         r1, 48
+    add         r2, r4
+    add         r0, r3
+    dec         r5d
+    jg .loop
+    REP_RET
+
+;-----------------------------------------------------------------------------
+; void pixels16_l2(uint8_t *dst, uint8_t *src1, uint8_t *src2,
+;                  int dstStride, int src1Stride, int h)
+; src2 has a stride of 16
+;-----------------------------------------------------------------------------
+cglobal %1_pixels16_l2_%2, 6,6,2
+    movsxdifnidn r3, r3d
+    movsxdifnidn r4, r4d
+.loop:
+    movu        m0, [r1]
+    movu        m1, [r2]
+    pavgb       m0, m1
+    op_%1     [r0], m0, m1
+    add         r1, r4
+    add         r2, 16
+    add         r0, r3
+    dec         r5d
+    jg .loop
+    REP_RET
+%endmacro
+
+%macro QPEL_FUNCS 1
+QPEL8_H_LOWPASS   put, %1
+QPEL8_H_LOWPASS   avg, %1
+QPEL8_V_LOWPASS   put, %1
+QPEL8_V_LOWPASS   avg, %1
+QPEL8_HV1_LOWPASS      %1
+QPEL_HV2_LOWPASS  put, %1
+QPEL_HV2_LOWPASS  avg, %1
+PIXELS_L2_SHIFT5  put, %1
+PIXELS_L2_SHIFT5  avg, %1
+%endmacro
+
+INIT_XMM
+QPEL_FUNCS sse2
+%ifdef HAVE_AVX
+INIT_AVX
+QPEL_FUNCS avx
+%endif
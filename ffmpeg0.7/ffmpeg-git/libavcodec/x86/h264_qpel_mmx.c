@@ -837,6 +837,7 @@ static av_noinline void OPNAME ## h264_qpel16_v_lowpass_ ## MMX(uint8_t *dst, ui
     OPNAME ## h264_qpel8or16_v_lowpass_ ## MMX(dst+8, src+8, dstStride, srcStride, 16);\
 }
 
+#if !HAVE_YASM
 static av_always_inline void put_h264_qpel8or16_hv1_lowpass_sse2(int16_t *tmp, uint8_t *src, int tmpStride, int srcStride, int size){
     int w = (size+8)>>3;
     src -= 2*srcStride+2;
@@ -887,6 +888,7 @@ static av_always_inline void put_h264_qpel8or16_hv1_lowpass_sse2(int16_t *tmp, u
         src += 8 - (size+5)*srcStride;
     }
 }
+#endif
 
 #define QPEL_H264_HV2_XMM(OPNAME, OP, MMX)\
 static av_always_inline void OPNAME ## h264_qpel8or16_hv2_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp, int dstStride, int tmpStride, int size){\
@@ -1001,26 +1003,32 @@ static void OPNAME ## h264_qpel16_hv_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp,
 
 #define put_pixels8_l2_sse2 put_pixels8_l2_mmx2
 #define avg_pixels8_l2_sse2 avg_pixels8_l2_mmx2
+#if !HAVE_YASM
 #define put_pixels16_l2_sse2 put_pixels16_l2_mmx2
 #define avg_pixels16_l2_sse2 avg_pixels16_l2_mmx2
+#endif
 #define put_pixels8_l2_ssse3 put_pixels8_l2_mmx2
 #define avg_pixels8_l2_ssse3 avg_pixels8_l2_mmx2
 #define put_pixels16_l2_ssse3 put_pixels16_l2_mmx2
 #define avg_pixels16_l2_ssse3 avg_pixels16_l2_mmx2
 
+#if !HAVE_YASM
 #define put_pixels8_l2_shift5_sse2 put_pixels8_l2_shift5_mmx2
 #define avg_pixels8_l2_shift5_sse2 avg_pixels8_l2_shift5_mmx2
 #define put_pixels16_l2_shift5_sse2 put_pixels16_l2_shift5_mmx2
 #define avg_pixels16_l2_shift5_sse2 avg_pixels16_l2_shift5_mmx2
+#endif
 #define put_pixels8_l2_shift5_ssse3 put_pixels8_l2_shift5_mmx2
 #define avg_pixels8_l2_shift5_ssse3 avg_pixels8_l2_shift5_mmx2
 #define put_pixels16_l2_shift5_ssse3 put_pixels16_l2_shift5_mmx2
 #define avg_pixels16_l2_shift5_ssse3 avg_pixels16_l2_shift5_mmx2
 
+#if !HAVE_YASM
 #define put_h264_qpel8_h_lowpass_l2_sse2 put_h264_qpel8_h_lowpass_l2_mmx2
 #define avg_h264_qpel8_h_lowpass_l2_sse2 avg_h264_qpel8_h_lowpass_l2_mmx2
 #define put_h264_qpel16_h_lowpass_l2_sse2 put_h264_qpel16_h_lowpass_l2_mmx2
 #define avg_h264_qpel16_h_lowpass_l2_sse2 avg_h264_qpel16_h_lowpass_l2_mmx2
+#endif
 
 #define put_h264_qpel8_v_lowpass_ssse3 put_h264_qpel8_v_lowpass_sse2
 #define avg_h264_qpel8_v_lowpass_ssse3 avg_h264_qpel8_v_lowpass_sse2
@@ -1030,6 +1038,78 @@ static void OPNAME ## h264_qpel16_hv_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp,
 #define put_h264_qpel8or16_hv2_lowpass_sse2 put_h264_qpel8or16_hv2_lowpass_mmx2
 #define avg_h264_qpel8or16_hv2_lowpass_sse2 avg_h264_qpel8or16_hv2_lowpass_mmx2
 
+#if HAVE_YASM
+/* The SSE2 and AVX lowpass filters are in h264_qpel.asm; they handle one
+ * 8 pixel wide column, the 16 pixel versions are built from two. */
+#define QPEL_H264_HV1_YASM(MMX)\
+void ff_put_h264_qpel8_hv1_lowpass_ ## MMX(int16_t *tmp, uint8_t *src, int srcStride, int h);\
+static av_always_inline void put_h264_qpel8or16_hv1_lowpass_ ## MMX(int16_t *tmp, uint8_t *src, int tmpStride, int srcStride, int size){\
+    int w = (size+8)>>3;\
+    src -= 2*srcStride+2;\
+    while(w--){\
+        ff_put_h264_qpel8_hv1_lowpass_ ## MMX(tmp, src, srcStride, size);\
+        tmp += 8;\
+        src += 8;\
+    }\
+}
+
+#define QPEL_H264_YASM(OPNAME, MMX)\
+void ff_ ## OPNAME ## h264_qpel8_h_lowpass_ ## MMX(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int h);\
+void ff_ ## OPNAME ## h264_qpel8_h_lowpass_l2_ ## MMX(uint8_t *dst, uint8_t *src, uint8_t *src2, int dstStride, int src2Stride, int h);\
+void ff_ ## OPNAME ## h264_qpel8_v_lowpass_ ## MMX(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int h);\
+void ff_ ## OPNAME ## h264_qpel8_hv2_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp, int dstStride, int h);\
+void ff_ ## OPNAME ## h264_qpel16_hv2_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp, int dstStride, int h);\
+void ff_ ## OPNAME ## pixels8_l2_shift5_ ## MMX(uint8_t *dst, int16_t *src16, uint8_t *src8, int dstStride, int src8Stride, int h);\
+void ff_ ## OPNAME ## pixels16_l2_shift5_ ## MMX(uint8_t *dst, int16_t *src16, uint8_t *src8, int dstStride, int src8Stride, int h);\
+void ff_ ## OPNAME ## pixels16_l2_ ## MMX(uint8_t *dst, uint8_t *src1, uint8_t *src2, int dstStride, int src1Stride, int h);\
+\
+static void OPNAME ## h264_qpel8_h_lowpass_ ## MMX(uint8_t *dst, uint8_t *src, int dstStride, int srcStride){\
+    ff_ ## OPNAME ## h264_qpel8_h_lowpass_ ## MMX(dst  , src  , dstStride, srcStride, 8);\
+}\
+static void OPNAME ## h264_qpel16_h_lowpass_ ## MMX(uint8_t *dst, uint8_t *src, int dstStride, int srcStride){\
+    ff_ ## OPNAME ## h264_qpel8_h_lowpass_ ## MMX(dst  , src  , dstStride, srcStride, 16);\
+    ff_ ## OPNAME ## h264_qpel8_h_lowpass_ ## MMX(dst+8, src+8, dstStride, srcStride, 16);\
+}\
+static void OPNAME ## h264_qpel8_h_lowpass_l2_ ## MMX(uint8_t *dst, uint8_t *src, uint8_t *src2, int dstStride, int src2Stride){\
+    ff_ ## OPNAME ## h264_qpel8_h_lowpass_l2_ ## MMX(dst  , src  , src2  , dstStride, src2Stride, 8);\
+}\
+static void OPNAME ## h264_qpel16_h_lowpass_l2_ ## MMX(uint8_t *dst, uint8_t *src, uint8_t *src2, int dstStride, int src2Stride){\
+    ff_ ## OPNAME ## h264_qpel8_h_lowpass_l2_ ## MMX(dst  , src  , src2  , dstStride, src2Stride, 16);\
+    ff_ ## OPNAME ## h264_qpel8_h_lowpass_l2_ ## MMX(dst+8, src+8, src2+8, dstStride, src2Stride, 16);\
+}\
+static void OPNAME ## h264_qpel8_v_lowpass_ ## MMX(uint8_t *dst, uint8_t *src, int dstStride, int srcStride){\
+    ff_ ## OPNAME ## h264_qpel8_v_lowpass_ ## MMX(dst  , src  , dstStride, srcStride, 8);\
+}\
+static void OPNAME ## h264_qpel16_v_lowpass_ ## MMX(uint8_t *dst, uint8_t *src, int dstStride, int srcStride){\
+    ff_ ## OPNAME ## h264_qpel8_v_lowpass_ ## MMX(dst  , src  , dstStride, srcStride, 16);\
+    ff_ ## OPNAME ## h264_qpel8_v_lowpass_ ## MMX(dst+8, src+8, dstStride, srcStride, 16);\
+}\
+static void OPNAME ## h264_qpel8_hv_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp, uint8_t *src, int dstStride, int tmpStride, int srcStride){\
+    put_h264_qpel8or16_hv1_lowpass_ ## MMX(tmp, src, tmpStride, srcStride, 8);\
+    ff_ ## OPNAME ## h264_qpel8_hv2_lowpass_ ## MMX(dst, tmp, dstStride, 8);\
+}\
+static void OPNAME ## h264_qpel16_hv_lowpass_ ## MMX(uint8_t *dst, int16_t *tmp, uint8_t *src, int dstStride, int tmpStride, int srcStride){\
+    put_h264_qpel8or16_hv1_lowpass_ ## MMX(tmp, src, tmpStride, srcStride, 16);\
+    ff_ ## OPNAME ## h264_qpel16_hv2_lowpass_ ## MMX(dst, tmp, dstStride, 16);\
+}
+
+#define put_pixels16_l2_sse2 ff_put_pixels16_l2_sse2
+#define avg_pixels16_l2_sse2 ff_avg_pixels16_l2_sse2
+#define put_pixels8_l2_shift5_sse2 ff_put_pixels8_l2_shift5_sse2
+#define avg_pixels8_l2_shift5_sse2 ff_avg_pixels8_l2_shift5_sse2
+#define put_pixels16_l2_shift5_sse2 ff_put_pixels16_l2_shift5_sse2
+#define avg_pixels16_l2_shift5_sse2 ff_avg_pixels16_l2_shift5_sse2
+
+#define put_pixels8_l2_avx put_pixels8_l2_mmx2
+#define avg_pixels8_l2_avx avg_pixels8_l2_mmx2
+#define put_pixels16_l2_avx ff_put_pixels16_l2_avx
+#define avg_pixels16_l2_avx ff_avg_pixels16_l2_avx
+#define put_pixels8_l2_shift5_avx ff_put_pixels8_l2_shift5_avx
+#define avg_pixels8_l2_shift5_avx ff_avg_pixels8_l2_shift5_avx
+#define put_pixels16_l2_shift5_avx ff_put_pixels16_l2_shift5_avx
+#define avg_pixels16_l2_shift5_avx ff_avg_pixels16_l2_shift5_avx
+#endif /* HAVE_YASM */
+
 #define H264_MC(OPNAME, SIZE, MMX, ALIGN) \
 H264_MC_C(OPNAME, SIZE, MMX, ALIGN)\
 H264_MC_V(OPNAME, SIZE, MMX, ALIGN)\
@@ -1177,10 +1257,21 @@ QPEL_H264(avg_, AVG_3DNOW_OP, 3dnow)
 #define PAVGB "pavgb"
 QPEL_H264(put_,       PUT_OP, mmx2)
 QPEL_H264(avg_,  AVG_MMX2_OP, mmx2)
+#if HAVE_YASM
+QPEL_H264_HV1_YASM(sse2)
+QPEL_H264_YASM(put_, sse2)
+QPEL_H264_YASM(avg_, sse2)
+#if HAVE_AVX
+QPEL_H264_HV1_YASM(avx)
+QPEL_H264_YASM(put_, avx)
+QPEL_H264_YASM(avg_, avx)
+#endif
+#else
 QPEL_H264_V_XMM(put_,       PUT_OP, sse2)
 QPEL_H264_V_XMM(avg_,  AVG_MMX2_OP, sse2)
 QPEL_H264_HV_XMM(put_,       PUT_OP, sse2)
 QPEL_H264_HV_XMM(avg_,  AVG_MMX2_OP, sse2)
+#endif
 #if HAVE_SSSE3
 QPEL_H264_H_XMM(put_,       PUT_OP, ssse3)
 QPEL_H264_H_XMM(avg_,  AVG_MMX2_OP, ssse3)
@@ -1193,9 +1284,17 @@ QPEL_H264_HV_XMM(avg_,  AVG_MMX2_OP, ssse3)
 
 H264_MC_4816(3dnow)
 H264_MC_4816(mmx2)
+#if HAVE_YASM
+H264_MC_816(H264_MC_H, sse2)
+#endif
 H264_MC_816(H264_MC_V, sse2)
 H264_MC_816(H264_MC_HV, sse2)
 #if HAVE_SSSE3
 H264_MC_816(H264_MC_H, ssse3)
 H264_MC_816(H264_MC_HV, ssse3)
 #endif
+#if HAVE_YASM && HAVE_AVX
+H264_MC_816(H264_MC_H, avx)
+H264_MC_816(H264_MC_V, avx)
+H264_MC_816(H264_MC_HV, avx)
+#endif
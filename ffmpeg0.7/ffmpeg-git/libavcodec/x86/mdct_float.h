@@ -0,0 +1,174 @@
+/*
+ * AVX IMDCT pre- and post-rotation
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_X86_MDCT_FLOAT_H
+#define AVCODEC_X86_MDCT_FLOAT_H
+
+#include <stdint.h>
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/fft.h"
+#include "config.h"
+
+#if ARCH_X86_64 && HAVE_INLINE_ASM && HAVE_AVX
+
+#define mdct_init_simd mdct_init_avx
+
+static const int32_t mdct_avx_dup[8] = { 0, 0, 1, 1, 2, 2, 3, 3 };
+
+/* load 4 twiddles with each one duplicated */
+#define MDCT_AVX_LOAD_W(src, dst)                               \
+    "vbroadcastf128 " src ", %%" dst "                  \n\t"   \
+    "vpermilps    %[dup], %%" dst ", %%" dst "          \n\t"
+
+/* reverse the order of 4 complex values */
+#define MDCT_AVX_REVERSE(reg)                                   \
+    "vperm2f128       $1, %%" reg ", %%" reg ", %%" reg "\n\t"  \
+    "vpermilps     $0x4e, %%" reg ", %%" reg "          \n\t"
+
+/**
+ * Same as ff_imdct_half_c(), the rotations process 8 and 4 values per
+ * iteration with the same arithmetic. Needs nbits >= 5.
+ */
+static void imdct_half_avx(FFTContext *s, FFTSample *output, const FFTSample *input)
+{
+    int n  = 1 << s->mdct_bits;
+    int n2 = n >> 1;
+    int n4 = n >> 2;
+    int n8 = n >> 3;
+    FFTComplex *z = (FFTComplex *)output;
+    const FFTSample *in2 = input + n2 - 16;
+    const uint16_t *revtab = s->revtab;
+    const FFTComplex *za, *zb;
+    const FFTSample *ca, *cb;
+    x86_reg k = 0, j0, j1;
+
+    /* pre rotation */
+    __asm__ volatile(
+        "1:                                             \n\t"
+        "vmovups   (%[in1],%[k],2), %%ymm0              \n\t"
+        "vmovups 32(%[in1],%[k],2), %%ymm1              \n\t"
+        "vmovups          (%[in2]), %%ymm4              \n\t"
+        "vmovups        32(%[in2]), %%ymm5              \n\t"
+        "vperm2f128 $0x20, %%ymm1, %%ymm0, %%ymm2       \n\t"
+        "vperm2f128 $0x31, %%ymm1, %%ymm0, %%ymm3       \n\t"
+        "vshufps    $0x88, %%ymm3, %%ymm2, %%ymm0       \n\t" /* *in1 */
+        "vperm2f128 $0x20, %%ymm5, %%ymm4, %%ymm2       \n\t"
+        "vperm2f128 $0x31, %%ymm5, %%ymm4, %%ymm3       \n\t"
+        "vshufps    $0xdd, %%ymm3, %%ymm2, %%ymm1       \n\t"
+        "vperm2f128 $0x01, %%ymm1, %%ymm1, %%ymm1       \n\t"
+        "vpermilps  $0x1b, %%ymm1, %%ymm1               \n\t" /* *in2 */
+        "vmovups  (%[tcos],%[k]), %%ymm2                \n\t"
+        "vmovups  (%[tsin],%[k]), %%ymm3                \n\t"
+        "vmulps     %%ymm2, %%ymm1, %%ymm4              \n\t"
+        "vmulps     %%ymm3, %%ymm0, %%ymm5              \n\t"
+        "vmulps     %%ymm3, %%ymm1, %%ymm1              \n\t"
+        "vmulps     %%ymm2, %%ymm0, %%ymm0              \n\t"
+        "vsubps     %%ymm5, %%ymm4, %%ymm4              \n\t" /* re */
+        "vaddps     %%ymm0, %%ymm1, %%ymm1              \n\t" /* im */
+        "vunpcklps  %%ymm1, %%ymm4, %%ymm0              \n\t" /* 0 1 4 5 */
+        "vunpckhps  %%ymm1, %%ymm4, %%ymm1              \n\t" /* 2 3 6 7 */
+        "movzwl      (%[rev]), %k[j0]                   \n\t"
+        "movzwl     2(%[rev]), %k[j1]                   \n\t"
+        "vmovlps    %%xmm0, (%[z],%[j0],8)              \n\t"
+        "vmovhps    %%xmm0, (%[z],%[j1],8)              \n\t"
+        "movzwl     4(%[rev]), %k[j0]                   \n\t"
+        "movzwl     6(%[rev]), %k[j1]                   \n\t"
+        "vmovlps    %%xmm1, (%[z],%[j0],8)              \n\t"
+        "vmovhps    %%xmm1, (%[z],%[j1],8)              \n\t"
+        "vextractf128   $1, %%ymm0, %%xmm0              \n\t"
+        "vextractf128   $1, %%ymm1, %%xmm1              \n\t"
+        "movzwl     8(%[rev]), %k[j0]                   \n\t"
+        "movzwl    10(%[rev]), %k[j1]                   \n\t"
+        "vmovlps    %%xmm0, (%[z],%[j0],8)              \n\t"
+        "vmovhps    %%xmm0, (%[z],%[j1],8)              \n\t"
+        "movzwl    12(%[rev]), %k[j0]                   \n\t"
+        "movzwl    14(%[rev]), %k[j1]                   \n\t"
+        "vmovlps    %%xmm1, (%[z],%[j0],8)              \n\t"
+        "vmovhps    %%xmm1, (%[z],%[j1],8)              \n\t"
+        "add           $16, %[rev]                      \n\t"
+        "sub           $64, %[in2]                      \n\t"
+        "add           $32, %[k]                        \n\t"
+        "cmp        %[end], %[k]                        \n\t"
+        " jl            1b                              \n\t"
+        "vzeroupper                                     \n\t"
+        : [k]"+r"(k), [in2]"+r"(in2), [rev]"+r"(revtab),
+          [j0]"=&r"(j0), [j1]"=&r"(j1)
+        : [in1]"r"(input), [tcos]"r"(s->tcos), [tsin]"r"(s->tsin),
+          [z]"r"(z), [end]"r"((x86_reg)(4 * n4))
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+          "memory"
+    );
+
+    s->fft_calc(s, z);
+
+    /* post rotation + reordering */
+    za = z + n8 - 4;
+    zb = z + n8;
+    ca = s->tcos + n8 - 4;
+    cb = s->tcos + n8;
+    k  = n8 >> 2;
+    __asm__ volatile(
+        "1:                                             \n\t"
+        MDCT_AVX_LOAD_W("(%[cb])",        "ymm2")
+        MDCT_AVX_LOAD_W("(%[cb],%[so])",  "ymm3")
+        MDCT_AVX_LOAD_W("(%[ca])",        "ymm4")
+        MDCT_AVX_LOAD_W("(%[ca],%[so])",  "ymm5")
+        "vmovups        (%[zb]), %%ymm0                 \n\t"
+        "vmovups        (%[za]), %%ymm1                 \n\t"
+        "vpermilps  $0xb1, %%ymm0, %%ymm6               \n\t"
+        "vpermilps  $0xb1, %%ymm1, %%ymm7               \n\t"
+        "vmulps     %%ymm2, %%ymm0, %%ymm0              \n\t"
+        "vmulps     %%ymm3, %%ymm6, %%ymm6              \n\t"
+        "vmulps     %%ymm4, %%ymm1, %%ymm1              \n\t"
+        "vmulps     %%ymm5, %%ymm7, %%ymm7              \n\t"
+        "vaddsubps  %%ymm0, %%ymm6, %%ymm0              \n\t" /* r1, i0 */
+        "vaddsubps  %%ymm1, %%ymm7, %%ymm1              \n\t" /* r0, i1 */
+        MDCT_AVX_REVERSE("ymm1")
+        "vblendps   $0xaa, %%ymm1, %%ymm0, %%ymm2       \n\t"
+        "vblendps   $0xaa, %%ymm0, %%ymm1, %%ymm3       \n\t"
+        MDCT_AVX_REVERSE("ymm3")
+        "vmovups    %%ymm2, (%[zb])                     \n\t"
+        "vmovups    %%ymm3, (%[za])                     \n\t"
+        "add           $32, %[zb]                       \n\t"
+        "sub           $32, %[za]                       \n\t"
+        "add           $16, %[cb]                       \n\t"
+        "sub           $16, %[ca]                       \n\t"
+        "sub            $1, %[k]                        \n\t"
+        " jg            1b                              \n\t"
+        "vzeroupper                                     \n\t"
+        : [k]"+r"(k), [za]"+r"(za), [zb]"+r"(zb), [ca]"+r"(ca), [cb]"+r"(cb)
+        : [so]"r"((x86_reg)(sizeof(FFTSample) * (s->tsin - s->tcos))),
+          [dup]"m"(*mdct_avx_dup)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",
+                       "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+static av_cold void mdct_init_avx(FFTContext *s)
+{
+    if (s->mdct_bits >= 5 && s->mdct_permutation == FF_MDCT_PERM_NONE &&
+        av_get_cpu_flags() & AV_CPU_FLAG_AVX)
+        s->imdct_half = imdct_half_avx;
+}
+
+#endif /* ARCH_X86_64 && HAVE_INLINE_ASM && HAVE_AVX */
+#endif /* AVCODEC_X86_MDCT_FLOAT_H */
@@ -0,0 +1,336 @@
+/*
+ * SSE/SSE2 AAC Parametric Stereo DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/psdsp.h"
+
+/* Every function computes each output value with the same operations in
+ * the same order as the C version, so the results are identical. */
+
+static void ps_add_squares_sse(float *dst, const float (*src)[2], int n)
+{
+    x86_reg i = -4 * (x86_reg)n;
+
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movups   (%2,%0,2), %%xmm0     \n\t"
+        "movups 16(%2,%0,2), %%xmm1     \n\t"
+        "mulps        %%xmm0, %%xmm0    \n\t"
+        "mulps        %%xmm1, %%xmm1    \n\t"
+        "movaps       %%xmm0, %%xmm2    \n\t"
+        "shufps $0x88, %%xmm1, %%xmm0   \n\t"
+        "shufps $0xdd, %%xmm1, %%xmm2   \n\t"
+        "addps        %%xmm2, %%xmm0    \n\t"
+        "movups     (%1,%0), %%xmm1     \n\t"
+        "addps        %%xmm0, %%xmm1    \n\t"
+        "movups       %%xmm1, (%1,%0)   \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(dst + n), "r"(src + n)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+    );
+}
+
+static void ps_mul_pair_single_sse2(float (*dst)[2], const float (*src0)[2],
+                                   const float *src1, int n)
+{
+    x86_reg i = -4 * (x86_reg)n;
+
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movups     (%3,%0), %%xmm2     \n\t"
+        "movaps       %%xmm2, %%xmm3    \n\t"
+        "unpcklps     %%xmm2, %%xmm2    \n\t"
+        "unpckhps     %%xmm3, %%xmm3    \n\t"
+        "movups   (%2,%0,2), %%xmm0     \n\t"
+        "movups 16(%2,%0,2), %%xmm1     \n\t"
+        "mulps        %%xmm2, %%xmm0    \n\t"
+        "mulps        %%xmm3, %%xmm1    \n\t"
+        "movups       %%xmm0,   (%1,%0,2) \n\t"
+        "movups       %%xmm1, 16(%1,%0,2) \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(dst + n), "r"(src0 + n), "r"(src1 + n)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+
+/* one tap pair of two filters, the sums and differences are in %2 */
+#define HYBRID_TAP(j)                                    \
+        "movsd  " #j "*8(%1), %%xmm0        \n\t"        \
+        "movhps " #j "*8+56(%1), %%xmm0     \n\t"        \
+        "movaps       %%xmm0, %%xmm1        \n\t"        \
+        "shufps $0xa0, %%xmm0, %%xmm0       \n\t"        \
+        "shufps $0xf5, %%xmm1, %%xmm1       \n\t"        \
+        "xorps        %%xmm7, %%xmm1        \n\t"        \
+        "movups " #j "*32(%2), %%xmm2       \n\t"        \
+        "movups " #j "*32+16(%2), %%xmm3    \n\t"        \
+        "mulps        %%xmm2, %%xmm0        \n\t"        \
+        "mulps        %%xmm3, %%xmm1        \n\t"        \
+        "addps        %%xmm1, %%xmm0        \n\t"        \
+        "addps        %%xmm0, %%xmm6        \n\t"
+
+/**
+ * Two filters per iteration. The sums and the swapped differences of the
+ * symmetric input pairs do not depend on the filter and are computed first.
+ */
+static void ps_hybrid_analysis_sse2(float (*out)[2], const float (*in)[2],
+                                   const float (*filter)[7][2], int stride, int n)
+{
+    float sd[7][2][4];
+    x86_reg s = 8 * (x86_reg)stride;
+    int i, j;
+
+    for (j = 0; j < 6; j++) {
+        sd[j][0][0] = sd[j][0][2] = in[j][0] + in[12-j][0];
+        sd[j][0][1] = sd[j][0][3] = in[j][1] + in[12-j][1];
+        sd[j][1][0] = sd[j][1][2] = in[j][1] - in[12-j][1];
+        sd[j][1][1] = sd[j][1][3] = in[j][0] - in[12-j][0];
+    }
+    sd[6][0][0] = sd[6][0][2] = in[6][0];
+    sd[6][0][1] = sd[6][0][3] = in[6][1];
+
+    for (i = 0; i < n; i += 2) {
+        __asm__ volatile(
+            "pcmpeqd      %%xmm7, %%xmm7    \n\t"
+            "psrlq           $63, %%xmm7    \n\t"
+            "pslld           $31, %%xmm7    \n\t"
+            "movsd        48(%1), %%xmm6    \n\t"
+            "movhps      104(%1), %%xmm6    \n\t"
+            "shufps $0xa0, %%xmm6, %%xmm6   \n\t"
+            "movups      192(%2), %%xmm0    \n\t"
+            "mulps        %%xmm0, %%xmm6    \n\t"
+            HYBRID_TAP(0)
+            HYBRID_TAP(1)
+            HYBRID_TAP(2)
+            HYBRID_TAP(3)
+            HYBRID_TAP(4)
+            HYBRID_TAP(5)
+            "movlps       %%xmm6, (%0)      \n\t"
+            "movhps       %%xmm6, (%0,%3)   \n\t"
+            :
+            : "r"(out + i * stride), "r"(filter + i), "r"(sd), "r"(s)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm6", "%xmm7",) "memory"
+        );
+    }
+}
+
+/**
+ * Four subbands per iteration, the remaining ones are copied in C.
+ */
+static void ps_hybrid_analysis_ileave_sse(float (*out)[32][2], float L[2][38][64],
+                                          int i, int len)
+{
+    int j;
+
+    for (; i + 4 <= 64; i += 4) {
+        x86_reg n = -256 * (x86_reg)len;
+        float (*dst)[2] = out[i];
+        __asm__ volatile(
+            "1:                             \n\t"
+            "movups     (%2,%0), %%xmm0     \n\t"
+            "movups 9728(%2,%0), %%xmm1     \n\t"
+            "movaps       %%xmm0, %%xmm2    \n\t"
+            "unpcklps     %%xmm1, %%xmm0    \n\t"
+            "unpckhps     %%xmm1, %%xmm2    \n\t"
+            "movlps       %%xmm0,    (%1)   \n\t"
+            "movhps       %%xmm0, 256(%1)   \n\t"
+            "movlps       %%xmm2, 512(%1)   \n\t"
+            "movhps       %%xmm2, 768(%1)   \n\t"
+            "add              $8, %1        \n\t"
+            "add            $256, %0        \n\t"
+            " js              1b            \n\t"
+            : "+&r"(n), "+&r"(dst)
+            : "r"(L[0][len] + i)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+        );
+    }
+    for (; i < 64; i++) {
+        for (j = 0; j < len; j++) {
+            out[i][j][0] = L[0][j][i];
+            out[i][j][1] = L[1][j][i];
+        }
+    }
+}
+
+/**
+ * Four subbands per iteration, the remaining ones are copied in C.
+ */
+static void ps_hybrid_synthesis_deint_sse2(float out[2][38][64], float (*in)[32][2],
+                                          int i, int len)
+{
+    int n;
+
+    for (; i + 4 <= 64; i += 4) {
+        x86_reg k = -256 * (x86_reg)len;
+        float (*src)[2] = in[i];
+        __asm__ volatile(
+            "1:                             \n\t"
+            "movsd          (%1), %%xmm0    \n\t"
+            "movhps      256(%1), %%xmm0    \n\t"
+            "movsd       512(%1), %%xmm1    \n\t"
+            "movhps      768(%1), %%xmm1    \n\t"
+            "movaps       %%xmm0, %%xmm2    \n\t"
+            "shufps $0x88, %%xmm1, %%xmm0   \n\t"
+            "shufps $0xdd, %%xmm1, %%xmm2   \n\t"
+            "movups       %%xmm0,     (%2,%0) \n\t"
+            "movups       %%xmm2, 9728(%2,%0) \n\t"
+            "add              $8, %1        \n\t"
+            "add            $256, %0        \n\t"
+            " js              1b            \n\t"
+            : "+&r"(k), "+&r"(src)
+            : "r"(out[0][len] + i)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+        );
+    }
+    for (; i < 64; i++) {
+        for (n = 0; n < len; n++) {
+            out[0][n][i] = in[i][n][0];
+            out[1][n][i] = in[i][n][1];
+        }
+    }
+}
+
+/**
+ * The left and right outputs of a sample are computed together, with h11
+ * and h12 in one register and h21 and h22 in another.
+ */
+static void ps_stereo_interpolate_sse2(float (*l)[2], float (*r)[2],
+                                      float h[2][4], float h_step[2][4], int len)
+{
+    const float hv[4][4] = {
+        { h[0][0],      h[0][0],      h[0][1],      h[0][1]      },
+        { h[0][2],      h[0][2],      h[0][3],      h[0][3]      },
+        { h_step[0][0], h_step[0][0], h_step[0][1], h_step[0][1] },
+        { h_step[0][2], h_step[0][2], h_step[0][3], h_step[0][3] },
+    };
+    x86_reg n = -8 * (x86_reg)len;
+
+    if (len <= 0)
+        return;
+    __asm__ volatile(
+        "movups         (%3), %%xmm4    \n\t"
+        "movups       16(%3), %%xmm5    \n\t"
+        "movups       32(%3), %%xmm6    \n\t"
+        "movups       48(%3), %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movsd      (%1,%0), %%xmm0     \n\t"
+        "movsd      (%2,%0), %%xmm1     \n\t"
+        "movlhps      %%xmm0, %%xmm0    \n\t"
+        "movlhps      %%xmm1, %%xmm1    \n\t"
+        "addps        %%xmm6, %%xmm4    \n\t"
+        "addps        %%xmm7, %%xmm5    \n\t"
+        "mulps        %%xmm4, %%xmm0    \n\t"
+        "mulps        %%xmm5, %%xmm1    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "movlps       %%xmm0, (%1,%0)   \n\t"
+        "movhps       %%xmm0, (%2,%0)   \n\t"
+        "add              $8, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(n)
+        : "r"(l + len), "r"(r + len), "r"(hv)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm4", "%xmm5",
+                       "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+/**
+ * Like ps_stereo_interpolate_sse2() with the imaginary parts of h negated
+ * in the lanes of the real outputs, the negation is exact so they can be
+ * interpolated as they are.
+ */
+static void ps_stereo_interpolate_ipdopd_sse2(float (*l)[2], float (*r)[2],
+                                             float h[2][4], float h_step[2][4],
+                                             int len)
+{
+    const float hv[8][4] = {
+        {  h[0][0],       h[0][0],       h[0][1],       h[0][1]      },
+        {  h[0][2],       h[0][2],       h[0][3],       h[0][3]      },
+        { -h[1][0],       h[1][0],      -h[1][1],       h[1][1]      },
+        { -h[1][2],       h[1][2],      -h[1][3],       h[1][3]      },
+        {  h_step[0][0],  h_step[0][0],  h_step[0][1],  h_step[0][1] },
+        {  h_step[0][2],  h_step[0][2],  h_step[0][3],  h_step[0][3] },
+        { -h_step[1][0],  h_step[1][0], -h_step[1][1],  h_step[1][1] },
+        { -h_step[1][2],  h_step[1][2], -h_step[1][3],  h_step[1][3] },
+    };
+    x86_reg n = -8 * (x86_reg)len;
+
+    if (len <= 0)
+        return;
+    __asm__ volatile(
+        "movups         (%3), %%xmm4    \n\t"
+        "movups       16(%3), %%xmm5    \n\t"
+        "movups       32(%3), %%xmm6    \n\t"
+        "movups       48(%3), %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups       64(%3), %%xmm2    \n\t"
+        "movups       80(%3), %%xmm3    \n\t"
+        "addps        %%xmm2, %%xmm4    \n\t"
+        "addps        %%xmm3, %%xmm5    \n\t"
+        "movups       96(%3), %%xmm2    \n\t"
+        "movups      112(%3), %%xmm3    \n\t"
+        "addps        %%xmm2, %%xmm6    \n\t"
+        "addps        %%xmm3, %%xmm7    \n\t"
+        "movsd      (%1,%0), %%xmm0     \n\t"
+        "movsd      (%2,%0), %%xmm1     \n\t"
+        "movlhps      %%xmm0, %%xmm0    \n\t"
+        "movlhps      %%xmm1, %%xmm1    \n\t"
+        "movaps       %%xmm0, %%xmm2    \n\t"
+        "movaps       %%xmm1, %%xmm3    \n\t"
+        "mulps        %%xmm4, %%xmm0    \n\t"
+        "mulps        %%xmm5, %%xmm1    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "shufps $0xb1, %%xmm2, %%xmm2   \n\t"
+        "shufps $0xb1, %%xmm3, %%xmm3   \n\t"
+        "mulps        %%xmm6, %%xmm2    \n\t"
+        "mulps        %%xmm7, %%xmm3    \n\t"
+        "addps        %%xmm2, %%xmm0    \n\t"
+        "addps        %%xmm3, %%xmm0    \n\t"
+        "movlps       %%xmm0, (%1,%0)   \n\t"
+        "movhps       %%xmm0, (%2,%0)   \n\t"
+        "add              $8, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(n)
+        : "r"(l + len), "r"(r + len), "r"(hv)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+av_cold void ff_psdsp_init_x86(PSDSPContext *s)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE) {
+        s->add_squares            = ps_add_squares_sse;
+        s->hybrid_analysis_ileave = ps_hybrid_analysis_ileave_sse;
+    }
+    if (mm_flags & AV_CPU_FLAG_SSE2) {
+        s->mul_pair_single        = ps_mul_pair_single_sse2;
+        s->hybrid_analysis        = ps_hybrid_analysis_sse2;
+        s->hybrid_synthesis_deint = ps_hybrid_synthesis_deint_sse2;
+        s->stereo_interpolate[0]  = ps_stereo_interpolate_sse2;
+        s->stereo_interpolate[1]  = ps_stereo_interpolate_ipdopd_sse2;
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * AVX RDFT butterflies
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_X86_RDFT_H
+#define AVCODEC_X86_RDFT_H
+
+#include <stdint.h>
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/rdft.h"
+#include "config.h"
+
+#if ARCH_X86_64 && HAVE_INLINE_ASM && HAVE_AVX
+
+#define rdft_butterflies_simd       rdft_butterflies_avx
+#define rdft_butterflies_simd_flags AV_CPU_FLAG_AVX
+
+static const int32_t rdft_avx_dup[8] = { 0, 0, 1, 1, 2, 2, 3, 3 };
+
+#define RDFT_AVX_REVERSE(reg)                                   \
+    "vperm2f128       $1, %%" reg ", %%" reg ", %%" reg "\n\t"  \
+    "vpermilps     $0x4e, %%" reg ", %%" reg "          \n\t"
+
+/**
+ * Unmangle the values i = 1, 2, ... of ff_rdft_calc_c() in groups of 4 with
+ * the same arithmetic as the C loop.
+ * @return the first i left to the C loop
+ */
+static int rdft_butterflies_avx(RDFTContext *s, FFTSample *data)
+{
+    const int n = 1 << s->nbits;
+    const float k1 = 0.5;
+    const float k2[2] = { 0.5 - s->inverse, -(0.5 - s->inverse) };
+    const FFTSample *tcos = s->tcos + 1;
+    const FFTSample *tsin = s->tsin + 1;
+    FFTSample *d1 = data + 2;
+    FFTSample *d2 = data + n - 8;
+    x86_reg i = ((n >> 2) - 1) >> 2;
+
+    if (!i)
+        return 1;
+
+    __asm__ volatile(
+        "vbroadcastss   %[k1], %%ymm14                  \n\t"
+        "vbroadcastsd   %[k2], %%ymm15                  \n\t"
+        "vpcmpeqd   %%xmm13, %%xmm13, %%xmm13           \n\t"
+        "vpsllq         $63, %%xmm13, %%xmm13           \n\t"
+        "vinsertf128     $1, %%xmm13, %%ymm13, %%ymm13  \n\t"
+        "1:                                             \n\t"
+        "vmovups      (%[d1]), %%ymm0                   \n\t"
+        "vmovups      (%[d2]), %%ymm1                   \n\t"
+        RDFT_AVX_REVERSE("ymm1")
+        "vaddps      %%ymm1, %%ymm0, %%ymm2             \n\t"
+        "vsubps      %%ymm1, %%ymm0, %%ymm3             \n\t"
+        "vblendps    $0xaa, %%ymm3, %%ymm2, %%ymm4      \n\t"
+        "vblendps    $0xaa, %%ymm2, %%ymm3, %%ymm5      \n\t"
+        "vmulps     %%ymm14, %%ymm4, %%ymm4             \n\t" /* ev */
+        "vpermilps   $0xb1, %%ymm5, %%ymm5              \n\t"
+        "vmulps     %%ymm15, %%ymm5, %%ymm5             \n\t" /* od */
+        "vbroadcastf128 (%[tcos]), %%ymm6               \n\t"
+        "vbroadcastf128 (%[tsin]), %%ymm7               \n\t"
+        "vpermilps   %[dup], %%ymm6, %%ymm6             \n\t"
+        "vpermilps   %[dup], %%ymm7, %%ymm7             \n\t"
+        "vpermilps   $0xb1, %%ymm5, %%ymm0              \n\t"
+        "vmulps      %%ymm6, %%ymm5, %%ymm5             \n\t"
+        "vmulps      %%ymm7, %%ymm0, %%ymm0             \n\t"
+        "vaddps      %%ymm5, %%ymm4, %%ymm1             \n\t"
+        "vaddsubps   %%ymm0, %%ymm1, %%ymm1             \n\t" /* data[i1] */
+        "vxorps     %%ymm13, %%ymm4, %%ymm4             \n\t"
+        "vxorps     %%ymm13, %%ymm5, %%ymm5             \n\t"
+        "vsubps      %%ymm5, %%ymm4, %%ymm4             \n\t"
+        "vaddps      %%ymm0, %%ymm4, %%ymm4             \n\t" /* data[i2] */
+        RDFT_AVX_REVERSE("ymm4")
+        "vmovups     %%ymm1, (%[d1])                    \n\t"
+        "vmovups     %%ymm4, (%[d2])                    \n\t"
+        "add            $32, %[d1]                      \n\t"
+        "sub            $32, %[d2]                      \n\t"
+        "add            $16, %[tcos]                    \n\t"
+        "add            $16, %[tsin]                    \n\t"
+        "sub             $1, %[i]                       \n\t"
+        " jg             1b                             \n\t"
+        "vzeroupper                                     \n\t"
+        : [i]"+r"(i), [d1]"+r"(d1), [d2]"+r"(d2),
+          [tcos]"+r"(tcos), [tsin]"+r"(tsin)
+        : [k1]"m"(k1), [k2]"m"(k2), [dup]"m"(*rdft_avx_dup)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",
+                       "%xmm6", "%xmm7", "%xmm13", "%xmm14", "%xmm15",)
+          "memory"
+    );
+
+    return 1 + 4 * (((n >> 2) - 1) >> 2);
+}
+
+#endif /* ARCH_X86_64 && HAVE_INLINE_ASM && HAVE_AVX */
+#endif /* AVCODEC_X86_RDFT_H */
@@ -0,0 +1,109 @@
+/*
+ * SSE2 audio resampling filters
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/resample2.h"
+
+static int resample_filter_sse2(const short *src, const int16_t *filter, int len)
+{
+    int n8 = len & ~7;
+    int i, val = 0;
+
+    if (n8) {
+        x86_reg j = -2 * n8;
+
+        __asm__ volatile(
+            "pxor          %%xmm0, %%xmm0   \n\t"
+            "1:                             \n\t"
+            "movdqu      (%2,%0), %%xmm1    \n\t"
+            "movdqu      (%3,%0), %%xmm2    \n\t"
+            "pmaddwd       %%xmm2, %%xmm1   \n\t"
+            "paddd         %%xmm1, %%xmm0   \n\t"
+            "add              $16, %0       \n\t"
+            " js              1b            \n\t"
+            "pshufd  $0x4e, %%xmm0, %%xmm1  \n\t"
+            "paddd         %%xmm1, %%xmm0   \n\t"
+            "pshufd  $0xb1, %%xmm0, %%xmm1  \n\t"
+            "paddd         %%xmm1, %%xmm0   \n\t"
+            "movd          %%xmm0, %1       \n\t"
+            : "+&r"(j), "=r"(val)
+            : "r"(src + n8), "r"(filter + n8)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+        );
+    }
+    for (i = n8; i < len; i++)
+        val += src[i] * filter[i];
+    return val;
+}
+
+static void resample_filter2_sse2(int *val, const short *src,
+                                  const int16_t *filter, int len)
+{
+    int n8 = len & ~7;
+    int i, v[2] = { 0, 0 };
+
+    if (n8) {
+        x86_reg j = -2 * n8;
+
+        __asm__ volatile(
+            "pxor          %%xmm0, %%xmm0   \n\t"
+            "1:                             \n\t"
+            "movdqu      (%3,%0), %%xmm2    \n\t" /* f0 .. f7 */
+            "movdqu    (%2,%0,2), %%xmm4    \n\t"
+            "movdqu  16(%2,%0,2), %%xmm5    \n\t"
+            "pshufd  $0x50, %%xmm2, %%xmm3  \n\t" /* f0 f1 f0 f1 f2 f3 f2 f3 */
+            "pshufd  $0xfa, %%xmm2, %%xmm2  \n\t" /* f4 f5 f4 f5 f6 f7 f6 f7 */
+            "pshuflw $0xd8, %%xmm4, %%xmm4  \n\t"
+            "pshufhw $0xd8, %%xmm4, %%xmm4  \n\t" /* l0 l1 r0 r1 l2 l3 r2 r3 */
+            "pshuflw $0xd8, %%xmm5, %%xmm5  \n\t"
+            "pshufhw $0xd8, %%xmm5, %%xmm5  \n\t"
+            "pmaddwd       %%xmm3, %%xmm4   \n\t"
+            "pmaddwd       %%xmm2, %%xmm5   \n\t"
+            "paddd         %%xmm4, %%xmm0   \n\t"
+            "paddd         %%xmm5, %%xmm0   \n\t"
+            "add              $16, %0       \n\t"
+            " js              1b            \n\t"
+            "pshufd  $0x4e, %%xmm0, %%xmm1  \n\t"
+            "paddd         %%xmm1, %%xmm0   \n\t"
+            "movq          %%xmm0, %1       \n\t"
+            : "+&r"(j), "=m"(v)
+            : "r"(src + 2 * n8), "r"(filter + n8)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+              "memory"
+        );
+    }
+    for (i = n8; i < len; i++) {
+        v[0] += src[2 * i    ] * filter[i];
+        v[1] += src[2 * i + 1] * filter[i];
+    }
+    val[0] = v[0];
+    val[1] = v[1];
+}
+
+void ff_resample_dsp_init_x86(ResampleDSPContext *c)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE2) {
+        c->filter  = resample_filter_sse2;
+        c->filter2 = resample_filter2_sse2;
+    }
+}
@@ -0,0 +1,402 @@
+/*
+ * SSE/SSE2 AAC Spectral Band Replication DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/sbrdsp.h"
+
+/* Every function computes each output value with the same operations in
+ * the same order as the C version, so the results are identical. */
+
+static void sbr_sum64x5_sse(float *z)
+{
+    x86_reg i = -256;
+
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movups     (%1,%0), %%xmm0     \n\t"
+        "movups  256(%1,%0), %%xmm1     \n\t"
+        "movups  512(%1,%0), %%xmm2     \n\t"
+        "movups  768(%1,%0), %%xmm3     \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "movups 1024(%1,%0), %%xmm1     \n\t"
+        "addps        %%xmm2, %%xmm0    \n\t"
+        "addps        %%xmm3, %%xmm0    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "movups       %%xmm0, (%1,%0)   \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(z + 64)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+
+static void sbr_qmf_pre_shuffle_sse2(float *z)
+{
+    x86_reg i = -112;
+    const float *p = z + 60;
+    int k;
+
+    /* k = 1..28, four per iteration */
+    __asm__ volatile(
+        "pcmpeqd      %%xmm7, %%xmm7    \n\t"
+        "pslld           $31, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups     (%2,%0), %%xmm0     \n\t"
+        "movups        (%1), %%xmm1     \n\t"
+        "shufps $0x1b, %%xmm1, %%xmm1   \n\t"
+        "xorps        %%xmm7, %%xmm1    \n\t"
+        "movaps       %%xmm0, %%xmm2    \n\t"
+        "unpcklps     %%xmm1, %%xmm0    \n\t"
+        "unpckhps     %%xmm1, %%xmm2    \n\t"
+        "movups       %%xmm0,   (%3,%0,2) \n\t"
+        "movups       %%xmm2, 16(%3,%0,2) \n\t"
+        "sub             $16, %1        \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i), "+&r"(p)
+        : "r"(z + 29), "r"(z + 121)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",) "memory"
+    );
+    z[64] = z[0];
+    for (k = 29; k < 32; k++) {
+        z[64+2*k-1] =  z[   k];
+        z[64+2*k  ] = -z[64-k];
+    }
+    z[64+63] = z[32];
+}
+
+static void sbr_qmf_post_shuffle_sse2(float W[32][2], const float *z)
+{
+    x86_reg i = -128;
+    const float *p = z + 60;
+
+    __asm__ volatile(
+        "pcmpeqd      %%xmm7, %%xmm7    \n\t"
+        "pslld           $31, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups     (%2,%0), %%xmm0     \n\t"
+        "movups        (%1), %%xmm1     \n\t"
+        "shufps $0x1b, %%xmm1, %%xmm1   \n\t"
+        "xorps        %%xmm7, %%xmm1    \n\t"
+        "movaps       %%xmm1, %%xmm2    \n\t"
+        "unpcklps     %%xmm0, %%xmm1    \n\t"
+        "unpckhps     %%xmm0, %%xmm2    \n\t"
+        "movups       %%xmm1,   (%3,%0,2) \n\t"
+        "movups       %%xmm2, 16(%3,%0,2) \n\t"
+        "sub             $16, %1        \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i), "+&r"(p)
+        : "r"(z + 32), "r"(W[0] + 64)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",) "memory"
+    );
+}
+
+static void sbr_neg_odd_64_sse2(float *x)
+{
+    x86_reg i = -256;
+
+    __asm__ volatile(
+        "pcmpeqd      %%xmm7, %%xmm7    \n\t"
+        "psllq           $63, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups     (%1,%0), %%xmm0     \n\t"
+        "movups   16(%1,%0), %%xmm1     \n\t"
+        "xorps        %%xmm7, %%xmm0    \n\t"
+        "xorps        %%xmm7, %%xmm1    \n\t"
+        "movups       %%xmm0,   (%1,%0) \n\t"
+        "movups       %%xmm1, 16(%1,%0) \n\t"
+        "add             $32, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(x + 64)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",) "memory"
+    );
+}
+
+static void sbr_qmf_deint_neg_sse2(float *v, const float *src)
+{
+    x86_reg i = -128;
+    const float *p = src + 56;
+    float *hi = v + 60;
+
+    __asm__ volatile(
+        "pcmpeqd      %%xmm7, %%xmm7    \n\t"
+        "pslld           $31, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups        (%1), %%xmm0     \n\t"
+        "movups      16(%1), %%xmm1     \n\t"
+        "movaps       %%xmm0, %%xmm2    \n\t"
+        "shufps $0x88, %%xmm1, %%xmm2   \n\t"
+        "shufps $0x77, %%xmm0, %%xmm1   \n\t"
+        "xorps        %%xmm7, %%xmm2    \n\t"
+        "movups       %%xmm1, (%3,%0)   \n\t"
+        "movups       %%xmm2, (%2)      \n\t"
+        "sub             $32, %1        \n\t"
+        "sub             $16, %2        \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i), "+&r"(p), "+&r"(hi)
+        : "r"(v + 32)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",) "memory"
+    );
+}
+
+static void sbr_qmf_deint_bfly_sse(float *v, const float *src0, const float *src1)
+{
+    x86_reg i = -256;
+    const float *p = src1 + 60;
+    float *hi = v + 124;
+
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movups     (%4,%0), %%xmm0     \n\t"
+        "movups        (%1), %%xmm1     \n\t"
+        "shufps $0x1b, %%xmm1, %%xmm1   \n\t"
+        "movaps       %%xmm0, %%xmm2    \n\t"
+        "subps        %%xmm1, %%xmm0    \n\t"
+        "addps        %%xmm1, %%xmm2    \n\t"
+        "shufps $0x1b, %%xmm2, %%xmm2   \n\t"
+        "movups       %%xmm0, (%3,%0)   \n\t"
+        "movups       %%xmm2, (%2)      \n\t"
+        "sub             $16, %1        \n\t"
+        "sub             $16, %2        \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i), "+&r"(p), "+&r"(hi)
+        : "r"(v + 64), "r"(src0 + 64)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+    );
+}
+
+/**
+ * The sums over x[1..37] are computed for all three lags at once, with lag
+ * 0 and 1 in one register and lag 1 and 2 in another. The terms with x[0]
+ * and x[38] are added in C like in the C version.
+ */
+static void sbr_autocorrelate_sse2(const float x[40][2], float phi[3][2][2])
+{
+    float sum[8];
+    x86_reg i = -37 * 8;
+
+    __asm__ volatile(
+        "pcmpeqd      %%xmm5, %%xmm5    \n\t"
+        "psllq           $63, %%xmm5    \n\t"
+        "xorps        %%xmm6, %%xmm6    \n\t"
+        "xorps        %%xmm7, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups     (%2,%0), %%xmm2     \n\t"
+        "movups    8(%2,%0), %%xmm3     \n\t"
+        "movaps       %%xmm2, %%xmm0    \n\t"
+        "movaps       %%xmm2, %%xmm1    \n\t"
+        "shufps $0x00, %%xmm0, %%xmm0   \n\t"
+        "shufps $0x55, %%xmm1, %%xmm1   \n\t"
+        "movaps       %%xmm2, %%xmm4    \n\t"
+        "shufps $0xb1, %%xmm4, %%xmm4   \n\t"
+        "mulps        %%xmm0, %%xmm2    \n\t"
+        "mulps        %%xmm1, %%xmm4    \n\t"
+        "xorps        %%xmm5, %%xmm4    \n\t"
+        "addps        %%xmm4, %%xmm2    \n\t"
+        "addps        %%xmm2, %%xmm6    \n\t"
+        "movaps       %%xmm3, %%xmm4    \n\t"
+        "shufps $0xb1, %%xmm4, %%xmm4   \n\t"
+        "mulps        %%xmm0, %%xmm3    \n\t"
+        "mulps        %%xmm1, %%xmm4    \n\t"
+        "xorps        %%xmm5, %%xmm4    \n\t"
+        "addps        %%xmm4, %%xmm3    \n\t"
+        "addps        %%xmm3, %%xmm7    \n\t"
+        "add              $8, %0        \n\t"
+        " js              1b            \n\t"
+        "movups       %%xmm6,   (%1)    \n\t"
+        "movups       %%xmm7, 16(%1)    \n\t"
+        : "+&r"(i)
+        : "r"(sum), "r"(x[38])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+
+    phi[2][1][0] = sum[0] + x[ 0][0] * x[ 0][0] + x[ 0][1] * x[ 0][1];
+    phi[1][0][0] = sum[0] + x[38][0] * x[38][0] + x[38][1] * x[38][1];
+    phi[1][1][0] = sum[4] + x[ 0][0] * x[ 1][0] + x[ 0][1] * x[ 1][1];
+    phi[1][1][1] = sum[5] + x[ 0][0] * x[ 1][1] - x[ 0][1] * x[ 1][0];
+    phi[0][0][0] = sum[4] + x[38][0] * x[39][0] + x[38][1] * x[39][1];
+    phi[0][0][1] = sum[5] + x[38][0] * x[39][1] - x[38][1] * x[39][0];
+    phi[0][1][0] = sum[6] + x[ 0][0] * x[ 2][0] + x[ 0][1] * x[ 2][1];
+    phi[0][1][1] = sum[7] + x[ 0][0] * x[ 2][1] - x[ 0][1] * x[ 2][0];
+}
+
+static void sbr_hf_gen_sse2(float (*X_high)[2], const float (*X_low)[2],
+                           const float alpha[4], int start, int end)
+{
+    x86_reg i = 8 * (x86_reg)(start - end);
+
+    if (start >= end)
+        return;
+
+    __asm__ volatile(
+        "movups         (%3), %%xmm7    \n\t"
+        "pcmpeqd      %%xmm3, %%xmm3    \n\t"
+        "psrlq           $63, %%xmm3    \n\t"
+        "pslld           $31, %%xmm3    \n\t"
+        "movaps       %%xmm7, %%xmm4    \n\t"
+        "movaps       %%xmm7, %%xmm5    \n\t"
+        "movaps       %%xmm7, %%xmm6    \n\t"
+        "shufps $0x00, %%xmm4, %%xmm4   \n\t"
+        "shufps $0x55, %%xmm5, %%xmm5   \n\t"
+        "shufps $0xaa, %%xmm6, %%xmm6   \n\t"
+        "shufps $0xff, %%xmm7, %%xmm7   \n\t"
+        "xorps        %%xmm3, %%xmm5    \n\t"
+        "xorps        %%xmm3, %%xmm7    \n\t"
+        "1:                             \n\t"
+        "movups  -16(%2,%0), %%xmm0     \n\t"
+        "movups   -8(%2,%0), %%xmm1     \n\t"
+        "movaps       %%xmm0, %%xmm2    \n\t"
+        "shufps $0xb1, %%xmm2, %%xmm2   \n\t"
+        "mulps        %%xmm4, %%xmm0    \n\t"
+        "mulps        %%xmm5, %%xmm2    \n\t"
+        "addps        %%xmm2, %%xmm0    \n\t"
+        "movaps       %%xmm1, %%xmm2    \n\t"
+        "shufps $0xb1, %%xmm2, %%xmm2   \n\t"
+        "mulps        %%xmm6, %%xmm1    \n\t"
+        "mulps        %%xmm7, %%xmm2    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "movups     (%2,%0), %%xmm1     \n\t"
+        "addps        %%xmm2, %%xmm0    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "movups       %%xmm0, (%1,%0)   \n\t"
+        "add             $16, %0        \n\t"
+        " js              1b            \n\t"
+        : "+&r"(i)
+        : "r"(X_high + end), "r"(X_low + end), "r"(alpha)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+static void sbr_hf_g_filt_sse2(float (*Y)[2], const float (*X_high)[40][2],
+                              const float *g_filt, int m_max, int ixh)
+{
+    const float *x = X_high[0][ixh];
+    x86_reg i = -4 * (x86_reg)(m_max & ~1);
+
+    if (i) {
+        __asm__ volatile(
+            "1:                             \n\t"
+            "movsd          (%1), %%xmm0    \n\t"
+            "movhps      320(%1), %%xmm0    \n\t"
+            "movsd      (%3,%0), %%xmm1     \n\t"
+            "unpcklps     %%xmm1, %%xmm1    \n\t"
+            "mulps        %%xmm1, %%xmm0    \n\t"
+            "movups       %%xmm0, (%2,%0,2) \n\t"
+            "add            $640, %1        \n\t"
+            "add              $8, %0        \n\t"
+            " js              1b            \n\t"
+            : "+&r"(i), "+&r"(x)
+            : "r"(Y + (m_max & ~1)), "r"(g_filt + (m_max & ~1))
+            : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+        );
+    }
+    if (m_max & 1) {
+        Y[m_max - 1][0] = x[0] * g_filt[m_max - 1];
+        Y[m_max - 1][1] = x[1] * g_filt[m_max - 1];
+    }
+}
+
+/**
+ * Two subbands per iteration. Both the sinusoid and the noise are
+ * computed and the one the C version adds is selected by s_m != 0.
+ */
+static void sbr_hf_apply_noise_sse2(float (*Y)[2], const float *s_m,
+                                   const float *q_filt,
+                                   const float (*noise_table)[2], int noise,
+                                   int phi_re, int phi_im, int m_max)
+{
+    const float phi[4] = { phi_re, phi_im, phi_re, -phi_im };
+    x86_reg m = 0, n = noise, pairs = m_max & ~1;
+
+    if (pairs) {
+        __asm__ volatile(
+            "movups           %7, %%xmm7    \n\t"
+            "xorps        %%xmm6, %%xmm6    \n\t"
+            "1:                             \n\t"
+            "movsd      (%3,%0,4), %%xmm0   \n\t"
+            "movsd      (%4,%0,4), %%xmm1   \n\t"
+            "unpcklps     %%xmm0, %%xmm0    \n\t"
+            "unpcklps     %%xmm1, %%xmm1    \n\t"
+            "add              $1, %1        \n\t"
+            "and          $0x1ff, %1        \n\t"
+            "movsd      (%5,%1,8), %%xmm2   \n\t"
+            "add              $1, %1        \n\t"
+            "and          $0x1ff, %1        \n\t"
+            "movhps     (%5,%1,8), %%xmm2   \n\t"
+            "mulps        %%xmm1, %%xmm2    \n\t"
+            "movaps       %%xmm0, %%xmm3    \n\t"
+            "mulps        %%xmm7, %%xmm3    \n\t"
+            "cmpneqps     %%xmm6, %%xmm0    \n\t"
+            "andps        %%xmm0, %%xmm3    \n\t"
+            "andnps       %%xmm2, %%xmm0    \n\t"
+            "orps         %%xmm3, %%xmm0    \n\t"
+            "movups     (%2,%0,8), %%xmm1   \n\t"
+            "addps        %%xmm0, %%xmm1    \n\t"
+            "movups       %%xmm1, (%2,%0,8) \n\t"
+            "add              $2, %0        \n\t"
+            "cmp              %6, %0        \n\t"
+            " jl              1b            \n\t"
+            : "+&r"(m), "+&r"(n)
+            : "r"(Y), "r"(s_m), "r"(q_filt), "r"(noise_table),
+              "m"(pairs), "m"(*(const float (*)[4])phi)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm6", "%xmm7",) "memory"
+        );
+    }
+    if (m_max & 1) {
+        n = (n + 1) & 0x1ff;
+        m = m_max - 1;
+        if (s_m[m]) {
+            Y[m][0] += s_m[m] * phi_re;
+            Y[m][1] += s_m[m] * phi_im;
+        } else {
+            Y[m][0] += q_filt[m] * noise_table[n][0];
+            Y[m][1] += q_filt[m] * noise_table[n][1];
+        }
+    }
+}
+
+av_cold void ff_sbrdsp_init_x86(SBRDSPContext *s)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE) {
+        s->sum64x5          = sbr_sum64x5_sse;
+        s->qmf_deint_bfly   = sbr_qmf_deint_bfly_sse;
+    }
+    if (mm_flags & AV_CPU_FLAG_SSE2) {
+        s->qmf_pre_shuffle  = sbr_qmf_pre_shuffle_sse2;
+        s->qmf_post_shuffle = sbr_qmf_post_shuffle_sse2;
+        s->neg_odd_64       = sbr_neg_odd_64_sse2;
+        s->qmf_deint_neg    = sbr_qmf_deint_neg_sse2;
+        s->autocorrelate    = sbr_autocorrelate_sse2;
+        s->hf_gen           = sbr_hf_gen_sse2;
+        s->hf_g_filt        = sbr_hf_g_filt_sse2;
+        s->hf_apply_noise   = sbr_hf_apply_noise_sse2;
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * SSE2 start code candidate search
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/h264dsp.h"
+
+/* checks 32 bytes per iteration, only whole blocks inside buf are read */
+static int startcode_find_candidate_sse2(const uint8_t *buf, int size)
+{
+    x86_reg i = 0, mask, tmp;
+
+    if (size >= 32)
+    __asm__ volatile(
+        "pxor          %%xmm7, %%xmm7   \n\t"
+        "1:                             \n\t"
+        "movdqu      (%3,%0), %%xmm0    \n\t"
+        "movdqu    16(%3,%0), %%xmm1    \n\t"
+        "pcmpeqb       %%xmm7, %%xmm0   \n\t"
+        "pcmpeqb       %%xmm7, %%xmm1   \n\t"
+        "movdqa        %%xmm0, %%xmm2   \n\t"
+        "por           %%xmm1, %%xmm2   \n\t"
+        "pmovmskb      %%xmm2, %k1      \n\t"
+        "test             %k1, %k1      \n\t"
+        " jnz               2f          \n\t"
+        "add              $32, %0       \n\t"
+        "cmp               %4, %0       \n\t"
+        " jle               1b          \n\t"
+        " jmp               3f          \n\t"
+        "2:                             \n\t"
+        "pmovmskb      %%xmm0, %k1      \n\t"
+        "pmovmskb      %%xmm1, %k2      \n\t"
+        "shl              $16, %k2      \n\t"
+        "or               %k2, %k1      \n\t"
+        "bsf              %k1, %k1      \n\t"
+        "add               %1, %0       \n\t"
+        "3:                             \n\t"
+        : "+&r"(i), "=&r"(mask), "=&r"(tmp)
+        : "r"(buf), "r"((x86_reg)size - 32)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",) "memory"
+    );
+
+    for (; i < size; i++)
+        if (!buf[i])
+            break;
+    return i;
+}
+
+void ff_h264dsp_startcode_init_x86(H264DSPContext *c)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE2)
+        c->startcode_find_candidate = startcode_find_candidate_sse2;
+}
@@ -499,6 +499,7 @@ SECTION .note.GNU-stack noalloc noexec nowrite progbits
 %endmacro
 
 %macro INIT_MMX 0
+    %assign avx_enabled 0
     %define RESET_MM_PERMUTATION INIT_MMX
     %define mmsize 8
     %define num_mmregs 8
@@ -520,6 +521,7 @@ SECTION .note.GNU-stack noalloc noexec nowrite progbits
 %endmacro
 
 %macro INIT_XMM 0
+    %assign avx_enabled 0
     %define RESET_MM_PERMUTATION INIT_XMM
     %define mmsize 16
     %define num_mmregs 8
@@ -538,6 +540,14 @@ SECTION .note.GNU-stack noalloc noexec nowrite progbits
     %endrep
 %endmacro
 
+; Same registers as INIT_XMM, but instructions wrapped by AVX_INSTR below are
+; emitted in their VEX-encoded 3-operand form.
+%macro INIT_AVX 0
+    INIT_XMM
+    %assign avx_enabled 1
+    %define RESET_MM_PERMUTATION INIT_AVX
+%endmacro
+
 INIT_MMX
 
 ; I often want to use macros that permute their arguments. e.g. there's no
@@ -645,3 +655,134 @@ INIT_MMX
         sub %1, %2
     %endif
 %endmacro
+
+;=============================================================================
+; AVX abstraction layer
+;=============================================================================
+
+%assign i 0
+%rep 16
+    %if i < 8
+        CAT_XDEFINE sizeofmm, i, 8
+    %endif
+    CAT_XDEFINE sizeofxmm, i, 16
+%assign i i+1
+%endrep
+%undef i
+
+; Any instruction wrapped below may be given an extra source operand, e.g.
+; "paddw m0, m1, m2". With INIT_AVX this is emitted as vpaddw, otherwise as
+; a register copy into m0 (if needed) followed by the 2-operand form.
+; Plain 2-operand uses are emitted unchanged, except that with INIT_AVX they
+; are VEX-encoded as well.
+;%1 == instruction
+;%2 == 1 if float, 0 if int
+;%3 == 1 if the instruction takes a trailing immediate, 0 otherwise
+;%4 == number of operands given
+;%5+: operands
+%macro RUN_AVX_INSTR 6-7+
+    %if %4 >= 3+%3
+        %if avx_enabled && sizeof%5 == 16
+            v%1 %5, %6, %7
+        %else
+            %ifnidn %5, %6
+                %if sizeof%5 == 8
+                    movq %5, %6
+                %elif %2
+                    movaps %5, %6
+                %else
+                    movdqa %5, %6
+                %endif
+            %endif
+            %1 %5, %7
+        %endif
+    %elif avx_enabled && sizeof%5 == 16
+        %if %3
+            v%1 %5, %5, %6, %7
+        %else
+            v%1 %5, %5, %6
+        %endif
+    %elif %3
+        %1 %5, %6, %7
+    %else
+        %1 %5, %6
+    %endif
+%endmacro
+
+;%1 == instruction
+;%2 == 1 if float, 0 if int
+;%3 == 1 if the instruction takes a trailing immediate, 0 otherwise
+%macro AVX_INSTR 3
+    %macro %1 2-7 fnord, fnord, %1, %2, %3
+        %ifidn %3, fnord
+            RUN_AVX_INSTR %5, %6, %7, 2, %1, %2
+        %elifidn %4, fnord
+            RUN_AVX_INSTR %5, %6, %7, 3, %1, %2, %3
+        %else
+            RUN_AVX_INSTR %5, %6, %7, 4, %1, %2, %3, %4
+        %endif
+    %endmacro
+%endmacro
+
+AVX_INSTR packssdw, 0, 0
+AVX_INSTR packsswb, 0, 0
+AVX_INSTR packuswb, 0, 0
+AVX_INSTR paddb, 0, 0
+AVX_INSTR paddw, 0, 0
+AVX_INSTR paddd, 0, 0
+AVX_INSTR paddq, 0, 0
+AVX_INSTR paddsb, 0, 0
+AVX_INSTR paddsw, 0, 0
+AVX_INSTR paddusb, 0, 0
+AVX_INSTR paddusw, 0, 0
+AVX_INSTR palignr, 0, 1
+AVX_INSTR pand, 0, 0
+AVX_INSTR pandn, 0, 0
+AVX_INSTR pavgb, 0, 0
+AVX_INSTR pavgw, 0, 0
+AVX_INSTR pcmpeqb, 0, 0
+AVX_INSTR pcmpeqw, 0, 0
+AVX_INSTR pcmpeqd, 0, 0
+AVX_INSTR pcmpgtb, 0, 0
+AVX_INSTR pcmpgtw, 0, 0
+AVX_INSTR pcmpgtd, 0, 0
+AVX_INSTR pmaddwd, 0, 0
+AVX_INSTR pmaddubsw, 0, 0
+AVX_INSTR pmaxsw, 0, 0
+AVX_INSTR pmaxub, 0, 0
+AVX_INSTR pminsw, 0, 0
+AVX_INSTR pminub, 0, 0
+AVX_INSTR pmulhuw, 0, 0
+AVX_INSTR pmulhrsw, 0, 0
+AVX_INSTR pmulhw, 0, 0
+AVX_INSTR pmullw, 0, 0
+AVX_INSTR por, 0, 0
+AVX_INSTR psadbw, 0, 0
+AVX_INSTR pshufb, 0, 0
+AVX_INSTR psllw, 0, 0
+AVX_INSTR pslld, 0, 0
+AVX_INSTR psllq, 0, 0
+AVX_INSTR pslldq, 0, 0
+AVX_INSTR psraw, 0, 0
+AVX_INSTR psrad, 0, 0
+AVX_INSTR psrlw, 0, 0
+AVX_INSTR psrld, 0, 0
+AVX_INSTR psrlq, 0, 0
+AVX_INSTR psrldq, 0, 0
+AVX_INSTR psubb, 0, 0
+AVX_INSTR psubw, 0, 0
+AVX_INSTR psubd, 0, 0
+AVX_INSTR psubq, 0, 0
+AVX_INSTR psubsb, 0, 0
+AVX_INSTR psubsw, 0, 0
+AVX_INSTR psubusb, 0, 0
+AVX_INSTR psubusw, 0, 0
+AVX_INSTR punpckhbw, 0, 0
+AVX_INSTR punpckhwd, 0, 0
+AVX_INSTR punpckhdq, 0, 0
+AVX_INSTR punpckhqdq, 0, 0
+AVX_INSTR punpcklbw, 0, 0
+AVX_INSTR punpcklwd, 0, 0
+AVX_INSTR punpckldq, 0, 0
+AVX_INSTR punpcklqdq, 0, 0
+AVX_INSTR pxor, 0, 0
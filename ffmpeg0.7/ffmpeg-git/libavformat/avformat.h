@@ -46,6 +46,7 @@ FFMPEGLIB_API const char *avformat_license(void);
 #include <time.h>
 #include <stdio.h>  /* FILE */
 #include "libavcodec/avcodec.h"
+#include "libavutil/time.h"
 
 #include "avio.h"
 #include "libavformat/version.h"
@@ -1525,11 +1526,6 @@ attribute_deprecated
 FFMPEGLIB_API int64_t parse_date(const char *datestr, int duration);
 #endif
 
-/**
- * Get the current time in microseconds.
- */
-FFMPEGLIB_API int64_t av_gettime(void);
-
 #if FF_API_FIND_INFO_TAG
 /**
  * @deprecated use av_find_info_tag in libavutil instead.
@@ -3464,63 +3464,6 @@ int parse_frame_rate(int *frame_rate_num, int *frame_rate_den, const char *arg)
 }
 #endif
 
-
-
-//
-//#if defined(_MSC_VER) || defined(_WINDOWS_)
-//#include <time.h>
-//#if !defined(_WINSOCK2API_) && !defined(_WINSOCKAPI_)
-//struct timeval 
-//{
-//	long tv_sec;
-//	long tv_usec;
-//};
-//#endif 
-//#else
-//#include <sys/time.h>
-//#endif 
-//#if defined(_MSC_VER) || defined(_WINDOWS_)
-//static int gettimeofday(struct timeval* tv) 
-//{
-//	union {
-//		long long ns100;
-//		FILETIME ft;
-//	} now;
-//
-//	GetSystemTimeAsFileTime (&now.ft);
-//	tv->tv_usec = (long) ((now.ns100 / 10LL) % 1000000LL);
-//	tv->tv_sec = (long) ((now.ns100 - 116444736000000000LL) / 10000000LL);
-//	return (0);
-//}
-//#endif
-
-
-#include <time.h>
-
-typedef union 
-{
-	long long ns100;
-	FILETIME ft;
-} NOWTime;
-static int gettimeofday(struct timeval* tv) 
-{
-	NOWTime now;
-
-	GetSystemTimeAsFileTime (&now.ft);
-	tv->tv_usec = (long) ((now.ns100 / 10LL) % 1000000LL);
-	tv->tv_sec = (long) ((now.ns100 - 116444736000000000LL) / 10000000LL);
-	return (0);
-}
-
-
-
-int64_t av_gettime(void)
-{
-    struct timeval tv;
-    gettimeofday(&tv,NULL);
-    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
-}
-
 uint64_t ff_ntp_time(void)
 {
   return (av_gettime() / 1000) * 1000 + NTP_OFFSET_US;
@@ -28,7 +28,9 @@ int av_get_cpu_flags(void)
 
     //if (ARCH_ARM) flags = ff_get_cpu_flags_arm();
     //if (ARCH_PPC) flags = ff_get_cpu_flags_ppc();
-    //if (ARCH_X86) flags = ff_get_cpu_flags_x86();
+#if ARCH_X86
+    flags = ff_get_cpu_flags_x86();
+#endif
 
     checked = 1;
     return flags;
@@ -20,8 +20,8 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
 #include "timer.h"
-#include "time.h"
 #include "random_seed.h"
 #include "avutil.h"
 
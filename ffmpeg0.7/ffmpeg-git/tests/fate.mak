@@ -40,6 +40,9 @@ FATE_TESTS += fate-cljr
 fate-cljr: CMD = framecrc  -i $(SAMPLES)/cljr/testcljr-partial.avi
 FATE_TESTS += fate-corepng
 fate-corepng: CMD = framecrc  -i $(SAMPLES)/png1/corepng-partial.avi
+FATE_TESTS += fate-corepng-mt
+fate-corepng-mt: CMD = framecrc  -threads 4 -i $(SAMPLES)/png1/corepng-partial.avi
+fate-corepng-mt: REF = $(SRC_PATH)/tests/ref/fate/corepng
 FATE_TESTS += fate-creative-adpcm
 fate-creative-adpcm: CMD = md5  -i $(SAMPLES)/creative/intro-partial.wav -f s16le
 FATE_TESTS += fate-creative-adpcm-8-2.6bit
@@ -324,6 +327,9 @@ FATE_TESTS += fate-v210
 fate-v210: CMD = framecrc  -i $(SAMPLES)/v210/v210_720p-partial.avi -pix_fmt yuv422p16be -an
 FATE_TESTS += fate-vc1
 fate-vc1: CMD = framecrc  -i $(SAMPLES)/vc1/SA00040.vc1
+FATE_TESTS += fate-vc1-mt
+fate-vc1-mt: CMD = framecrc  -threads 4 -i $(SAMPLES)/vc1/SA00040.vc1
+fate-vc1-mt: REF = $(SRC_PATH)/tests/ref/fate/vc1
 FATE_TESTS += fate-vcr1
 fate-vcr1: CMD = framecrc  -i $(SAMPLES)/vcr1/VCR1test.avi -an
 FATE_TESTS += fate-video-xl
@@ -26,3 +26,14 @@ FATE_TESTS += $(FATE_AAC)
 fate-aac: $(FATE_AAC)
 $(FATE_AAC): CMP = oneoff
 $(FATE_AAC): FUZZ = 2
+
+FATE_AAC_DSP = fate-sbrdsp fate-psdsp
+
+fate-sbrdsp: libavcodec/sbrdsp-test$(EXESUF)
+fate-sbrdsp: CMD = run libavcodec/sbrdsp-test
+fate-psdsp:  libavcodec/psdsp-test$(EXESUF)
+fate-psdsp:  CMD = run libavcodec/psdsp-test
+
+FATE_TESTS += $(FATE_AAC_DSP)
+fate-aac: $(FATE_AAC_DSP)
+$(FATE_AAC_DSP): REF = /dev/null
@@ -341,3 +341,17 @@ fate-h264-conformance-sva_nl2_e: CMD = framecrc  -i $(SAMPLES)/h264-conformance/
 fate-h264-interlace-crop: CMD = framecrc  -vframes 3 -i $(SAMPLES)/h264/interlaced_crop.mp4
 fate-h264-lossless: CMD = framecrc -i $(SAMPLES)/h264/lossless.h264
 fate-h264-extreme-plane-pred: CMD = framemd5 -strict 1 -vsync 0 -i $(SAMPLES)/h264/extreme-plane-pred.h264
+
+FATE_H264_PIPELINE = fate-h264-pipeline-ba_mw_d                         \
+                     fate-h264-pipeline-caba3_toshiba_e                 \
+                     fate-h264-pipeline-cabac_mot_picaff0_full          \
+
+FATE_TESTS += $(FATE_H264_PIPELINE)
+fate-h264-pipeline: $(FATE_H264_PIPELINE)
+
+fate-h264-pipeline-ba_mw_d: CMD = framecrc  -threads 2 -thread_type slice+pipeline -i $(SAMPLES)/h264-conformance/BA_MW_D.264
+fate-h264-pipeline-ba_mw_d: REF = $(SRC_PATH_BARE)/tests/ref/fate/h264-conformance-ba_mw_d
+fate-h264-pipeline-caba3_toshiba_e: CMD = framecrc  -threads 2 -thread_type frame+pipeline -i $(SAMPLES)/h264-conformance/CABA3_TOSHIBA_E.264
+fate-h264-pipeline-caba3_toshiba_e: REF = $(SRC_PATH_BARE)/tests/ref/fate/h264-conformance-caba3_toshiba_e
+fate-h264-pipeline-cabac_mot_picaff0_full: CMD = framecrc  -vsync 0 -strict 1 -threads 2 -thread_type frame+pipeline -i $(SAMPLES)/h264-conformance/camp_mot_picaff0_full.26l
+fate-h264-pipeline-cabac_mot_picaff0_full: REF = $(SRC_PATH_BARE)/tests/ref/fate/h264-conformance-cabac_mot_picaff0_full
@@ -37,6 +37,10 @@ fate-ra-cook: REF = $(SAMPLES)/real/ra_cook.pcm
 FATE_TESTS += fate-mpeg2-field-enc
 fate-mpeg2-field-enc: CMD = framecrc -flags +bitexact -dct fastint -idct simple -i $(SAMPLES)/mpeg2/mpeg2_field_encoding.ts -an
 
+FATE_TESTS += fate-mpeg2-field-enc-mt
+fate-mpeg2-field-enc-mt: CMD = framecrc -flags +bitexact -dct fastint -idct simple -threads 4 -i $(SAMPLES)/mpeg2/mpeg2_field_encoding.ts -an
+fate-mpeg2-field-enc-mt: REF = $(SRC_PATH)/tests/ref/fate/mpeg2-field-enc
+
 FATE_TESTS += fate-qcelp
 fate-qcelp: CMD = pcm -i $(SAMPLES)/qcp/0036580847.QCP
 fate-qcelp: CMP = oneoff
@@ -217,6 +221,21 @@ FATE_TESTS += fate-sha
 fate-sha: libavutil/sha-test$(EXESUF)
 fate-sha: CMD = run libavutil/sha-test
 
+FATE_TESTS += fate-resample2
+fate-resample2: libavcodec/resample2-test$(EXESUF)
+fate-resample2: CMD = run libavcodec/resample2-test
+fate-resample2: REF = /dev/null
+
+FATE_TESTS += fate-audioconvert
+fate-audioconvert: libavcodec/audioconvert-test$(EXESUF)
+fate-audioconvert: CMD = run libavcodec/audioconvert-test
+fate-audioconvert: REF = /dev/null
+
+FATE_TESTS += fate-mpegvideo-enc-mt
+fate-mpegvideo-enc-mt: libavcodec/mpegvideo_enc-test$(EXESUF)
+fate-mpegvideo-enc-mt: CMD = run libavcodec/mpegvideo_enc-test
+fate-mpegvideo-enc-mt: REF = /dev/null
+
 FATE_TESTS += fate-musepack7
 fate-musepack7: CMD = pcm -i $(SAMPLES)/musepack/inside-mp7.mpc
 fate-musepack7: CMP = oneoff
@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# Measure H.264 (CABAC) decoding speed over a range of bitrates.
+#
+# usage: h264_bitrate_sweep.sh <input> [kbit/s ...]
+#
+# The input is encoded with libx264 at each of the given bitrates and the
+# user time needed to decode the result is printed. The ffmpeg binary to use
+# can be set with FFMPEG, the number of frames with FRAMES.
+
+FFMPEG=${FFMPEG:-./ffmpeg}
+FRAMES=${FRAMES:-250}
+
+test $# -ge 1 || { echo "usage: $0 <input> [kbit/s ...]"; exit 1; }
+INPUT=$1
+shift
+RATES=${*:-2000 5000 10000 20000 40000 60000}
+
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf $TMP' EXIT
+
+printf "%10s %10s %10s %10s\n" "kbit/s" "size kB" "utime s" "fps"
+for rate in $RATES; do
+    OUT=$TMP/$rate.h264
+    $FFMPEG -v 0 -y -i "$INPUT" -an -vframes $FRAMES -vcodec libx264 \
+        -preset fast -b ${rate}k -threads 1 $OUT </dev/null || exit 1
+    UTIME=$($FFMPEG -benchmark -threads 1 -i $OUT -f null - </dev/null 2>/dev/null |
+            sed -n 's/^bench: utime=\([0-9.]*\)s.*/\1/p')
+    SIZE=$(( $(wc -c < $OUT) / 1024 ))
+    printf "%10s %10s %10s %10s\n" $rate $SIZE $UTIME \
+        $(echo "$FRAMES $UTIME" | awk '{ printf "%.1f", ($2 > 0 ? $1 / $2 : 0) }')
+done